@@ -153,7 +153,7 @@ class Adafruit_RA8875_R : public Adafruit_RA8875 {
         char getChar(void) {
             return (0);
         }
-        void setEarthPix (char *day_pixels, char *night_pixels);
+        bool setEarthPix (char *day_pixels, char *night_pixels);
 #endif
 
 };
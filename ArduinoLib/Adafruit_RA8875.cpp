@@ -13,7 +13,8 @@
  * periodically copied to fb_stage on change. _USE_FB0 uses a third copy fb_cursor in which to draw cursor.
  * FB_X0 and FB_Y0 are the upper left coords on the hardware of drawing area FB_YRES x FB_XRES.
  *
- * Earth map pixels area mmap'd from local day and night files.
+ * Earth map pixels area mmap'd from local day and night files then copied into a tiled layout, see
+ * makeTiledEarth().
  * 
  * This class assumes the original ESP Arduino code was drawing onto a canvas 800w x 480h, set by APP_WIDTH
  * and APP_HEIGHT. If it weren't for fonts and the Earth map this could be scaled rather easily to any size.
@@ -37,9 +38,13 @@
 #include <sys/mman.h>
 
 #include "Adafruit_RA8875.h"
+#include "Arduino.h"
 
 uint32_t spi_speed;
 
+// microseconds from struct timespec a to b
+#define _TS_US(a,b) ((uint32_t)(((b).tv_sec - (a).tv_sec)*1000000L + ((b).tv_nsec - (a).tv_nsec)/1000))
+
 Adafruit_RA8875::Adafruit_RA8875(uint8_t CS, uint8_t RST)
 {
 	// emulate a bug in the real RA8875 whereby the very first pixel read back is bogus
@@ -51,19 +56,137 @@ Adafruit_RA8875::Adafruit_RA8875(uint8_t CS, uint8_t RST)
         // insure earth map pointers are NULL until set
         DEARTH_BIG = NULL;
         NEARTH_BIG = NULL;
+        earth_tiled = false;
+
+        // no frames yet
+        pthread_mutex_init (&frame_lock, NULL);
+        n_frame_stats = 0;
+        n_frames_lost = 0;
+        stage_upload_us = 0;
+        stage_dirty_px = 0;
+        dirty_ts.tv_sec = 0;
+        dirty_ts.tv_nsec = 0;
+
+}
+
+/* return a copy of the given row-major earth map rearranged into EARTH_TILE_SZ square tiles, or NULL if
+ * no memory. the copy is anonymous memory so we can ask for huge pages and have it faulted in now,
+ * not scattered through the first map sweep.
+ */
+uint16_t *Adafruit_RA8875::makeTiledEarth (const uint16_t *flat)
+{
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_POPULATE)
+        flags |= MAP_POPULATE;
+#endif
+        void *mem = mmap (NULL, EARTH_TILED_NBYTES, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (mem == MAP_FAILED) {
+            printf ("tiled earth mmap(%d): %s\n", EARTH_TILED_NBYTES, strerror(errno));
+            return (NULL);
+        }
+#if defined(MADV_HUGEPAGE)
+        // just a hint, fine if transparent huge pages are not enabled
+        (void) madvise (mem, EARTH_TILED_NBYTES, MADV_HUGEPAGE);
+#endif
+
+        // copy by source rows so the file is read sequentially, padding tiles beyond the edges remain 0
+        uint16_t *tiled = (uint16_t *) mem;
+        for (int ey = 0; ey < EARTH_BIG_H; ey++) {
+            const uint16_t *src = &flat[ey*EARTH_BIG_W];
+            for (int tx = 0; tx < EARTH_TILES_W; tx++) {
+                int ex0 = tx << EARTH_TILE_SHIFT;
+                int n = EARTH_BIG_W - ex0;
+                if (n > EARTH_TILE_SZ)
+                    n = EARTH_TILE_SZ;
+                int tile = (ey>>EARTH_TILE_SHIFT)*EARTH_TILES_W + tx;
+                uint16_t *dst = &tiled[(tile<<(2*EARTH_TILE_SHIFT)) | ((ey&EARTH_TILE_MASK)<<EARTH_TILE_SHIFT)];
+                memcpy (dst, &src[ex0], n*sizeof(uint16_t));
+            }
+        }
+
+        return (tiled);
+}
 
+/* release any tiled earth maps and fall back to none.
+ */
+void Adafruit_RA8875::freeTiledEarth()
+{
+        if (earth_tiled) {
+            if (DEARTH_BIG)
+                munmap (DEARTH_BIG, EARTH_TILED_NBYTES);
+            if (NEARTH_BIG)
+                munmap (NEARTH_BIG, EARTH_TILED_NBYTES);
+            earth_tiled = false;
+        }
+        DEARTH_BIG = NULL;
+        NEARTH_BIG = NULL;
 }
 
-void Adafruit_RA8875::setEarthPix (char *day_pixels, char *night_pixels)
+/* install the given row-major day and night earth maps, either may be NULL to indicate none.
+ * return whether the pixels were copied, in which case the caller may unmap them after we return,
+ * else they are used in place and must remain until the next call.
+ */
+bool Adafruit_RA8875::setEarthPix (char *day_pixels, char *night_pixels)
 {
-        DEARTH_BIG = (uint16_t(*)[EARTH_BIG_H][EARTH_BIG_W]) day_pixels;
-        NEARTH_BIG = (uint16_t(*)[EARTH_BIG_H][EARTH_BIG_W]) night_pixels;
+        freeTiledEarth();
+
+#if !defined(_UNTILED_EARTH)
+        if (day_pixels && night_pixels) {
+            uint16_t *day_tiled = makeTiledEarth ((uint16_t *)day_pixels);
+            uint16_t *night_tiled = day_tiled ? makeTiledEarth ((uint16_t *)night_pixels) : NULL;
+            if (day_tiled && night_tiled) {
+                DEARTH_BIG = day_tiled;
+                NEARTH_BIG = night_tiled;
+                earth_tiled = true;
+                return (true);
+            }
+            // fall back to using the files as-is
+            if (day_tiled)
+                munmap (day_tiled, EARTH_TILED_NBYTES);
+        }
+#endif // !_UNTILED_EARTH
 
+        DEARTH_BIG = (uint16_t *) day_pixels;
+        NEARTH_BIG = (uint16_t *) night_pixels;
+        return (false);
 }
 
 bool Adafruit_RA8875::begin (int x)
 {
 
+#ifdef _USE_BENCH
+
+	// same canvas as X11 but nothing ever displays it
+	fb_si.xres = FB_XRES;
+	fb_si.yres = FB_YRES;
+        SCALESZ = FB_XRES / APP_WIDTH;
+        FB_X0 = 0;
+        FB_Y0 = 0;
+        fb_nbytes = FB_XRES * FB_YRES * BYTESPFBPIX;
+	fb_canvas = (fbpix_t *) calloc (1, fb_nbytes);
+	fb_stage = (fbpix_t *) calloc (1, fb_nbytes);
+	if (!fb_canvas || !fb_stage) {
+	    printf ("Can not malloc(%d) for canvas\n", fb_nbytes);
+	    exit(1);
+	}
+
+	pthread_mutexattr_t fb_attr;
+	pthread_mutexattr_init (&fb_attr);
+	pthread_mutexattr_settype (&fb_attr, PTHREAD_MUTEX_RECURSIVE);
+	if (pthread_mutex_init (&fb_lock, &fb_attr) || pthread_mutex_init (&mouse_lock, NULL)
+                                || pthread_mutex_init (&kb_lock, NULL)) {
+	    printf ("fb_lock: %s\n", strerror(errno));
+	    exit(1);
+	}
+	mouse_downs = mouse_ups = 0;
+	kb_cqhead = kb_cqtail = 0;
+
+	current_font = &Courier_Prime_Sans6pt7b;
+
+	return (true);
+
+#endif // _USE_BENCH
+
 #ifdef _USE_X11
 
 	// connect to X server
@@ -659,7 +782,7 @@ void Adafruit_RA8875::drawPixel(int16_t x, int16_t y, uint16_t color16)
 		    for (uint8_t dy = 0; dy < SCALESZ; dy++)
 			plotfb (x+dx, y+dy, c32);
 	    }
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -676,7 +799,7 @@ void Adafruit_RA8875::drawSubPixel(int16_t x, int16_t y, uint16_t color16)
 	uint32_t c32 = RGB16TOFBPIX(color16);
 	pthread_mutex_lock(&fb_lock);
 	    plotfb (x, y, c32);
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -689,7 +812,7 @@ void Adafruit_RA8875::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, u
 	y1 *= SCALESZ;
 	pthread_mutex_lock(&fb_lock);
 	    plotLine (x0, y0, x1, y1, c32);
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -713,7 +836,7 @@ void Adafruit_RA8875::drawRect(int16_t x0, int16_t y0, int16_t w, int16_t h, uin
 	    plotLine (x0+w, y0, x0+w, y0+h, c32);
 	    plotLine (x0+w, y0+h, x0, y0+h, c32);
 	    plotLine (x0, y0+h, x0, y0, c32);
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -734,7 +857,7 @@ void Adafruit_RA8875::fillRect(int16_t x0, int16_t y0, int16_t w, int16_t h, uin
 	    for (uint16_t y = y0; y < y0+h; y++)
 		for (uint16_t x = x0; x < x0+w; x++)
 		    plotfb (x, y, c32);
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -759,7 +882,7 @@ void Adafruit_RA8875::drawCircle(int16_t x0, int16_t y0, int16_t r0, uint16_t co
 			plotfb (x0+dx/2, y0+dy/2, c32);
                 }
             }
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 
 }
@@ -784,7 +907,7 @@ void Adafruit_RA8875::fillCircle(int16_t x0, int16_t y0, int16_t r0, uint16_t co
 			plotfb (x0+dx/2, y0+dy/2, c32);
                 }
             }
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -802,7 +925,7 @@ void Adafruit_RA8875::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y
 	    plotLine (x0, y0, x1, y1, c32);
 	    plotLine (x1, y1, x2, y2, c32);
 	    plotLine (x2, y2, x0, y0, c32);
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -829,7 +952,7 @@ void Adafruit_RA8875::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y
 		int xrite = x0 + dx*(y-y0)/dy;
 		plotLine (xleft, y, xrite, y, c32);
 	    }
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 }
 
@@ -946,13 +1069,13 @@ float dlatr, float dlngr, float dlatd, float dlngd, float fract_day)
                 ey = (ey + EARTH_BIG_H) % EARTH_BIG_H;
 		uint16_t c16; 
 		if (fract_day == 0) {
-		    c16 = (*NEARTH_BIG)[ey][ex];
+		    c16 = earthPix (NEARTH_BIG, ey, ex);
 		} else if (fract_day == 1) {
-		    c16 = (*DEARTH_BIG)[ey][ex];
+		    c16 = earthPix (DEARTH_BIG, ey, ex);
 		} else {
 		    // blend from day to night
-		    uint16_t day_pix = (*DEARTH_BIG)[ey][ex];
-		    uint16_t night_pix = (*NEARTH_BIG)[ey][ex];
+		    uint16_t day_pix = earthPix (DEARTH_BIG, ey, ex);
+		    uint16_t night_pix = earthPix (NEARTH_BIG, ey, ex);
 		    uint8_t day_r = RGB565_R(day_pix);
 		    uint8_t day_g = RGB565_G(day_pix);
 		    uint8_t day_b = RGB565_B(day_pix);
@@ -988,7 +1111,7 @@ void Adafruit_RA8875::plotChar (char ch)
 		    bitn++;
 		}
 	    }
-	    fb_dirty = true;
+	    markDirty();
 	pthread_mutex_unlock (&fb_lock);
 
 	cursor_x += gp->xAdvance;
@@ -1034,6 +1157,43 @@ char Adafruit_RA8875::getChar()
     return (c);
 }
 
+/* copy up to max_fs metrics of frames presented since the previous call into fs, return count.
+ * also return count of frames whose metrics were lost because we were not called often enough.
+ */
+int Adafruit_RA8875::getFrameStats (FrameStats *fs, int max_fs, uint32_t *n_lost)
+{
+    pthread_mutex_lock (&frame_lock);
+        int n = n_frame_stats < max_fs ? n_frame_stats : max_fs;
+        memcpy (fs, frame_stats, n*sizeof(FrameStats));
+        *n_lost = n_frames_lost + (n_frame_stats - n);
+        n_frame_stats = 0;
+        n_frames_lost = 0;
+    pthread_mutex_unlock (&frame_lock);
+    return (n);
+}
+
+/* save metrics of one frame that started staging at t0, finished staging at t1 and was presented at t2.
+ * drawn is when the first drawing to appear in this frame was done, tv_sec 0 if not known.
+ * setStagingArea() reports in stage_upload_us how much of t0..t1 was actually spent uploading.
+ */
+void Adafruit_RA8875::addFrameStats (const struct timespec &t0, const struct timespec &t1,
+const struct timespec &t2, const struct timespec &drawn)
+{
+    FrameStats f;
+    uint32_t stage_us = _TS_US (t0, t1);
+    f.copy_us = stage_us > stage_upload_us ? stage_us - stage_upload_us : 0;
+    f.upload_us = _TS_US (t1, t2) + stage_upload_us;
+    f.dirty_px = stage_dirty_px;
+    f.latency_us = drawn.tv_sec ? _TS_US (drawn, t2) : 0;
+
+    pthread_mutex_lock (&frame_lock);
+        if (n_frame_stats < N_FRAMESTATS)
+            frame_stats[n_frame_stats++] = f;
+        else
+            n_frames_lost++;
+    pthread_mutex_unlock (&frame_lock);
+}
+
 
 
 
@@ -1064,8 +1224,11 @@ void Adafruit_RA8875::setStagingArea()
         int t_h = FB_YRES/48;                   // tile height
         int bptr = t_w*BYTESPFBPIX;             // bytes per tile row
 
-        // send each changed tile to X server
+        // send each changed tile to X server, timing just the sending
         bool any_change = false;
+        struct timespec u0, u1;
+        stage_upload_us = 0;
+        stage_dirty_px = 0;
         for (int t_y = 0; t_y < FB_YRES; t_y += t_h) {
             for (int t_x = 0; t_x < FB_XRES; t_x += t_w) {
 
@@ -1087,15 +1250,25 @@ void Adafruit_RA8875::setStagingArea()
                 // send changed tile to X server
                 if (tile_changed) {
                     any_change = true;
+                    clock_gettime (CLOCK_MONOTONIC, &u0);
                     XPutImage(display, pixmap, gc, img, t_x, t_y, t_x, t_y, t_w, t_h);
+                    clock_gettime (CLOCK_MONOTONIC, &u1);
+                    stage_upload_us += _TS_US (u0, u1);
+                    stage_dirty_px += t_w*t_h;
                 }
             }
         }
 
         // copy from X server backing store to display if anything changed.
-        // this uses more cpu on server side but looks better than seeing individual tiles change
-        if (any_change)
+        // this uses more cpu on server side but looks better than seeing individual tiles change.
+        // flush now, rather than at the next XPending, so the upload time includes getting it to the server.
+        if (any_change) {
+            clock_gettime (CLOCK_MONOTONIC, &u0);
             XCopyArea(display, pixmap, win, gc, 0, 0, FB_XRES, FB_YRES, FB_X0, FB_Y0);
+            XFlush (display);
+            clock_gettime (CLOCK_MONOTONIC, &u1);
+            stage_upload_us += _TS_US (u0, u1);
+        }
 }
 
 /* thread that runs forever reacting to X11 events and painting fb_canvas whenever it changes
@@ -1141,6 +1314,7 @@ void Adafruit_RA8875::fbThread ()
                                 if (kb_cqtail == sizeof(kb_cq))
                                     kb_cqtail = 0;
                             pthread_mutex_unlock (&kb_lock);
+                            wakeLoop();
                         }
                     }
 		    break;
@@ -1151,6 +1325,7 @@ void Adafruit_RA8875::fbThread ()
 			mouse_y = event.xbutton.y;
 			mouse_downs++;
 		    pthread_mutex_unlock (&mouse_lock);
+		    wakeLoop();
 		    break;
 
 		case ButtonRelease:
@@ -1159,6 +1334,7 @@ void Adafruit_RA8875::fbThread ()
 			mouse_y = event.xbutton.y;
 			mouse_ups++;
 		    pthread_mutex_unlock (&mouse_lock);
+		    wakeLoop();
 		    break;
 
 		case ConfigureNotify:
@@ -1179,7 +1355,12 @@ void Adafruit_RA8875::fbThread ()
 	    // show any changes
             pthread_mutex_lock (&fb_lock);
                 if (fb_dirty || pr_flag) {
+                    struct timespec t0, t1;
+                    clock_gettime (CLOCK_MONOTONIC, &t0);
                     setStagingArea();
+                    clock_gettime (CLOCK_MONOTONIC, &t1);
+                    addFrameStats (t0, t1, t1, dirty_ts);
+                    dirty_ts.tv_sec = 0;
                     fb_dirty = false;
                     pr_flag = 0;
                 }
@@ -1198,6 +1379,7 @@ void Adafruit_RA8875::fbThread ()
                             if (kb_cqtail == sizeof(kb_cq))
                                 kb_cqtail = 0;
                         pthread_mutex_unlock (&kb_lock);
+                        wakeLoop();
                     }
                     kp0 = ts0;
                 }
@@ -1427,6 +1609,7 @@ void Adafruit_RA8875::mouseThread (void)
                         else
                             mouse_ups++;
                         fb_dirty = true;
+                        wakeLoop();
                     }
 
                     if (fb_dirty) {
@@ -1497,6 +1680,7 @@ void Adafruit_RA8875::kbThread ()
                         kb_cqtail = 0;
 		    fb_dirty = true;
 		pthread_mutex_unlock (&kb_lock);
+                wakeLoop();
                 // printf ("KB: %d %c\n", buf[0], buf[0]);
 	    } else {
                 if (nr < 0)
@@ -1535,11 +1719,16 @@ void Adafruit_RA8875::setCursorIfVis (uint16_t row, uint16_t col, fbpix_t color)
  */
 void Adafruit_RA8875::setStagingArea()
 {
+        // nothing is sent to the display here
+        stage_upload_us = 0;
+
         // put only the unproteced region unless pr_flag is set
         if (pr_flag) {
             // draw everything
             memcpy (fb_stage, fb_canvas, fb_nbytes);
+            stage_dirty_px = FB_XRES*FB_YRES;
         } else {
+            stage_dirty_px = FB_XRES*FB_YRES - pr_w*pr_h;
             // draw only around the protected area
             uint16_t bw = FB_XRES*BYTESPFBPIX;                                  // bytes wide
             uint16_t pr_r = pr_x + pr_w;                                        // right of PR
@@ -1570,10 +1759,15 @@ void Adafruit_RA8875::fbThread ()
 	for (;;) {
 
 	    // get stable copy of canvas into staging area
+            struct timespec t0, t1, drawn;
 	    pthread_mutex_lock (&fb_lock);
 		bool is_new = fb_dirty || pr_flag;
 		if (is_new) {
+                    clock_gettime (CLOCK_MONOTONIC, &t0);
                     setStagingArea();
+                    clock_gettime (CLOCK_MONOTONIC, &t1);
+                    drawn = dirty_ts;
+                    dirty_ts.tv_sec = 0;
 		    fb_dirty = false;
                     pr_flag = 0;
 		}
@@ -1632,6 +1826,13 @@ void Adafruit_RA8875::fbThread ()
 
                 // black bottom border
                 memset (fb_fb+(FB_Y0+FB_YRES)*fb_si.xres, 0, FB_Y0*fb_rowbytes);
+
+                // record new frames, not just cursor refreshes
+                if (is_new) {
+                    struct timespec t2;
+                    clock_gettime (CLOCK_MONOTONIC, &t2);
+                    addFrameStats (t0, t1, t2, drawn);
+                }
             }
 
 	    // no need to go crazy
@@ -1,4 +1,5 @@
 /* this is the same as Adafruit_RA8875 but runs on Rasp Pi using /dev/fb0 or any UNIX using X Windows.
+ * _USE_BENCH draws only into memory for the benchmark harness.
  * N.B. we only remimplented the functions we use, we may have missed a few.
  */
 
@@ -9,6 +10,7 @@
 
 #include <stdint.h>
 #include <pthread.h>
+#include <time.h>
 
 #ifdef _USE_X11
 
@@ -23,6 +25,15 @@ struct fb_var_screeninfo {
 
 #endif // _USE_X11
 
+#ifdef _USE_BENCH
+
+// no display, drawing only updates fb_canvas, but keep the same fb structure
+struct fb_var_screeninfo {
+    int xres, yres;
+};
+
+#endif // _USE_BENCH
+
 #ifdef _USE_FB0
 
 #include <fcntl.h>
@@ -47,6 +58,14 @@ extern const GFXfont Courier_Prime_Sans6pt7b;
 #define RGB565_G(c)     (((c) & 0x07E0) >> 3)
 #define RGB565_B(c)     (((c) & 0x001F) << 3)
 
+// metrics of one frame presented by the display thread, see getFrameStats()
+typedef struct {
+    uint32_t copy_us;                   // time to find changes and copy fb_canvas to the staging area
+    uint32_t upload_us;                 // time to send the staging area to the display
+    uint32_t dirty_px;                  // display pixels sent
+    uint32_t latency_us;                // from first drawing since the previous frame until presented
+} FrameStats;
+
 #define	RGB1632(C16)	((((uint32_t)(C16)&0xF800)<<8) | (((uint32_t)(C16)&0x07E0)<<5) | (((C16)&0x001F)<<3))
 #define	RGB3216(C32)	RGB565(((C32)>>16)&0xFF, ((C32)>>8)&0xFF, ((C32)&0xFF))
 
@@ -176,7 +195,10 @@ class Adafruit_RA8875 {
         // get next keyboard character
         char getChar(void);
 
-        void setEarthPix (char *day_pixels, char *night_pixels);
+        bool setEarthPix (char *day_pixels, char *night_pixels);
+
+        // collect metrics of frames presented since last call
+        int getFrameStats (FrameStats *fs, int max_fs, uint32_t *n_lost);
 
     protected:
 
@@ -269,6 +291,23 @@ class Adafruit_RA8875 {
 	pthread_mutex_t fb_lock;
 	struct fb_var_screeninfo fb_si;
 	volatile bool fb_dirty;
+        struct timespec dirty_ts;       // when first drawn since last frame, tv_sec 0 if not yet
+        void markDirty(void) {
+            if (dirty_ts.tv_sec == 0)
+                clock_gettime (CLOCK_MONOTONIC, &dirty_ts);
+            fb_dirty = true;
+        }
+
+        // frame metrics from the display thread waiting for getFrameStats(), protected by frame_lock
+        #define N_FRAMESTATS 64
+        pthread_mutex_t frame_lock;
+        FrameStats frame_stats[N_FRAMESTATS];
+        int n_frame_stats;
+        uint32_t n_frames_lost;         // frames not collected in time
+        uint32_t stage_upload_us;       // setStagingArea() part spent uploading, if any
+        uint32_t stage_dirty_px;        // setStagingArea() pixels staged
+        void addFrameStats (const struct timespec &t0, const struct timespec &t1, const struct timespec &t2,
+            const struct timespec &drawn);
 	fbpix_t *fb_canvas;             // main drawing image buffer
 	fbpix_t *fb_stage;              // temp image during staging to fb hw
 	int fb_nbytes;                  // bytes in each in-memory image buffer
@@ -285,9 +324,29 @@ class Adafruit_RA8875 {
 	int FB_X0;
 	int FB_Y0;
 
-	// big earth mmap'd maps
-        uint16_t (*DEARTH_BIG)[EARTH_BIG_H][EARTH_BIG_W];
-        uint16_t (*NEARTH_BIG)[EARTH_BIG_H][EARTH_BIG_W];
+	// big earth maps, either the mmap'd files as-is or copies rearranged into square tiles.
+        // azimuthal and rim sampling jump between rows so the tiled layout keeps neighboring lat/lng
+        // within the same few cache lines and pages; define _UNTILED_EARTH to use the files directly.
+        #define EARTH_TILE_SHIFT 4                                      // log2 tile edge, pixels
+        #define EARTH_TILE_SZ   (1<<EARTH_TILE_SHIFT)                   // tile edge, pixels
+        #define EARTH_TILE_MASK (EARTH_TILE_SZ-1)                       // pixel within tile
+        #define EARTH_TILES_W   ((EARTH_BIG_W+EARTH_TILE_MASK)/EARTH_TILE_SZ)   // n tiles across
+        #define EARTH_TILES_H   ((EARTH_BIG_H+EARTH_TILE_MASK)/EARTH_TILE_SZ)   // n tiles down
+        #define EARTH_TILED_NBYTES (EARTH_TILES_W*EARTH_TILES_H*EARTH_TILE_SZ*EARTH_TILE_SZ*2)
+        uint16_t *DEARTH_BIG;
+        uint16_t *NEARTH_BIG;
+        bool earth_tiled;                                               // whether *EARTH_BIG are tiled
+        uint16_t *makeTiledEarth (const uint16_t *flat);
+        void freeTiledEarth (void);
+        inline uint16_t earthPix (const uint16_t *map, int ey, int ex)
+        {
+            if (earth_tiled) {
+                int tile = (ey>>EARTH_TILE_SHIFT)*EARTH_TILES_W + (ex>>EARTH_TILE_SHIFT);
+                int pix = ((ey&EARTH_TILE_MASK)<<EARTH_TILE_SHIFT) | (ex&EARTH_TILE_MASK);
+                return (map[(tile<<(2*EARTH_TILE_SHIFT)) | pix]);
+            }
+            return (map[ey*EARTH_BIG_W + ex]);
+        }
 
 };
 
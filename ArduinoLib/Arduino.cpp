@@ -1,15 +1,37 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#endif
+
 #include "Arduino.h"
 
 char *our_name;
 
+// longest main() waits between loop() calls when no one asks for sooner
+#define LOOP_MAX_IDLE_MS        100
+
+#if defined(__linux__)
+static int loop_epfd = -1;                      // epoll on everything that may wake loop()
+static int loop_tfd = -1;                       // timerfd for the next wakeLoopIn()
+static int loop_efd = -1;                       // eventfd for wakeLoop()
+static bool loop_due_set;                       // whether loop_due is set
+static uint32_t loop_due;                       // millis() when loop() wants to run again
+static pthread_t loop_tid;                      // thread that calls loop()
+static bool loop_tid_set;                       // whether loop_tid is set
+#endif
+
 /* return milliseconds since first call
  */
 uint32_t millis(void)
@@ -27,6 +49,15 @@ uint32_t millis(void)
 	return (dt_ms);
 }
 
+/* return microseconds since an arbitrary time, wrapping as a uint32_t just as on the ESP
+ */
+uint32_t micros(void)
+{
+	struct timespec t;
+	clock_gettime (CLOCK_MONOTONIC, &t);
+	return ((uint32_t)t.tv_sec*1000000U + t.tv_nsec/1000);
+}
+
 void delay (uint32_t ms)
 {
 	usleep (ms*1000);
@@ -44,9 +75,180 @@ uint16_t analogRead(int pin)
 
 
 
+#if defined(__linux__)
+
+/* create the epoll set with its timer and wake-up event, once.
+ * return whether ready.
+ */
+static bool loopInit (void)
+{
+	static bool tried;
+
+	if (tried)
+	    return (loop_epfd >= 0);
+	tried = true;
+
+	loop_epfd = epoll_create1 (EPOLL_CLOEXEC);
+	loop_tfd = timerfd_create (CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+	loop_efd = eventfd (0, EFD_NONBLOCK|EFD_CLOEXEC);
+	if (loop_epfd < 0 || loop_tfd < 0 || loop_efd < 0) {
+	    printf ("Loop: epoll not available, polling: %s\n", strerror(errno));
+	    if (loop_epfd >= 0)
+		close (loop_epfd);
+	    loop_epfd = -1;
+	    return (false);
+	}
+
+	struct epoll_event ev;
+	memset (&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = loop_tfd;
+	epoll_ctl (loop_epfd, EPOLL_CTL_ADD, loop_tfd, &ev);
+	ev.data.fd = loop_efd;
+	epoll_ctl (loop_epfd, EPOLL_CTL_ADD, loop_efd, &ev);
+
+	return (true);
+}
+
+#endif // __linux__
+
+/* have loop() run again soon, may be called from any thread
+ */
+void wakeLoop (void)
+{
+#if defined(__linux__)
+	if (loop_efd >= 0) {
+	    uint64_t one = 1;
+	    if (write (loop_efd, &one, sizeof(one)) < 0)
+		return;                                     // already pending
+	}
+#endif
+}
+
+/* have loop() run again within ms, 0 for as soon as possible.
+ * N.B. only from the thread that calls loop(); each loop() must ask again.
+ */
+void wakeLoopIn (uint32_t ms)
+{
+#if defined(__linux__)
+	uint32_t due = millis() + ms;
+	if (!loop_due_set || (int32_t)(due - loop_due) < 0) {
+	    loop_due = due;
+	    loop_due_set = true;
+	}
+#else
+	(void) ms;
+#endif
+}
+
+/* have loop() run whenever something arrives on fd. Closing fd forgets it.
+ * only fds opened on the thread that calls loop() are registered; those opened by other threads are read
+ * there, so news on them would only wake loop() for nothing.
+ */
+void wakeLoopOnFd (int fd)
+{
+#if defined(__linux__)
+	if (fd < 0 || !loop_tid_set || !pthread_equal (pthread_self(), loop_tid) || !loopInit())
+	    return;
+
+	struct epoll_event ev;
+	memset (&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.fd = fd;
+	if (epoll_ctl (loop_epfd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno == EEXIST)
+	    epoll_ctl (loop_epfd, EPOLL_CTL_MOD, fd, &ev);
+#else
+	(void) fd;
+#endif
+}
+
+#if !defined(_USE_BENCH)
+
+#if defined(__linux__)
+
+/* sleep until a registered fd has news, wakeLoop() is called, the earliest wakeLoopIn() is due, the next
+ * second begins for the clocks, or LOOP_MAX_IDLE_MS passes.
+ * return false if epoll is not available.
+ */
+static bool loopWait (void)
+{
+	if (!loopInit())
+	    return (false);
+
+	struct timespec rt;
+	clock_gettime (CLOCK_REALTIME, &rt);
+	int32_t wait_ms = 1000 - rt.tv_nsec/1000000;
+	if (wait_ms > LOOP_MAX_IDLE_MS)
+	    wait_ms = LOOP_MAX_IDLE_MS;
+	if (loop_due_set) {
+	    int32_t due_ms = (int32_t)(loop_due - millis());
+	    if (due_ms < wait_ms)
+		wait_ms = due_ms;
+	    loop_due_set = false;
+	}
+	if (wait_ms <= 0)
+	    return (true);
+
+	struct itimerspec its;
+	memset (&its, 0, sizeof(its));
+	its.it_value.tv_sec = wait_ms / 1000;
+	its.it_value.tv_nsec = (wait_ms % 1000) * 1000000L;
+	timerfd_settime (loop_tfd, 0, &its, NULL);
+
+	// N.B. registered sockets are edge triggered, we only care that something arrived
+	struct epoll_event evs[16];
+	int n = epoll_wait (loop_epfd, evs, 16, -1);
+	for (int i = 0; i < n; i++) {
+	    int fd = evs[i].data.fd;
+	    if (fd == loop_tfd || fd == loop_efd) {
+		uint64_t count;
+		if (read (fd, &count, sizeof(count)) < 0)
+		    continue;                               // already drained
+	    }
+	}
+
+	// disarm in case something else woke us
+	memset (&its, 0, sizeof(its));
+	timerfd_settime (loop_tfd, 0, &its, NULL);
+
+	return (true);
+}
+
+#endif // __linux__
+
+/* original throttle for systems without epoll
+ */
+static void loopThrottle (void)
+{
+	// this loop by itself would run 100% CPU so try to be a better citizen and throttle back
+
+	// measure cpu time used during previous loop
+	static struct rusage ru0;
+	struct rusage ru1;
+	getrusage (RUSAGE_SELF, &ru1);
+	if (ru0.ru_utime.tv_sec == 0 && ru0.ru_utime.tv_usec == 0)
+	    ru0 = ru1;
+	struct timeval *ut0 = &ru0.ru_utime;
+	struct timeval *ut1 = &ru1.ru_utime;
+	struct timeval *st0 = &ru0.ru_stime;
+	struct timeval *st1 = &ru1.ru_stime;
+	int ut_us = (ut1->tv_sec - ut0->tv_sec)*1000000 + (ut1->tv_usec - ut0->tv_usec);
+	int st_us = (st1->tv_sec - st0->tv_sec)*1000000 + (st1->tv_usec - st0->tv_usec);
+	int cpu_us = ut_us + st_us;
+	ru0 = ru1;
+	// printf ("ut %d st %d\n", ut_us, st_us);
+
+	// sleep for 20% longer to keep CPU < 80%, beware lengthy loop()
+	if (cpu_us < 10000)
+	    usleep (cpu_us/5);
+}
+
+
 /* Every normal C program requires a main().
  * This is provided as magic in the Arduino IDE so here we must do it ourselves.
+ * The benchmark harness provides its own.
  */
+
 int main (int ac, char *av[])
 {
 	// save our name for remote update
@@ -55,34 +257,25 @@ int main (int ac, char *av[])
         // synchronous logging
         setbuf (stdout, NULL);
 
+	// prepare to sleep between loops before setup() registers anything
+#if defined(__linux__)
+	loop_tid = pthread_self();
+	loop_tid_set = true;
+	(void) loopInit();
+#endif
+
 	// call setup one time
 	setup();
 
-	// call loop forever
+	// call loop forever, sleeping between unless there is more to do
 	for (;;) {
 	    loop();
 
-            // this loop by itself would run 100% CPU so try to be a better citizen and throttle back
-
-            // measure cpu time used during previous loop
-            static struct rusage ru0;
-            struct rusage ru1;
-            getrusage (RUSAGE_SELF, &ru1);
-            if (ru0.ru_utime.tv_sec == 0 && ru0.ru_utime.tv_usec == 0)
-                ru0 = ru1;
-            struct timeval *ut0 = &ru0.ru_utime;
-            struct timeval *ut1 = &ru1.ru_utime;
-            struct timeval *st0 = &ru0.ru_stime;
-            struct timeval *st1 = &ru1.ru_stime;
-            int ut_us = (ut1->tv_sec - ut0->tv_sec)*1000000 + (ut1->tv_usec - ut0->tv_usec);
-            int st_us = (st1->tv_sec - st0->tv_sec)*1000000 + (st1->tv_usec - st0->tv_usec);
-            int cpu_us = ut_us + st_us;
-            ru0 = ru1;
-            // printf ("ut %d st %d\n", ut_us, st_us);
-
-            // sleep for 20% longer to keep CPU < 80%, beware lengthy loop()
-            if (cpu_us < 10000)
-                usleep (cpu_us/5);
-
+#if defined(__linux__)
+	    if (!loopWait())
+#endif
+		loopThrottle();
 	}
 }
+
+#endif // !_USE_BENCH
@@ -50,6 +50,7 @@
 #define	pgm_read_float(a)	(*(a))
 
 extern uint32_t millis(void);
+extern uint32_t micros(void);
 extern int random(int max);
 extern void delay (uint32_t ms);
 extern uint16_t analogRead(int pin);
@@ -57,5 +58,10 @@ extern void setup(void);
 extern void loop(void);
 extern char *our_name;
 
+// let main() sleep between calls to loop() until something happens, see Arduino.cpp
+extern void wakeLoop (void);
+extern void wakeLoopIn (uint32_t ms);
+extern void wakeLoopOnFd (int fd);
+
 
 #endif // _ARDUINO_H
@@ -17,6 +17,7 @@ ESP::ESP()
 void ESP::restart(void)
 {
         printf ("Executing %s\n", our_name);
+        Serial.flush();
         for (int fd = 3; fd < 1000; fd++)
             (void) close (fd);
         execl (our_name, our_name, (char*)0);
@@ -25,6 +26,31 @@ void ESP::restart(void)
         exit(1);
 }
 
+/* return memory still available to us, ie, what the system could give without swapping.
+ * N.B. capped at INT32_MAX since callers keep it in an int
+ */
+uint32_t ESP::getFreeHeap()
+{
+        uint32_t avail = 0;
+
+#if defined(__linux__)
+        FILE *fp = fopen ("/proc/meminfo", "r");
+        if (fp) {
+            char buf[128];
+            unsigned long kb;
+            while (fgets (buf, sizeof(buf), fp)) {
+                if (sscanf (buf, "MemAvailable: %lu", &kb) == 1) {
+                    avail = kb >= INT32_MAX/1024 ? INT32_MAX : kb*1024;
+                    break;
+                }
+            }
+            fclose (fp);
+        }
+#endif // __linux__
+
+        return (avail);
+}
+
 /* try to get some sort of system serial number.
  * return 0xFFFFFFFF if unknown.
  */
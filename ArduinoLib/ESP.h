@@ -19,10 +19,7 @@ class ESP {
             // noop
 	}
 
-	uint32_t getFreeHeap(void) 
-        {
-            return (0);
-        }
+	uint32_t getFreeHeap(void);
 
         int checkFlashCRC()
         {
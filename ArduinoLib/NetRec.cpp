@@ -0,0 +1,143 @@
+/* record outgoing network exchanges and redirect them to a stand-in server, see NetRec.h
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "NetRec.h"
+
+// recording state, shared by all threads
+static pthread_mutex_t rec_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool rec_checked;                        // set once env has been checked
+static FILE *rec_fp;                            // recording file, NULL if none
+static struct timespec rec_t0;                  // when recording began
+static int rec_id;                              // last conversation id assigned
+
+/* return ms since recording began.
+ * N.B. caller must hold rec_lock
+ */
+static long recMs(void)
+{
+        struct timespec t;
+        clock_gettime (CLOCK_MONOTONIC, &t);
+        return ((t.tv_sec - rec_t0.tv_sec)*1000L + (t.tv_nsec - rec_t0.tv_nsec)/1000000L);
+}
+
+/* open the recording file if requested and not already.
+ * N.B. caller must hold rec_lock
+ */
+static void recCheck(void)
+{
+        if (rec_checked)
+            return;
+        rec_checked = true;
+
+        const char *fn = getenv ("HAMCLOCK_NETREC");
+        if (!fn || !*fn)
+            return;
+
+        rec_fp = fopen (fn, "a");
+        if (!rec_fp) {
+            printf ("NetRec: %s: %s\n", fn, strerror(errno));
+            return;
+        }
+        clock_gettime (CLOCK_MONOTONIC, &rec_t0);
+        fprintf (rec_fp, "# HamClock network recording started %ld\n", (long)time(NULL));
+        fflush (rec_fp);
+        printf ("NetRec: recording to %s\n", fn);
+}
+
+/* start recording a new conversation with host:port.
+ * return its id for use with netRecData and netRecClose, or 0 if not recording.
+ */
+int netRecOpen (const char *proto, const char *host, int port)
+{
+        int id = 0;
+
+        pthread_mutex_lock (&rec_lock);
+        recCheck();
+        if (rec_fp) {
+            id = ++rec_id;
+            fprintf (rec_fp, "C %d %ld %s %s %d\n", id, recMs(), proto, host, port);
+            fflush (rec_fp);
+        }
+        pthread_mutex_unlock (&rec_lock);
+
+        return (id);
+}
+
+/* record n bytes sent, dir 'W', or received, dir 'R', in conversation id
+ */
+void netRecData (int id, char dir, const uint8_t *buf, int n)
+{
+        if (id <= 0 || n <= 0)
+            return;
+
+        pthread_mutex_lock (&rec_lock);
+        if (rec_fp) {
+            fprintf (rec_fp, "%c %d %ld %d\n", dir, id, recMs(), n);
+            fwrite (buf, 1, n, rec_fp);
+            fputc ('\n', rec_fp);
+            fflush (rec_fp);
+        }
+        pthread_mutex_unlock (&rec_lock);
+}
+
+/* record that conversation id has ended
+ */
+void netRecClose (int id)
+{
+        if (id <= 0)
+            return;
+
+        pthread_mutex_lock (&rec_lock);
+        if (rec_fp) {
+            fprintf (rec_fp, "X %d %ld\n", id, recMs());
+            fflush (rec_fp);
+        }
+        pthread_mutex_unlock (&rec_lock);
+}
+
+/* if all connections are to be redirected to a stand-in server return its host and port, else false
+ */
+bool netSimAddr (char *host, int host_len, int *port)
+{
+        static bool checked, ok;
+        static char sim_host[100];
+        static int sim_port;
+
+        pthread_mutex_lock (&rec_lock);
+        if (!checked) {
+            checked = true;
+            const char *env = getenv ("HAMCLOCK_NETSIM");
+            if (env && *env) {
+                const char *colon = strrchr (env, ':');
+                if (colon && colon > env && (int)(colon - env) < (int)sizeof(sim_host)
+                                        && (sim_port = atoi(colon+1)) > 0) {
+                    snprintf (sim_host, sizeof(sim_host), "%.*s", (int)(colon - env), env);
+                    ok = true;
+                    printf ("NetRec: all connections go to %s:%d\n", sim_host, sim_port);
+                } else
+                    printf ("NetRec: HAMCLOCK_NETSIM must be host:port: %s\n", env);
+            }
+        }
+        pthread_mutex_unlock (&rec_lock);
+
+        if (ok) {
+            snprintf (host, host_len, "%s", sim_host);
+            *port = sim_port;
+        }
+        return (ok);
+}
+
+/* fill buf with the line that tells the stand-in server the real destination, return its length
+ */
+int netSimPreamble (char *buf, int buf_len, const char *proto, const char *host, int port)
+{
+        int n = snprintf (buf, buf_len, "NETSIM %s %s %d\n", proto, host, port);
+        return (n < buf_len ? n : buf_len - 1);
+}
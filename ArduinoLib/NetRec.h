@@ -0,0 +1,28 @@
+#ifndef _NETREC_H
+#define _NETREC_H
+
+/* optional recording of every outgoing TCP and UDP exchange, and redirection of them all to a stand-in
+ * server that replays such a recording, see tools/netsim.cpp.
+ *
+ * both are controlled by environment variables so nothing changes unless asked:
+ *   HAMCLOCK_NETREC=file       append all exchanges to file
+ *   HAMCLOCK_NETSIM=host:port  connect to host:port instead of the real server; each TCP connection and
+ *                              UDP datagram is preceded by "NETSIM tcp|udp host port\n" naming the real one.
+ *
+ * recording format, one header line per event, data events followed by exactly n raw bytes then newline:
+ *   C id ms tcp|udp host port          new conversation
+ *   W id ms n                          n bytes we sent
+ *   R id ms n                          n bytes we received
+ *   X id ms                            conversation closed
+ * ms is milliseconds since the recording was opened.
+ */
+
+#include <stdint.h>
+
+extern int netRecOpen (const char *proto, const char *host, int port);
+extern void netRecData (int id, char dir, const uint8_t *buf, int n);
+extern void netRecClose (int id);
+extern bool netSimAddr (char *host, int host_len, int *port);
+extern int netSimPreamble (char *buf, int buf_len, const char *proto, const char *host, int port);
+
+#endif // _NETREC_H
@@ -1,3 +1,452 @@
+/* Serial over unix, see Serial.h.
+ *
+ * after begin() messages go into log_ring, a bounded lock free queue of fixed size slots that any thread
+ * may add to and only logThread removes from. Adding never blocks nor makes a system call: if the ring
+ * is full the message is dropped and counted. Each call site of an INFO or DEBUG message may log a burst
+ * of LOG_SITE_BURST then LOG_SITE_RATE per second, the rest are counted and dropped, so one chatty site
+ * can not flood the log while a loop that logs a few hundred lines at once loses none. ERROR and WARN
+ * messages are never throttled. logThread wakes each LOG_POLL_MS, writes all waiting messages with as few
+ * write(2) as possible, then rotates the log file if it, including anything written to it directly such as
+ * by plain printf(), has grown beyond its limit.
+ *
+ * environment variables:
+ *   HAMCLOCK_LOG=file          log to file instead of stdout; stdout is also redirected there
+ *   HAMCLOCK_LOGMAX=bytes      rotate the log file, or stdout if it is a file, beyond this size, 0 never
+ *   HAMCLOCK_LOGLEVEL=level    least important level to log: error, warn, info or debug
+ *
+ * N.B. output from plain printf() bypasses the ring so it may appear slightly out of order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "Serial.h"
 
 class Serial Serial;
+
+#define LOG_NSLOTS      4096                    // ring size, power of 2
+#define LOG_SLOTLEN     250                     // max bytes per slot, longer messages use several
+#define LOG_MSGLEN      4096                    // max formatted message length
+#define LOG_NSITES      1024                    // call sites tracked for rate limiting, power of 2
+#define LOG_SITE_BURST  2000                    // max messages at once from one call site
+#define LOG_SITE_RATE   20                      // max sustained messages per second from one call site
+#define LOG_POLL_MS     50                      // writer thread interval
+#define LOG_WBUF        65536                   // writer batch size
+#define LOG_MAXSIZE     (10*1024*1024L)         // default log size before rotating
+#define LOG_NKEEP       2                       // n rotated logs kept as .1 .. .N
+
+// one ring entry. seq tells who may use it: the producer at position p when seq == p, the consumer
+// when seq == p+1, then the producer one lap later when the consumer sets it to p+LOG_NSLOTS.
+typedef struct {
+        uint32_t seq;
+        uint16_t len;
+        char text[LOG_SLOTLEN];
+} LogSlot;
+
+static LogSlot log_ring[LOG_NSLOTS];
+static uint32_t log_enq;                        // next position to claim, any thread
+static uint32_t log_deq;                        // next position to write, logThread only
+static bool log_async;                          // set once logThread is running
+
+// rate limit per call site, a token bucket
+typedef struct {
+        uintptr_t site;                         // identifies the call site, 0 if unused
+        uint32_t ms;                            // logMillis() when credit was last topped up
+        int32_t credit;                         // messages that may be logged now, times 1000
+} LogSite;
+static LogSite log_sites[LOG_NSITES];
+static const char *log_limited_fmt;             // format of a recently throttled message
+
+// counts of lost messages, reported and reset by logThread
+static uint32_t log_n_full;                     // ring was full
+static uint32_t log_n_limited;                  // call site was too busy
+
+// output file state, logThread only after begin()
+static char log_path[1024];                     // file to rotate, or empty if not a regular file
+static long log_max = LOG_MAXSIZE;              // rotate when larger, 0 never
+
+
+/* write all of buf to stdout, return whether all went
+ */
+static bool logWrite (const char *buf, int n)
+{
+        while (n > 0) {
+            ssize_t nw = write (1, buf, n);
+            if (nw < 0) {
+                if (errno == EINTR)
+                    continue;
+                return (false);
+            }
+            buf += nw;
+            n -= nw;
+        }
+        return (true);
+}
+
+/* return monotonic milliseconds, cheaply
+ */
+static uint32_t logMillis (void)
+{
+        struct timespec t;
+#if defined(CLOCK_MONOTONIC_COARSE)
+        clock_gettime (CLOCK_MONOTONIC_COARSE, &t);
+#else
+        clock_gettime (CLOCK_MONOTONIC, &t);
+#endif
+        return (t.tv_sec*1000U + t.tv_nsec/1000000);
+}
+
+/* return whether the given call site may log another message now.
+ * N.B. a new site starts with ms 0 so its first top up fills it.
+ * N.B. racing threads may let a few extra through, which is fine.
+ */
+static bool logSiteOk (uintptr_t site)
+{
+        uint32_t now = logMillis();
+        uint32_t h = (uint32_t)((site >> 2) * 2654435761U);
+
+        for (int probe = 0; probe < 8; probe++) {
+            LogSite &ls = log_sites[(h + probe) & (LOG_NSITES-1)];
+            uintptr_t ls_site = __atomic_load_n (&ls.site, __ATOMIC_RELAXED);
+            if (!ls_site) {
+                // claim, unless another thread just did
+                if (!__atomic_compare_exchange_n (&ls.site, &ls_site, site, false,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+                                && ls_site != site)
+                    continue;
+            } else if (ls_site != site)
+                continue;
+
+            // top up by the time since the last top up, at most a full burst
+            uint32_t dt = now - __atomic_load_n (&ls.ms, __ATOMIC_RELAXED);
+            if (dt > 0) {
+                __atomic_store_n (&ls.ms, now, __ATOMIC_RELAXED);
+                int32_t credit = __atomic_load_n (&ls.credit, __ATOMIC_RELAXED);
+                if (dt > 1000U*LOG_SITE_BURST/LOG_SITE_RATE)
+                    credit = 1000*LOG_SITE_BURST;
+                else
+                    credit += dt*LOG_SITE_RATE;
+                if (credit > 1000*LOG_SITE_BURST)
+                    credit = 1000*LOG_SITE_BURST;
+                __atomic_store_n (&ls.credit, credit, __ATOMIC_RELAXED);
+            }
+            if (__atomic_sub_fetch (&ls.credit, 1000, __ATOMIC_RELAXED) >= 0)
+                return (true);
+            __atomic_add_fetch (&ls.credit, 1000, __ATOMIC_RELAXED);         // undo so credit stays >= 0
+            return (false);
+        }
+
+        // table full, no limit
+        return (true);
+}
+
+/* add n bytes of text to the ring, or write at once if the ring is not running
+ */
+static void logPut (const char *text, int n)
+{
+        if (n <= 0)
+            return;
+
+        if (!__atomic_load_n (&log_async, __ATOMIC_ACQUIRE)) {
+            (void) logWrite (text, n);
+            return;
+        }
+
+        // claim k consecutive slots. The consumer frees slots in order so if the last is free so are the rest.
+        uint32_t k = (n + LOG_SLOTLEN - 1) / LOG_SLOTLEN;
+        uint32_t pos = __atomic_load_n (&log_enq, __ATOMIC_RELAXED);
+        for (;;) {
+            uint32_t last = pos + k - 1;
+            uint32_t seq = __atomic_load_n (&log_ring[last & (LOG_NSLOTS-1)].seq, __ATOMIC_ACQUIRE);
+            int32_t dif = (int32_t)(seq - last);
+            if (dif == 0) {
+                if (__atomic_compare_exchange_n (&log_enq, &pos, pos + k, true,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                    break;
+            } else if (dif < 0) {
+                __atomic_add_fetch (&log_n_full, 1, __ATOMIC_RELAXED);
+                return;
+            } else
+                pos = __atomic_load_n (&log_enq, __ATOMIC_RELAXED);
+        }
+
+        // fill and publish each
+        for (uint32_t i = 0; i < k; i++) {
+            LogSlot &s = log_ring[(pos + i) & (LOG_NSLOTS-1)];
+            int l = n > LOG_SLOTLEN ? LOG_SLOTLEN : n;
+            memcpy (s.text, text, l);
+            s.len = l;
+            text += l;
+            n -= l;
+            __atomic_store_n (&s.seq, pos + i + 1, __ATOMIC_RELEASE);
+        }
+}
+
+/* write and free all complete messages in the ring, batching into wbuf.
+ * return bytes written.
+ */
+static long logDrain (char *wbuf, int wbuf_len)
+{
+        long total = 0;
+        int n = 0;
+
+        for (;;) {
+            LogSlot &s = log_ring[log_deq & (LOG_NSLOTS-1)];
+            if (__atomic_load_n (&s.seq, __ATOMIC_ACQUIRE) != log_deq + 1)
+                break;
+            if (n + s.len > wbuf_len) {
+                (void) logWrite (wbuf, n);
+                total += n;
+                n = 0;
+            }
+            memcpy (wbuf + n, s.text, s.len);
+            n += s.len;
+            __atomic_store_n (&s.seq, log_deq + LOG_NSLOTS, __ATOMIC_RELEASE);
+            __atomic_store_n (&log_deq, log_deq + 1, __ATOMIC_RELEASE);
+        }
+
+        if (n > 0) {
+            (void) logWrite (wbuf, n);
+            total += n;
+        }
+        return (total);
+}
+
+/* return whether the log file has grown beyond log_max, whoever wrote to it
+ */
+static bool logTooBig (void)
+{
+        struct stat st;
+        return (log_path[0] && log_max > 0 && fstat (1, &st) == 0 && st.st_size > log_max);
+}
+
+/* start a fresh log file after keeping the current one and up to LOG_NKEEP-1 older ones
+ */
+static void logRotate (void)
+{
+        char from[sizeof(log_path)+10], to[sizeof(log_path)+10];
+
+        for (int i = LOG_NKEEP; i > 1; --i) {
+            snprintf (from, sizeof(from), "%s.%d", log_path, i-1);
+            snprintf (to, sizeof(to), "%s.%d", log_path, i);
+            (void) rename (from, to);
+        }
+        snprintf (to, sizeof(to), "%s.1", log_path);
+        if (rename (log_path, to) < 0) {
+            ::printf ("Log: rename %s: %s\n", log_path, strerror(errno));
+            log_max = 0;
+            return;
+        }
+
+        int fd = open (log_path, O_WRONLY|O_CREAT|O_APPEND, 0644);
+        if (fd < 0) {
+            ::printf ("Log: %s: %s\n", log_path, strerror(errno));
+            log_max = 0;
+            return;
+        }
+        dup2 (fd, 1);
+        close (fd);
+}
+
+/* thread that writes the ring
+ */
+static void *logThread (void *unused)
+{
+        (void) unused;
+        static char wbuf[LOG_WBUF];
+        char msg[100];
+
+        for (;;) {
+            usleep (LOG_POLL_MS*1000);
+
+            (void) logDrain (wbuf, sizeof(wbuf));
+
+            // report losses
+            uint32_t n_full = __atomic_exchange_n (&log_n_full, 0, __ATOMIC_RELAXED);
+            uint32_t n_limited = __atomic_exchange_n (&log_n_limited, 0, __ATOMIC_RELAXED);
+            if (n_full || n_limited) {
+                // show the start of one throttled format, on one line
+                char eg[40] = "";
+                const char *fmt = __atomic_load_n (&log_limited_fmt, __ATOMIC_RELAXED);
+                if (n_limited && fmt) {
+                    int i;
+                    for (i = 0; i < (int)sizeof(eg)-1 && fmt[i]; i++)
+                        eg[i] = fmt[i] < ' ' ? ' ' : fmt[i];
+                    eg[i] = '\0';
+                }
+                int l = snprintf (msg, sizeof(msg),
+                                "Log: lost %u messages to a full ring, %u from busy call sites%s%s%s\n",
+                                n_full, n_limited, eg[0] ? " such as \"" : "", eg, eg[0] ? "\"" : "");
+                (void) logWrite (msg, l < (int)sizeof(msg) ? l : (int)sizeof(msg)-1);
+            }
+
+            if (logTooBig())
+                logRotate();
+        }
+
+        return (NULL);
+}
+
+/* write whatever is in the ring then let the signal do what it normally does
+ */
+static void onFatalSignal (int sig)
+{
+        // N.B. logThread may be in the middle of this too, best effort.
+        for (uint32_t pos = log_deq; ; pos++) {
+            LogSlot &s = log_ring[pos & (LOG_NSLOTS-1)];
+            if (s.seq != pos + 1)
+                break;
+            if (write (1, s.text, s.len) < 0)
+                break;
+        }
+        raise (sig);
+}
+
+/* called by exit()
+ */
+static void flushAtExit (void)
+{
+        Serial.flush();
+}
+
+/* decide where output goes, return whether ok
+ */
+static bool logSetOutput (void)
+{
+        const char *max = getenv ("HAMCLOCK_LOGMAX");
+        if (max && *max)
+            log_max = atol (max);
+
+        const char *fn = getenv ("HAMCLOCK_LOG");
+        if (fn && *fn) {
+            int fd = open (fn, O_WRONLY|O_CREAT|O_APPEND, 0644);
+            if (fd < 0) {
+                ::printf ("Log: %s: %s\n", fn, strerror(errno));
+                return (false);
+            }
+            dup2 (fd, 1);
+            close (fd);
+            snprintf (log_path, sizeof(log_path), "%s", fn);
+        } else {
+            // rotate stdout too if it is a file we can find again
+            ssize_t l = readlink ("/proc/self/fd/1", log_path, sizeof(log_path)-1);
+            log_path[l > 0 ? l : 0] = '\0';
+        }
+
+        struct stat st;
+        if (!log_path[0] || fstat (1, &st) < 0 || !S_ISREG(st.st_mode) || st.st_nlink == 0)
+            log_path[0] = '\0';
+
+        return (true);
+}
+
+/* start logging through the ring.
+ * N.B. baud is ignored of course
+ */
+void Serial::begin (int baud)
+{
+        (void) baud;
+
+        if (log_async)
+            return;
+
+        const char *lvl = getenv ("HAMCLOCK_LOGLEVEL");
+        if (lvl && *lvl) {
+            if (!strcasecmp (lvl, "error"))
+                level = LOGL_ERROR;
+            else if (!strcasecmp (lvl, "warn"))
+                level = LOGL_WARN;
+            else if (!strcasecmp (lvl, "info"))
+                level = LOGL_INFO;
+            else if (!strcasecmp (lvl, "debug"))
+                level = LOGL_DEBUG;
+            else
+                ::printf ("Log: HAMCLOCK_LOGLEVEL must be error, warn, info or debug: %s\n", lvl);
+        }
+
+        if (!logSetOutput())
+            return;
+
+        for (uint32_t i = 0; i < LOG_NSLOTS; i++)
+            log_ring[i].seq = i;
+
+        pthread_t tid;
+        int e = pthread_create (&tid, NULL, logThread, NULL);
+        if (e) {
+            ::printf ("Log: thread failed, logging synchronously: %s\n", strerror(e));
+            return;
+        }
+        pthread_detach (tid);
+
+        // try to save the last words of a crash
+        struct sigaction sa;
+        memset (&sa, 0, sizeof(sa));
+        sa.sa_handler = onFatalSignal;
+        sa.sa_flags = SA_RESETHAND;
+        sigemptyset (&sa.sa_mask);
+        sigaction (SIGSEGV, &sa, NULL);
+        sigaction (SIGBUS, &sa, NULL);
+        sigaction (SIGFPE, &sa, NULL);
+        sigaction (SIGILL, &sa, NULL);
+        sigaction (SIGABRT, &sa, NULL);
+        atexit (flushAtExit);
+
+        __atomic_store_n (&log_async, true, __ATOMIC_RELEASE);
+}
+
+/* wait a while for logThread to write everything logged so far
+ */
+void Serial::flush (void)
+{
+        if (!__atomic_load_n (&log_async, __ATOMIC_ACQUIRE))
+            return;
+
+        uint32_t end = __atomic_load_n (&log_enq, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < 2000; i++) {
+            if ((int32_t)(__atomic_load_n (&log_deq, __ATOMIC_ACQUIRE) - end) >= 0)
+                break;
+            usleep (1000);
+        }
+}
+
+/* log s, with newline if nl
+ */
+void Serial::logs (const char *s, bool nl)
+{
+        if (LOGL_INFO > level)
+            return;
+
+        if (nl) {
+            char buf[LOG_MSGLEN];
+            int n = snprintf (buf, sizeof(buf), "%s\n", s);
+            logPut (buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf)-1);
+        } else
+            logPut (s, strlen(s));
+}
+
+/* format and log a message of level l from the given call site, return length of message
+ */
+int Serial::vlogf (LogLevel l, uintptr_t site, const char *fmt, va_list ap)
+{
+        if (l >= LOGL_INFO && __atomic_load_n (&log_async, __ATOMIC_RELAXED) && !logSiteOk (site)) {
+            __atomic_add_fetch (&log_n_limited, 1, __ATOMIC_RELAXED);
+            __atomic_store_n (&log_limited_fmt, fmt, __ATOMIC_RELAXED);
+            return (0);
+        }
+
+        char buf[LOG_MSGLEN];
+        int n = vsnprintf (buf, sizeof(buf), fmt, ap);
+        if (n >= (int)sizeof(buf))
+            n = sizeof(buf) - 1;
+        logPut (buf, n);
+        return (n);
+}
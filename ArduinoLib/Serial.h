@@ -6,6 +6,25 @@
 
 #include "Arduino.h"
 
+/* Serial over unix.
+ *
+ * until begin() everything is written to stdout at once. After that each message is copied into a lock
+ * free ring and a background thread writes them out in batches, so logging from the main loop costs
+ * little more than formatting the message. See Serial.cpp for environment variables that set the log
+ * level, a log file and its rotation size, and for how busy call sites are throttled.
+ *
+ * each message remembers where it was logged from for the throttle: LOGF() in HamClock.h passes __FILE__
+ * and __LINE__ to lprintfAt(), the others use their return address, hence they must never be inlined.
+ */
+
+// message levels, lower is more important
+typedef enum {
+        LOGL_ERROR,
+        LOGL_WARN,
+        LOGL_INFO,
+        LOGL_DEBUG,
+} LogLevel;
+
 class Serial {
 
     public:
@@ -16,9 +35,19 @@ class Serial {
             setbuf (stdout, NULL);
         }
 
-	void begin (int baud)
-	{
-	}
+	void begin (int baud);
+
+        void flush (void);
+
+        void setLevel (LogLevel l)
+        {
+            level = l;
+        }
+
+        LogLevel getLevel (void)
+        {
+            return (level);
+        }
 
         void print (void)
         {
@@ -26,49 +55,79 @@ class Serial {
 
 	void print (char *s)
 	{
-	    printf ("%s", s);
+	    logs (s);
 	}
 
 	void print (const char *s)
 	{
-	    printf ("%s", s);
+	    logs (s);
 	}
 
 	void print (int i)
 	{
-	    printf ("%d", i);
+	    char buf[16];
+	    snprintf (buf, sizeof(buf), "%d", i);
+	    logs (buf);
 	}
 
 	void print (String s)
 	{
-	    printf ("%s", s.c_str());
+	    logs (s.c_str());
 	}
 
         void println (void)
         {
-	    printf ("\n");
+	    logs ("\n");
         }
 
 	void println (char *s)
 	{
-	    printf ("%s\n", s);
+	    logs (s, true);
 	}
 
 	void println (const char *s)
 	{
-	    printf ("%s\n", s);
+	    logs (s, true);
 	}
 
 	void println (int i)
 	{
-	    printf ("%d\n", i);
+	    char buf[16];
+	    snprintf (buf, sizeof(buf), "%d", i);
+	    logs (buf, true);
 	}
 
-	int printf (const char *fmt, ...)
+	int __attribute__((noinline)) printf (const char *fmt, ...)
 	{
+            if (LOGL_INFO > level)
+                return (0);
 	    va_list ap;
 	    va_start (ap, fmt);
-	    int n = vprintf (fmt, ap);
+	    int n = vlogf (LOGL_INFO, (uintptr_t)__builtin_return_address(0), fmt, ap);
+	    va_end (ap);
+	    return (n);
+	}
+
+        // printf at the given level, discarded at once if less important than getLevel()
+	int __attribute__((noinline)) lprintf (LogLevel l, const char *fmt, ...)
+	{
+            if (l > level)
+                return (0);
+	    va_list ap;
+	    va_start (ap, fmt);
+	    int n = vlogf (l, (uintptr_t)__builtin_return_address(0), fmt, ap);
+	    va_end (ap);
+	    return (n);
+	}
+
+        // same as lprintf but from the given source file and line
+	int lprintfAt (LogLevel l, const char *file, int line, const char *fmt, ...)
+	{
+            if (l > level)
+                return (0);
+	    va_list ap;
+	    va_start (ap, fmt);
+	    int n = vlogf (l, (uintptr_t)file*31 + line, fmt, ap);
 	    va_end (ap);
 	    return (n);
 	}
@@ -77,6 +136,13 @@ class Serial {
 	{
 	    return (true);
 	}
+
+    private:
+
+        LogLevel level = LOGL_INFO;
+
+        void logs (const char *s, bool nl = false);
+        int vlogf (LogLevel l, uintptr_t site, const char *fmt, va_list ap);
 };
 
 extern class Serial Serial;
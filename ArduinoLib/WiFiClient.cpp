@@ -5,6 +5,7 @@
 
 #include "IPAddress.h"
 #include "WiFiClient.h"
+#include "NetRec.h"
 
 // set for core info
 static bool _trace_client = false;
@@ -13,6 +14,7 @@ WiFiClient::WiFiClient()
 {
 	socket = -1;
 	n_peek = 0;
+	rec_id = 0;
 }
 
 WiFiClient::WiFiClient(int fd)
@@ -20,6 +22,7 @@ WiFiClient::WiFiClient(int fd)
 	if (fd >= 0 && _trace_client) printf ("WiFiCl: new WiFiClient inheriting socket %d\n", fd);
 	socket = fd;
 	n_peek = 0;
+	rec_id = 0;
 }
 
 // return whether this socket is active
@@ -73,15 +76,17 @@ int WiFiClient::tout (int to_ms, int fd)
         struct timeval tv;
         int ret;
 
-        FD_ZERO (&rset);
-        FD_ZERO (&wset);
-        FD_SET (fd, &rset);
-        FD_SET (fd, &wset);
-
         tv.tv_sec = to_ms / 1000;
         tv.tv_usec = to_ms % 1000;
 
-        ret = select (fd + 1, &rset, &wset, NULL, &tv);
+        // linux updates tv with time remaining so just try again if interrupted
+        do {
+            FD_ZERO (&rset);
+            FD_ZERO (&wset);
+            FD_SET (fd, &rset);
+            FD_SET (fd, &wset);
+            ret = select (fd + 1, &rset, &wset, NULL, &tv);
+        } while (ret < 0 && errno == EINTR);
         if (ret > 0)
             return (0);
         if (ret == 0)
@@ -90,12 +95,19 @@ int WiFiClient::tout (int to_ms, int fd)
 }
 
 
-bool WiFiClient::connect(const char *host, int port)
+bool WiFiClient::connect(const char *real_host, int real_port)
 {
         struct addrinfo hints, *aip;
         char port_str[16];
         int sockfd;
 
+        /* connect to the stand-in server instead if requested */
+        char sim_host[100];
+        int sim_port;
+        bool use_sim = netSimAddr (sim_host, sizeof(sim_host), &sim_port);
+        const char *host = use_sim ? sim_host : real_host;
+        int port = use_sim ? sim_port : real_port;
+
         /* lookup host address.
          * N.B. must call freeaddrinfo(aip) after successful call before returning
          */
@@ -128,11 +140,25 @@ bool WiFiClient::connect(const char *host, int port)
         /* handle write errors inline */
         signal (SIGPIPE, SIG_IGN);
 
+        /* tell the stand-in server where we really wanted to go */
+        if (use_sim) {
+            char pre[200];
+            int n = netSimPreamble (pre, sizeof(pre), "tcp", real_host, real_port);
+            if (::write (sockfd, pre, n) != n) {
+                printf ("NetSim(%s:%d): %s\n", host, port, strerror(errno));
+                freeaddrinfo (aip);
+                close (sockfd);
+                return (false);
+            }
+        }
+
         /* ok */
         if (_trace_client) printf ("WiFiCl: new %s:%d socket %d\n", host, port, sockfd);
         freeaddrinfo (aip);
 	socket = sockfd;
 	n_peek = 0;
+        rec_id = netRecOpen ("tcp", real_host, real_port);
+        wakeLoopOnFd (sockfd);
         return (true);
 }
 
@@ -159,6 +185,8 @@ void WiFiClient::stop()
 	    close (socket);
 	    socket = -1;
 	    n_peek = 0;
+            netRecClose (rec_id);
+            rec_id = 0;
 	}
 }
 
@@ -197,6 +225,7 @@ int WiFiClient::available()
 	int n = ::read(socket, peek, sizeof(peek));
 	if (n > 0) {
 	    n_peek = n;
+            netRecData (rec_id, 'R', peek, n);
 	    return (1);
 	} else {
             if (n == 0)
@@ -234,6 +263,7 @@ int WiFiClient::write (const uint8_t *buf, int n)
 	    }
 	    if (_trace_client) printf ("WiFiCl: write %.*s", nw, buf+ntot);
 	}
+        netRecData (rec_id, 'W', buf, n);
 	return (n);
 }
 
@@ -63,6 +63,7 @@ class WiFiClient {
 	int socket;
 	uint8_t peek[1024];
 	int n_peek;
+        int rec_id;                     // NetRec conversation, 0 if none
 
         int connect_to (int sockfd, struct sockaddr *serv_addr, int addrlen, int to_ms);
         int tout (int to_ms, int fd);
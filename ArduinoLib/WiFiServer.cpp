@@ -91,6 +91,7 @@ void WiFiServer::begin()
         /* ok */
         if (_trace_server) printf ("WiFiSvr: new server socket %d\n", sfd);
         socket = sfd;
+        wakeLoopOnFd (sfd);
 }
 
 WiFiClient WiFiServer::available()
@@ -103,6 +104,7 @@ WiFiClient WiFiServer::available()
             socklen_t cli_len = sizeof(cli_socket);
             cli_fd = ::accept (socket, (struct sockaddr *)&cli_socket, &cli_len);
             if (cli_fd >= 0 && _trace_server) printf ("WiFiSvr: new server client fd %d\n", cli_fd);
+            wakeLoopOnFd (cli_fd);
         }
 
 	// return as a client
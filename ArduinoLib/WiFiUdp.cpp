@@ -1,9 +1,12 @@
 #include "WiFiUdp.h"
+#include "NetRec.h"
 
 
 WiFiUDP::WiFiUDP()
 {
 	sockfd = -1;
+        rec_id = 0;
+        n_pre = 0;
 }
 
 WiFiUDP::~WiFiUDP()
@@ -11,7 +14,10 @@ WiFiUDP::~WiFiUDP()
 	stop();
 }
 
-bool WiFiUDP::begin(int port)
+/* bind to port. if shared other sockets may bind the same port and the kernel then spreads datagrams
+ * among them, else binding fails if the port is already in use and later shared binds fail too.
+ */
+bool WiFiUDP::begin(int port, bool shared)
 {
         // create UDP socket
 	sockfd = ::socket(AF_INET, SOCK_DGRAM, 0);
@@ -26,10 +32,12 @@ bool WiFiUDP::begin(int port)
         sin.sin_family = AF_INET;
         sin.sin_port = htons(port);
         sin.sin_addr.s_addr = htonl(INADDR_ANY);
-        int one = 1;
-        setsockopt (sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
-        one = 1;
-        setsockopt (sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (shared) {
+            int one = 1;
+            setsockopt (sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+            one = 1;
+            setsockopt (sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        }
         if (bind(sockfd, (struct sockaddr*)&sin, sizeof(sin)) < 0) {
             ::close (sockfd);
             sockfd = -1;
@@ -37,6 +45,7 @@ bool WiFiUDP::begin(int port)
 	    return (false);
 	}
 
+        wakeLoopOnFd (sockfd);
 	return (true);
 }
 
@@ -79,6 +88,7 @@ bool WiFiUDP::beginMulticast (IPAddress ifIP, IPAddress mcIP, int port)
         }
 
         // ok
+        wakeLoopOnFd (sockfd);
         return (true);
 }
 
@@ -97,8 +107,16 @@ IPAddress WiFiUDP::remoteIP()
 }
 
 
-void WiFiUDP::beginPacket (const char *host, int port)
+void WiFiUDP::beginPacket (const char *real_host, int real_port)
 {
+        // send to the stand-in server instead if requested, each datagram then starts with the real address
+        char sim_host[100];
+        int sim_port;
+        bool use_sim = netSimAddr (sim_host, sizeof(sim_host), &sim_port);
+        const char *host = use_sim ? sim_host : real_host;
+        int port = use_sim ? sim_port : real_port;
+        n_pre = use_sim ? netSimPreamble ((char*)pre, sizeof(pre), "udp", real_host, real_port) : 0;
+
         // get host
         struct hostent *server;
 	server = ::gethostbyname(host);
@@ -117,17 +135,31 @@ void WiFiUDP::beginPacket (const char *host, int port)
 	    printf ("Can not connect to %s:%d: %s\n", host, port, strerror(errno));
 	    return;
 	}
+
+        // record exchanges with this destination
+        if (rec_id == 0)
+            rec_id = netRecOpen ("udp", real_host, real_port);
 }
 
 void WiFiUDP::write (uint8_t *buf, int n)
 {
 	w_n = n;	// save original count
 
-	sendto_n = ::write(sockfd, buf, n);
+        if (n_pre > 0) {
+            // prefix the stand-in server preamble but report only the caller's count
+            uint8_t sim_buf[sizeof(pre) + sizeof(r_buf)];
+            if (n > (int)sizeof(r_buf))
+                n = sizeof(r_buf);
+            memcpy (sim_buf, pre, n_pre);
+            memcpy (sim_buf + n_pre, buf, n);
+            sendto_n = ::write(sockfd, sim_buf, n_pre + n) - n_pre;
+        } else
+            sendto_n = ::write(sockfd, buf, n);
 	if (sendto_n < 0) {
 	    printf ("sendto: %s\n", strerror(errno));
 	    return;
 	}
+        netRecData (rec_id, 'W', buf, sendto_n);
 }
 
 bool WiFiUDP::endPacket()
@@ -160,6 +192,7 @@ int WiFiUDP::parsePacket()
 	    printf ("recvfrom: %s\n", strerror(errno));
 	    return (0);
 	}
+        netRecData (rec_id, 'R', r_buf, r_n);
 	return (r_n);
 }
 
@@ -175,4 +208,7 @@ void WiFiUDP::stop()
 	    ::close (sockfd);
 	    sockfd = -1;
 	}
+        netRecClose (rec_id);
+        rec_id = 0;
+        n_pre = 0;
 }
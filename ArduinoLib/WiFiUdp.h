@@ -23,7 +23,7 @@ class WiFiUDP {
 	WiFiUDP();
 	~WiFiUDP();
         operator bool() const { return (sockfd >= 0); }
-	bool begin(int port);
+	bool begin(int port, bool shared = true);
         bool beginMulticast (IPAddress ifIP, IPAddress mcIP, int port);
 	void beginPacket (const char *host, int port);
 	void write (uint8_t *buf, int n);
@@ -41,6 +41,9 @@ class WiFiUDP {
 	uint8_t r_buf[1024];
 	int r_n, w_n;
 	int sendto_n;
+        int rec_id;                     // NetRec conversation, 0 if none
+        uint8_t pre[200];               // NetSim preamble for each datagram
+        int n_pre;                      // bytes in pre, 0 if not using NetSim
 };
 
 #endif // _WIFI_UDP_H
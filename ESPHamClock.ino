@@ -421,48 +421,93 @@ void setup()
     // init sensors
     initBME280();
 
-    // check for saved satellite
+    // load satellite elements, check for saved satellite and any to track
+    initSatCatalog();
     dx_info_for_sat = initSatSelection();
+    initSatTracker();
+
+    // start any extra spot sources
+    initSpotFeeds();
 
     // perform inital screen layout
     initScreen();
 
     // now start checking repetative wd
     max_wd_dt = 0;
+    startStallDetector();
 }
 
 // called repeatedly forever
 void loop()
 {
+    // time each section, see get_perf.txt
+    PerfTimer loop_pt (PERF_LOOP);
+
+    // collect display frame metrics, also for get_perf.txt
+    perfFrames();
+
     // update stopwatch exclusively, if active
-    if (runStopwatch())
+    if (runStopwatch()) {
+        wakeLoopIn (0);
         return;
+    }
 
     // check on wifi and plots
-    updateWiFi();
+    {
+        PerfTimer pt (PERF_WIFI);
+        updateWiFi();
+    }
 
     // update clocks
-    updateClocks(false);
+    {
+        PerfTimer pt (PERF_CLOCKS);
+        updateClocks(false);
+    }
 
     // update sat pass (this is just the pass; the path is recomputed before each map sweep)
-    updateSatPass();
+    {
+        PerfTimer pt (PERF_SATPASS);
+        updateSatPass();
+    }
+
+    // keep satellite elements and any tracked satellites current
+    {
+        PerfTimer pt (PERF_SATCAT);
+        updateSatCatalog();
+    }
+    {
+        PerfTimer pt (PERF_SATTRACK);
+        updateSatTracker();
+    }
 
     // update NCFDX beacons, don't erase if holding path
-    updateBeacons(!waiting4DXPath(), false, false);
+    {
+        PerfTimer pt (PERF_BEACONS);
+        updateBeacons(!waiting4DXPath(), false, false);
+    }
 
     // display more of earth map unless we are leaving a path up temporarily
-    if (!waiting4DXPath())
+    if (!waiting4DXPath()) {
+        PerfTimer pt (PERF_EARTH);
 	drawMoreEarth();
+    }
 
     // other goodies
-    drawUptime(false);
-    drawWiFiInfo();
-    drawVersion(false);
-    followBrightness();
-    updateBME280();
+    {
+        PerfTimer pt (PERF_OTHER);
+        drawUptime(false);
+        drawWiFiInfo();
+        drawVersion(false);
+        followBrightness();
+        updateBME280();
+        checkMemStats();
+    }
 
     // check for touch events
-    checkTouch();
+    {
+        PerfTimer pt (PERF_TOUCH);
+        checkTouch();
+    }
 }
 
 
@@ -1425,13 +1470,121 @@ bool overMap (const SCoord &s)
     return (inBox(s, map_b) && !overRSS(s) && !inBox(s,azm_btn_b) && !inBox(s,llg_btn_b));
 }
 
+/* overAnySymbol() is called for every map pixel so it first consults a coarse grid over the screen in which
+ * each cell records which groups of symbols have any part in it. Most cells are empty so most calls need
+ * only one lookup; otherwise only the groups found there are tested exactly.
+ * The grid is rebuilt when any of the circles or santa_b change or after mapSymbolsMoved() is called.
+ */
+#if defined(_IS_ESP8266)
+#define SG_CELL         32                              // cell size, pixels; 750 bytes of grid
+#else
+#define SG_CELL         16                              // cell size, pixels; 3000 bytes of grid
+#endif
+#define SG_NX           ((800+SG_CELL-1)/SG_CELL)       // n cells across
+#define SG_NY           ((480+SG_CELL-1)/SG_CELL)       // n cells down
+enum {
+    SG_DE       = (1<<0),
+    SG_DX       = (1<<1),
+    SG_DEAP     = (1<<2),
+    SG_SUN      = (1<<3),
+    SG_MOON     = (1<<4),
+    SG_BEACONS  = (1<<5),
+    SG_SPOTS    = (1<<6),
+    SG_SATS     = (1<<7),
+    SG_SANTA    = (1<<8),
+};
+static uint16_t sg_cells[SG_NY][SG_NX];                 // SG_* mask of groups in each cell
+static uint16_t sg_marking;                             // group being added by markSymbolBox()
+static uint32_t sg_gen = 1, sg_built_gen;               // change count and value when sg_cells was built
+static struct {
+    SCircle de, dx, deap, sun, moon;
+    SBox santa;
+} sg_shapes;                                            // shapes when sg_cells was built
+
+/* record that some beacon, spot or satellite symbol has moved, appeared or disappeared
+ */
+void mapSymbolsMoved()
+{
+    sg_gen++;
+}
+
+/* add box b to sg_cells for the group now being built.
+ * N.B. only called by markXXXSymbols() from sgBuild()
+ */
+void markSymbolBox (const SBox &b)
+{
+    if (b.w == 0 || b.h == 0)
+        return;
+    int x1 = (b.x + b.w - 1)/SG_CELL, y1 = (b.y + b.h - 1)/SG_CELL;
+    if (x1 >= SG_NX) x1 = SG_NX-1;
+    if (y1 >= SG_NY) y1 = SG_NY-1;
+    for (int y = b.y/SG_CELL; y <= y1; y++)
+        for (int x = b.x/SG_CELL; x <= x1; x++)
+            sg_cells[y][x] |= sg_marking;
+}
+
+/* add circle c to sg_cells for the given group
+ */
+static void sgMarkCircle (const SCircle &c, uint16_t group)
+{
+    SBox b;
+    b.x = c.s.x > c.r ? c.s.x - c.r : 0;
+    b.y = c.s.y > c.r ? c.s.y - c.r : 0;
+    b.w = c.s.x + c.r + 1 - b.x;
+    b.h = c.s.y + c.r + 1 - b.y;
+    sg_marking = group;
+    markSymbolBox (b);
+}
+
+/* rebuild sg_cells from all current symbols if anything has changed
+ */
+static void sgBuild()
+{
+    if (sg_built_gen == sg_gen && !memcmp (&sg_shapes.de, &de_c, sizeof(SCircle))
+                && !memcmp (&sg_shapes.dx, &dx_c, sizeof(SCircle)) && !memcmp (&sg_shapes.deap, &deap_c, sizeof(SCircle))
+                && !memcmp (&sg_shapes.sun, &sun_c, sizeof(SCircle)) && !memcmp (&sg_shapes.moon, &moon_c, sizeof(SCircle))
+                && !memcmp (&sg_shapes.santa, &santa_b, sizeof(SBox)))
+        return;
+
+    memset (sg_cells, 0, sizeof(sg_cells));
+    sgMarkCircle (de_c, SG_DE);
+    sgMarkCircle (dx_c, SG_DX);
+    sgMarkCircle (deap_c, SG_DEAP);
+    sgMarkCircle (sun_c, SG_SUN);
+    sgMarkCircle (moon_c, SG_MOON);
+    sg_marking = SG_SANTA;
+    markSymbolBox (santa_b);
+    sg_marking = SG_BEACONS;
+    markBeaconSymbols();
+    sg_marking = SG_SPOTS;
+    markDXSpotSymbols();
+    sg_marking = SG_SATS;
+    markSatTrackerSymbols();
+
+    sg_shapes.de = de_c;
+    sg_shapes.dx = dx_c;
+    sg_shapes.deap = deap_c;
+    sg_shapes.sun = sun_c;
+    sg_shapes.moon = moon_c;
+    sg_shapes.santa = santa_b;
+    sg_built_gen = sg_gen;
+}
+
 /* return whether coordinate s is over any symbol
  */
 bool overAnySymbol (const SCoord &s)
 {
-    return (inCircle(s, de_c) || inCircle(s, dx_c) || inCircle(s, deap_c)
-                || inCircle (s, sun_c) || inCircle (s, moon_c) || overAnyBeacon(s)
-                || overAnyDXSpots(s) || inBox(s,santa_b));
+    // just the groups with any part in the cell containing s
+    sgBuild();
+    uint16_t g = s.x < SG_NX*SG_CELL && s.y < SG_NY*SG_CELL ? sg_cells[s.y/SG_CELL][s.x/SG_CELL] : 0xffff;
+    if (!g)
+        return (false);
+
+    return (((g & SG_DE) && inCircle(s, de_c)) || ((g & SG_DX) && inCircle(s, dx_c))
+                || ((g & SG_DEAP) && inCircle(s, deap_c)) || ((g & SG_SUN) && inCircle (s, sun_c))
+                || ((g & SG_MOON) && inCircle (s, moon_c)) || ((g & SG_BEACONS) && overAnyBeacon(s))
+                || ((g & SG_SPOTS) && overAnyDXSpots(s)) || ((g & SG_SATS) && overAnySatTracker(s))
+                || ((g & SG_SANTA) && inBox(s,santa_b)));
 }
 
 /* draw all symbols, order establishes layering priority
@@ -1452,6 +1605,7 @@ void drawAllSymbols(bool erase_too)
     if (!overRSS(deap_c.s))
         drawDEAPMarker();
     drawDXSpotsOnMap();
+    drawSatTrackerOnMap();
     drawSanta ();
 
     updateClocks(false);
@@ -1825,13 +1979,13 @@ void setMapTagBox (const char *tag, const SCoord &s, uint16_t r, SBox &box)
 
 /* draw a small string within the given box set by setMapTagBox
  */
-void drawMapTag (const char *tag, SBox &box)
+void drawMapTag (const char *tag, SBox &box, uint16_t color)
 {
     // draw
     tft.fillRect (box.x, box.y, box.w, box.h, RA8875_BLACK);
     selectFontStyle (LIGHT_FONT, FAST_FONT);
     tft.setCursor (box.x+2, box.y);
-    tft.setTextColor (RA8875_WHITE);
+    tft.setTextColor (color);
     tft.print((char*)tag);
 }
 
@@ -1902,6 +2056,9 @@ void resetWatchdog()
     }
     prev_ms = ms;
 
+    // tell stall detector main loop is still running
+    stallCheckIn (ms);
+
     ESP.wdtFeed();
     yield();
 }
@@ -2124,7 +2281,16 @@ void printFreeHeap (const __FlashStringHelper *label)
     // getFreeHeap() is close to binary search of max malloc
     Serial.printf (_FX("Up %lu s: "), millis()/1000U); // N.B. do not use getUptime here, it loops NTP
     Serial.print (label);
+#if defined(_USE_UNIX)
+    // free heap is what the system has left, so also show our own use and charge any change to label
+    MemStats ms;
+    bool kernel_ok = readMemStats (ms);
+    memStatsLabel (label, ms.heap_used);
+    Serial.printf (_FX("(), free heap %d, stack size %d, heap in use %ld, RSS %ld\n"), free_heap, stack_used,
+                                ms.heap_used, kernel_ok ? ms.rss : -1L);
+#else
     Serial.printf (_FX("(), free heap %d, stack size %d\n"), free_heap, stack_used);
+#endif
 
     // record worst
     if (free_heap < worst_heap)
@@ -7,7 +7,7 @@
 
 
 // handy build categories
-#if defined(_USE_X11) || defined(_USE_FB0)
+#if defined(_USE_X11) || defined(_USE_FB0) || defined(_USE_BENCH)
 #define _USE_DESKTOP
 #endif
 
@@ -126,6 +126,13 @@
 
 
 
+#if defined(_USE_UNIX)
+extern void memStatsStackMalloc (long nbytes);          // see memstats.cpp
+#define SM_COUNT(n)     memStatsStackMalloc(n)
+#else
+#define SM_COUNT(n)
+#endif
+
 /* handy malloc wrapper that frees automatically when leaves scope
  */
 class StackMalloc 
@@ -136,17 +143,20 @@ class StackMalloc
             // printf ("SM: new %lu\n", nbytes);
             mem = (char *) malloc (nbytes);
             siz = nbytes;
+            SM_COUNT ((long)siz);
         }
 
         StackMalloc (const char *string) {
             // printf ("SM: new %s\n", string);
             mem = (char *) strdup (string);
             siz = strlen(string) + 1;
+            SM_COUNT ((long)siz);
         }
 
         ~StackMalloc (void) {
             // printf ("SM: free(%d)\n", siz);
             free (mem);
+            SM_COUNT (-(long)siz);
         }
 
         size_t getSize(void) {
@@ -272,6 +282,18 @@ extern const char *_FX_helper(const __FlashStringHelper *flash_string);
 #define _FX(x)  x
 #endif
 
+// ESP has no main loop scheduler, it just runs loop() again
+#if !defined(_USE_UNIX)
+#define wakeLoopIn(ms)
+#endif
+
+// log at a level from this call site, see Serial.h. ESP Serial has no levels so log everything there.
+#if defined(_USE_UNIX)
+#define LOGF(l,...)     Serial.lprintfAt (l, __FILE__, __LINE__, __VA_ARGS__)
+#else
+#define LOGF(l,...)     Serial.printf (__VA_ARGS__)
+#endif
+
 #define RSS_BG_COLOR    RGB565(0,40,80)		// RSS banner background color
 #define RSS_FG_COLOR    RA8875_WHITE		// RSS banner text color
 
@@ -305,6 +327,8 @@ extern void setDXPathInvalid(void);
 extern void drawRSSButton(void);
 extern bool overMap (const SCoord &s);
 extern bool overAnySymbol (const SCoord &s);
+extern void mapSymbolsMoved(void);
+extern void markSymbolBox (const SBox &b);
 extern bool overRSS (const SCoord &s);
 extern bool overRSS (const SBox &b);
 extern void drawAzmMercButton (void);
@@ -321,7 +345,7 @@ extern bool screenIsLocked(void);
 extern time_t getUptime (uint16_t *days, uint8_t *hrs, uint8_t *mins, uint8_t *secs);
 extern void eraseScreen(void);
 extern void setMapTagBox (const char *tag, const SCoord &c, uint16_t r, SBox &box);
-extern void drawMapTag (const char *tag, SBox &box);
+extern void drawMapTag (const char *tag, SBox &box, uint16_t color = RA8875_WHITE);
 extern void setDXPrefixOverride (char p[MAX_PREF_LEN]);
 extern bool getDXPrefix (char p[MAX_PREF_LEN+1]);
 extern void call2Prefix (const char *call, char prefix[MAX_PREF_LEN]);
@@ -351,6 +375,7 @@ extern void doOTAupdate(void);
 extern void subSolar (time_t t, LatLong &ll);
 extern void subLunar (time_t t, LatLong &ll);
 extern void sunrs (const time_t &t0, const LatLong &ll, time_t *riset, time_t *sett);
+extern void sunrsMany (const time_t &t0, const LatLong ll[], int n, time_t riset[], time_t sett[]);
 extern float rad2deg(float r);
 extern float deg2rad(float d);
 
@@ -443,6 +468,18 @@ extern void hsvtorgb(uint8_t *r, uint8_t *g, uint8_t *b, uint8_t h, uint8_t s, u
 
 
 
+/*********************************************************************************************
+ *
+ * cty.cpp
+ *
+ */
+
+extern bool ctyLookup (const char *call, LatLong &ll, char *entity, size_t entity_len);
+extern bool ctyDXCC (const char *call, char *prefix, size_t prefix_len);
+
+
+
+
 /*********************************************************************************************
  *
  * dxcluster.cpp
@@ -465,11 +502,15 @@ extern void closeDXCluster(void);
 extern bool checkDXTouch (const SCoord &s);
 extern bool getDXSpots (DXSpot **spp, uint8_t *nspotsp);
 extern bool overAnyDXSpots(const SCoord &s);
+extern void markDXSpotSymbols(void);
 extern void drawDXSpotsOnMap (void);
 extern void updateDXSpotScreenLocations(void);
 extern bool isDXConnected(void);
 extern bool sendDELLGrid(void);
 
+extern bool crackDXClusterSpot (const char *line, char call[MAX_DXSPOTCALL_LEN], char de_call[MAX_DXSPOTCALL_LEN],
+        float *kHzp, uint8_t *modep);
+
 
 
 
@@ -590,6 +631,20 @@ extern bool getSatAzElNow (char *name, float *azp, float *elp, float *rangep, fl
         float *razp, float *sazp, float *rdtp, float *sdtp);
 extern bool isNewPass(void);
 extern bool isSatMoon(void);
+extern bool tleHasValidChecksum (const char *line);
+
+// one satellite pass, see findSatPass()
+typedef struct {
+    DateTime rise_t, set_t, max_t;      // rise, set and culmination times
+    float rise_az, set_az;              // rise and set az, degrees
+    float max_el, max_az;               // culmination el and az, degrees
+    bool up_now;                        // whether already up at start of search, then rise_ is start
+    bool rise_ok, set_ok, max_ok;       // whether corresponding fields are valid
+    uint16_t n_eval;                    // n predictions required
+} SatPassInfo;
+
+extern void findSatPass (Satellite *sp, const Observer *op, const DateTime &t0, float max_days,
+        SatPassInfo &pass);
 
 #define SAT_NOAZ        (-999)  // error flag
 #define SAT_MIN_EL      1.0F    // rise elevation
@@ -715,6 +770,35 @@ extern FS_Info *getConfigDirInfo (int *n_info, char **fs_name, uint64_t *fs_size
 
 
 
+/*********************************************************************************************
+ *
+ * memstats.cpp
+ *
+ */
+
+// process memory use, all in bytes
+typedef struct {
+    long rss;                                   // resident set
+    long rss_peak;                              // peak resident set
+    long vsize;                                 // virtual size
+    long n_maps;                                // n memory mappings
+    long heap_arena;                            // malloc arena from sbrk
+    long heap_used;                             // malloc in use, including heap_mmap
+    long heap_free;                             // free within arena
+    long heap_mmap;                             // large chunks malloc gave their own mmap
+    long n_heap_mmap;                           // n such chunks
+} MemStats;
+
+#if defined(_USE_UNIX)
+extern bool readMemStats (MemStats &ms);
+extern void memStatsLabel (const char *label, long heap_used);
+#endif
+extern void checkMemStats (void);
+extern void reportMemStats (WiFiClient &client);
+
+
+
+
 /*********************************************************************************************
  *
  * ncdxf.cpp
@@ -724,6 +808,7 @@ extern FS_Info *getConfigDirInfo (int *n_info, char **fs_name, uint64_t *fs_size
 extern void updateBeacons (bool erase_too, bool immediate, bool force);
 extern void updateBeaconScreenLocations(void);
 extern bool overAnyBeacon (const SCoord &s);
+extern void markBeaconSymbols(void);
 extern void drawBeaconBox();
 
 typedef uint8_t BeaconID;
@@ -860,6 +945,67 @@ extern void unpackMaidToStr (char maidstr[5], uint32_t grid);
 
 
 
+/*********************************************************************************************
+ *
+ * perf.cpp
+ *
+ */
+
+// main loop sections whose execution times are recorded, inclusive of any nested sections
+typedef enum {
+    PERF_LOOP,
+    PERF_WIFI,
+    PERF_DXCLUSTER,
+    PERF_WEB,
+    PERF_RSS,
+    PERF_CLOCKS,
+    PERF_SATPASS,
+    PERF_SATCAT,
+    PERF_SATTRACK,
+    PERF_BEACONS,
+    PERF_EARTH,
+    PERF_SATPATH,
+    PERF_TOUCH,
+    PERF_OTHER,
+
+    // metrics of each frame presented by the desktop display thread, collected by perfFrames()
+    PERF_FRAME_COPY,
+    PERF_FRAME_UPLOAD,
+    PERF_FRAME_DIRTY,                   // pixels, not microseconds
+    PERF_FRAME_LATENCY,
+
+    PERF_N
+} PerfSection;
+
+extern void perfRecord (PerfSection s, uint32_t us);
+extern void perfFrames (void);
+extern void reportPerf (WiFiClient &client);
+
+/* records the time from construction until leaving scope against the given section
+ */
+class PerfTimer
+{
+    public:
+
+        PerfTimer (PerfSection s) {
+            sec = s;
+            t0 = micros();
+        }
+
+        ~PerfTimer (void) {
+            perfRecord (sec, micros() - t0);
+        }
+
+    private:
+
+        PerfSection sec;
+        uint32_t t0;
+};
+
+
+
+
+
 /*********************************************************************************************
  *
  * plot.cpp
@@ -910,7 +1056,8 @@ typedef struct {
 } WXInfo;
 #define	N_WXINFO_FIELDS	8
 
-extern void BCHelper (const SBox *bp, int busy, float rel_table[PROP_MAP_N], char *config_str);
+extern void BCHelper (const SBox *bp, int busy, float rel_table[PROP_MAP_N], char *config_str,
+        const char *title);
 extern bool plotBandConditions (const SBox &box, char response[], char config[]);
 extern bool plotXY (const SBox &box, float x[], float y[], int nxy, const char *xlabel,
 	const char *ylabel, uint16_t color, float center_value);
@@ -937,6 +1084,24 @@ extern bool nearestPrefix (const LatLong &ll, char prefix[MAX_PREF_LEN+1]);
 
 
 
+/*********************************************************************************************
+ *
+ * propmodel.cpp
+ *
+ */
+
+extern void setPropModelSSN (float ssn);
+extern void setPropModelSFI (float sfi);
+extern void setPropModelKp (float kp);
+extern void propModelBC (float rel[PROP_MAP_N], char cfg[], size_t cfg_len);
+#if defined(_USE_UNIX)
+extern bool propModelMap (float MHz, uint8_t *rel, int w, int h);
+extern void propModelRecord (const char *response);
+#endif
+
+
+
+
 /*********************************************************************************************
  *
  * radio.cpp
@@ -958,6 +1123,50 @@ extern SBox santa_b;
 
 
 
+/*********************************************************************************************
+ *
+ * satcat.cpp
+ *
+ */
+
+extern void initSatCatalog(void);
+extern void updateSatCatalog(void);
+extern bool satCatLookup (const char *name, char name_out[NV_SATNAME_LEN], char t1[TLE_LINEL],
+    char t2[TLE_LINEL]);
+extern bool satCatLookupNum (uint32_t catnum, char name[NV_SATNAME_LEN], char t1[TLE_LINEL],
+    char t2[TLE_LINEL]);
+extern bool satCatGet (uint16_t i, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL]);
+extern bool satCatPending (const char *name);
+
+
+
+
+/*********************************************************************************************
+ *
+ * sattrack.cpp
+ *
+ */
+
+// one pass of a tracked satellite over DE
+typedef struct {
+    char name[NV_SATNAME_LEN];          // sat name, blanks are underscores
+    time_t rise_t;                      // rise time, or when schedule was made if already up
+    time_t set_t;                       // set time, or 0 if not set within schedule
+    float rise_az, set_az;              // rise and set az, degrees
+    float max_el;                       // max elevation, degrees
+} SatTrackPass;
+
+extern void initSatTracker(void);
+extern bool setSatTrackNames (const char *names);
+extern void updateSatTracker(void);
+extern void updateSatTrackerScreenLocations(void);
+extern void drawSatTrackerOnMap(void);
+extern bool overAnySatTracker (const SCoord &s);
+extern void markSatTrackerSymbols(void);
+extern bool getSatTrackPasses (const SatTrackPass **passes, uint16_t *n_passes);
+
+
+
 /*********************************************************************************************
  *
  * selectFont.cpp
@@ -995,6 +1204,55 @@ extern void solveSphere (float A, float b, float cc, float sc, float *cap, float
 
 
 
+
+/*********************************************************************************************
+ *
+ * spotstore.cpp
+ *
+ */
+
+#define MAX_SPOTDXCC_LEN        8
+typedef struct {
+    char call[MAX_DXSPOTCALL_LEN];      // call spotted
+    char de_call[MAX_DXSPOTCALL_LEN];   // spotter, or empty
+    char dxcc[MAX_SPOTDXCC_LEN];        // DXCC primary prefix, or empty
+    float kHz;                          // frequency
+    float lat_d, lng_d;                 // location, degs +N +E
+    time_t t;                           // UNIX time spotted
+    uint8_t band;                       // band in meters, 0 if out of band
+    uint8_t mode;                       // see spotModeName()
+} SpotRec;
+
+typedef struct {
+    int band;                           // band in meters, or 0 for any
+    uint8_t mode;                       // mode, or 0 for any
+    const char *dxcc;                   // DXCC primary prefix, or NULL for any
+    const char *call;                   // call, or NULL for any
+    time_t since;                       // earliest time, or 0 for any
+} SpotQuery;
+
+extern bool spotStoreAdd (const SpotRec &r);
+extern bool spotStoreIsDup (const char *call, float kHz, time_t t);
+extern int spotStoreQuery (const SpotQuery &q, SpotRec out[], int max_out);
+extern int spotStoreCount(void);
+extern uint8_t spotModeFromName (const char *name);
+extern const char *spotModeName (uint8_t mode);
+extern uint8_t spotModeGuess (const char *comment, float kHz);
+
+
+
+
+/*********************************************************************************************
+ *
+ * spotfeed.cpp
+ *
+ */
+
+extern void initSpotFeeds(void);
+extern bool reportSpotFeeds (WiFiClient &client);
+
+
+
 /*********************************************************************************************
  *
  * touch.cpp
@@ -1019,6 +1277,20 @@ extern SCoord wifi_tt_s;
 
 
 
+/*********************************************************************************************
+ *
+ * stall.cpp
+ *
+ */
+
+extern void startStallDetector(void);
+extern void stallCheckIn (uint32_t ms);
+extern void reportStalls (WiFiClient &client);
+
+
+
+
+
 /*********************************************************************************************
  *
  * stopwatch.cpp
@@ -1043,6 +1315,7 @@ extern uint32_t getCountdownLeft(void);
  *
  */
 extern int32_t getTZ (const LatLong &ll);
+extern const char *getTZName (const LatLong &ll);
 
 
 
@@ -1083,6 +1356,9 @@ extern bool wifiOk(void);
 extern void httpGET (WiFiClient &client, const char *server, const char *page);
 extern bool httpSkipHeader (WiFiClient &client);
 extern bool httpSkipHeader (WiFiClient &client, uint32_t *lastmodp);
+extern void threadHttpGET (WiFiClient &client, const char *server, const char *page);
+extern bool threadGetTCPLine (WiFiClient &client, char line[], uint16_t line_len);
+extern bool threadHttpSkipHeader (WiFiClient &client);
 extern void FWIFIPR (WiFiClient &client, const __FlashStringHelper *str);
 extern void FWIFIPRLN (WiFiClient &client, const __FlashStringHelper *str);
 extern bool setPlot1 (PLOT1_Choices p1);
@@ -1095,6 +1371,26 @@ extern uint16_t bc_power;
 
 
 
+/*********************************************************************************************
+ *
+ * wsjtx.cpp
+ *
+ */
+
+#include "wsjtx.h"
+
+// context carried from Status to later messages
+typedef struct {
+    uint64_t dial_hz;
+    uint8_t mode;
+    char de_call[MAX_DXSPOTCALL_LEN];
+} WSJTXState;
+
+extern bool wsjtxSpot (const WSJTXMsg &m, WSJTXState &st, SpotRec &r, char grid[5]);
+
+
+
+
 /*********************************************************************************************
  *
  * wx.cpp
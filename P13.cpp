@@ -25,8 +25,10 @@
 //
 
 // Added a few select DateTime overloaded operators and _DATETIME_UNITTEST	-- ECD
+// Added optional double precision SGP4 propagation per Satellite, see SGP4.cpp	-- ECD
 
 #include "P13.h"
+#include "SGP4.h"
 
 // here are a bunch of constants that will be used throughout the
 // code, but which will probably not be helpful outside.
@@ -52,6 +54,7 @@ static const float EQC2 = 0.00035 ;
 static const float INS = (23.4375f)*M_PI/180.0 ;
 static const float CNS = cosf(INS) ;
 static const float SNS = sinf(INS) ;
+static const double JD_DN = 1721409.5 ;         // julian date of fnday() 0
 
 
 float
@@ -276,13 +279,15 @@ getlong(const char *c, int i0, int i1)
     return atol(buf) ;
 }
 
-Satellite::Satellite(const char *l1, const char *l2)
+Satellite::Satellite(const char *l1, const char *l2, bool use_sgp4)
 {
+    sgp4 = use_sgp4 ? new SGP4 : NULL ;
     tle(l1, l2) ;
 }
 
 Satellite::~Satellite()
 {
+    delete sgp4 ;
 }
 
 void
@@ -318,20 +323,67 @@ Satellite::tle(const char *l1, const char *l2)
     B_0 = A_0*sqrt(1.F-EC*EC) ;
     PC = RE*A_0/(B_0*B_0) ;
     PC = 1.5f*J2*PC*PC*MM ;
-    float CI = cosf(IN) ;
+    CI = cosf(IN) ;
+    SI = sinf(IN) ;
     QD = -PC*CI ;
     WD =  PC*(5*CI*CI-1)/2 ;
     DC = -2*M2/(3*MM) ;
+
+    // greenwich hour angle at epoch
+    float TEG = DE - fnday(YG, 1, 0) + TE ;
+    GHAE = RADIANS(G0) + TEG * WE ;
+
+    // SGP4 too if wanted, else quietly stay with Plan-13
+    if (sgp4 && !sgp4->init(l1, l2)) {
+        delete sgp4 ;
+        sgp4 = NULL ;
+    }
+}
+
+/* find the SGP4 geocentric position GS and velocity GV at the given day number and fraction, and
+ * optionally the celestial CS and CV. return false if SGP4 fails so caller can fall back to Plan-13.
+ */
+bool
+Satellite::predictSGP4(long DN, double TN, float *GS, float *GV, float *CS, float *CV)
+{
+    double jd = DN + JD_DN + TN ;
+    double r[3], v[3] ;
+    if (!sgp4->propagate((jd - sgp4->jdepoch)*1440.0, r, v))
+        return (false) ;
+
+    // TEME to earth fixed
+    double G = SGP4::gmst(jd) ;
+    double CG = cos(G) ;
+    double SG = sin(G) ;
+
+    GS[0] = r[0] * CG + r[1] * SG ;
+    GS[1] = r[1] * CG - r[0] * SG ;
+    GS[2] = r[2] ;
+
+    GV[0] = v[0] * CG + v[1] * SG ;
+    GV[1] = v[1] * CG - v[0] * SG ;
+    GV[2] = v[2] ;
+
+    if (CS) {
+        for (int i = 0; i < 3; i++) {
+            CS[i] = r[i] ;
+            CV[i] = v[i] ;
+        }
+    }
+
+    return (true) ;
 }
+
 void
 Satellite::predict(const DateTime &dt)
 {
     long DN = dt.DN ;
     float TN = dt.TN ;
 
-    float TEG = DE - fnday(YG, 1, 0) + TE ;
-
-    float GHAE = RADIANS(G0) + TEG * WE ;
+    if (sgp4 && predictSGP4(DN, TN, S, V, SAT, VEL)) {
+        RS = sqrtf(SAT[0]*SAT[0] + SAT[1]*SAT[1] + SAT[2]*SAT[2]) ;
+        return ;
+    }
 
     float T = (float) (DN - DE) + (TN-TE) ;
     float DT = DC * T / 2.F ;
@@ -376,9 +428,6 @@ Satellite::predict(const DateTime &dt)
     float CQ = cosf(RAAN) ;
     float SQ = sinf(RAAN) ;
 
-    float CI = cosf(IN) ;
-    float SI = sinf(IN) ;
-
     // CX, CY, and CZ form a 3x3 matrix
     // that converts between orbit coordinates,
     // and celestial coordinates.
@@ -422,11 +471,164 @@ Satellite::predict(const DateTime &dt)
     V[2] = VEL[2] ;
 }
 
+// number of epochs predictT() works on together, small enough for ESP stack
+#define PREDICT_BATCH   16
+
+/* geocentric S and V at each of n times T, days since epoch.
+ * same model as predict() but each step is a tight loop over all the epochs in the batch so the
+ * per-orbit constants are loaded once and the compiler is free to vectorize the plain arithmetic.
+ */
+void
+Satellite::predictT(const float T[], int n, SatState out[])
+{
+    float M[PREDICT_BATCH], KD[PREDICT_BATCH], KDP[PREDICT_BATCH] ;
+    float C_EA[PREDICT_BATCH], S_EA[PREDICT_BATCH], DNOM[PREDICT_BATCH] ;
+
+    for (int i0 = 0; i0 < n; i0 += PREDICT_BATCH) {
+        int nb = n - i0 < PREDICT_BATCH ? n - i0 : PREDICT_BATCH ;
+        const float *Tb = &T[i0] ;
+        SatState *ob = &out[i0] ;
+
+        // drag and mean anomaly
+        for (int i = 0; i < nb; i++) {
+            float DT = DC * Tb[i] / 2.F ;
+            KD[i] = 1.F + 4.F * DT ;
+            KDP[i] = 1.F - 7.F * DT ;
+            float Mi = MA + MM * Tb[i] * (1.F - 3.F * DT) ;
+            float DR = (long) (Mi / (2.F * M_PI)) ;
+            M[i] = Mi - DR * 2.F * M_PI ;
+        }
+
+        // solve Kepler's equation
+        for (int i = 0; i < nb; i++) {
+            float EA = M[i] ;
+            for (;;) {
+                C_EA[i] = cosf(EA) ;
+                S_EA[i] = sinf(EA) ;
+                DNOM[i] = 1.F - EC * C_EA[i] ;
+                float D = (EA-EC*S_EA[i]-M[i])/DNOM[i] ;
+                EA -= D ;
+                if (fabs(D) < 1e-5)
+                    break ;
+            }
+        }
+
+        // rotate from orbit plane through celestial to geocentric
+        for (int i = 0; i < nb; i++) {
+            float A = A_0 * KD[i] ;
+            float B = B_0 * KD[i] ;
+            float Sx = A * (C_EA[i] - EC) ;
+            float Sy = B * S_EA[i] ;
+            float Vx = -A * S_EA[i] / DNOM[i] * N0 ;
+            float Vy =  B * C_EA[i] / DNOM[i] * N0 ;
+
+            float AP = WP + WD * Tb[i] * KDP[i] ;
+            float CW = cosf(AP) ;
+            float SW = sinf(AP) ;
+            float RAAN = RA + QD * Tb[i] * KDP[i] ;
+            float CQ = cosf(RAAN) ;
+            float SQ = sinf(RAAN) ;
+
+            float CX0 =  CW * CQ - SW * CI * SQ ;
+            float CX1 = -SW * CQ - CW * CI * SQ ;
+            float CY0 =  CW * SQ + SW * CI * CQ ;
+            float CY1 = -SW * SQ + CW * CI * CQ ;
+            float CZ0 = SW * SI ;
+            float CZ1 = CW * SI ;
+
+            float SAT0 = Sx * CX0 + Sy * CX1 ;
+            float SAT1 = Sx * CY0 + Sy * CY1 ;
+            float VEL0 = Vx * CX0 + Vy * CX1 ;
+            float VEL1 = Vx * CY0 + Vy * CY1 ;
+
+            float GHAA = (GHAE + WE * Tb[i]) ;
+            float CG = cosf(-GHAA) ;
+            float SG = sinf(-GHAA) ;
+
+            ob[i].S[0] = SAT0 * CG - SAT1 * SG ;
+            ob[i].S[1] = SAT0 * SG + SAT1 * CG ;
+            ob[i].S[2] = Sx * CZ0 + Sy * CZ1 ;
+            ob[i].V[0] = VEL0 * CG - VEL1 * SG ;
+            ob[i].V[1] = VEL0 * SG + VEL1 * CG ;
+            ob[i].V[2] = Vx * CZ0 + Vy * CZ1 ;
+        }
+    }
+}
+
+/* predict geocentric S and V at each of n arbitrary times.
+ * N.B. does not change the state left by predict()
+ */
+void
+Satellite::predictMany(const DateTime t[], int n, SatState out[])
+{
+    float T[PREDICT_BATCH] ;
+
+    if (sgp4) {
+        for (int i = 0; i < n; i++) {
+            if (!predictSGP4 (t[i].DN, t[i].TN, out[i].S, out[i].V, NULL, NULL)) {
+                T[0] = (float) (t[i].DN - DE) + (t[i].TN - TE) ;
+                predictT (T, 1, &out[i]) ;
+            }
+        }
+        return ;
+    }
+
+    for (int i0 = 0; i0 < n; i0 += PREDICT_BATCH) {
+        int nb = n - i0 < PREDICT_BATCH ? n - i0 : PREDICT_BATCH ;
+        for (int i = 0; i < nb; i++)
+            T[i] = (float) (t[i0+i].DN - DE) + (t[i0+i].TN - TE) ;
+        predictT (T, nb, &out[i0]) ;
+    }
+}
+
+/* predict geocentric S and V at n times starting at t0 and separated by step days.
+ * N.B. does not change the state left by predict()
+ */
+void
+Satellite::predictMany(const DateTime &t0, float step, int n, SatState out[])
+{
+    float T[PREDICT_BATCH] ;
+    float T0 = (float) (t0.DN - DE) + (t0.TN - TE) ;
+
+    if (sgp4) {
+        for (int i = 0; i < n; i++) {
+            if (!predictSGP4 (t0.DN, t0.TN + (double)i*step, out[i].S, out[i].V, NULL, NULL)) {
+                T[0] = T0 + i*step ;
+                predictT (T, 1, &out[i]) ;
+            }
+        }
+        return ;
+    }
+
+    for (int i0 = 0; i0 < n; i0 += PREDICT_BATCH) {
+        int nb = n - i0 < PREDICT_BATCH ? n - i0 : PREDICT_BATCH ;
+        for (int i = 0; i < nb; i++)
+            T[i] = T0 + (i0+i)*step ;
+        predictT (T, nb, &out[i0]) ;
+    }
+}
+
 /* find local apparent circumstances
  */
 void
 Satellite::topo(const Observer *obs, float &alt, float &az, float &range, float &range_rate)
 {
+    SatState st ;
+    for (int i = 0; i < 3; i++) {
+        st.S[i] = S[i] ;
+        st.V[i] = V[i] ;
+    }
+    topo (obs, st, alt, az, range, range_rate) ;
+}
+
+/* find local apparent circumstances of the given state, such as from predictMany()
+ */
+void
+Satellite::topo(const Observer *obs, const SatState &st, float &alt, float &az, float &range, float &range_rate)
+{
+    const float *S = st.S ;
+    const float *V = st.V ;
+
     Vec3 R ;
     R[0] = S[0] - obs->O[0] ;
     R[1] = S[1] - obs->O[1] ;
@@ -447,8 +649,10 @@ Satellite::topo(const Observer *obs, float &alt, float &az, float &range, float
 
     alt = DEGREES(asinf(u)) ;
 
-    // Saemundson refraction, true to apparent, 10C 1000 mbar (29.5 inch Hg)
-    alt += (1000.0F/1010.0F)*(283.0F/(273.0F+10.0F))*1.02F/tanf(RADIANS(alt + 10.3F/(alt+5.11)))/60.0F;
+    // Saemundson refraction, true to apparent, 10C 1000 mbar (29.5 inch Hg).
+    // N.B. formula blows up near -5 so only apply near and above the horizon
+    if (alt > -2.0F)
+        alt += (1000.0F/1010.0F)*(283.0F/(273.0F+10.0F))*1.02F/tanf(RADIANS(alt + 10.3F/(alt+5.11)))/60.0F;
 }
 
 // subsat location
@@ -460,6 +664,15 @@ Satellite::geo(float &lat, float &lng)
     lng = atan2f(S[1],S[0]);
 }
 
+// subsat location of the given state, such as from predictMany()
+void
+Satellite::geo(const SatState &st, float &lat, float &lng)
+{
+    float r = sqrt(st.S[0]*st.S[0] + st.S[1]*st.S[1]);
+    lat = atan2(st.S[2],r);
+    lng = atan2f(st.S[1],st.S[0]);
+}
+
 // celestial coords
 void
 Satellite::celest (float &lat, float &lng)
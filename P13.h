@@ -44,6 +44,8 @@
 
 typedef float Vec3[3] ;
 
+class SGP4 ;
+
 
 extern float RADIANS(float deg);
 extern float DEGREES(float rad);
@@ -98,6 +100,13 @@ public:
 
 //----------------------------------------------------------------------
 
+// geocentric position and velocity of a satellite at one epoch, see Satellite::predictMany()
+typedef struct {
+    Vec3 S, V ;
+} SatState ;
+
+//----------------------------------------------------------------------
+
 class Satellite { 
   	long N ;
 	long YE ;	
@@ -119,6 +128,17 @@ class Satellite {
         float PC ;
         float QD, WD, DC ;
         float RS ;
+        float GHAE, CI, SI ;
+
+        void predictT(const float T[], int n, SatState out[]) ;
+
+        // optional double precision propagator used instead of Plan-13 if not NULL
+        SGP4 *sgp4 ;
+        bool predictSGP4(long DN, double TN, float *GS, float *GV, float *CS, float *CV) ;
+
+        // not copyable because of sgp4
+        Satellite(const Satellite &) ;
+        Satellite &operator= (const Satellite &) ;
 
 public:
         long DE ;
@@ -127,18 +147,24 @@ public:
 	Vec3 SAT, VEL ;		// celestial coordinates
     	Vec3 S, V ; 		// geocentric coordinates
  
-	Satellite() { } ;
-	Satellite(const char *l1, const char *l2) ;
+	Satellite() : sgp4(NULL) { } ;
+	Satellite(const char *l1, const char *l2, bool use_sgp4 = false) ;
 	~Satellite() ;
         void tle(const char *l1, const char *l2) ;
         void predict(const DateTime &dt) ;
 	bool eclipsed(Sun *sp);
 	void topo(const Observer *obs, float &alt, float &az, float &range, float &range_rate);
 	void geo(float &lat, float &lng);
+        void predictMany(const DateTime t[], int n, SatState out[]) ;
+        void predictMany(const DateTime &t0, float step, int n, SatState out[]) ;
+	static void topo(const Observer *obs, const SatState &st, float &alt, float &az, float &range,
+            float &range_rate);
+	static void geo(const SatState &st, float &lat, float &lng);
         void celest (float &lat, float &lng);
 	float period (void);
 	float viewingRadius(float alt);
 	DateTime epoch(void);
+        bool isSGP4(void) { return (sgp4 != NULL); }
 
 } ;
 
@@ -0,0 +1,1095 @@
+/* double precision SGP4/SDP4 orbit propagator, see SGP4.h.
+ *
+ * To build the stand-alone accuracy and speed harness that compares against the published
+ * reference vectors and times SGP4 against Plan-13:
+ *
+ *   g++ -O2 -D_SGP4_UNITTEST -o x.sgp4 SGP4.cpp P13.cpp && ./x.sgp4
+ *
+ * With no arguments only a few built-in vectors are checked. For the full verification run, including
+ * the 12 and 24 hour resonant objects, also give the SGP4-VER.TLE and tcppver.out files distributed with
+ * the reference code at https://celestrak.org/publications/AIAA/2006-6753/ :
+ *
+ *   ./x.sgp4 SGP4-VER.TLE tcppver.out
+ *
+ * Exit status is 0 only if every vector is within REF_TOL_KM.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SGP4.h"
+
+// WGS-72, as used to generate the element sets
+static const double RE_KM = 6378.135;                   // earth radius, km
+static const double MU = 398600.8;                      // km^3/s^2
+static const double XKE = 0.0743669161331734132;        // 60/sqrt(RE^3/MU), er^1.5/min
+static const double J2 = 0.001082616;
+static const double J3 = -0.00000253881;
+static const double J4 = -0.00000165597;
+static const double J3OJ2 = J3/J2;
+
+static const double TWOPI = 2.0*M_PI;
+static const double X2O3 = 2.0/3.0;
+static const double DEG2RAD = M_PI/180.0;
+static const double XPDOTP = 1440.0/TWOPI;              // rev/day -> rad/min
+
+/* return a double from the given TLE columns [i0,i1)
+ */
+static double tleDouble (const char *c, int i0, int i1)
+{
+    char buf[20];
+    int i;
+    for (i = 0; i0+i < i1 && c[i0+i]; i++)
+        buf[i] = c[i0+i];
+    buf[i] = '\0';
+    return (strtod (buf, NULL));
+}
+
+/* return a TLE field in the form [-]nnnnn[-+]e meaning [-]0.nnnnn x 10^[-+]e
+ */
+static double tleExpDouble (const char *c, int i0, int i1)
+{
+    char mant[20], ex[4];
+    int nm = 0;
+    mant[nm++] = '0';
+    mant[nm++] = '.';
+    double sign = 1;
+    for (int i = i0; i < i1-2 && c[i]; i++) {
+        if (c[i] == '-')
+            sign = -1;
+        else if (c[i] >= '0' && c[i] <= '9')
+            mant[nm++] = c[i];
+    }
+    mant[nm] = '\0';
+    ex[0] = c[i1-2] == '-' ? '-' : '+';
+    ex[1] = c[i1-1];
+    ex[2] = '\0';
+    return (sign * strtod (mant, NULL) * pow (10.0, atoi(ex)));
+}
+
+/* Greenwich mean sidereal time at the given julian date, radians
+ */
+double SGP4::gmst (double jd)
+{
+    double tut1 = (jd - 2451545.0) / 36525.0;
+    double temp = -6.2e-6*tut1*tut1*tut1 + 0.093104*tut1*tut1
+                    + (876600.0*3600 + 8640184.812866)*tut1 + 67310.54841;     // seconds
+    temp = fmod (temp*DEG2RAD/240.0, TWOPI);
+    if (temp < 0.0)
+        temp += TWOPI;
+    return (temp);
+}
+
+/* apply lunar-solar periodics at t minutes after epoch to the given deep space elements
+ */
+void SGP4::dpper (double t, double &ep, double &inclp, double &nodep, double &argpp, double &mp)
+{
+    const double zns = 1.19459e-5, zes = 0.01675, znl = 1.5835218e-4, zel = 0.05490;
+
+    double zm = zmos + zns*t;
+    double zf = zm + 2.0*zes*sin(zm);
+    double sinzf = sin(zf);
+    double f2 = 0.5*sinzf*sinzf - 0.25;
+    double f3 = -0.5*sinzf*cos(zf);
+    double ses = se2*f2 + se3*f3;
+    double sis = si2*f2 + si3*f3;
+    double sls = sl2*f2 + sl3*f3 + sl4*sinzf;
+    double sghs = sgh2*f2 + sgh3*f3 + sgh4*sinzf;
+    double shs = sh2*f2 + sh3*f3;
+
+    zm = zmol + znl*t;
+    zf = zm + 2.0*zel*sin(zm);
+    sinzf = sin(zf);
+    f2 = 0.5*sinzf*sinzf - 0.25;
+    f3 = -0.5*sinzf*cos(zf);
+    double sel = ee2*f2 + e3*f3;
+    double sil = xi2*f2 + xi3*f3;
+    double sll = xl2*f2 + xl3*f3 + xl4*sinzf;
+    double sghl = xgh2*f2 + xgh3*f3 + xgh4*sinzf;
+    double shll = xh2*f2 + xh3*f3;
+
+    double pe = ses + sel;
+    double pinc = sis + sil;
+    double pl = sls + sll;
+    double pgh = sghs + sghl;
+    double ph = shs + shll;
+
+    inclp += pinc;
+    ep += pe;
+    double sinip = sin(inclp);
+    double cosip = cos(inclp);
+
+    if (inclp >= 0.2) {
+        // apply periodics directly
+        ph /= sinip;
+        pgh -= cosip*ph;
+        argpp += pgh;
+        nodep += ph;
+        mp += pl;
+    } else {
+        // apply periodics with Lyddane modification
+        double sinop = sin(nodep);
+        double cosop = cos(nodep);
+        double alfdp = sinip*sinop;
+        double betdp = sinip*cosop;
+        double dalf = ph*cosop + pinc*cosip*sinop;
+        double dbet = -ph*sinop + pinc*cosip*cosop;
+        alfdp += dalf;
+        betdp += dbet;
+        nodep = fmod (nodep, TWOPI);
+        double xls = mp + argpp + cosip*nodep;
+        double dls = pl + pgh - pinc*nodep*sinip;
+        xls += dls;
+        double xnoh = nodep;
+        nodep = atan2 (alfdp, betdp);
+        if (fabs(xnoh - nodep) > M_PI) {
+            if (nodep < xnoh)
+                nodep += TWOPI;
+            else
+                nodep -= TWOPI;
+        }
+        mp += pl;
+        argpp = xls - mp - cosip*nodep;
+    }
+}
+
+/* deep space secular effects and resonance integration to time t, minutes since epoch
+ */
+void SGP4::dspace (double t, double tc, double &em, double &argpm, double &inclm, double &mm,
+double &nodem, double &dndt, double &nm)
+{
+    const double fasx2 = 0.13130908, fasx4 = 2.8843198, fasx6 = 0.37448087;
+    const double g22 = 5.7686396, g32 = 0.95240898, g44 = 1.8014998, g52 = 1.0508330, g54 = 4.4108898;
+    const double rptim = 4.37526908801129966e-3;        // earth rotation, rad/min
+    const double stepp = 720.0, stepn = -720.0, step2 = 259200.0;
+
+    dndt = 0.0;
+    double theta = fmod (gsto + tc*rptim, TWOPI);
+    em += dedt*t;
+    inclm += didt*t;
+    argpm += domdt*t;
+    nodem += dnodt*t;
+    mm += dmdt*t;
+
+    if (irez == 0)
+        return;
+
+    // restart the integrator from epoch unless continuing in the same direction
+    if (atime == 0.0 || t*atime <= 0.0 || fabs(t) < fabs(atime)) {
+        atime = 0.0;
+        xni = no;
+        xli = xlamo;
+    }
+    double delt = t > 0.0 ? stepp : stepn;
+
+    double xndt, xldot, xnddt, ft = 0.0;
+    for (;;) {
+        if (irez != 2) {
+            // near synchronous resonance terms
+            xndt = del1*sin(xli - fasx2) + del2*sin(2.0*(xli - fasx4)) + del3*sin(3.0*(xli - fasx6));
+            xldot = xni + xfact;
+            xnddt = del1*cos(xli - fasx2) + 2.0*del2*cos(2.0*(xli - fasx4))
+                        + 3.0*del3*cos(3.0*(xli - fasx6));
+            xnddt *= xldot;
+        } else {
+            // near half day resonance terms
+            double xomi = argpo + argpdot*atime;
+            double x2omi = xomi + xomi;
+            double x2li = xli + xli;
+            xndt = d2201*sin(x2omi + xli - g22) + d2211*sin(xli - g22)
+                 + d3210*sin(xomi + xli - g32) + d3222*sin(-xomi + xli - g32)
+                 + d4410*sin(x2omi + x2li - g44) + d4422*sin(x2li - g44)
+                 + d5220*sin(xomi + xli - g52) + d5232*sin(-xomi + xli - g52)
+                 + d5421*sin(xomi + x2li - g54) + d5433*sin(-xomi + x2li - g54);
+            xldot = xni + xfact;
+            xnddt = d2201*cos(x2omi + xli - g22) + d2211*cos(xli - g22)
+                  + d3210*cos(xomi + xli - g32) + d3222*cos(-xomi + xli - g32)
+                  + d5220*cos(xomi + xli - g52) + d5232*cos(-xomi + xli - g52)
+                  + 2.0*(d4410*cos(x2omi + x2li - g44) + d4422*cos(x2li - g44)
+                        + d5421*cos(xomi + x2li - g54) + d5433*cos(-xomi + x2li - g54));
+            xnddt *= xldot;
+        }
+
+        if (fabs(t - atime) < stepp) {
+            ft = t - atime;
+            break;
+        }
+
+        xli += xldot*delt + xndt*step2;
+        xni += xndt*delt + xnddt*step2;
+        atime += delt;
+    }
+
+    nm = xni + xndt*ft + xnddt*ft*ft*0.5;
+    double xl = xli + xldot*ft + xndt*ft*ft*0.5;
+    if (irez != 1)
+        mm = xl - 2.0*nodem + 2.0*theta;
+    else
+        mm = xl - nodem - argpm + theta;
+    dndt = nm - no;
+    nm = no + dndt;
+}
+
+/* load the given TLE and initialize all propagation coefficients.
+ * return whether the elements are usable.
+ */
+bool SGP4::init (const char *l1, const char *l2)
+{
+    memset (this, 0, sizeof(*this));
+
+    // elements
+    int epochyr = (int) tleDouble (l1, 18, 20);
+    double epochdays = tleDouble (l1, 20, 32);
+    bstar = tleExpDouble (l1, 53, 61);
+    inclo = tleDouble (l2, 8, 16) * DEG2RAD;
+    nodeo = tleDouble (l2, 17, 25) * DEG2RAD;
+    ecco = tleDouble (l2, 26, 33) / 1e7;
+    argpo = tleDouble (l2, 34, 42) * DEG2RAD;
+    mo = tleDouble (l2, 43, 51) * DEG2RAD;
+    no = tleDouble (l2, 52, 63) / XPDOTP;
+    if (no <= 0.0 || ecco >= 1.0) {
+        error = 1;
+        return (false);
+    }
+
+    // julian date of epoch
+    int year = epochyr < 57 ? epochyr + 2000 : epochyr + 1900;
+    jdepoch = 367.0*year - floor(7.0*year*0.25) + 31.0 + 1721013.5 - 1.0 + epochdays;
+    double epoch = jdepoch - 2433281.5;                 // days since 1950 Jan 0
+
+    // un-Kozai the mean motion
+    double eccsq = ecco*ecco;
+    double omeosq = 1.0 - eccsq;
+    double rteosq = sqrt(omeosq);
+    double cosio = cos(inclo);
+    double cosio2 = cosio*cosio;
+    double ak = pow (XKE/no, X2O3);
+    double d1 = 0.75*J2*(3.0*cosio2 - 1.0)/(rteosq*omeosq);
+    double del = d1/(ak*ak);
+    double adel = ak*(1.0 - del*del - del*(1.0/3.0 + 134.0*del*del/81.0));
+    del = d1/(adel*adel);
+    no = no/(1.0 + del);
+
+    double ao = pow (XKE/no, X2O3);
+    double sinio = sin(inclo);
+    double po = ao*omeosq;
+    double con42 = 1.0 - 5.0*cosio2;
+    con41 = -con42 - cosio2 - cosio2;
+    double posq = po*po;
+    double rp = ao*(1.0 - ecco);
+    method = 'n';
+    gsto = gmst (jdepoch);
+
+    // atmosphere model, altered for perigees below 156 km
+    double ss = 78.0/RE_KM + 1.0;
+    double qzms2t = pow ((120.0 - 78.0)/RE_KM, 4.0);
+    isimp = rp < 220.0/RE_KM + 1.0;
+    double sfour = ss;
+    double qzms24 = qzms2t;
+    double perige = (rp - 1.0)*RE_KM;
+    if (perige < 156.0) {
+        sfour = perige < 98.0 ? 20.0 : perige - 78.0;
+        qzms24 = pow ((120.0 - sfour)/RE_KM, 4.0);
+        sfour = sfour/RE_KM + 1.0;
+    }
+
+    double pinvsq = 1.0/posq;
+    double tsi = 1.0/(ao - sfour);
+    eta = ao*ecco*tsi;
+    double etasq = eta*eta;
+    double eeta = ecco*eta;
+    double psisq = fabs(1.0 - etasq);
+    double coef = qzms24*pow(tsi, 4.0);
+    double coef1 = coef/pow(psisq, 3.5);
+    double cc2 = coef1*no*(ao*(1.0 + 1.5*etasq + eeta*(4.0 + etasq))
+                    + 0.375*J2*tsi/psisq*con41*(8.0 + 3.0*etasq*(8.0 + etasq)));
+    cc1 = bstar*cc2;
+    double cc3 = 0.0;
+    if (ecco > 1.0e-4)
+        cc3 = -2.0*coef*tsi*J3OJ2*no*sinio/ecco;
+    x1mth2 = 1.0 - cosio2;
+    cc4 = 2.0*no*coef1*ao*omeosq*(eta*(2.0 + 0.5*etasq) + ecco*(0.5 + 2.0*etasq)
+            - J2*tsi/(ao*psisq)*(-3.0*con41*(1.0 - 2.0*eeta + etasq*(1.5 - 0.5*eeta))
+            + 0.75*x1mth2*(2.0*etasq - eeta*(1.0 + etasq))*cos(2.0*argpo)));
+    cc5 = 2.0*coef1*ao*omeosq*(1.0 + 2.75*(etasq + eeta) + eeta*etasq);
+    double cosio4 = cosio2*cosio2;
+    double temp1 = 1.5*J2*pinvsq*no;
+    double temp2 = 0.5*temp1*J2*pinvsq;
+    double temp3 = -0.46875*J4*pinvsq*pinvsq*no;
+    mdot = no + 0.5*temp1*rteosq*con41 + 0.0625*temp2*rteosq*(13.0 - 78.0*cosio2 + 137.0*cosio4);
+    argpdot = -0.5*temp1*con42 + 0.0625*temp2*(7.0 - 114.0*cosio2 + 395.0*cosio4)
+                + temp3*(3.0 - 36.0*cosio2 + 49.0*cosio4);
+    double xhdot1 = -temp1*cosio;
+    nodedot = xhdot1 + (0.5*temp2*(4.0 - 19.0*cosio2) + 2.0*temp3*(3.0 - 7.0*cosio2))*cosio;
+    double xpidot = argpdot + nodedot;
+    omgcof = bstar*cc3*cos(argpo);
+    xmcof = 0.0;
+    if (ecco > 1.0e-4)
+        xmcof = -X2O3*coef*bstar/eeta;
+    nodecf = 3.5*omeosq*xhdot1*cc1;
+    t2cof = 1.5*cc1;
+    if (fabs(cosio + 1.0) > 1.5e-12)
+        xlcof = -0.25*J3OJ2*sinio*(3.0 + 5.0*cosio)/(1.0 + cosio);
+    else
+        xlcof = -0.25*J3OJ2*sinio*(3.0 + 5.0*cosio)/1.5e-12;
+    aycof = -0.5*J3OJ2*sinio;
+    double delmotemp = 1.0 + eta*cos(mo);
+    delmo = delmotemp*delmotemp*delmotemp;
+    sinmao = sin(mo);
+    x7thm1 = 7.0*cosio2 - 1.0;
+
+    // deep space if period is 225 minutes or more
+    if (TWOPI/no >= 225.0) {
+
+        method = 'd';
+        isimp = 1;
+
+        const double zes = 0.01675, zel = 0.05490, c1ss = 2.9864797e-6, c1l = 4.7968065e-7;
+        const double zsinis = 0.39785416, zcosis = 0.91744867, zcosgs = 0.1945905, zsings = -0.98088458;
+        const double znl = 1.5835218e-4, zns = 1.19459e-5;
+
+        // lunar and solar geometry at epoch, originally dscom()
+        double nm = no;
+        double em = ecco;
+        double snodm = sin(nodeo);
+        double cnodm = cos(nodeo);
+        double sinomm = sin(argpo);
+        double cosomm = cos(argpo);
+        double sinim = sin(inclo);
+        double cosim = cos(inclo);
+        double emsq = em*em;
+        double betasq = 1.0 - emsq;
+        double rtemsq = sqrt(betasq);
+
+        double day = epoch + 18261.5;
+        double xnodce = fmod (4.5236020 - 9.2422029e-4*day, TWOPI);
+        double stem = sin(xnodce);
+        double ctem = cos(xnodce);
+        double zcosil = 0.91375164 - 0.03568096*ctem;
+        double zsinil = sqrt(1.0 - zcosil*zcosil);
+        double zsinhl = 0.089683511*stem/zsinil;
+        double zcoshl = sqrt(1.0 - zsinhl*zsinhl);
+        double gam = 5.8351514 + 0.0019443680*day;
+        double zx = 0.39785416*stem/zsinil;
+        double zy = zcoshl*ctem + 0.91744867*zsinhl*stem;
+        zx = atan2 (zx, zy);
+        zx = gam + zx - xnodce;
+        double zcosgl = cos(zx);
+        double zsingl = sin(zx);
+
+        // first pass is the sun, second is the moon
+        double zcosg = zcosgs, zsing = zsings, zcosi = zcosis, zsini = zsinis;
+        double zcosh = cnodm, zsinh = snodm, cc = c1ss, xnoi = 1.0/nm;
+        double s1=0, s2=0, s3=0, s4=0, s5=0, s6=0, s7=0;
+        double ss1=0, ss2=0, ss3=0, ss4=0, ss5=0, ss6=0, ss7=0;
+        double z1=0, z2=0, z3=0, z11=0, z12=0, z13=0, z21=0, z22=0, z23=0, z31=0, z32=0, z33=0;
+        double sz1=0, sz2=0, sz3=0, sz11=0, sz12=0, sz13=0, sz21=0, sz22=0, sz23=0, sz31=0, sz32=0, sz33=0;
+        for (int lsflg = 1; lsflg <= 2; lsflg++) {
+            double a1 = zcosg*zcosh + zsing*zcosi*zsinh;
+            double a3 = -zsing*zcosh + zcosg*zcosi*zsinh;
+            double a7 = -zcosg*zsinh + zsing*zcosi*zcosh;
+            double a8 = zsing*zsini;
+            double a9 = zsing*zsinh + zcosg*zcosi*zcosh;
+            double a10 = zcosg*zsini;
+            double a2 = cosim*a7 + sinim*a8;
+            double a4 = cosim*a9 + sinim*a10;
+            double a5 = -sinim*a7 + cosim*a8;
+            double a6 = -sinim*a9 + cosim*a10;
+
+            double x1 = a1*cosomm + a2*sinomm;
+            double x2 = a3*cosomm + a4*sinomm;
+            double x3 = -a1*sinomm + a2*cosomm;
+            double x4 = -a3*sinomm + a4*cosomm;
+            double x5 = a5*sinomm;
+            double x6 = a6*sinomm;
+            double x7 = a5*cosomm;
+            double x8 = a6*cosomm;
+
+            z31 = 12.0*x1*x1 - 3.0*x3*x3;
+            z32 = 24.0*x1*x2 - 6.0*x3*x4;
+            z33 = 12.0*x2*x2 - 3.0*x4*x4;
+            z1 = 3.0*(a1*a1 + a2*a2) + z31*emsq;
+            z2 = 6.0*(a1*a3 + a2*a4) + z32*emsq;
+            z3 = 3.0*(a3*a3 + a4*a4) + z33*emsq;
+            z11 = -6.0*a1*a5 + emsq*(-24.0*x1*x7 - 6.0*x3*x5);
+            z12 = -6.0*(a1*a6 + a3*a5) + emsq*(-24.0*(x2*x7 + x1*x8) - 6.0*(x3*x6 + x4*x5));
+            z13 = -6.0*a3*a6 + emsq*(-24.0*x2*x8 - 6.0*x4*x6);
+            z21 = 6.0*a2*a5 + emsq*(24.0*x1*x5 - 6.0*x3*x7);
+            z22 = 6.0*(a4*a5 + a2*a6) + emsq*(24.0*(x2*x5 + x1*x6) - 6.0*(x4*x7 + x3*x8));
+            z23 = 6.0*a4*a6 + emsq*(24.0*x2*x6 - 6.0*x4*x8);
+            z1 = z1 + z1 + betasq*z31;
+            z2 = z2 + z2 + betasq*z32;
+            z3 = z3 + z3 + betasq*z33;
+            s3 = cc*xnoi;
+            s2 = -0.5*s3/rtemsq;
+            s4 = s3*rtemsq;
+            s1 = -15.0*em*s4;
+            s5 = x1*x3 + x2*x4;
+            s6 = x2*x3 + x1*x4;
+            s7 = x2*x4 - x1*x3;
+
+            if (lsflg == 1) {
+                ss1 = s1; ss2 = s2; ss3 = s3; ss4 = s4; ss5 = s5; ss6 = s6; ss7 = s7;
+                sz1 = z1; sz2 = z2; sz3 = z3;
+                sz11 = z11; sz12 = z12; sz13 = z13;
+                sz21 = z21; sz22 = z22; sz23 = z23;
+                sz31 = z31; sz32 = z32; sz33 = z33;
+                zcosg = zcosgl;
+                zsing = zsingl;
+                zcosi = zcosil;
+                zsini = zsinil;
+                zcosh = zcoshl*cnodm + zsinhl*snodm;
+                zsinh = snodm*zcoshl - cnodm*zsinhl;
+                cc = c1l;
+            }
+        }
+
+        zmol = fmod (4.7199672 + 0.22997150*day - gam, TWOPI);
+        zmos = fmod (6.2565837 + 0.017201977*day, TWOPI);
+
+        se2 = 2.0*ss1*ss6;
+        se3 = 2.0*ss1*ss7;
+        si2 = 2.0*ss2*sz12;
+        si3 = 2.0*ss2*(sz13 - sz11);
+        sl2 = -2.0*ss3*sz2;
+        sl3 = -2.0*ss3*(sz3 - sz1);
+        sl4 = -2.0*ss3*(-21.0 - 9.0*emsq)*zes;
+        sgh2 = 2.0*ss4*sz32;
+        sgh3 = 2.0*ss4*(sz33 - sz31);
+        sgh4 = -18.0*ss4*zes;
+        sh2 = -2.0*ss2*sz22;
+        sh3 = -2.0*ss2*(sz23 - sz21);
+
+        ee2 = 2.0*s1*s6;
+        e3 = 2.0*s1*s7;
+        xi2 = 2.0*s2*z12;
+        xi3 = 2.0*s2*(z13 - z11);
+        xl2 = -2.0*s3*z2;
+        xl3 = -2.0*s3*(z3 - z1);
+        xl4 = -2.0*s3*(-21.0 - 9.0*emsq)*zel;
+        xgh2 = 2.0*s4*z32;
+        xgh3 = 2.0*s4*(z33 - z31);
+        xgh4 = -18.0*s4*zel;
+        xh2 = -2.0*s2*z22;
+        xh3 = -2.0*s2*(z23 - z21);
+
+        // secular rates and resonance terms, originally dsinit()
+        const double q22 = 1.7891679e-6, q31 = 2.1460748e-6, q33 = 2.2123015e-7;
+        const double root22 = 1.7891679e-6, root44 = 7.3636953e-9, root54 = 2.1765803e-9;
+        const double rptim = 4.37526908801129966e-3;
+        const double root32 = 3.7393792e-7, root52 = 1.1428639e-7;
+
+        double inclm = inclo;
+        irez = 0;
+        if (nm < 0.0052359877 && nm > 0.0034906585)
+            irez = 1;
+        if (nm >= 8.26e-3 && nm <= 9.24e-3 && em >= 0.5)
+            irez = 2;
+
+        double ses = ss1*zns*ss5;
+        double sis = ss2*zns*(sz11 + sz13);
+        double sls = -zns*ss3*(sz1 + sz3 - 14.0 - 6.0*emsq);
+        double sghs = ss4*zns*(sz31 + sz33 - 6.0);
+        double shs = -zns*ss2*(sz21 + sz23);
+        if (inclm < 5.2359877e-2 || inclm > M_PI - 5.2359877e-2)
+            shs = 0.0;
+        if (sinim != 0.0)
+            shs = shs/sinim;
+        double sgs = sghs - cosim*shs;
+
+        dedt = ses + s1*znl*s5;
+        didt = sis + s2*znl*(z11 + z13);
+        dmdt = sls - znl*s3*(z1 + z3 - 14.0 - 6.0*emsq);
+        double sghl = s4*znl*(z31 + z33 - 6.0);
+        double shll = -znl*s2*(z21 + z23);
+        if (inclm < 5.2359877e-2 || inclm > M_PI - 5.2359877e-2)
+            shll = 0.0;
+        domdt = sgs + sghl;
+        dnodt = shs;
+        if (sinim != 0.0) {
+            domdt -= cosim/sinim*shll;
+            dnodt += shll/sinim;
+        }
+
+        double dndt = 0.0;
+        double theta = fmod (gsto, TWOPI);
+
+        if (irez != 0) {
+            double aonv = pow (nm/XKE, X2O3);
+
+            if (irez == 2) {
+                // geopotential resonance for 12 hour orbits
+                double cosisq = cosim*cosim;
+                double e = ecco;
+                double esq = eccsq;
+                double eoc = e*esq;
+                double g201 = -0.306 - (e - 0.64)*0.440;
+                double g211, g310, g322, g410, g422, g520, g521, g532, g533;
+
+                if (e <= 0.65) {
+                    g211 = 3.616 - 13.2470*e + 16.2900*esq;
+                    g310 = -19.302 + 117.3900*e - 228.4190*esq + 156.5910*eoc;
+                    g322 = -18.9068 + 109.7927*e - 214.6334*esq + 146.5816*eoc;
+                    g410 = -41.122 + 242.6940*e - 471.0940*esq + 313.9530*eoc;
+                    g422 = -146.407 + 841.8800*e - 1629.014*esq + 1083.4350*eoc;
+                    g520 = -532.114 + 3017.977*e - 5740.032*esq + 3708.2760*eoc;
+                } else {
+                    g211 = -72.099 + 331.819*e - 508.738*esq + 266.724*eoc;
+                    g310 = -346.844 + 1582.851*e - 2415.925*esq + 1246.113*eoc;
+                    g322 = -342.585 + 1554.908*e - 2366.899*esq + 1215.972*eoc;
+                    g410 = -1052.797 + 4758.686*e - 7193.992*esq + 3651.957*eoc;
+                    g422 = -3581.690 + 16178.110*e - 24462.770*esq + 12422.520*eoc;
+                    if (e > 0.715)
+                        g520 = -5149.66 + 29936.92*e - 54087.36*esq + 31324.56*eoc;
+                    else
+                        g520 = 1464.74 - 4664.75*e + 3763.64*esq;
+                }
+                if (e < 0.7) {
+                    g533 = -919.22770 + 4988.6100*e - 9064.7700*esq + 5542.21*eoc;
+                    g521 = -822.71072 + 4568.6173*e - 8491.4146*esq + 5337.524*eoc;
+                    g532 = -853.66600 + 4690.2500*e - 8624.7700*esq + 5341.4*eoc;
+                } else {
+                    g533 = -37995.780 + 161616.52*e - 229838.20*esq + 109377.94*eoc;
+                    g521 = -51752.104 + 218913.95*e - 309468.16*esq + 146349.42*eoc;
+                    g532 = -40023.880 + 170470.89*e - 242699.48*esq + 115605.82*eoc;
+                }
+
+                double sini2 = sinim*sinim;
+                double f220 = 0.75*(1.0 + 2.0*cosim + cosisq);
+                double f221 = 1.5*sini2;
+                double f321 = 1.875*sinim*(1.0 - 2.0*cosim - 3.0*cosisq);
+                double f322 = -1.875*sinim*(1.0 + 2.0*cosim - 3.0*cosisq);
+                double f441 = 35.0*sini2*f220;
+                double f442 = 39.3750*sini2*sini2;
+                double f522 = 9.84375*sinim*(sini2*(1.0 - 2.0*cosim - 5.0*cosisq)
+                                + 0.33333333*(-2.0 + 4.0*cosim + 6.0*cosisq));
+                double f523 = sinim*(4.92187512*sini2*(-2.0 - 4.0*cosim + 10.0*cosisq)
+                                + 6.56250012*(1.0 + 2.0*cosim - 3.0*cosisq));
+                double f542 = 29.53125*sinim*(2.0 - 8.0*cosim + cosisq*(-12.0 + 8.0*cosim + 10.0*cosisq));
+                double f543 = 29.53125*sinim*(-2.0 - 8.0*cosim + cosisq*(12.0 + 8.0*cosim - 10.0*cosisq));
+                double xno2 = nm*nm;
+                double ainv2 = aonv*aonv;
+                double t1 = 3.0*xno2*ainv2;
+                double tmp = t1*root22;
+                d2201 = tmp*f220*g201;
+                d2211 = tmp*f221*g211;
+                t1 *= aonv;
+                tmp = t1*root32;
+                d3210 = tmp*f321*g310;
+                d3222 = tmp*f322*g322;
+                t1 *= aonv;
+                tmp = 2.0*t1*root44;
+                d4410 = tmp*f441*g410;
+                d4422 = tmp*f442*g422;
+                t1 *= aonv;
+                tmp = t1*root52;
+                d5220 = tmp*f522*g520;
+                d5232 = tmp*f523*g532;
+                tmp = 2.0*t1*root54;
+                d5421 = tmp*f542*g521;
+                d5433 = tmp*f543*g533;
+                xlamo = fmod (mo + nodeo + nodeo - theta - theta, TWOPI);
+                xfact = mdot + dmdt + 2.0*(nodedot + dnodt - rptim) - no;
+            }
+
+            if (irez == 1) {
+                // synchronous resonance terms
+                double g200 = 1.0 + emsq*(-2.5 + 0.8125*emsq);
+                double g310 = 1.0 + 2.0*emsq;
+                double g300 = 1.0 + emsq*(-6.0 + 6.60937*emsq);
+                double f220 = 0.75*(1.0 + cosim)*(1.0 + cosim);
+                double f311 = 0.9375*sinim*sinim*(1.0 + 3.0*cosim) - 0.75*(1.0 + cosim);
+                double f330 = 1.0 + cosim;
+                f330 = 1.875*f330*f330*f330;
+                del1 = 3.0*nm*nm*aonv*aonv;
+                del2 = 2.0*del1*f220*g200*q22;
+                del3 = 3.0*del1*f330*g300*q33*aonv;
+                del1 = del1*f311*g310*q31*aonv;
+                xlamo = fmod (mo + nodeo + argpo - theta, TWOPI);
+                xfact = mdot + xpidot - rptim + dmdt + domdt + dnodt - no;
+            }
+
+            xli = xlamo;
+            xni = no;
+            atime = 0.0;
+            nm = no + dndt;
+        }
+    }
+
+    // higher order drag terms for near earth orbits with perigee above 220 km
+    if (isimp != 1) {
+        double cc1sq = cc1*cc1;
+        d2 = 4.0*ao*tsi*cc1sq;
+        double temp = d2*tsi*cc1/3.0;
+        d3 = (17.0*ao + sfour)*temp;
+        d4 = 0.5*temp*ao*tsi*(221.0*ao + 31.0*sfour)*cc1;
+        t3cof = d2 + 2.0*cc1sq;
+        t4cof = 0.25*(3.0*d3 + cc1*(12.0*d2 + 10.0*cc1sq));
+        t5cof = 0.2*(3.0*d4 + 12.0*cc1*d3 + 6.0*d2*d2 + 15.0*cc1sq*(2.0*d2 + cc1sq));
+    }
+
+    // check by propagating to epoch
+    double r[3], v[3];
+    return (propagate (0.0, r, v));
+}
+
+/* find TEME position r, km, and velocity v, km/s, at tsince minutes after epoch.
+ * return whether the orbit is still sensible, else error tells why.
+ */
+bool SGP4::propagate (double tsince, double r[3], double v[3])
+{
+    const double vkmpersec = RE_KM*XKE/60.0;
+    double t = tsince;
+
+    error = 0;
+
+    // secular gravity and atmospheric drag
+    double xmdf = mo + mdot*t;
+    double argpdf = argpo + argpdot*t;
+    double nodedf = nodeo + nodedot*t;
+    double argpm = argpdf;
+    double mm = xmdf;
+    double t2 = t*t;
+    double nodem = nodedf + nodecf*t2;
+    double tempa = 1.0 - cc1*t;
+    double tempe = bstar*cc4*t;
+    double templ = t2cof*t2;
+
+    if (isimp != 1) {
+        double delomg = omgcof*t;
+        double delmtemp = 1.0 + eta*cos(xmdf);
+        double delm = xmcof*(delmtemp*delmtemp*delmtemp - delmo);
+        double temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2*t;
+        double t4 = t3*t;
+        tempa = tempa - d2*t2 - d3*t3 - d4*t4;
+        tempe = tempe + bstar*cc5*(sin(mm) - sinmao);
+        templ = templ + t3cof*t3 + t4*(t4cof + t*t5cof);
+    }
+
+    double nm = no;
+    double em = ecco;
+    double inclm = inclo;
+    if (method == 'd') {
+        double dndt;
+        dspace (t, t, em, argpm, inclm, mm, nodem, dndt, nm);
+    }
+
+    if (nm <= 0.0) {
+        error = 2;
+        return (false);
+    }
+    double am = pow (XKE/nm, X2O3)*tempa*tempa;
+    nm = XKE/pow (am, 1.5);
+    em -= tempe;
+    if (em >= 1.0 || em < -0.001) {
+        error = 1;
+        return (false);
+    }
+    if (em < 1.0e-6)
+        em = 1.0e-6;
+    mm += no*templ;
+    double xlm = mm + argpm + nodem;
+
+    nodem = fmod (nodem, TWOPI);
+    argpm = fmod (argpm, TWOPI);
+    xlm = fmod (xlm, TWOPI);
+    mm = fmod (xlm - argpm - nodem, TWOPI);
+
+    // lunar-solar periodics
+    double ep = em;
+    double xincp = inclm;
+    double argpp = argpm;
+    double nodep = nodem;
+    double mp = mm;
+    double sinip = sin(inclm);
+    double cosip = cos(inclm);
+    double axlcof = xlcof;
+    double aaycof = aycof;
+    if (method == 'd') {
+        dpper (t, ep, xincp, nodep, argpp, mp);
+        if (xincp < 0.0) {
+            xincp = -xincp;
+            nodep += M_PI;
+            argpp -= M_PI;
+        }
+        if (ep < 0.0 || ep > 1.0) {
+            error = 3;
+            return (false);
+        }
+
+        // long period periodics depend on the perturbed inclination
+        sinip = sin(xincp);
+        cosip = cos(xincp);
+        aaycof = -0.5*J3OJ2*sinip;
+        if (fabs(cosip + 1.0) > 1.5e-12)
+            axlcof = -0.25*J3OJ2*sinip*(3.0 + 5.0*cosip)/(1.0 + cosip);
+        else
+            axlcof = -0.25*J3OJ2*sinip*(3.0 + 5.0*cosip)/1.5e-12;
+    }
+
+    double axnl = ep*cos(argpp);
+    double temp = 1.0/(am*(1.0 - ep*ep));
+    double aynl = ep*sin(argpp) + temp*aaycof;
+    double xl = mp + argpp + nodep + temp*axlcof*axnl;
+
+    // solve Kepler's equation
+    double u = fmod (xl - nodep, TWOPI);
+    double eo1 = u;
+    double tem5 = 9999.9;
+    double sineo1 = 0, coseo1 = 0;
+    for (int ktr = 1; fabs(tem5) >= 1.0e-12 && ktr <= 10; ktr++) {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        tem5 = 1.0 - coseo1*axnl - sineo1*aynl;
+        tem5 = (u - aynl*coseo1 + axnl*sineo1 - eo1)/tem5;
+        if (fabs(tem5) >= 0.95)
+            tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 += tem5;
+    }
+
+    // short period preliminary quantities
+    double ecose = axnl*coseo1 + aynl*sineo1;
+    double esine = axnl*sineo1 - aynl*coseo1;
+    double el2 = axnl*axnl + aynl*aynl;
+    double pl = am*(1.0 - el2);
+    if (pl < 0.0) {
+        error = 4;
+        return (false);
+    }
+
+    double rl = am*(1.0 - ecose);
+    double rdotl = sqrt(am)*esine/rl;
+    double rvdotl = sqrt(pl)/rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine/(1.0 + betal);
+    double sinu = am/rl*(sineo1 - aynl - axnl*temp);
+    double cosu = am/rl*(coseo1 - axnl + aynl*temp);
+    double su = atan2 (sinu, cosu);
+    double sin2u = (cosu + cosu)*sinu;
+    double cos2u = 1.0 - 2.0*sinu*sinu;
+    temp = 1.0/pl;
+    double temp1 = 0.5*J2*temp;
+    double temp2 = temp1*temp;
+
+    // short period periodics
+    double acon41 = con41, ax1mth2 = x1mth2, ax7thm1 = x7thm1;
+    if (method == 'd') {
+        double cosisq = cosip*cosip;
+        acon41 = 3.0*cosisq - 1.0;
+        ax1mth2 = 1.0 - cosisq;
+        ax7thm1 = 7.0*cosisq - 1.0;
+    }
+    double mrt = rl*(1.0 - 1.5*temp2*betal*acon41) + 0.5*temp1*ax1mth2*cos2u;
+    su -= 0.25*temp2*ax7thm1*sin2u;
+    double xnode = nodep + 1.5*temp2*cosip*sin2u;
+    double xinc = xincp + 1.5*temp2*cosip*sinip*cos2u;
+    double mvt = rdotl - nm*temp1*ax1mth2*sin2u/XKE;
+    double rvdot = rvdotl + nm*temp1*(ax1mth2*cos2u + 1.5*acon41)/XKE;
+
+    // orientation vectors
+    double sinsu = sin(su);
+    double cossu = cos(su);
+    double snod = sin(xnode);
+    double cnod = cos(xnode);
+    double sini = sin(xinc);
+    double cosi = cos(xinc);
+    double xmx = -snod*cosi;
+    double xmy = cnod*cosi;
+    double ux = xmx*sinsu + cnod*cossu;
+    double uy = xmy*sinsu + snod*cossu;
+    double uz = sini*sinsu;
+    double vx = xmx*cossu - cnod*sinsu;
+    double vy = xmy*cossu - snod*sinsu;
+    double vz = sini*cossu;
+
+    r[0] = mrt*ux*RE_KM;
+    r[1] = mrt*uy*RE_KM;
+    r[2] = mrt*uz*RE_KM;
+    v[0] = (mvt*ux + rvdot*vx)*vkmpersec;
+    v[1] = (mvt*uy + rvdot*vy)*vkmpersec;
+    v[2] = (mvt*uz + rvdot*vz)*vkmpersec;
+
+    // decayed
+    if (mrt < 1.0) {
+        error = 6;
+        return (false);
+    }
+
+    return (true);
+}
+
+
+#ifdef _SGP4_UNITTEST
+
+#include <time.h>
+#include <errno.h>
+
+#include "P13.h"
+
+// max position error against a reference vector, km. Faithful ports agree to well under this; the
+// margin only covers libm differences over long deep space resonance integrations.
+#define REF_TOL_KM      1e-5
+
+// reference TEME vector from tcppver.out, as published with the paper cited in SGP4.h
+typedef struct {
+    double tsince;                      // minutes
+    double r[3];                        // km
+} RefVec;
+
+typedef struct {
+    const char *name;
+    const char *l1, *l2;
+    const RefVec *ref;
+    int n_ref;
+} RefSat;
+
+static const RefVec ref_00005[] = {
+    {    0.0, { 7022.46529266, -1400.08296755,     0.03995155}},
+    {  360.0, {-7154.03120202, -3783.17682504, -3536.19412294}},
+    {  720.0, {-7134.59340119,  6531.68641334,  3260.27186483}},
+    { 1080.0, { 5568.53901181,  4492.06992591,  3863.87641983}},
+    { 1440.0, { -938.55923943, -6268.18748831, -4294.02924751}},
+};
+
+static const RefVec ref_06251[] = {
+    {    0.0, { 3988.31022699,  5498.96657235,     0.90055879}},
+    {  120.0, {-3935.69800083,   409.10980837,  5471.33577327}},
+    {  240.0, {-1675.12766915, -5683.30432352, -3286.21510937}},
+};
+
+static const RefVec ref_08195[] = {
+    {    0.0, { 2349.89483350, -14785.93811562,     0.02119378}},
+    {  120.0, {15223.91713658, -17852.95881482, 25280.39558222}},
+};
+
+static const RefVec ref_09880[] = {
+    {    0.0, {13020.06750784,  -2449.07193500,     1.15896030}},
+};
+
+static const RefVec ref_88888[] = {
+    {    0.0, { 2328.96975262, -5995.22051338,  1719.97297192}},
+    {  360.0, { 2456.10706533, -6071.93855503,  1222.89768554}},
+};
+
+static const RefSat ref_sats[] = {
+    {"00005 near earth",
+     "1 00005U 58002B   00179.78495062  .00000023  00000-0  28098-4 0  4753",
+     "2 00005  34.2682 348.7242 1859667 331.7664  19.3264 10.82419157413667",
+     ref_00005, sizeof(ref_00005)/sizeof(ref_00005[0])},
+    {"06251 low perigee",
+     "1 06251U 62025E   06176.82412014  .00008885  00000-0  12808-3 0  3985",
+     "2 06251  58.0579  54.0425 0030035 139.1568 221.1854 15.56387291  6774",
+     ref_06251, sizeof(ref_06251)/sizeof(ref_06251[0])},
+    {"08195 12h resonant",
+     "1 08195U 75081A   06176.33215444  .00000099  00000-0  11873-3 0   813",
+     "2 08195  64.1586 279.0717 6877146 264.7651  20.2257  2.00491383225656",
+     ref_08195, sizeof(ref_08195)/sizeof(ref_08195[0])},
+    {"09880 12h resonant",
+     "1 09880U 77021A   06176.56157475  .00000421  00000-0  10000-3 0  9814",
+     "2 09880  64.5968 349.3786 7069051 270.0229  16.3320  2.00813614112380",
+     ref_09880, sizeof(ref_09880)/sizeof(ref_09880[0])},
+    {"88888 simple drag",
+     "1 88888U          80275.98708465  .00073094  13844-3  66816-4 0    8",
+     "2 88888  72.8435 115.9689 0086731  52.6988 110.5714 16.05824518  105",
+     ref_88888, sizeof(ref_88888)/sizeof(ref_88888[0])},
+};
+
+/* return distance between r and ref, km
+ */
+static double refError (const double r[3], const double ref[3])
+{
+    double dx = r[0]-ref[0], dy = r[1]-ref[1], dz = r[2]-ref[2];
+    return (sqrt(dx*dx+dy*dy+dz*dz));
+}
+
+/* compare the built-in reference vectors.
+ * return number of failures.
+ */
+static int checkBuiltin (void)
+{
+    int n_bad = 0;
+
+    printf ("SGP4 vs built-in reference vectors, tolerance %g km:\n", REF_TOL_KM);
+    for (unsigned i = 0; i < sizeof(ref_sats)/sizeof(ref_sats[0]); i++) {
+        const RefSat &rs = ref_sats[i];
+        SGP4 s;
+        if (!s.init (rs.l1, rs.l2)) {
+            printf ("  %s: init failed, error %d\n", rs.name, s.error);
+            n_bad++;
+            continue;
+        }
+        for (int j = 0; j < rs.n_ref; j++) {
+            double r[3], v[3];
+            bool ok = s.propagate (rs.ref[j].tsince, r, v);
+            double err = refError (r, rs.ref[j].r);
+            bool bad = !ok || !(err <= REF_TOL_KM);
+            printf ("  %-18s t %7.1f min: error %10.6f km%s\n", rs.name, rs.ref[j].tsince, err,
+                            bad ? " FAIL" : "");
+            if (bad)
+                n_bad++;
+        }
+    }
+
+    return (n_bad);
+}
+
+/* find the TLE for satellite number satnum in the SGP4-VER.TLE file fp.
+ * return whether found.
+ */
+static bool findVerTLE (FILE *fp, int satnum, char l1[], char l2[], int len)
+{
+    rewind (fp);
+    while (fgets (l1, len, fp)) {
+        if (l1[0] != '1' || atoi (l1+2) != satnum)
+            continue;
+        return (fgets (l2, len, fp) != NULL && l2[0] == '2');
+    }
+    return (false);
+}
+
+/* compare every vector in the tcppver.out file out_fn against the elements in the SGP4-VER.TLE
+ * file tle_fn, both as distributed with the reference implementation.
+ * return number of failures.
+ */
+static int checkVerFiles (const char *tle_fn, const char *out_fn)
+{
+    FILE *tle_fp = fopen (tle_fn, "r");
+    if (!tle_fp) {
+        printf ("%s: %s\n", tle_fn, strerror(errno));
+        return (1);
+    }
+    FILE *out_fp = fopen (out_fn, "r");
+    if (!out_fp) {
+        printf ("%s: %s\n", out_fn, strerror(errno));
+        fclose (tle_fp);
+        return (1);
+    }
+
+    printf ("SGP4 vs %s, tolerance %g km:\n", out_fn, REF_TOL_KM);
+
+    SGP4 s;
+    bool s_ok = false;
+    int satnum = 0, n_vec = 0, n_bad = 0, n_sat_bad = 0, n_sats = 0;
+    double max_err = 0, max_t = 0;
+    char line[256], l1[130], l2[130];
+
+    for (;;) {
+        bool more = fgets (line, sizeof(line), out_fp) != NULL;
+        double t, r[3];
+        bool vec = more && sscanf (line, "%lf %lf %lf %lf", &t, &r[0], &r[1], &r[2]) == 4;
+        int header = more && !vec ? atoi (line) : 0;          // "nnnnn xx" starts each satellite
+
+        // report previous satellite at each new header and at EOF
+        if ((!more || header > 0) && satnum > 0) {
+            if (s_ok)
+                printf ("  %05d: %3d vectors, max error %10.6f km at %9.1f min%s\n", satnum, n_vec,
+                            max_err, max_t, n_sat_bad ? " FAIL" : "");
+            n_bad += n_sat_bad;
+            satnum = 0;
+        }
+        if (!more)
+            break;
+
+        if (header > 0) {
+            satnum = header;
+            n_sats++;
+            n_vec = n_sat_bad = 0;
+            max_err = max_t = 0;
+            s_ok = false;
+            if (!findVerTLE (tle_fp, satnum, l1, l2, sizeof(l1)))
+                printf ("  %05d: not found in %s\n", satnum, tle_fn);
+            else if (!s.init (l1, l2))
+                printf ("  %05d: init failed, error %d\n", satnum, s.error);
+            else
+                s_ok = true;
+            if (!s_ok)
+                n_sat_bad++;
+        } else if (vec && satnum > 0 && s_ok) {
+            double pr[3], pv[3];
+            bool ok = s.propagate (t, pr, pv);
+            double err = refError (pr, r);
+            n_vec++;
+            if (!ok || !(err <= REF_TOL_KM))
+                n_sat_bad++;
+            if (!ok || err > max_err) {
+                max_err = ok ? err : HUGE_VAL;
+                max_t = t;
+            }
+        }
+    }
+
+    printf ("  %d satellites, %d failures\n", n_sats, n_bad);
+
+    fclose (tle_fp);
+    fclose (out_fp);
+    return (n_bad);
+}
+
+// a recent LEO to compare the models and time them
+static const char iss_l1[] = "1 25544U 98067A   24001.50000000  .00016717  00000-0  30306-3 0  9990";
+static const char iss_l2[] = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.49815571432401";
+
+static double secsNow()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec*1e-9);
+}
+
+int main (int ac, char *av[])
+{
+    // accuracy against reference vectors
+    int n_bad = checkBuiltin();
+    if (ac == 3)
+        n_bad += checkVerFiles (av[1], av[2]);
+    else if (ac != 1) {
+        fprintf (stderr, "Usage: %s [SGP4-VER.TLE tcppver.out]\n", av[0]);
+        return (2);
+    }
+
+    // P13 vs SGP4 divergence over several days
+    Satellite p13 (iss_l1, iss_l2);
+    Satellite sgp (iss_l1, iss_l2, true);
+    Observer obs (37.0F, -122.0F, 0.0F);
+    DateTime t0 = p13.epoch();
+    printf ("\nP13 vs SGP4 for 25544:\n");
+    for (int d = 0; d <= 10; d += 2) {
+        DateTime t = t0 + (float)d;
+        p13.predict (t);
+        sgp.predict (t);
+        float dx = p13.S[0]-sgp.S[0], dy = p13.S[1]-sgp.S[1], dz = p13.S[2]-sgp.S[2];
+        printf ("  epoch + %2d days: position difference %8.2f km\n", d, sqrtf(dx*dx+dy*dy+dz*dz));
+    }
+
+    // speed, including topo as every caller does
+    const int N = 200000;
+    const float step = 10.0F/86400.0F;
+    float alt, az, range, rate, sum = 0;
+    double t_start = secsNow();
+    for (int i = 0; i < N; i++) {
+        p13.predict (t0 + i*step);
+        p13.topo (&obs, alt, az, range, rate);
+        sum += alt;
+    }
+    double p13_us = (secsNow() - t_start)/N*1e6;
+    t_start = secsNow();
+    for (int i = 0; i < N; i++) {
+        sgp.predict (t0 + i*step);
+        sgp.topo (&obs, alt, az, range, rate);
+        sum += alt;
+    }
+    double sgp_us = (secsNow() - t_start)/N*1e6;
+    printf ("\nspeed: P13 %.3f us/predict, SGP4 %.3f us/predict (%.1fx) [%g]\n", p13_us, sgp_us,
+                            sgp_us/p13_us, sum);
+
+    if (n_bad > 0)
+        printf ("\n%d reference vector failures\n", n_bad);
+    return (n_bad > 0);
+}
+
+#endif // _SGP4_UNITTEST
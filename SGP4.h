@@ -0,0 +1,48 @@
+#ifndef _SGP4_H
+#define _SGP4_H
+
+/* double precision SGP4/SDP4 near-earth and deep-space orbit propagator.
+ *
+ * This follows the reference implementation published with "Revisiting Spacetrack Report #3"
+ * (Vallado, Crawford, Hujsak, Kelso, AIAA 2006-6753) using WGS-72 constants and the "improved"
+ * operation mode. It is used by Satellite in P13.cpp when a satellite is constructed to use it,
+ * trading speed for accuracy over the life of a TLE.
+ *
+ * propagate() returns position in km and velocity in km/s in the TEME frame.
+ */
+
+class SGP4 {
+
+    public:
+
+        bool init (const char *l1, const char *l2);
+        bool propagate (double tsince, double r[3], double v[3]);
+        static double gmst (double jd);
+
+        double jdepoch;                 // julian date of the element epoch
+        int error;                      // 0 or code of last failure
+
+    private:
+
+        // mean elements, radians and radians/minute
+        double bstar, ecco, argpo, inclo, mo, no, nodeo;
+
+        // near earth
+        int isimp;
+        char method;
+        double aycof, con41, cc1, cc4, cc5, d2, d3, d4, delmo, eta, argpdot, omgcof, sinmao,
+            t2cof, t3cof, t4cof, t5cof, x1mth2, x7thm1, mdot, nodedot, xlcof, xmcof, nodecf;
+
+        // deep space
+        int irez;
+        double d2201, d2211, d3210, d3222, d4410, d4422, d5220, d5232, d5421, d5433, dedt, del1,
+            del2, del3, didt, dmdt, dnodt, domdt, e3, ee2, se2, se3,
+            sgh2, sgh3, sgh4, sh2, sh3, si2, si3, sl2, sl3, sl4, gsto, xfact, xgh2, xgh3, xgh4,
+            xh2, xh3, xi2, xi3, xl2, xl3, xl4, xlamo, zmol, zmos, atime, xli, xni;
+
+        void dpper (double t, double &ep, double &inclp, double &nodep, double &argpp, double &mp);
+        void dspace (double t, double tc, double &em, double &argpm, double &inclm, double &mm,
+            double &nodem, double &dndt, double &nm);
+};
+
+#endif // _SGP4_H
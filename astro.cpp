@@ -1,4 +1,8 @@
-/* functions to compute sublunar and subsolar lat and long.
+/* functions to compute sublunar and subsolar lat and long and sun rise and set times.
+ *
+ * subSolar() and subLunar() are memoized to EPH_DT seconds so any number of callers within the same
+ * quantum share one computation. sunrs() and sunrsMany() share a table of solar ephemeris across the
+ * UTC day so finding rise and set for every spot in a list costs little more than for one location.
  *
  * unit test:
  *   g++ -DLINIX_STANDALONE_TEST -o astro astro.cpp && ./astro 2016 7 31 19
@@ -34,10 +38,13 @@ typedef struct {
 float rad2deg (float r) { return (57.29578F*r); }
 float deg2rad (float d) { return (0.01745329F*d); }
 
+// sub solar and lunar positions are reused within this many seconds
+#define EPH_DT          10
+
 /* given seconds since 1/1/1970 compute subsolar lat and long.
  * http://aa.usno.navy.mil/faq/docs/SunApprox.php and GAST.php
  */
-void subSolar (time_t t, LatLong &ll)
+static void computeSubSolar (time_t t, LatLong &ll)
 {
     double JD = (t/86400.0) + 2440587.5;
     double D = JD - 2451545.0;
@@ -59,7 +66,7 @@ void subSolar (time_t t, LatLong &ll)
 /* given seconds since 1/1/1970 compute sublunar lat and long.
  * http://www.stjarnhimlen.se/comp/ppcomp.html
  */
-void subLunar (time_t t, LatLong &ll)
+static void computeSubLunar (time_t t, LatLong &ll)
 {
     // want days since 1999 Dec 31, 0:00 UT
     double d = (t - 946598400)/(3600.0*24.0);
@@ -165,6 +172,38 @@ void subLunar (time_t t, LatLong &ll)
     ll.lng = deg2rad(ll.lng_d);
 }
 
+/* given seconds since 1/1/1970 return subsolar lat and long, reusing the previous result if within the
+ * same EPH_DT quantum.
+ */
+void subSolar (time_t t, LatLong &ll)
+{
+    static time_t q_cache = -1;
+    static LatLong ll_cache;
+
+    time_t q = t - t%EPH_DT;
+    if (q != q_cache) {
+        computeSubSolar (q, ll_cache);
+        q_cache = q;
+    }
+    ll = ll_cache;
+}
+
+/* given seconds since 1/1/1970 return sublunar lat and long, reusing the previous result if within the
+ * same EPH_DT quantum.
+ */
+void subLunar (time_t t, LatLong &ll)
+{
+    static time_t q_cache = -1;
+    static LatLong ll_cache;
+
+    time_t q = t - t%EPH_DT;
+    if (q != q_cache) {
+        computeSubLunar (q, ll_cache);
+        q_cache = q;
+    }
+    ll = ll_cache;
+}
+
 
 #ifndef LINIX_STANDALONE_TEST
 // sorry, no stand-alone unit test for sunrs() because of heavy use of TimeLib
@@ -183,12 +222,27 @@ static float atand(float x) { return (rad2deg(atanf(x))); }
 static void range(float *x, float r) { while(*x < 0) *x += r; while (*x >= r) *x -= r; }
 
 
-/* given UNIX time, lat rads +N and lng rads +E, return UNIX secs of today's rise and set.
- * if sun never rises: *trise (only) will be 0; if never sets: *tset (only) will be 0.
+/* the steps of the algorithm that depend only on the sun are tabulated hourly over the range of
+ * approximate times any longitude may need during one UTC day, then interpolated for each location.
+ * the day number used by the algorithm is t = N + (6 or 18 - lngHour)/24, so t - N spans [-0.25,1.25].
  */
-void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
+#define SRS_T0          (-0.25F)                        // first table time, days from N
+#define SRS_NT          37                              // hourly entries to cover 1.5 days
+typedef struct {
+    float RA;                                           // right ascension, hours, unwrapped
+    float sinDec, cosDec;                               // declination
+} SunRSEntry;
+static SunRSEntry srs_tbl[SRS_NT];
+static time_t srs_day0 = -1;                            // UNIX midnight for which srs_tbl is valid
+static int srs_N;                                       // day of year of srs_day0
+
+/* insure srs_tbl is valid for the UTC day containing t0.
+ */
+static void initSunRSTable (const time_t &t0)
 {
-	// xxx_r denotes variable is used to compute rise time, xxx_s used for set
+	time_t day0 = previousMidnight(t0);
+	if (day0 == srs_day0)
+	    return;
 
 	// convert UNIX to day month year
 
@@ -201,62 +255,94 @@ void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
 	int N1 = floor(275 * mm / 9);
 	int N2 = floor((mm + 9) / 12);
 	int N3 = (1 + floor((yy - 4 * floor(yy / 4) + 2) / 3));
-	int N = N1 - (N2 * N3) + dd - 30;
+	srs_N = N1 - (N2 * N3) + dd - 30;
 
-	// 2. convert the longitude to hour value and calculate an approximate time
+	for (int i = 0; i < SRS_NT; i++) {
 
-	float lngHour = rad2deg(ll.lng) / 15;
-	
-	float t_r = N + ((6 - lngHour) / 24);
-	float t_s = N + ((18 - lngHour) / 24);
+	    SunRSEntry &e = srs_tbl[i];
+	    float t = srs_N + SRS_T0 + i/24.0F;
 
-	// 3. calculate the Sun's mean anomaly
-	
-	float M_r = (0.9856 * t_r) - 3.289;
-	float M_s = (0.9856 * t_s) - 3.289;
+	    // 3. calculate the Sun's mean anomaly
 
-	// 4. calculate the Sun's true longitude
-	// NOTE: L potentially needs to be adjusted into the range [0,360) by adding/subtracting 360
-	
-	float L_r = M_r + (1.916 * sind(M_r)) + (0.020 * sind(2 * M_r)) + 282.634;
-	range (&L_r, 360.0);
-	float L_s = M_s + (1.916 * sind(M_s)) + (0.020 * sind(2 * M_s)) + 282.634;
-	range (&L_s, 360.0);
+	    float M = (0.9856 * t) - 3.289;
 
-	// 5a. calculate the Sun's right ascension
-	// NOTE: RA potentially needs to be adjusted into the range [0,360) by adding/subtracting 360
-	
-	float RA_r = atand(0.91764 * tand(L_r));
-	range (&RA_r, 360.0);
-	float RA_s = atand(0.91764 * tand(L_s));
-	range (&RA_s, 360.0);
+	    // 4. calculate the Sun's true longitude
+
+	    float L = M + (1.916 * sind(M)) + (0.020 * sind(2 * M)) + 282.634;
+	    range (&L, 360.0);
 
-	// 5b. right ascension value needs to be in the same quadrant as L
+	    // 5a. calculate the Sun's right ascension
 
-	float Lquadrant_r  = (floor( L_r/90)) * 90;
-	float RAquadrant_r = (floor(RA_r/90)) * 90;
-	RA_r = RA_r + (Lquadrant_r - RAquadrant_r);
-	float Lquadrant_s  = (floor( L_s/90)) * 90;
-	float RAquadrant_s = (floor(RA_s/90)) * 90;
-	RA_s = RA_s + (Lquadrant_s - RAquadrant_s);
+	    float RA = atand(0.91764 * tand(L));
+	    range (&RA, 360.0);
 
-	// 5c. right ascension value needs to be converted into hours
+	    // 5b. right ascension value needs to be in the same quadrant as L
 
-	RA_r = RA_r / 15;
-	RA_s = RA_s / 15;
+	    float Lquadrant  = (floor( L/90)) * 90;
+	    float RAquadrant = (floor(RA/90)) * 90;
+	    RA = RA + (Lquadrant - RAquadrant);
 
-	// 6. calculate the Sun's declination
+	    // 5c. right ascension value needs to be converted into hours, kept continuous for interpolation
 
-	float sinDec_r = 0.39782 * sind(L_r);
-	float cosDec_r = cos(asin(sinDec_r));
-	float sinDec_s = 0.39782 * sind(L_s);
-	float cosDec_s = cos(asin(sinDec_s));
+	    e.RA = RA / 15;
+	    if (i > 0 && e.RA < srs_tbl[i-1].RA - 12)
+		e.RA += 24;
+
+	    // 6. calculate the Sun's declination
+
+	    e.sinDec = 0.39782 * sind(L);
+	    e.cosDec = cos(asin(e.sinDec));
+	}
+
+	srs_day0 = day0;
+}
+
+/* interpolate srs_tbl at day number t
+ */
+static void interpSunRS (float t, SunRSEntry &e)
+{
+    float f = (t - srs_N - SRS_T0) * 24;
+    if (f < 0)
+        f = 0;
+    if (f > SRS_NT - 1.001F)
+        f = SRS_NT - 1.001F;
+    int i = (int)f;
+    f -= i;
+
+    const SunRSEntry &a = srs_tbl[i];
+    const SunRSEntry &b = srs_tbl[i+1];
+    e.RA = a.RA + f*(b.RA - a.RA);
+    e.sinDec = a.sinDec + f*(b.sinDec - a.sinDec);
+    e.cosDec = a.cosDec + f*(b.cosDec - a.cosDec);
+}
+
+/* given lat rads +N and lng rads +E, return UNIX secs of rise and set for the day in srs_tbl.
+ */
+static void sunrsOne (const LatLong &ll, time_t *trise, time_t *tset)
+{
+	// xxx_r denotes variable is used to compute rise time, xxx_s used for set
+
+	// 2. convert the longitude to hour value and calculate an approximate time
+
+	float lngHour = rad2deg(ll.lng) / 15;
+	
+	float t_r = srs_N + ((6 - lngHour) / 24);
+	float t_s = srs_N + ((18 - lngHour) / 24);
+
+	// 3-6. look up the Sun's right ascension and declination
+
+	SunRSEntry e_r, e_s;
+	interpSunRS (t_r, e_r);
+	interpSunRS (t_s, e_s);
 
 	// 7a. calculate the Sun's local hour angle
 	
         #define RSZENANGLE      90.833F         // zenith angle of rise/set event
-	float cosH_r = (cosd(RSZENANGLE) - (sinDec_r * sin(ll.lat))) / (cosDec_r * cos(ll.lat));
-	float cosH_s = (cosd(RSZENANGLE) - (sinDec_s * sin(ll.lat))) / (cosDec_s * cos(ll.lat));
+	float cosZ = cosd(RSZENANGLE);
+	float sinLat = sin(ll.lat);
+	float cosLat = cos(ll.lat);
+	float cosH_r = (cosZ - (e_r.sinDec * sinLat)) / (e_r.cosDec * cosLat);
+	float cosH_s = (cosZ - (e_s.sinDec * sinLat)) / (e_s.cosDec * cosLat);
 	
 	// if (cosH >  1) 
 	//   the sun never rises on this location (on the specified date)
@@ -268,7 +354,7 @@ void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
 	    *tset = 1;	// anything other than 0
 	    return;
 	}
-	if (cosH_s < -1 || cosH_s < -1) {
+	if (cosH_r < -1 || cosH_s < -1) {
 	    *tset = 0;
 	    *trise = 1;	// anything other than 0
 	    return;
@@ -289,8 +375,8 @@ void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
 
 	// 8. calculate local mean time of rising/setting
 	
-	float T_r = H_r + RA_r - (0.06571 * t_r) - 6.622;
-	float T_s = H_s + RA_s - (0.06571 * t_s) - 6.622;
+	float T_r = H_r + e_r.RA - (0.06571 * t_r) - 6.622;
+	float T_s = H_s + e_s.RA - (0.06571 * t_s) - 6.622;
 
 	// 9. adjust back to UTC
 	// NOTE: UT potentially needs to be adjusted into the range [0,24) by adding/subtracting 24
@@ -302,9 +388,27 @@ void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
 
 	// convert to UNIX time based on UT_x being from start of today
 
-	time_t day0 = previousMidnight(t0);
-	*trise = day0 + SECS_PER_HOUR*UT_r;
-	*tset = day0 + SECS_PER_HOUR*UT_s;
+	*trise = srs_day0 + (time_t)(SECS_PER_HOUR*UT_r);
+	*tset = srs_day0 + (time_t)(SECS_PER_HOUR*UT_s);
+}
+
+/* given UNIX time, lat rads +N and lng rads +E, return UNIX secs of today's rise and set.
+ * if sun never rises: *trise (only) will be 0; if never sets: *tset (only) will be 0.
+ */
+void sunrs (const time_t &t0, const LatLong &ll, time_t *trise, time_t *tset)
+{
+	initSunRSTable (t0);
+	sunrsOne (ll, trise, tset);
+}
+
+/* same as sunrs() but for n locations at once, such as every spot in a list.
+ * the solar ephemeris for the day is computed at most once for all.
+ */
+void sunrsMany (const time_t &t0, const LatLong ll[], int n, time_t trise[], time_t tset[])
+{
+	initSunRSTable (t0);
+	for (int i = 0; i < n; i++)
+	    sunrsOne (ll[i], &trise[i], &tset[i]);
 }
 
 
@@ -720,7 +720,7 @@ void changeTime (time_t t)
 bool checkTZTouch (const SCoord &s, TZInfo &tzi, const LatLong &ll)
 {
     if (inBox (s, tzi.box)) {
-        int32_t tz0_secs = getTZ (ll);                  // nominal timezone offset
+        int32_t tz0_secs = getTZ (ll);                  // current local offset, including any daylight time
         if (tzi.tz_secs <= tz0_secs)
             tzi.tz_secs += 3600;                        // -1 -> 0 or 0 -> +1 hours
         else
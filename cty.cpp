@@ -0,0 +1,539 @@
+/* local callsign prefix database read from a cty.dat file.
+ *
+ * The file is the usual CT/country-files.com format: each entity begins with a header line
+ *   name: CQ zone: ITU zone: continent: lat: lng: UTC offset: primary prefix:
+ * where lng is +W, followed by a comma separated list of prefixes ending with ';'. A list entry beginning
+ * with '=' is a complete callsign rather than a prefix. An entry may be followed by (CQ) [ITU] <lat/lng>
+ * {continent} ~offset~ overrides of which only <lat/lng> is used here.
+ *
+ * All prefixes and calls are stored in a trie so finding the longest matching prefix of a call costs one
+ * step per character. The file is $HOME/.hamclock/cty.dat on UNIX and is reloaded if it changes. ESP has
+ * no room for it so ctyLookup() always fails there.
+ *
+ * unit test and timing:
+ *   g++ -O2 -D_CTY_UNITTEST -o x.cty cty.cpp && ./x.cty cty.dat K1ABC VP2E/W1AW EA8/DL1XYZ 3D2ABC/P
+ */
+
+#ifdef _CTY_UNITTEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define _USE_UNIX
+#define _FX(x)  x
+
+typedef struct {
+    float lat, lng;
+    float lat_d, lng_d;
+} LatLong;
+
+static struct {
+    void printf (const char *fmt, ...) {
+        va_list ap;
+        va_start (ap, fmt);
+        vprintf (fmt, ap);
+        va_end (ap);
+    }
+} Serial;
+
+static float deg2rad (float d) { return (0.01745329F*d); }
+
+#else
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+#include <pthread.h>
+#include <sys/stat.h>
+#endif
+
+#endif // _CTY_UNITTEST
+
+
+
+#if defined(_USE_UNIX)
+
+#define CTY_FILE        "cty.dat"       // file name in our private dir
+#define CTY_CHECK       60              // check for a changed file this often, secs
+#define CTY_NAMELEN     32              // max entity name length, including EOS
+#define CTY_PREFLEN     8               // max primary prefix length, including EOS
+
+// one DXCC entity
+typedef struct {
+    char name[CTY_NAMELEN];             // entity name
+    char prefix[CTY_PREFLEN];           // primary prefix
+} CtyEntity;
+
+// a location for a prefix or call, most share their entity's
+typedef struct {
+    uint16_t ent;                       // index into entities
+    float lat_d, lng_d;                 // degs +N +E
+} CtyLoc;
+
+// trie node, children are a singly linked list of siblings
+typedef struct {
+    int32_t child;                      // first child node, or -1
+    int32_t sibling;                    // next sibling, or -1
+    int32_t pref_loc;                   // index into locs if a prefix ends here, else -1
+    int32_t exact_loc;                  // index into locs if a complete call ends here, else -1
+    char c;                             // character leading here from parent
+} CtyNode;
+
+// a complete database
+typedef struct {
+    CtyEntity *ents;                    // malloced entities
+    int n_ents, max_ents;
+    CtyLoc *locs;                       // malloced locations
+    int n_locs, max_locs;
+    CtyNode *nodes;                     // malloced trie nodes, [0] is the root
+    int n_nodes, max_nodes;
+} CtyDB;
+
+// current database and when the file was last checked, only accessed with cty_lock held
+static CtyDB cty;
+static time_t cty_mtime;                // mtime of file loaded, 0 if none
+static time_t cty_checked;              // time() of last file check
+static pthread_mutex_t cty_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* release all memory used by db
+ */
+static void ctyFree (CtyDB &db)
+{
+    free (db.ents);
+    free (db.locs);
+    free (db.nodes);
+    memset (&db, 0, sizeof(db));
+}
+
+/* grow the array at *arrp if full, return whether ok
+ */
+static bool ctyGrow (void **arrp, int n, int *maxp, size_t size)
+{
+    if (n < *maxp)
+        return (true);
+    int new_max = *maxp ? 2 * *maxp : 1024;
+    void *new_arr = realloc (*arrp, new_max*size);
+    if (!new_arr)
+        return (false);
+    *arrp = new_arr;
+    *maxp = new_max;
+    return (true);
+}
+
+/* add a new node to db as a child of parent for character c.
+ * return its index or -1 if no memory.
+ */
+static int32_t ctyNewNode (CtyDB &db, int32_t parent, char c)
+{
+    if (!ctyGrow ((void**)&db.nodes, db.n_nodes, &db.max_nodes, sizeof(CtyNode)))
+        return (-1);
+    int32_t i = db.n_nodes++;
+    CtyNode &n = db.nodes[i];
+    n.child = -1;
+    n.sibling = -1;
+    n.pref_loc = -1;
+    n.exact_loc = -1;
+    n.c = c;
+    if (parent >= 0) {
+        n.sibling = db.nodes[parent].child;
+        db.nodes[parent].child = i;
+    }
+    return (i);
+}
+
+/* return the child of node for character c, or -1
+ */
+static int32_t ctyChild (const CtyDB &db, int32_t node, char c)
+{
+    for (int32_t i = db.nodes[node].child; i >= 0; i = db.nodes[i].sibling)
+        if (db.nodes[i].c == c)
+            return (i);
+    return (-1);
+}
+
+/* add a location to db, return its index or -1 if no memory
+ */
+static int32_t ctyNewLoc (CtyDB &db, int ent, float lat_d, float lng_d)
+{
+    if (!ctyGrow ((void**)&db.locs, db.n_locs, &db.max_locs, sizeof(CtyLoc)))
+        return (-1);
+    CtyLoc &l = db.locs[db.n_locs];
+    l.ent = ent;
+    l.lat_d = lat_d;
+    l.lng_d = lng_d;
+    return (db.n_locs++);
+}
+
+/* add the given prefix or complete call to db with the given location.
+ * return whether ok.
+ */
+static bool ctyInsert (CtyDB &db, const char *str, bool exact, int32_t loc)
+{
+    int32_t node = 0;
+    for (; *str; str++) {
+        char c = toupper (*str);
+        int32_t next = ctyChild (db, node, c);
+        if (next < 0 && (next = ctyNewNode (db, node, c)) < 0)
+            return (false);
+        node = next;
+    }
+    if (exact)
+        db.nodes[node].exact_loc = loc;
+    else
+        db.nodes[node].pref_loc = loc;
+    return (true);
+}
+
+/* add one entry from the prefix list of entity ent to db.
+ * the entry is a prefix or =call optionally followed by overrides.
+ * return whether ok.
+ */
+static bool ctyAddEntry (CtyDB &db, int ent, int32_t ent_loc, char *entry)
+{
+    bool exact = false;
+    while (isspace (*entry))
+        entry++;
+    if (*entry == '=') {
+        exact = true;
+        entry++;
+    }
+
+    // prefix ends at the first override, if any
+    char *ovr = strpbrk (entry, "([<{~");
+    char *end = ovr ? ovr : entry + strlen(entry);
+    while (end > entry && isspace(end[-1]))
+        end--;
+    if (end == entry)
+        return (true);                  // tolerate empty entries
+
+    // use own location if overridden
+    int32_t loc = ent_loc;
+    char *llp;
+    if (ovr && (llp = strchr (ovr, '<')) != NULL) {
+        float lat_d, lng_d;
+        if (sscanf (llp, "<%f/%f>", &lat_d, &lng_d) == 2)
+            loc = ctyNewLoc (db, ent, lat_d, -lng_d);
+    }
+
+    char save = *end;
+    *end = '\0';
+
+    bool ok = loc >= 0 && ctyInsert (db, entry, exact, loc);
+    *end = save;
+    return (ok);
+}
+
+/* add the entity described by the given header line and prefix list to db.
+ * return whether ok.
+ */
+static bool ctyAddEntity (CtyDB &db, char *hdr, char *list)
+{
+    // crack header
+    char *fields[8];
+    int nf = 0;
+    char *lasts;
+    for (char *f = strtok_r (hdr, ":", &lasts); f && nf < 8; f = strtok_r (NULL, ":", &lasts))
+        fields[nf++] = f;
+    if (nf != 8)
+        return (false);
+    for (int i = 0; i < nf; i++) {
+        while (isspace (*fields[i]))
+            fields[i]++;
+        char *e = fields[i] + strlen(fields[i]);
+        while (e > fields[i] && isspace(e[-1]))
+            *--e = '\0';
+    }
+
+    // add entity and its location, file longitude is +W
+    if (!ctyGrow ((void**)&db.ents, db.n_ents, &db.max_ents, sizeof(CtyEntity)))
+        return (false);
+    int ent = db.n_ents++;
+    CtyEntity &e = db.ents[ent];
+    snprintf (e.name, sizeof(e.name), "%s", fields[0]);
+    snprintf (e.prefix, sizeof(e.prefix), "%s", fields[7][0] == '*' ? fields[7]+1 : fields[7]);
+    int32_t ent_loc = ctyNewLoc (db, ent, atof(fields[4]), -atof(fields[5]));
+    if (ent_loc < 0)
+        return (false);
+
+    // add each entry in list
+    for (char *entry = strtok_r (list, ",", &lasts); entry; entry = strtok_r (NULL, ",", &lasts))
+        if (!ctyAddEntry (db, ent, ent_loc, entry))
+            return (false);
+
+    return (true);
+}
+
+/* build a fresh db from the given file.
+ * return whether ok, db is untouched if not.
+ */
+static bool ctyReadFile (const char *fn, CtyDB &db)
+{
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return (false);
+
+    CtyDB new_db;
+    memset (&new_db, 0, sizeof(new_db));
+    bool ok = ctyNewNode (new_db, -1, '\0') == 0;       // root
+
+    // each entity is a header line ending with ':' then list lines until ';'
+    char line[200];
+    char hdr[200] = "";
+    size_t list_len = 0, list_max = 0;
+    char *list = NULL;
+    bool in_list = false;
+    while (ok && fgets (line, sizeof(line), fp)) {
+        line[strcspn (line, "\r\n")] = '\0';
+        if (!in_list) {
+            if (strchr (line, ':')) {
+                snprintf (hdr, sizeof(hdr), "%s", line);
+                list_len = 0;
+                in_list = true;
+            }
+            continue;
+        }
+        size_t ll = strlen (line);
+        if (list_len + ll + 1 > list_max) {
+            list_max = 2*(list_len + ll + 1);
+            char *new_list = (char *) realloc (list, list_max);
+            if (!new_list) {
+                ok = false;
+                break;
+            }
+            list = new_list;
+        }
+        memcpy (list + list_len, line, ll + 1);
+        list_len += ll;
+        char *semi = strchr (list, ';');
+        if (semi) {
+            *semi = '\0';
+            if (!ctyAddEntity (new_db, hdr, list))
+                Serial.printf (_FX("Cty: bad entity %s\n"), hdr);
+            in_list = false;
+        }
+    }
+    fclose (fp);
+    free (list);
+
+    if (!ok || new_db.n_ents == 0) {
+        ctyFree (new_db);
+        return (false);
+    }
+
+    ctyFree (db);
+    db = new_db;
+    return (true);
+}
+
+/* load or reload the database if the file is new or changed.
+ * N.B. call with cty_lock held
+ */
+static void ctyCheckFile()
+{
+    time_t t = time(NULL);
+    if (t - cty_checked < CTY_CHECK)
+        return;
+    cty_checked = t;
+
+#ifdef _CTY_UNITTEST
+    const char *fn = getenv ("CTY_FILE");
+    if (!fn)
+        return;
+#else
+    char fn[1000];
+    snprintf (fn, sizeof(fn), "%s/.hamclock/%s", getenv("HOME"), CTY_FILE);
+#endif
+
+    struct stat sbuf;
+    if (stat (fn, &sbuf) < 0) {
+        static bool reported;
+        if (!reported) {
+            Serial.printf (_FX("Cty: %s not found\n"), fn);
+            reported = true;
+        }
+        return;
+    }
+    if (sbuf.st_mtime == cty_mtime)
+        return;
+
+    if (ctyReadFile (fn, cty)) {
+        cty_mtime = sbuf.st_mtime;
+        Serial.printf (_FX("Cty: %s: %d entities %d locations %d nodes\n"), fn, cty.n_ents, cty.n_locs,
+                        cty.n_nodes);
+    } else
+        Serial.printf (_FX("Cty: %s: read failed\n"), fn);
+}
+
+/* find the location of the given complete call if exact, else of its longest matching prefix.
+ * return index into cty.locs or -1.
+ * N.B. call with cty_lock held
+ */
+static int32_t ctyFind (const char *str, bool exact)
+{
+    int32_t best = -1;
+    int32_t node = 0;
+    for (; *str; str++) {
+        node = ctyChild (cty, node, toupper(*str));
+        if (node < 0)
+            return (exact ? -1 : best);
+        if (cty.nodes[node].pref_loc >= 0)
+            best = cty.nodes[node].pref_loc;
+    }
+    return (exact ? cty.nodes[node].exact_loc : best);
+}
+
+/* return whether s is a portable suffix that says nothing about location
+ */
+static bool ctyIgnoreSuffix (const char *s)
+{
+    static const char *sfx[] = {"P", "M", "A", "B", "QRP", "QRPP", "LH", "J"};
+    for (unsigned i = 0; i < sizeof(sfx)/sizeof(sfx[0]); i++)
+        if (strcasecmp (s, sfx[i]) == 0)
+            return (true);
+    return (isdigit(s[0]) && s[1] == '\0');
+}
+
+/* return index into cty.locs for the given call sign, or -1.
+ * portable forms such as DL/W1ABC and W1ABC/P are handled; /MM and /AM have no location.
+ * N.B. call with cty_lock held
+ */
+static int32_t ctyLocate (const char *call)
+{
+    // split on / into at most 3 parts, drop those that don't indicate location
+    char buf[32];
+    snprintf (buf, sizeof(buf), "%s", call);
+    char *parts[3];
+    int np = 0;
+    char *lasts;
+    for (char *p = strtok_r (buf, "/", &lasts); p && np < 3; p = strtok_r (NULL, "/", &lasts)) {
+        if (strcasecmp (p, "MM") == 0 || strcasecmp (p, "AM") == 0)
+            return (-1);
+        if (np == 0 || !ctyIgnoreSuffix (p))
+            parts[np++] = p;
+    }
+    if (np == 0)
+        return (-1);
+
+    // with two parts the shorter is the operating prefix
+    const char *key = parts[0];
+    if (np >= 2 && strlen (parts[1]) < strlen (parts[0]))
+        key = parts[1];
+
+    ctyCheckFile();
+
+    // whole call may be listed exactly, else use the longest prefix of key
+    int32_t loc = -1;
+    if (cty.n_nodes > 0) {
+        loc = ctyFind (call, true);
+        if (loc < 0)
+            loc = ctyFind (key, false);
+    }
+    return (loc);
+}
+
+/* given a call sign return its location and entity name.
+ * entity may be NULL.
+ * return whether found.
+ */
+bool ctyLookup (const char *call, LatLong &ll, char *entity, size_t entity_len)
+{
+    pthread_mutex_lock (&cty_lock);
+
+    int32_t loc = ctyLocate (call);
+    bool ok = loc >= 0;
+    if (ok) {
+        const CtyLoc &l = cty.locs[loc];
+        ll.lat_d = l.lat_d;
+        ll.lng_d = l.lng_d;
+        ll.lat = deg2rad (ll.lat_d);
+        ll.lng = deg2rad (ll.lng_d);
+        if (entity)
+            snprintf (entity, entity_len, "%s", cty.ents[l.ent].name);
+    }
+
+    pthread_mutex_unlock (&cty_lock);
+
+    return (ok);
+}
+
+/* given a call sign return the primary prefix of its DXCC entity, such as "K" or "DL".
+ * return whether found.
+ */
+bool ctyDXCC (const char *call, char *prefix, size_t prefix_len)
+{
+    pthread_mutex_lock (&cty_lock);
+
+    int32_t loc = ctyLocate (call);
+    bool ok = loc >= 0;
+    if (ok)
+        snprintf (prefix, prefix_len, "%s", cty.ents[cty.locs[loc].ent].prefix);
+
+    pthread_mutex_unlock (&cty_lock);
+
+    return (ok);
+}
+
+#else // !_USE_UNIX
+
+bool ctyLookup (const char *call, LatLong &ll, char *entity, size_t entity_len)
+{
+    (void) call; (void) ll; (void) entity; (void) entity_len;
+    return (false);
+}
+
+bool ctyDXCC (const char *call, char *prefix, size_t prefix_len)
+{
+    (void) call; (void) prefix; (void) prefix_len;
+    return (false);
+}
+
+#endif // _USE_UNIX
+
+
+
+#ifdef _CTY_UNITTEST
+
+int main (int ac, char *av[])
+{
+    if (ac < 3) {
+        fprintf (stderr, "Usage: %s cty.dat call ...\n", av[0]);
+        return (1);
+    }
+    setenv ("CTY_FILE", av[1], 1);
+
+    for (int i = 2; i < ac; i++) {
+        LatLong ll;
+        char entity[CTY_NAMELEN];
+        if (ctyLookup (av[i], ll, entity, sizeof(entity)))
+            printf ("%-12s %-26s %7.2f %8.2f\n", av[i], entity, ll.lat_d, ll.lng_d);
+        else
+            printf ("%-12s not found\n", av[i]);
+    }
+
+    // timing
+    const int NT = 1000000;
+    struct timespec t0, t1;
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    int n_found = 0;
+    for (int i = 0; i < NT; i++) {
+        LatLong ll;
+        n_found += ctyLookup (av[2 + i%(ac-2)], ll, NULL, 0);
+    }
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+    printf ("%.3f us per lookup (%d found)\n",
+        1e6*((t1.tv_sec - t0.tv_sec) + 1e-9*(t1.tv_nsec - t0.tv_nsec))/NT, n_found);
+
+    return (0);
+}
+
+#endif // _CTY_UNITTEST
@@ -7,6 +7,7 @@
  * WSJT-X:
  *   [ ] packet definition: https://github.com/roelandjansen/wsjt-x/blob/master/NetworkMessage.hpp
  *   [ ] We don't actually enforce the Status ID to be WSJT-X so this may also work for, say, JTDX.
+ *   [ ] Status sets DX; Decode, WSPR Decode and QSO Logged messages just add spots. See wsjtx.cpp.
  */
 
 #include "HamClock.h"
@@ -143,7 +144,7 @@ typedef enum {
 static ClusterType cl_type;
 
 
-static bool addDXSpot (float kHz, const char call[], uint32_t grid, uint16_t ut);
+static bool addDXSpot (float kHz, const char call[], const char de_call[], uint8_t mode, uint32_t grid, uint16_t ut);
 static void engageRow (DXSpot &s);
 
 
@@ -168,6 +169,7 @@ static void setDXSpotMapPosition (DXSpot &s)
         SCoord center;
         ll2s (s.ll, center, 0);
         setMapTagBox (tag, center, 0, s.map_b);
+        mapSymbolsMoved();
 }
 
 static void drawSpotOnMap (DXSpot &s)
@@ -192,155 +194,78 @@ static void eraseSpotOnMap (const DXSpot &s)
 }
 #endif
 
-/* given address of pointer into a WSJT-X message, extract bool and advance pointer to next field.
+/* add a spot for any WSJT-X message that describes one, setting DX too if from a Status message.
  */
-static bool wsjtx_bool (uint8_t **bpp)
+static void wsjtxProcessMsg (const WSJTXMsg &m)
 {
-        bool x = **bpp > 0;
-        *bpp += 1;
-        return (x);
-}
-
-/* given address of pointer into a WSJT-X message, extract uint32_t and advance pointer to next field.
- * bytes are big-endian order.
- */
-static uint32_t wsjtx_quint32 (uint8_t **bpp)
-{
-        uint32_t x = ((*bpp)[0] << 24) | ((*bpp)[1] << 16) | ((*bpp)[2] << 8) | (*bpp)[3];
-        *bpp += 4;
-        return (x);
-}
-
-/* given address of pointer into a WSJT-X message, extract utf8 string and advance pointer to next field.
- * N.B. returned string points into message so will only be valid as long as message memory is valid.
- */
-static char *wsjtx_utf8 (uint8_t **bpp)
-{
-        // save begining of this packet entry
-        uint8_t *bp0 = *bpp;
-
-        // decode length
-        uint32_t len = wsjtx_quint32 (bpp);
-
-        // check for flag meaning null length string same as 0 for our purposes
-        if (len == 0xffffffff)
-            len = 0;
-
-        // advance packet pointer over contents
-        *bpp += len;
-
-        // copy contents to front, overlaying length, to make room to add EOS
-        memmove (bp0, bp0+4, len);
-        bp0[len] = '\0';
+        static WSJTXState st;
 
-        // Serial.printf (_FX("DXC: utf8 %d '%s'\n"), len, (char*)bp0);
+        SpotRec r;
+        char maid[5];
+        if (!wsjtxSpot (m, st, r, maid))
+            return;
 
-        // return address of content now within packet
-        return ((char *)bp0);
-}
+        // use grid if known, else addDXSpot looks up the call
+        uint32_t grid = 0;
+        LatLong ll;
+        if (maid[0] && maidenhead2ll (ll, maid))
+            grid = packMaidFromStr (maid);
 
-/* given address of pointer into a WSJT-X message, extract double and advance pointer to next field.
- */
-static uint64_t wsjtx_quint64 (uint8_t **bpp)
-{
-        uint64_t x;
+        // prep current UT time
+        uint16_t ut = hour()*100 + minute();
 
-        x = ((uint64_t)(wsjtx_quint32(bpp))) << 32;
-        x |= wsjtx_quint32 (bpp);
+        // add to list unless a repeat
+        bool added = addDXSpot (r.kHz, r.call, r.de_call, r.mode, grid, ut);
+        if (m.type != WM_STATUS)
+            return;
 
-        return (x);
+        // Status always sets DX, even when reselecting a station already spotted
+        // Serial.printf (_FX("DXC: WSJT-X %s @ %s\n"), r.call, maid);
+        if (added) {
+            engageRow (spots[n_spots-1]);
+            return;
+        }
+        for (int i = n_spots; --i >= 0; ) {
+            DXSpot &s = spots[i];
+            if (fabsf(r.kHz-s.freq) < 0.1F && strcmp (r.call, s.call) == 0) {
+                engageRow (s);
+                return;
+            }
+        }
+        if (grid) {
+            // repeat no longer in the list
+            DXSpot s;
+            memset (&s, 0, sizeof(s));
+            s.freq = r.kHz;
+            memcpy (s.call, r.call, MAX_DXSPOTCALL_LEN-1);
+            s.grid = grid;
+            engageRow (s);
+        }
 }
 
-/* return whether the given packet contains a WSJT-X Status packet.
- * if true, leave *bpp positioned just after ID.
+/* crack a cluster line of the form
+ *   DX de KD0AA:     18100.0  JR1FYS       FT8 LOUD in FL!                2156Z EL98
+ * into the spotted call, spotter, frequency and mode guessed from the comment.
+ * N.B. safe to call from any thread.
  */
-static bool wsjtxIsStatusMsg (uint8_t **bpp)
+bool crackDXClusterSpot (const char *line, char call[MAX_DXSPOTCALL_LEN], char de_call[MAX_DXSPOTCALL_LEN],
+        float *kHzp, uint8_t *modep)
 {
-        resetWatchdog();
-
-        // crack magic header
-        uint32_t magic = wsjtx_quint32 (bpp);
-        // Serial.printf (_FX("DXC: magic 0x%x\n"), magic);
-        if (magic != 0xADBCCBDA) {
-            Serial.println (F("DXC: packet received but wrong magic"));
-            return (false);
-        }
-
-        // crack and ignore the max schema value
-        (void) wsjtx_quint32 (bpp);                         // skip past max schema
-
-        // crack message type. we only care about Status messages which are type 1
-        uint32_t msgtype = wsjtx_quint32 (bpp);
-        // Serial.printf (_FX("DXC: type %d\n"), msgtype);
-        if (msgtype != 1)
+        char c[30], de[30];
+        int comment;
+        if (sscanf (line, _FX("DX de %29s %f %29s%n"), de, kHzp, c, &comment) != 3)
             return (false);
 
-        // if we get this far assume packet is what we want.
-        // crack ID but ignore to allow compatibility with clones.
-        volatile char *id = wsjtx_utf8 (bpp);
-        (void)id;           // lint
-        // Serial.printf (_FX("DXC: id '%s'\n"), id);
-        // if (strcmp ("WSJT-X", id) != 0)
-            // return (false);
-
-        // ok!
+        // spotter is followed by colon
+        char *colon = strchr (de, ':');
+        if (colon)
+            *colon = '\0';
+        snprintf (call, MAX_DXSPOTCALL_LEN, "%.*s", MAX_DXSPOTCALL_LEN-1, c);
+        snprintf (de_call, MAX_DXSPOTCALL_LEN, "%.*s", MAX_DXSPOTCALL_LEN-1, de);
+        *modep = spotModeGuess (line + comment, *kHzp);
         return (true);
 }
 
-/* parse and process WSJT-X message known to be Status.
- * *bpp is positioned just after ID field.
- */
-static void wsjtxParseStatusMsg (uint8_t **bpp)
-{
-        resetWatchdog();
-        // Serial.println (_FX("DXC: Parsing status"));
-
-        // crack remaining fields down to DX grid
-        uint64_t dial_freq = wsjtx_quint64 (bpp);           // capture Hz
-        (void) wsjtx_utf8 (bpp);                            // skip over mode
-        char *dx_call = wsjtx_utf8 (bpp);                   // capture DX call
-        (void) wsjtx_utf8 (bpp);                            // skip over report
-        (void) wsjtx_utf8 (bpp);                            // skip over Tx mode
-        (void) wsjtx_bool (bpp);                            // skip over Tx enabled flag
-        (void) wsjtx_bool (bpp);                            // skip over transmitting flag
-        (void) wsjtx_bool (bpp);                            // skip over decoding flag
-        (void) wsjtx_quint32 (bpp);                         // skip over Rx DF -- not always correct
-        (void) wsjtx_quint32 (bpp);                         // skip over Tx DF
-        (void) wsjtx_utf8 (bpp);                            // skip over DE call
-        (void) wsjtx_utf8 (bpp);                            // skip over DE grid
-        char *dx_grid = wsjtx_utf8 (bpp);                   // capture DX grid
-
-        // Serial.printf (_FX("DXC: dial freq %lu\n"), dial_freq);
-        // Serial.printf (_FX("DXC: dx call %s\n"), dx_call);
-        // Serial.printf (_FX("DXC: dx grid %s\n"), dx_grid);
-
-        // ignore if frequency is clearly bogus (which I have seen)
-        if (dial_freq == 0)
-            return;
-
-        // prep grid if valid
-        LatLong ll;
-        if (!maidenhead2ll (ll, dx_grid)) {
-            // Serial.printf (_FX("DXC: %s invalid grid: %s\n"), dx_call, dx_grid);
-            return;
-        }
-        uint32_t grid;
-        memcpy (&grid, dx_grid, 4);
-
-        // prep current UT time
-        int hr = hour();
-        int mn = minute();
-        uint16_t ut = hr*100 + mn;
-
-        // add to list with actual frequency and set DX if new
-        if (addDXSpot (dial_freq*1e-3, dx_call, grid, ut)) {                  // Hz to kHz
-            // Serial.printf (_FX("DXC: WSJT-X %s @ %s\n"), dx_call, dx_grid);
-            engageRow (spots[n_spots-1]);
-        }
-
-        // printFreeHeap(F("wsjtxParseStatusMsg"));
-}
-
 /* convert any upper case letter in str to lower case IN PLACE
  */
 static void strtolower (char *str)
@@ -446,7 +371,7 @@ static bool findLabeledValue (const char *buf, int *valuep, const char *str)
 }
 
 
-/* given a call sign return its lat/long by querying dx_client.
+/* given a call sign return its lat/long from the local prefix database, else by querying dx_client.
  * technique depends on cl_type.
  * return whether successful.
  */
@@ -454,6 +379,12 @@ static bool getDXSpotLL (const char *call, LatLong &ll)
 {
         char buf[120];
 
+        // local lookup avoids a cluster round trip for each spot
+        if (ctyLookup (call, ll, buf, sizeof(buf))) {
+            LOGF (LOGL_DEBUG, _FX("DXC: %s %s lat= %g lon= %g\n"), call, buf, ll.lat_d, ll.lng_d);
+            return (true);
+        }
+
         if (cl_type == CT_DXSPIDER) {
 
             // ask for heading 
@@ -480,6 +411,11 @@ static bool getDXSpotLL (const char *call, LatLong &ll)
 
     #endif // _SUPPORT_ARCLUSTER
 
+        } else if (cl_type == CT_WSJTX) {
+
+            // nothing more to ask
+            return (false);
+
         } else {
 
             Serial.printf (_FX("Bug! cl_type= %d\n"), cl_type);
@@ -596,11 +532,12 @@ static bool connectDXCluster()
         return (false);
 }
 
-/* add and display a new spot both on map and in list, scrolling list if already full.
+/* add a new spot to the spot store and, unless already there, display it both on map and in list,
+ * scrolling list if already full.
  * use grid to get ll if set, else look up call to set both.
  * or return false if same spot again or some error.
  */
-static bool addDXSpot (float kHz, const char call[], uint32_t grid, uint16_t ut)
+static bool addDXSpot (float kHz, const char call[], const char de_call[], uint8_t mode, uint32_t grid, uint16_t ut)
 {
         // skip if same station on same freq as previous
         if (n_spots > 0) {
@@ -609,16 +546,15 @@ static bool addDXSpot (float kHz, const char call[], uint32_t grid, uint16_t ut)
                 return (false);
         }
 
-        // find next available row, scrolling if necessary
-        if (n_spots == LISTING_N) {
-            // scroll up, discarding top (first) entry
-            for (uint8_t i = 0; i < LISTING_N-1; i++) {
-                spots[i] = spots[i+1];
-                drawSpotOnList (i);
-            }
-            n_spots = LISTING_N-1;
-        }
-        DXSpot *sp = &spots[n_spots];
+        // skip repeats of any recent spot before spending a lookup or disturbing the list
+        time_t t = now();
+        if (spotStoreIsDup (call, kHz, t))
+            return (false);
+
+        // build here, list is only changed once the spot is known to be new
+        DXSpot new_spot;
+        memset (&new_spot, 0, sizeof(new_spot));
+        DXSpot *sp = &new_spot;
 
         // store some
         sp->freq = kHz;
@@ -635,7 +571,7 @@ static bool addDXSpot (float kHz, const char call[], uint32_t grid, uint16_t ut)
             unpackMaidToStr (maid, grid);
             ok = maidenhead2ll (sp->ll, maid);
             if (ok)
-                Serial.printf (_FX("DXC: %s %s lat= %g lng= %g\n"),
+                LOGF (LOGL_DEBUG, _FX("DXC: %s %s lat= %g lng= %g\n"),
                                         sp->call, maid, sp->ll.lat_d, sp->ll.lng_d);
             else
                 snprintf (errmsg, sizeof(errmsg), _FX("%s bad grid: %s"), call, maid);
@@ -650,14 +586,36 @@ static bool addDXSpot (float kHz, const char call[], uint32_t grid, uint16_t ut)
                 snprintf (errmsg, sizeof(errmsg), _FX("%s ll lookup failed"), call);
         }
         if (!ok) {
-            // error set grid and ll to 0/0
             dxcTrace (errmsg);
-            char maid[] = "JJ00";
-            memcpy (&sp->grid, maid, 4);
-            memset (&sp->ll, 0, sizeof(sp->ll));
             return (false);
         }
 
+        // record in store, which also rejects a repeat added meanwhile by another thread
+        SpotRec r;
+        memset (&r, 0, sizeof(r));
+        snprintf (r.call, sizeof(r.call), "%s", call);
+        snprintf (r.de_call, sizeof(r.de_call), "%s", de_call);
+        if (!ctyDXCC (call, r.dxcc, sizeof(r.dxcc)))
+            r.dxcc[0] = '\0';
+        r.kHz = kHz;
+        r.lat_d = sp->ll.lat_d;
+        r.lng_d = sp->ll.lng_d;
+        r.t = t;
+        r.mode = mode;
+        if (!spotStoreAdd (r))
+            return (false);
+
+        // find next available row, scrolling if necessary
+        if (n_spots == LISTING_N) {
+            // scroll up, discarding top (first) entry
+            for (uint8_t i = 0; i < LISTING_N-1; i++) {
+                spots[i] = spots[i+1];
+                drawSpotOnList (i);
+            }
+            n_spots = LISTING_N-1;
+        }
+        sp = &spots[n_spots];
+        *sp = new_spot;
 
         // draw
         drawSpotOnList (n_spots);
@@ -836,6 +794,7 @@ void initDXCluster()
                     drawSpotOnList (i);
             } else {
                 n_spots = 0;
+                mapSymbolsMoved();
             }
 
             // init time
@@ -866,6 +825,8 @@ void updateDXCluster()
         if (plot2_ch != PLOT2_DX || !useDXCluster())
             return;
 
+        PerfTimer pt (PERF_DXCLUSTER);
+
         // insure connected
         reconnect(false);
 
@@ -876,8 +837,6 @@ void updateDXCluster()
             // roll any new spots into list
             bool gotone = false;
             char line[120];
-            char call[30];
-            float kHz;
             while (dx_client.available() && getTCPLine (dx_client, line, sizeof(line), NULL)) {
                 // DX de KD0AA:     18100.0  JR1FYS       FT8 LOUD in FL!                2156Z EL98
 
@@ -891,7 +850,10 @@ void updateDXCluster()
                         *lp = ' ';
 
                 // crack
-                if (sscanf (line, _FX("DX de %*s %f %10s"), &kHz, call) == 2) {
+                char call[MAX_DXSPOTCALL_LEN], de_call[MAX_DXSPOTCALL_LEN];
+                float kHz;
+                uint8_t mode;
+                if (crackDXClusterSpot (line, call, de_call, &kHz, &mode)) {
                     dxcTrace (line);
 
                     // looks like a spot, extract time also
@@ -900,7 +862,7 @@ void updateDXCluster()
 
                     // note and display
                     gotone = true;
-                    (void) addDXSpot (kHz, call, 0, ut);
+                    (void) addDXSpot (kHz, call, de_call, mode, 0, ut);
                 }
             }
 
@@ -924,38 +886,26 @@ void updateDXCluster()
 
             resetWatchdog();
 
-            // drain ALL pending packets, retain most recent Status message if any
-
-            uint8_t *any_msg = NULL;        // malloced if get a new packet of any type
-            uint8_t *sts_msg = NULL;        // malloced if find Status msg
-
-            int packet_size;
-            while ((packet_size = wsjtx_server.parsePacket()) > 0) {
-                // Serial.printf (_FX("DXC: WSJT-X size= %d heap= %d\n"), packet_size, ESP.getFreeHeap());
-                any_msg = (uint8_t *) realloc (any_msg, packet_size);
-                resetWatchdog();
-                if (wsjtx_server.read (any_msg, packet_size) > 0) {
-                    uint8_t *bp = any_msg;
-                    if (wsjtxIsStatusMsg (&bp)) {
-                        // save from bp to the end in prep for wsjtxParseStatusMsg()
-                        int n_skip = bp - any_msg;
-                        // Serial.printf (_FX("DXC: skip= %d packet_size= %d\n"), n_skip, packet_size);
-                        sts_msg = (uint8_t *) realloc (sts_msg, packet_size - n_skip);
-                        memcpy (sts_msg, any_msg + n_skip, packet_size - n_skip);
-                    }
-                }
-            }
-
-            // process then free newest Status message if received
-            if (sts_msg) {
-                uint8_t *bp = sts_msg;
-                wsjtxParseStatusMsg (&bp);
-                free (sts_msg);
+            // drain ALL pending packets, decoding each in place.
+            // on ESP the buffer is only borrowed from the heap while packets are pending.
+            int packet_size = wsjtx_server.parsePacket();
+            if (packet_size > 0) {
+#if defined(_USE_UNIX)
+                static uint8_t pkt[WSJTX_MAXPKT];
+#else
+                StackMalloc pkt_mem(WSJTX_MAXPKT);
+                uint8_t *pkt = (uint8_t *) pkt_mem.getMem();
+#endif
+                do {
+                    // Serial.printf (_FX("DXC: WSJT-X size= %d heap= %d\n"), packet_size, ESP.getFreeHeap());
+                    resetWatchdog();
+                    if (packet_size > WSJTX_MAXPKT)
+                        packet_size = WSJTX_MAXPKT;
+                    WSJTXMsg m;
+                    if (wsjtx_server.read (pkt, packet_size) > 0 && wsjtxDecode (pkt, packet_size, m))
+                        wsjtxProcessMsg (m);
+                } while ((packet_size = wsjtx_server.parsePacket()) > 0);
             }
-
-            // clean up
-            if (any_msg)
-                free (any_msg);
         }
 
 }
@@ -1025,6 +975,14 @@ void updateDXSpotScreenLocations()
             setDXSpotMapPosition (spots[i]);
 }
 
+/* add the label box of each spot to the overAnySymbol() grid
+ */
+void markDXSpotSymbols()
+{
+        for (uint8_t i = 0; i < n_spots; i++)
+            markSymbolBox (spots[i].map_b);
+}
+
 /* draw all DX spots on map, if up
  */
 void drawDXSpotsOnMap ()
@@ -36,6 +36,13 @@ uint8_t show_lp;                                // display long path, else short
 #define	GRAYLINE_POW	(0.75F)	                // cos power exponent, sqrt is too severe, 1 is too gradual
 static SCoord moremap_s;		        // drawMoreEarth() scanning location 
 
+#if defined(_USE_UNIX)
+#define MAP_SWEEP_MS    10000                   // paced time to redraw the whole map
+#define MAP_MAX_ROWS    (EARTH_H/8)             // max rows drawn per call when catching up
+static bool moremap_rush;                       // draw first sweep after initEarthMap() asap
+static uint32_t moremap_t0;                     // millis() when current paced sweep began
+#endif
+
 
 /* erase the DE symbol by restoring map contents.
  * N.B. we assume coords insure marker will be wholy within map boundaries.
@@ -225,22 +232,26 @@ void initEarthMap()
     drawDEInfo();
     drawDXInfo();
 
-    // insure NCDXF and DX spots screen coords match current map type
+    // insure NCDXF, DX spots and tracked sats screen coords match current map type
     updateBeaconScreenLocations();
     updateDXSpotScreenLocations();
+    updateSatTrackerScreenLocations();
 
     // init scan line in map_b
     moremap_s.x = 0;                    // avoid updateCircumstances() first call to drawMoreEarth()
     moremap_s.y = map_b.y;
+#if defined(_USE_UNIX)
+    moremap_rush = true;
+#endif
 
     // now main loop can resume with drawMoreEarth()
 }
 
-/* display more earth map at mmoremap_s.
+/* display one more row of earth map at mmoremap_s.
  * _USE_DESKTOP draws all the map then all symbols then updates screen, but ESP has to take care not to
  *   clobber symbols while drawing the map.
  */
-void drawMoreEarth()
+static void drawEarthRow()
 {
     resetWatchdog();
 
@@ -315,6 +326,15 @@ void drawMoreEarth()
         tft.drawPR();
 #endif
 
+#if defined(_USE_UNIX)
+        // end of rush, pace from now on
+        if (moremap_rush) {
+            moremap_rush = false;
+            moremap_t0 = millis();
+        } else
+            moremap_t0 += MAP_SWEEP_MS;
+#endif
+
         // #define _TIME_MAP
         #if defined(_TIME_MAP)
             static uint32_t map_t0;
@@ -326,6 +346,47 @@ void drawMoreEarth()
     }
 }
 
+/* display more earth map.
+ * UNIX spreads each sweep over MAP_SWEEP_MS, drawing only the rows that are due then asking the main loop
+ *   to come back when the next one is, except the first sweep after initEarthMap() goes as fast as it can.
+ * ESP draws one row per call.
+ */
+void drawMoreEarth()
+{
+#if defined(_USE_UNIX)
+
+    if (moremap_rush) {
+        drawEarthRow();
+        wakeLoopIn (0);
+        return;
+    }
+
+    uint32_t now = millis();
+
+    // start over if fell a whole sweep behind, eg after a long blocking download
+    if ((int32_t)(now - moremap_t0) > 2*MAP_SWEEP_MS)
+        moremap_t0 = now - (moremap_s.y - map_b.y)*MAP_SWEEP_MS/EARTH_H;
+
+    for (int n_rows = 0; n_rows < MAP_MAX_ROWS; n_rows++) {
+        uint32_t row_ms = moremap_t0 + (moremap_s.y - map_b.y)*MAP_SWEEP_MS/EARTH_H;
+        int32_t dt = (int32_t)(row_ms - now);
+        if (dt > 0) {
+            wakeLoopIn (dt);
+            return;
+        }
+        drawEarthRow();
+    }
+
+    // more are due
+    wakeLoopIn (0);
+
+#else
+
+    drawEarthRow();
+
+#endif
+}
+
 /* convert lat and long in radians to screen coords.
  * keep result no closer than the given edge distance.
  * N.B. we assume lat/lng are in range [-90,90] [-180,180)
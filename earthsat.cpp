@@ -11,6 +11,7 @@
 bool dx_info_for_sat;			// global to indicate whether dx_info_b is for DX info or sat info
 
 #define	MAX_TLE_AGE	7.0F		// max age to use a TLE, days (except moon)
+#define	MAX_TLE_AGE_SGP4 14.0F		// max age when propagating with SGP4, days
 #define SAT_MIN_EL      1.0F            // minimum sat elevation for event
 #define	TLE_REFRESH	(3600*6)	// freshen TLEs this often, seconds
 #define	SAT_TOUCH_R	20U		// touch radius, pixels
@@ -37,16 +38,24 @@ bool dx_info_for_sat;			// global to indicate whether dx_info_b is for DX info o
 #define	MAX_NSAT	(N_ROWS*N_COLS)				// max names we can display
 #define MAX_PASS_STEPS  30              // max lines to draw for pass map
 
-static const char sat_get_all[] = "/ham/HamClock/esats.pl?getall=";	// command to get all TLE
-static const char sat_one_page[] = "/ham/HamClock/esats.pl?tlename=%s";	// command to get one TLE
+// use the slower but more accurate SGP4 model where we can afford it, see SGP4.cpp
+#if defined(_USE_UNIX)
+#define SAT_SGP4        true
+#else
+#define SAT_SGP4        false
+#endif
+
 static Satellite *sat;			// satellite definition, if any
 static Observer *obs;			// DE
 static DateTime rise_time, set_time;	// next pass info
 static bool rise_ok, set_ok;		// whether rise_time and set_time are valid
 static float rise_az, set_az;           // rise and set az, degrees, if valid
+static float pass_max_el;               // culmination of next or current pass, degrees, if pass_max_ok
+static bool pass_max_ok;                // whether pass_max_el is valid
 static bool ever_up, ever_down;         // whether sat is ever above or below SAT_MIN_EL in next day
-static SCoord *sat_path;		// mallocd screen coords for orbit, first always now, Moon only 1
-static SCoord *sat_foot;		// mallocd screen coords for footprint
+static SCoord *sat_path;		// mallocd screen coords for orbit sorted by row, Moon only 1
+static SCoord *sat_foot;		// mallocd screen coords for footprint sorted by row
+static SCoord sat_now;                  // screen coords of current location, valid if sat_path
 static uint16_t n_path, n_foot;		// actual number in use
 static SBox map_name_b;		        // location of sat name on map
 static SBox ok_b = {730,10,55,35};	// Ok button
@@ -55,6 +64,15 @@ static char sat_name[NV_SATNAME_LEN];	// NV_SATNAME cache (spaces are underscore
 static time_t tle_refresh;		// last TLE update
 static bool new_pass;                   // set when new pass is ready
 
+/* return a new Satellite for the given name and TLE, with SGP4 if enabled.
+ * N.B. the Moon elements are only good for a short time so stay with Plan-13 for it.
+ */
+static Satellite *newSat (const char *name, const char *t1, const char *t2)
+{
+    bool use_sgp4 = SAT_SGP4 && strcmp_P (name, PSTR("Moon")) != 0;
+    return (new Satellite (t1, t2, use_sgp4));
+}
+
 /* completely undefine the current sat
  */
 static void unsetSat()
@@ -88,6 +106,63 @@ static void strncpySubChar (char to_str[], const char from_str[], char to_char,
     *to_str = '\0';
 }
 
+/* qsort-style function to sort SCoord by row then column
+ */
+static int qsSCoordRow (const void *p1, const void *p2)
+{
+    const SCoord *s1 = (const SCoord *)p1;
+    const SCoord *s2 = (const SCoord *)p2;
+    if (s1->y != s2->y)
+        return ((int)s1->y - (int)s2->y);
+    return ((int)s1->x - (int)s2->x);
+}
+
+/* sort the n points in s[] by row and remove duplicates so drawSatPointsOnRow() need only visit the
+ * points on its row. return the new count.
+ */
+static uint16_t sortRows (SCoord s[], uint16_t n)
+{
+    if (n == 0)
+        return (0);
+
+    qsort (s, n, sizeof(SCoord), qsSCoordRow);
+
+    uint16_t n_new = 1;
+    for (uint16_t i = 1; i < n; i++)
+        if (s[i].x != s[n_new-1].x || s[i].y != s[n_new-1].y)
+            s[n_new++] = s[i];
+    return (n_new);
+}
+
+/* draw a fat pixel at each point of the row-sorted s[] that lies on row y0.
+ * N.B. fat pixels extend up into the row above to avoid being erased by the next row
+ */
+static void drawRowPoints (const SCoord s[], uint16_t n, uint16_t y0, uint16_t color)
+{
+    // binary search for first point on or below row y0
+    uint16_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi)/2;
+        if (s[mid].y < y0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (uint16_t i = lo; i < n && s[i].y == y0; i++) {
+        SCoord si = s[i];
+        if (!overMap(si))
+            continue;
+        tft.drawPixel (si.x, si.y, color);
+        si.y -= 1;
+        if (overMap(si)) tft.drawPixel (si.x, si.y, color);
+        si.x += 1;
+        if (overMap(si)) tft.drawPixel (si.x, si.y, color);
+        si.y += 1;
+        if (overMap(si)) tft.drawPixel (si.x, si.y, color);
+    }
+}
+
 /* fill sat_foot with loci of points that see the sat at various viewing altitudes.
  * N.B. call this before updateSatPath malloc's its memory
  */
@@ -139,7 +214,8 @@ static void updateFootPrint (float satlat, float satlng)
     }
     // Serial.printf (_FX("n_foot %u / %u\n"), n_foot, MAX_FOOT);
 
-    // reduce
+    // sort by row and reduce
+    n_foot = sortRows (sat_foot, n_foot);
     sat_foot = (SCoord *) realloc (sat_foot, n_foot*sizeof(SCoord));
     if (!sat_foot) {
 	Serial.println (F("Failed to realloc sat_foot"));
@@ -164,101 +240,343 @@ static DateTime userNow()
     return (dt);
 }
 
+#define PASS_MIN_DT     5.0             // smallest search step, seconds
+#define PASS_ROOT_TOL   0.1             // rise and set time tolerance, seconds
+#define PASS_MAX_TOL    1.0             // culmination time tolerance, seconds
+#define PASS_RE_KM      6378.0F         // earth radius, km
+#define PASS_OBS_V      0.5F            // bound on observer speed due to earth rotation, km/s
+#define PASS_EARTH_W    7.292e-5F       // earth rotation rate, rads/sec
+
+// one search performed by findSatPass(), times are seconds after t0
+typedef struct {
+    Satellite *sp;                      // satellite
+    const Observer *op;                 // observer
+    DateTime t0;                        // search start
+    double max_dt;                      // longest search step, seconds
+    uint16_t n_eval;                    // n predictions, just for the curious
+} PassSearch;
+
+/* return the elevation of ps.sp above SAT_MIN_EL at ps.t0 + secs, degrees.
+ * also return az, degrees, and the longest time the elevation is sure not to reach SAT_MIN_EL, secs,
+ *   if interested.
+ * the line of sight can turn no faster than the sat speed relative to the observer divided by its range, plus
+ *   the rotation of the horizon itself. the range can shrink no faster than that speed and, while the sat
+ *   stays on the same side of the horizon, never below the range at the horizon or the altitude.
+ */
+static float passElevation (PassSearch &ps, double secs, float *azp, float *dtp)
+{
+    ps.sp->predict (ps.t0 + (float)(secs/SPD));
+    ps.n_eval++;
+
+    float el, az, range, rate;
+    ps.sp->topo (ps.op, el, az, range, rate);
+    if (azp)
+        *azp = az;
+
+    if (dtp) {
+        const float *S = ps.sp->S;
+        const float *V = ps.sp->V;
+        float r = 0.99F*sqrtf(S[0]*S[0] + S[1]*S[1] + S[2]*S[2]);      // allow a little eccentricity
+        float w = sqrtf(V[0]*V[0] + V[1]*V[1] + V[2]*V[2]) + PASS_OBS_V;
+        float min_range = el < SAT_MIN_EL ? sqrtf(fmaxf(r*r - PASS_RE_KM*PASS_RE_KM, 1.0F))
+                                          : fmaxf(r - PASS_RE_KM, 1.0F);
+        float f = deg2rad (fabsf (el - SAT_MIN_EL));
+
+        // time assuming the sat is already as close as it can be
+        float dt = f / (w/min_range + PASS_EARTH_W);
+
+        // longer if it is still far enough away to be sure it stays farther for the whole step
+        float dt_far = f*range/(w*(1 + f));
+        float range_far = range - w*dt_far;
+        if (range_far > min_range) {
+            dt_far = f / (w/range_far + PASS_EARTH_W);
+            if (dt_far > dt)
+                dt = dt_far;
+        }
+
+        *dtp = dt;
+    }
+
+    return (el - SAT_MIN_EL);
+}
+
+/* given f(a) and f(b) of opposite sign, find where f crosses 0 between a and b using Brent's method,
+ * where f is passElevation(). return time of crossing, secs after ps.t0.
+ */
+static double passBrentRoot (PassSearch &ps, double a, double b, double fa, double fb)
+{
+    double c = a, fc = fa;
+    double d = b - a, e = d;
+
+    for (int iter = 0; iter < 50; iter++) {
+
+        // keep b the best estimate, c the contrapoint
+        if ((fb > 0) == (fc > 0)) {
+            c = a;
+            fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb)) {
+            a = b;  b = c;  c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        double tol = PASS_ROOT_TOL/2;
+        double m = (c - b)/2;
+        if (fabs(m) <= tol || fb == 0)
+            break;
+
+        if (fabs(e) >= tol && fabs(fa) > fabs(fb)) {
+            // try inverse quadratic interpolation, or secant if only two points
+            double p, q, r;
+            double s = fb/fa;
+            if (a == c) {
+                p = 2*m*s;
+                q = 1 - s;
+            } else {
+                q = fa/fc;
+                r = fb/fc;
+                p = s*(2*m*q*(q - r) - (b - a)*(r - 1));
+                q = (q - 1)*(r - 1)*(s - 1);
+            }
+            if (p > 0)
+                q = -q;
+            else
+                p = -p;
+            if (2*p < fmin (3*m*q - fabs(tol*q), fabs(e*q))) {
+                // accept interpolation
+                e = d;
+                d = p/q;
+            } else {
+                // fall back to bisection
+                d = m;
+                e = m;
+            }
+        } else {
+            d = m;
+            e = m;
+        }
+
+        a = b;
+        fa = fb;
+        b += fabs(d) > tol ? d : (m > 0 ? tol : -tol);
+        fb = passElevation (ps, b, NULL, NULL);
+    }
+
+    return (b);
+}
+
+/* find the time of maximum elevation between a and b using Brent's method.
+ * return time, secs after ps.t0, and the elevation above SAT_MIN_EL there.
+ */
+static double passBrentMax (PassSearch &ps, double a, double b, float *maxp)
+{
+    const double cgold = 0.3819660;     // (3 - sqrt(5))/2
+    double x = a + cgold*(b - a);
+    double w = x, v = x;
+    double fx = -passElevation (ps, x, NULL, NULL);
+    double fw = fx, fv = fx;
+    double d = 0, e = 0;
+
+    for (int iter = 0; iter < 50; iter++) {
+
+        double xm = (a + b)/2;
+        double tol1 = PASS_MAX_TOL/2;
+        double tol2 = 2*tol1;
+        if (fabs(x - xm) <= tol2 - (b - a)/2)
+            break;
+
+        bool golden = true;
+        if (fabs(e) > tol1) {
+            // try parabolic fit through x, w and v
+            double r = (x - w)*(fx - fv);
+            double q = (x - v)*(fx - fw);
+            double p = (x - v)*q - (x - w)*r;
+            q = 2*(q - r);
+            if (q > 0)
+                p = -p;
+            q = fabs(q);
+            if (fabs(p) < fabs(q*e/2) && p > q*(a - x) && p < q*(b - x)) {
+                e = d;
+                d = p/q;
+                double u = x + d;
+                if (u - a < tol2 || b - u < tol2)
+                    d = xm >= x ? tol1 : -tol1;
+                golden = false;
+            }
+        }
+        if (golden) {
+            e = x >= xm ? a - x : b - x;
+            d = cgold*e;
+        }
+
+        double u = fabs(d) >= tol1 ? x + d : x + (d > 0 ? tol1 : -tol1);
+        double fu = -passElevation (ps, u, NULL, NULL);
+
+        if (fu <= fx) {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w;  fv = fw;
+            w = x;  fw = fx;
+            x = u;  fx = fu;
+        } else {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw || w == x) {
+                v = w;  fv = fw;
+                w = u;  fw = fu;
+            } else if (fu <= fv || v == x || v == w) {
+                v = u;  fv = fu;
+            }
+        }
+    }
+
+    *maxp = -fx;
+    return (x);
+}
+
+/* search forward from s0 until s_end, seconds after ps.t0, for the first time the elevation crosses SAT_MIN_EL.
+ * each step is as large as possible such that the elevation can not cross and back again within it.
+ * return whether found and, if so, its time.
+ */
+static bool passCrossing (PassSearch &ps, double s0, double s_end, double *s_crossp)
+{
+    float dt_ok;
+    double s = s0;
+    float f = passElevation (ps, s, NULL, &dt_ok);
+
+    while (s < s_end) {
+#if !defined(_USE_UNIX)
+        // long searches need this on ESP, where everything runs in the main loop
+        resetWatchdog();
+#endif
+
+        double dt = dt_ok;
+        if (dt < PASS_MIN_DT)
+            dt = PASS_MIN_DT;
+        else if (dt > ps.max_dt)
+            dt = ps.max_dt;
+        double s1 = s + dt < s_end ? s + dt : s_end;
+
+        float f1 = passElevation (ps, s1, NULL, &dt_ok);
+        if ((f1 >= 0) != (f >= 0)) {
+            *s_crossp = passBrentRoot (ps, s, s1, f, f1);
+            return (true);
+        }
+
+        s = s1;
+        f = f1;
+    }
+
+    return (false);
+}
+
+/* find the pass of sp seen from op that is underway at t0, or else the next one that rises within max_days.
+ * if underway, up_now is set and the rise fields are at t0. culmination is only found if the pass also sets
+ *   within max_days.
+ * N.B. uses only its arguments and on UNIX never touches the watchdog, which belongs to the main thread, so
+ *      there it may be used from any thread.
+ */
+void findSatPass (Satellite *sp, const Observer *op, const DateTime &t0, float max_days, SatPassInfo &pass)
+{
+    PassSearch ps;
+    ps.sp = sp;
+    ps.op = op;
+    ps.t0 = t0;
+    ps.max_dt = sp->period()*SPD/8;
+    ps.n_eval = 0;
+
+    double s_end = max_days*SPD;
+    double s_rise = 0, s_set = 0;
+
+    pass.rise_ok = pass.set_ok = pass.max_ok = false;
+
+    // find rise, or note already up
+    pass.up_now = passElevation (ps, 0, &pass.rise_az, NULL) >= 0;
+    if (pass.up_now) {
+        pass.rise_t = ps.t0;
+        pass.rise_ok = true;
+    } else if (passCrossing (ps, 0, s_end, &s_rise)) {
+        passElevation (ps, s_rise, &pass.rise_az, NULL);
+        pass.rise_t = ps.t0 + (float)(s_rise/SPD);
+        pass.rise_ok = true;
+    }
+
+    // then set
+    if (pass.rise_ok && passCrossing (ps, s_rise + PASS_ROOT_TOL, s_end, &s_set)) {
+        passElevation (ps, s_set, &pass.set_az, NULL);
+        pass.set_t = ps.t0 + (float)(s_set/SPD);
+        pass.set_ok = true;
+    }
+
+    // then culmination between
+    if (pass.set_ok) {
+        double s_max = passBrentMax (ps, s_rise, s_set, &pass.max_el);
+        pass.max_el += SAT_MIN_EL;
+        passElevation (ps, s_max, &pass.max_az, NULL);
+        pass.max_t = ps.t0 + (float)(s_max/SPD);
+        pass.max_ok = true;
+    }
+
+    pass.n_eval = ps.n_eval;
+}
+
 /* find next rise and set times if sat valid.
  * always find rise and set in the future, so set_time will be < rise_time iff pass is in progress.
- * also update flags ever_up, set_ok, ever_down and rise_ok.
+ * also update flags ever_up, set_ok, ever_down and rise_ok and the culmination.
  */
 static void findNextPass(char *name)
 {
     if (!sat || !obs) {
-	set_ok = rise_ok = false;
+	set_ok = rise_ok = pass_max_ok = false;
 	return;
     }
 
     // measure how long this takes
     uint32_t t0 = millis();
 
-    #define COARSE_DT	90L		// seconds/step forward for fast search
-    #define FINE_DT  	(-2L)		// seconds/step backward for refined search
-    float pel;				// previous elevation
-    long dt = COARSE_DT;		// search time step size, seconds
     DateTime t_now = userNow();		// user's display time
-    DateTime t_srch = t_now + -FINE_DT;	// search time, start beyond any previous solution
-    float tel, taz, trange, trate;	// target el and az, degrees
-
-    // init pel and make first step
-    sat->predict (t_srch);
-    sat->topo (obs, pel, taz, trange, trate);
-    t_srch += dt;
-
-    // search up to a few days ahead for next rise and set times (for example for moon)
-    set_ok = rise_ok = false;
-    ever_up = ever_down = false;
-    while ((!set_ok || !rise_ok) && t_srch < t_now + 2.0F) {
-	resetWatchdog();
-
-	// find circumstances at time t_srch
-	sat->predict (t_srch);
-	sat->topo (obs, tel, taz, trange, trate);
-
-	// check for rising or setting events
-	if (tel >= SAT_MIN_EL) {
-            ever_up = true;
-            if (pel < SAT_MIN_EL) {
-                if (dt == FINE_DT) {
-                    // found a refined set event (recall we are going backwards),
-                    // record and resume forward time.
-                    set_time = t_srch;
-                    set_az = taz;
-                    set_ok = true;
-                    dt = COARSE_DT;
-                    pel = tel;
-                } else if (!rise_ok) {
-                    // found a coarse rise event, go back slower looking for better set
-                    dt = FINE_DT;
-                    pel = tel;
-                }
-            }
-	} else {
-            ever_down = true;
-            if (pel > SAT_MIN_EL) {
-                if (dt == FINE_DT) {
-                    // found a refined rise event (recall we are going backwards).
-                    // record and resume forward time but skip if set is within COARSE_DT because we
-                    // would jump over it and find the NEXT set.
-                    float check_tel, check_taz;
-                    DateTime check_set = t_srch + COARSE_DT;
-                    sat->predict (check_set);
-                    sat->topo (obs, check_tel, check_taz, trange, trate);
-                    if (check_tel >= SAT_MIN_EL) {
-                        rise_time = t_srch;
-                        rise_az = taz;
-                        rise_ok = true;
-                    }
-                    // regardless, resume forward search
-                    dt = COARSE_DT;
-                    pel = tel;
-                } else if (!set_ok) {
-                    // found a coarse set event, go back slower looking for better rise
-                    dt = FINE_DT;
-                    pel = tel;
-                }
-            }
-	}
-
-	// Serial.printf (_FX("R %d S %d dt %ld from_now %8.3fs tel %g\n"), rise_ok, set_ok, dt, 24*3600*(t_srch - t_now), tel);
-
-	// advance time and save tel
-	t_srch += dt;
-	pel = tel;
+    float max_days = 2.0F;              // search up to a few days ahead, for example for moon
+
+    SatPassInfo pass;
+    findSatPass (sat, obs, t_now, max_days, pass);
+    uint16_t n_eval = pass.n_eval;
+
+    ever_up = pass.rise_ok;
+    ever_down = !pass.up_now || pass.set_ok;
+    set_ok = pass.set_ok;
+    set_time = pass.set_t;
+    set_az = pass.set_az;
+    pass_max_ok = pass.max_ok;
+    pass_max_el = pass.max_el;
+
+    if (pass.up_now) {
+        // in progress so also find the following rise
+        rise_ok = false;
+        if (set_ok) {
+            DateTime t_next = set_time + (long)PASS_MIN_DT;
+            findSatPass (sat, obs, t_next, max_days - (t_next - t_now), pass);
+            n_eval += pass.n_eval;
+            rise_ok = pass.rise_ok && !pass.up_now;
+            rise_time = pass.rise_t;
+            rise_az = pass.rise_az;
+        }
+    } else {
+        rise_ok = pass.rise_ok;
+        rise_time = pass.rise_t;
+        rise_az = pass.rise_az;
     }
 
     // new pass ready
     new_pass = true;
 
-    Serial.printf (_FX("%s: next rise in %g hrs, set in %g (%ld ms)\n"), name,
+    Serial.printf (_FX("%s: next rise in %g hrs, set in %g, max el %g (%u evals %ld ms)\n"), name,
 	rise_ok ? 24*(rise_time - t_now) : 0.0F, set_ok ? 24*(set_time - t_now) : 0.0F,
-        millis() - t0);
+        pass_max_ok ? pass_max_el : 0.0F, n_eval, millis() - t0);
 
     printFreeHeap (F("findNextPass"));
 }
@@ -412,7 +730,7 @@ static void drawNextPass()
         x += draw_left_of_pass ? -30 : 20;
         y += draw_below_pass ? 5 : -18;
         tft.setCursor (x, y); 
-        tft.print(max_el, 0);
+        tft.print(pass_max_ok ? pass_max_el : max_el, 0);
         tft.drawCircle (tft.getCursorX()+2, tft.getCursorY(), 1, BRGRAY);       // simple degree symbol
 
         // pass duration
@@ -498,7 +816,7 @@ static void setSatMapNameLoc()
     } else {
 	// locate name far from current location and potential obstacles.
 	// N.B. start choice above RSS and below sun and moon
-	SCoord loc = sat_path[0];
+	SCoord loc = sat_now;
 	if (loc.x < map_b.x + map_b.w/2) {
 	    // Indian ocean
 	    map_name_b.x = map_b.x + 5*map_b.w/8;
@@ -616,7 +934,7 @@ static void drawSatTime (const char *title, float t)
 /* return whether the given line appears to be a valid TLE
  * only count digits and '-' counts as 1
  */
-static bool tleHasValidChecksum (const char *line)
+bool tleHasValidChecksum (const char *line)
 {
     // sum first 68 chars
     int sum = 0;
@@ -672,7 +990,7 @@ static void showSelectionBox (uint16_t x, uint16_t y, bool on)
 }
 
 
-/* look up sat_name. if found set up sat, else inform user and remove sat altogether.
+/* look up sat_name in the local catalog. if found set up sat, else inform user and remove sat altogether.
  * return whether found it.
  */
 static bool satLookup ()
@@ -688,70 +1006,25 @@ static bool satLookup ()
         sat = NULL;
     }
 
-    WiFiClient tle_client;
     StackMalloc t1(TLE_LINEL);
     StackMalloc t2(TLE_LINEL);
-    char name[100];
-    bool ok = false;
+    char name[NV_SATNAME_LEN];
 
     resetWatchdog();
-    if (wifiOk() && tle_client.connect (svr_host, HTTPPORT)) {
-	resetWatchdog();
-
-	// query
-	snprintf (name, sizeof(name), sat_one_page, sat_name);
-	httpGET (tle_client, svr_host, name);
-	if (!httpSkipHeader (tle_client)) {
-	    fatalSatError (_FX("Bad http header"));
-	    goto out;
-	}
-
-	// first response line is sat name, should match query
-	if (!getTCPLine (tle_client, name, sizeof(name), NULL)) {
-	    fatalSatError (_FX("Satellite %s not found"), sat_name);
-	    goto out;
-	}
-	if (strcasecmp (name, sat_name)) {
-	    fatalSatError (_FX("Name does not match: '%s' '%s'"), sat_name, name);
-	    goto out;
-	}
-
-	// next two lines are TLE
-	if (!getTCPLine (tle_client, t1.getMem(), TLE_LINEL, NULL)) {
-	    fatalSatError (_FX("Error reading line 1"));
-	    goto out;
-	}
-	if (!tleHasValidChecksum (t1.getMem())) {
-	    fatalSatError (_FX("Bad checksum for %s in line 1"), sat_name);
-	    goto out;
-	}
-	if (!getTCPLine (tle_client, t2.getMem(), TLE_LINEL, NULL)) {
-	    fatalSatError (_FX("Error reading line 2"));
-	    goto out;
-	}
-	if (!tleHasValidChecksum (t2.getMem())) {
-	    fatalSatError (_FX("Bad checksum for %s in line 2"), sat_name);
-	    goto out;
-	}
-
-	// TLE looks good, update name so cases match, define new sat
-        memcpy (sat_name, name, sizeof(sat_name)-1);    // retain EOS
-	sat = new Satellite (t1.getMem(), t2.getMem());
-	tle_refresh = nowWO();
-	ok = true;
-
-    } else {
-
-	fatalSatError (_FX("network error"));
+    if (!satCatLookup (sat_name, name, t1.getMem(), t2.getMem())) {
+        if (satCatPending (sat_name))
+            Serial.printf (_FX("%s not yet in catalog\n"), sat_name);     // try again later
+        else
+            fatalSatError (_FX("Satellite %s not found"), sat_name);
+        return (false);
     }
 
-out:
-
-    tle_client.stop();
-
-    printFreeHeap (F("satLookup"));
+    // update name so cases match, define new sat
+    strcpy (sat_name, name);
+    sat = newSat (sat_name, t1.getMem(), t2.getMem());
+    tle_refresh = nowWO();
 
-    return (ok);
+    return (true);
 }
 
 /* show all names and allow op to choose one or none.
@@ -811,28 +1084,14 @@ static bool askSat()
     int8_t sel_idx = NO_SAT;
     uint8_t n_sat = 0;
 
-    // open connection
-    WiFiClient sat_client;
-    resetWatchdog();
-    if (!wifiOk() || !sat_client.connect (svr_host, HTTPPORT))
-        goto out;
-
-    // query page and skip header
+    // display each sat from the local catalog, allow tapping part way through to stop
     resetWatchdog();
-    httpGET (sat_client, svr_host, sat_get_all);
-    if (!httpSkipHeader (sat_client))
-        goto out;
-
-    // read and display each sat, allow tapping part way through to stop
     selectFontStyle (LIGHT_FONT, SMALL_FONT);
     for (n_sat = 0; n_sat < MAX_NSAT; n_sat++) {
 
-        // read name and 2 lines, done when eof or tap
-        if (!getTCPLine (sat_client, &(*sat_names)[n_sat][0], NV_SATNAME_LEN, NULL)
-                         || !getTCPLine (sat_client, t1.getMem(), TLE_LINEL, NULL)
-                         || !getTCPLine (sat_client, t2.getMem(), TLE_LINEL, NULL)) {
+        // get name and 2 lines, done when end or tap
+        if (!satCatGet (n_sat, &(*sat_names)[n_sat][0], t1.getMem(), t2.getMem()))
             break;
-        }
 
         // find row and column, col-major order
         uint8_t r = n_sat % N_ROWS;
@@ -864,7 +1123,7 @@ static bool askSat()
         // display next rise time of this sat
         if (sat)
             delete sat;
-	sat = new Satellite (t1.getMem(), t2.getMem());
+	sat = newSat ((*sat_names)[n_sat], t1.getMem(), t2.getMem());
         findNextPass((*sat_names)[n_sat]);
         tft.setTextColor (RA8875_WHITE);
         tft.setCursor (x + CB_SIZE + 8, y + FONT_H);
@@ -905,9 +1164,6 @@ static bool askSat()
         tft.print (user_name);
     }
 
-    // close connection
-    sat_client.stop();
-
     // bale if no satellites displayed
     if (n_sat == 0)
 	goto out;
@@ -962,13 +1218,13 @@ static bool askSat()
 
   out:
 
-    // close connection
-    sat_client.stop();
-
     printFreeHeap (F("askSat"));
 
     if (n_sat == 0) {
-	fatalSatError (_FX("No satellites found"));
+        if (satCatPending (NULL))
+            fatalSatError (_FX("Satellite list not yet available"));
+        else
+            fatalSatError (_FX("No satellites found"));
 	return (false);
     }
 
@@ -993,8 +1249,8 @@ static bool checkSatEpoch()
     DateTime t_epo = sat->epoch();
     if (isSatMoon())
         return (t_epo + 1.5F > t_now && t_now + 1.5F > t_epo);
-    else
-        return (t_epo + MAX_TLE_AGE > t_now && t_now + MAX_TLE_AGE > t_epo);
+    float max_age = sat->isSGP4() ? MAX_TLE_AGE_SGP4 : MAX_TLE_AGE;
+    return (t_epo + max_age > t_now && t_now + max_age > t_epo);
 }
 
 /* set the satellite observing location
@@ -1132,6 +1388,8 @@ void updateSatPath()
     if (!obs || !SAT_NAME_IS_SET() || !clockTimeOk())
 	return;
 
+    PerfTimer pt (PERF_SATPATH);
+
     resetWatchdog();
 
     // look up if first time
@@ -1180,26 +1438,32 @@ void updateSatPath()
 	while (1);	// timeout
     }
 
-    // fill sat_path
-    float period = sat->period();
+    // fill sat_path with 1 rev starting now, predicting PATH_BATCH points at a time
+    #define PATH_BATCH 40
+    SatState states[PATH_BATCH];
+    float step = sat->period()/MAX_PATH;
     n_path = 0;
     uint16_t max_path = isSatMoon() ? 1 : MAX_PATH;         // N.B. only set the current location if Moon
-    for (uint16_t p = 0; p < max_path; p++) {
-	ll2s (satlat, satlng, sat_path[n_path], 2);
-	if (n_path == 0 || memcmp (&sat_path[n_path], &sat_path[n_path-1], sizeof(SCoord)))
-	    n_path++;
-	t += period/max_path;	// show 1 rev
-	sat->predict (t);
-	sat->geo (satlat, satlng);
-
-        // loop takes over a second on ESP so update clock midway
-        if (p == max_path/2)
+    for (uint16_t p0 = 0; p0 < max_path; p0 += PATH_BATCH) {
+        uint16_t nb = max_path - p0 < PATH_BATCH ? max_path - p0 : PATH_BATCH;
+        sat->predictMany (t + p0*step, step, nb, states);
+        for (uint16_t i = 0; i < nb; i++) {
+            Satellite::geo (states[i], satlat, satlng);
+            ll2s (satlat, satlng, sat_path[n_path], 2);
+            if (n_path == 0 || memcmp (&sat_path[n_path], &sat_path[n_path-1], sizeof(SCoord)))
+                n_path++;
+        }
+
+        // loop can still take a while on ESP so update clock midway
+        if (p0 <= max_path/2 && max_path/2 < p0 + nb)
             updateClocks(false);
     }
     updateClocks(false);
     // Serial.printf (_FX("n_path %u / %u\n"), n_path, MAX_PATH);
 
-    // reduce
+    // save current location then sort by row and reduce
+    sat_now = sat_path[0];
+    n_path = sortRows (sat_path, n_path);
     sat_path = (SCoord *) realloc (sat_path, n_path * sizeof(SCoord));
     if (!sat_path) {
 	Serial.println (F("Failed to realloc sat_path"));
@@ -1219,33 +1483,8 @@ void drawSatPointsOnRow (uint16_t y0)
 
     resetWatchdog();
 
-    // draw fat pixel on row above to avoid next row erasing it
-
-    for (uint16_t p = 0; p < n_path; p++) {
-        SCoord s = sat_path[p];
-        if (y0 == s.y && overMap(s)) {
-            tft.drawPixel (s.x, s.y, TRACK_COLOR);
-            s.y -= 1;
-            if (overMap(s)) tft.drawPixel (s.x, s.y, TRACK_COLOR);
-            s.x += 1;
-            if (overMap(s)) tft.drawPixel (s.x, s.y, TRACK_COLOR);
-            s.y += 1;
-            if (overMap(s)) tft.drawPixel (s.x, s.y, TRACK_COLOR);
-        }
-    }
-
-    for (uint16_t f = 0; f < n_foot; f++) {
-	SCoord s = sat_foot[f];
-	if (y0 == s.y && overMap(s)) {
-	    tft.drawPixel (s.x, s.y, FP_COLOR);
-            s.y -= 1;
-	    if (overMap(s)) tft.drawPixel (s.x, s.y, FP_COLOR);
-            s.x += 1;
-	    if (overMap(s)) tft.drawPixel (s.x, s.y, FP_COLOR);
-            s.y += 1;
-	    if (overMap(s)) tft.drawPixel (s.x, s.y, FP_COLOR);
-	}
-    }
+    drawRowPoints (sat_path, n_path, y0, TRACK_COLOR);
+    drawRowPoints (sat_foot, n_foot, y0, FP_COLOR);
 }
 
 /* draw sat name on map if it includes row y0 unless already showing in dx_info.
@@ -1279,8 +1518,8 @@ bool checkSatTouch (const SCoord &s)
 	return (false);
 
     SBox sat_b;
-    sat_b.x = sat_path[0].x-SAT_TOUCH_R;
-    sat_b.y = sat_path[0].y-SAT_TOUCH_R;
+    sat_b.x = sat_now.x-SAT_TOUCH_R;
+    sat_b.y = sat_now.y-SAT_TOUCH_R;
     sat_b.w = 2*SAT_TOUCH_R;
     sat_b.h = 2*SAT_TOUCH_R;
 
@@ -1369,9 +1608,13 @@ bool setSatFromName (const char *new_name)
         return (true);
     }
 
-    // build internal name, done if already engaged
+    // build internal name, done if already engaged. all digits is a NORAD catalog number.
     char tmp_name[NV_SATNAME_LEN];
-    strncpySubChar (tmp_name, new_name, '_', ' ', NV_SATNAME_LEN);
+    if (new_name[0] && strspn (new_name, "0123456789") == strlen (new_name)) {
+        if (!satCatLookupNum (atol (new_name), tmp_name, NULL, NULL))
+            return (false);
+    } else
+        strncpySubChar (tmp_name, new_name, '_', ' ', NV_SATNAME_LEN);
     if (strcmp (tmp_name, sat_name) == 0)
         return (true);
     strcpy (sat_name, tmp_name);
@@ -1406,7 +1649,7 @@ bool setSatFromTLE (const char *name, const char *t1, const char *t2)
     // stop any tracking
     stopGimbalNow();
 
-    sat = new Satellite (t1, t2);
+    sat = newSat (name, t1, t2);
     if (!checkSatEpoch()) {
         delete sat;
 	sat = NULL;
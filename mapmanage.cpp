@@ -680,6 +680,119 @@ static bool downloadMapFile (bool verbose, WiFiClient &client, const char *file,
 }
 
 
+/* store a little-endian value of n bytes at buf
+ */
+static void packLE (char *buf, uint32_t v, int n)
+{
+        for (int i = 0; i < n; i++) {
+            buf[i] = v & 0xff;
+            v >>= 8;
+        }
+}
+
+/* fill hdr with a BMP header for our map size that passes bmpHdrOk()
+ */
+static void makeBMPHdr (char hdr[BHDRSZ])
+{
+        const uint32_t npixbytes = HC_MAP_W*HC_MAP_H*BPBMPP;
+
+        memset (hdr, 0, BHDRSZ);
+        hdr[0] = 'B';
+        hdr[1] = 'M';
+        packLE (hdr+2, BHDRSZ + npixbytes, 4);          // file size
+        packLE (hdr+10, BHDRSZ, 4);                     // offset to pixels
+        packLE (hdr+14, HDRVER, 4);                     // subheader size
+        packLE (hdr+18, HC_MAP_W, 4);                   // ncols
+        packLE (hdr+22, -(int32_t)HC_MAP_H, 4);         // nrows, top row first
+        packLE (hdr+26, 1, 2);                          // planes
+        packLE (hdr+28, 16, 2);                         // bits per pixel
+        packLE (hdr+30, 3, 4);                          // BI_BITFIELDS
+        packLE (hdr+34, npixbytes, 4);                  // pixel bytes
+        packLE (hdr+54, 0xF800, 4);                     // RGB565 masks
+        packLE (hdr+58, 0x07E0, 4);
+        packLE (hdr+62, 0x001F, 4);
+}
+
+/* create the given day and night prop map files by shading the core day and night maps with the
+ * built-in propagation model reliability from DE at the given frequency.
+ * return whether ok.
+ * UNIX version
+ */
+static bool makePropMapFiles (float MHz, const char *dfile, const char *nfile)
+{
+        resetWatchdog();
+
+        const uint32_t npix = HC_MAP_W*HC_MAP_H;
+        char hdr[BHDRSZ];
+        bool ok = false;
+
+        // core map names
+        char core_dfile[32], core_nfile[32];
+        char core_dtitle[NV_MAPSTYLE_LEN+10], core_ntitle[NV_MAPSTYLE_LEN+10];
+        getMapNames (getCoreMapStyle(), core_dfile, core_nfile, core_dtitle, core_ntitle);
+
+        // compute reliability and read core maps, black if missing
+        uint8_t *rel = (uint8_t *) malloc (npix);
+        uint16_t *pix = (uint16_t *) malloc (npix*BPBMPP);
+        if (!rel || !pix) {
+            Serial.printf (_FX("PropMap: no mem\n"));
+            goto out;
+        }
+        if (!propModelMap (MHz, rel, HC_MAP_W, HC_MAP_H))
+            goto out;
+
+        for (int dn = 0; dn < 2; dn++) {
+
+            const char *core_file = dn == 0 ? core_dfile : core_nfile;
+            const char *prop_file = dn == 0 ? dfile : nfile;
+
+            memset (pix, 0, npix*BPBMPP);
+            FILE *fp = fopen (path(core_file), "r");
+            if (fp) {
+                if (fseek (fp, BHDRSZ, SEEK_SET) < 0 || fread (pix, BPBMPP, npix, fp) != npix) {
+                    Serial.printf (_FX("PropMap: %s: short\n"), path(core_file));
+                    memset (pix, 0, npix*BPBMPP);
+                }
+                fclose (fp);
+            }
+
+            // shade from red to green as reliability increases
+            for (uint32_t i = 0; i < npix; i++) {
+                int r = rel[i];
+                uint8_t tint_r = r < 128 ? 255 : 2*(255-r);
+                uint8_t tint_g = r < 128 ? 2*r : 255;
+                uint16_t c = pix[i];
+                uint8_t out_r = (2*RGB565_R(c) + 3*tint_r)/5;
+                uint8_t out_g = (2*RGB565_G(c) + 3*tint_g)/5;
+                uint8_t out_b = (2*RGB565_B(c))/5;
+                pix[i] = RGB565 (out_r, out_g, out_b);
+            }
+
+            // write
+            makeBMPHdr (hdr);
+            fp = fopen (path(prop_file), "w");
+            if (!fp) {
+                Serial.printf ("%s: %s\n", path(prop_file), strerror(errno));
+                goto out;
+            }
+            bool wok = fwrite (hdr, 1, BHDRSZ, fp) == BHDRSZ && fwrite (pix, BPBMPP, npix, fp) == npix;
+            if (fclose (fp) != 0 || !wok) {
+                Serial.printf ("%s: write failed\n", path(prop_file));
+                unlink (path(prop_file));
+                goto out;
+            }
+        }
+
+        ok = true;
+
+    out:
+
+        free (rel);
+        free (pix);
+        return (ok);
+}
+
+
 /* open the given map file and confirm its size, downloading fresh if not found, no match or newer.
  * if successful return open FILE and set file offset to first pixel,
  * else return NULL.
@@ -816,7 +929,7 @@ bool installBackgroundMap (bool verbose, const char *style)
             night_file = NULL;
         }
         if (night_pixels) {
-            munmap (night_pixels, day_fbytes);
+            munmap (night_pixels, night_fbytes);
             night_pixels = NULL;
         }
 
@@ -833,12 +946,18 @@ bool installBackgroundMap (bool verbose, const char *style)
 
         // mmap and install into Adafruit_RA8875
 
+        // prefault the whole file now rather than page by page during the first map sweep
+        int mmap_flags = MAP_FILE|MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        mmap_flags |= MAP_POPULATE;
+#endif
+
         day_fbytes = BHDRSZ + HC_MAP_W*HC_MAP_H*2;          // n bytes of 16 bit RGB565 pixels
         night_fbytes = BHDRSZ + HC_MAP_W*HC_MAP_H*2;
         day_pixels = (char *)                             // allow OS to choose addr
-            mmap (NULL, day_fbytes, PROT_READ, MAP_FILE|MAP_PRIVATE, fileno(day_file), 0);
+            mmap (NULL, day_fbytes, PROT_READ, mmap_flags, fileno(day_file), 0);
         night_pixels = (char *)
-            mmap (NULL, night_fbytes, PROT_READ, MAP_FILE|MAP_PRIVATE, fileno(night_file), 0);
+            mmap (NULL, night_fbytes, PROT_READ, mmap_flags, fileno(night_file), 0);
 
         if (day_pixels == MAP_FAILED || night_pixels == MAP_FAILED) {
             // boo!
@@ -869,7 +988,22 @@ bool installBackgroundMap (bool verbose, const char *style)
         } else {
             // ok!
             // Serial.println (F("both mmaps good"));
-            tft.setEarthPix (day_pixels+BHDRSZ, night_pixels+BHDRSZ);
+
+            // MAP_POPULATE is linux only so also ask for read-ahead
+            (void) madvise (day_pixels, day_fbytes, MADV_WILLNEED);
+            (void) madvise (night_pixels, night_fbytes, MADV_WILLNEED);
+
+            // once copied into tiles the files and their prefaulted pages are no longer needed
+            if (tft.setEarthPix (day_pixels+BHDRSZ, night_pixels+BHDRSZ)) {
+                munmap (day_pixels, day_fbytes);
+                day_pixels = NULL;
+                munmap (night_pixels, night_fbytes);
+                night_pixels = NULL;
+                fclose (day_file);
+                day_file = NULL;
+                fclose (night_file);
+                night_file = NULL;
+            }
             return (true);
         }
 }
@@ -969,15 +1103,16 @@ bool getMapNightPixel (uint16_t row, uint16_t col, uint16_t *nightp) { return (f
 
 /* install and activate VOACAP world-wide propagation files to be used as background maps
  *    for the current time and given band.
+ * on UNIX if the download fails these are computed with the built-in propagation model instead.
  * return whether ok
  * shared version.
  */
 bool installPropMaps (float MHz)
 {
-        static char prop_page[] = "/ham/HamClock/fetchVOACAPArea.pl";
-
         resetWatchdog();
 
+        static char prop_page[] = "/ham/HamClock/fetchVOACAPArea.pl";
+
         // get clock time
         time_t t = nowWO();
         int yr = year(t);
@@ -1039,8 +1174,16 @@ bool installPropMaps (float MHz)
             }
         }
 
+#if defined(_USE_UNIX)
+        // server unavailable so compute locally
+        if (!ok) {
+            Serial.printf (_FX("%s: download failed, using model\n"), style);
+            ok = makePropMapFiles (MHz, dfile, nfile) && installBackgroundMap (false, style);
+        }
+#endif // _USE_UNIX
+
         if (!ok)
-            Serial.printf (_FX("%s: download failed\n"), style);
+            Serial.printf (_FX("%s: install failed\n"), style);
 
         printFreeHeap (F("installPropMaps"));
 
@@ -0,0 +1,309 @@
+/* process memory accounting for long running UNIX systems, where ESP.getFreeHeap() tells little.
+ *
+ * readMemStats() collects RSS and peak RSS from /proc/self/status, malloc arena usage from mallinfo
+ * and the number of mappings from /proc/self/maps. checkMemStats() samples these each MEM_SAMPLE_MS
+ * into a ring covering about a week, logs each sample and fits a line to heap in use and RSS over the
+ * ring to spot steady growth. Each printFreeHeap() call also charges the change in heap in use since the
+ * previous call to its label so a leaking subsystem stands out. get_mem.txt reports it all.
+ */
+
+#include "HamClock.h"
+
+
+#if defined(_USE_UNIX)
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#define MEM_SAMPLE_MS   (3600*1000UL)           // sampling interval
+#define N_MEMSAMPLES    (7*24)                  // samples kept, a week at hourly
+#define MEM_TREND_S     (24*3600L)              // min span before judging trends
+#define MEM_LEAK_BPD    (1024*1024L)            // growth considered a leak, bytes per day
+#define MEM_LEAK_R2     0.8F                    // min goodness of fit to call it a leak
+#define N_MEMLABELS     48                      // max printFreeHeap labels tracked
+#define MEMLABEL_LEN    24                      // max label length kept, including EOS
+
+// one snapshot
+typedef struct {
+    long up_s;                                  // monotonic seconds since startup
+    long rss;                                   // resident set, bytes
+    long heap_used;                             // malloc bytes in use, including mmap'd chunks
+} MemSample;
+
+// sample history, oldest first
+static MemSample mem_samples[N_MEMSAMPLES];
+static int n_mem_samples;
+static uint32_t mem_sample_ms;                  // millis() of last sample
+static bool mem_leak_warned;                    // set once a leak has been logged
+
+// heap change charged to each printFreeHeap label
+typedef struct {
+    char label[MEMLABEL_LEN];
+    uint32_t n_calls;                           // n times label was seen
+    long net_bytes;                             // sum of heap changes just before each call
+    long max_bytes;                             // largest single increase
+} MemLabel;
+static MemLabel mem_labels[N_MEMLABELS];
+static int n_mem_labels;
+static long mem_label_heap;                     // heap_used at previous label, 0 until first
+
+// StackMalloc totals, updated atomically since threads may use them too
+static long sm_live_bytes, sm_peak_bytes;
+static uint32_t sm_n_allocs;
+
+// monotonic start time
+static struct timespec mem_t0;
+
+
+/* return monotonic seconds since first call
+ */
+static long memUptime (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    if (mem_t0.tv_sec == 0)
+        mem_t0 = t;
+    return (t.tv_sec - mem_t0.tv_sec);
+}
+
+/* fill ms with the current process memory usage.
+ * return whether the kernel values were available, else only the malloc values are set.
+ */
+bool readMemStats (MemStats &ms)
+{
+    memset (&ms, 0, sizeof(ms));
+    bool ok = false;
+
+#if defined(__GLIBC__)
+  #if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 mi = mallinfo2();
+  #else
+    struct mallinfo mi = mallinfo();
+  #endif
+    ms.heap_arena = (long)mi.arena;
+    ms.heap_used = (long)mi.uordblks + (long)mi.hblkhd;
+    ms.heap_free = (long)mi.fordblks;
+    ms.heap_mmap = (long)mi.hblkhd;
+    ms.n_heap_mmap = (long)mi.hblks;
+#endif
+
+#if defined(__linux__)
+    FILE *fp = fopen ("/proc/self/status", "r");
+    if (fp) {
+        char line[128];
+        long kb;
+        while (fgets (line, sizeof(line), fp)) {
+            if (sscanf (line, "VmRSS: %ld", &kb) == 1) {
+                ms.rss = kb * 1024;
+                ok = true;
+            } else if (sscanf (line, "VmHWM: %ld", &kb) == 1)
+                ms.rss_peak = kb * 1024;
+            else if (sscanf (line, "VmSize: %ld", &kb) == 1)
+                ms.vsize = kb * 1024;
+        }
+        fclose (fp);
+    }
+
+    fp = fopen ("/proc/self/maps", "r");
+    if (fp) {
+        char line[512];
+        while (fgets (line, sizeof(line), fp))
+            if (strchr (line, '\n'))
+                ms.n_maps++;
+        fclose (fp);
+    }
+#endif // __linux__
+
+    return (ok);
+}
+
+/* fit a line to the given field of mem_samples[].
+ * return slope in bytes per day and r^2, or false if too few samples or too short a span.
+ */
+static bool memTrend (long MemSample::*field, float *bpd, float *r2)
+{
+    if (n_mem_samples < 3 || mem_samples[n_mem_samples-1].up_s - mem_samples[0].up_s < MEM_TREND_S)
+        return (false);
+
+    // accumulate relative to the first sample to keep the sums small
+    double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+    const MemSample &s0 = mem_samples[0];
+    for (int i = 0; i < n_mem_samples; i++) {
+        double x = (mem_samples[i].up_s - s0.up_s) / 86400.0;
+        double y = mem_samples[i].*field - s0.*field;
+        sx += x;
+        sy += y;
+        sxx += x*x;
+        syy += y*y;
+        sxy += x*y;
+    }
+    double n = n_mem_samples;
+    double vx = n*sxx - sx*sx;
+    double vy = n*syy - sy*sy;
+    double cxy = n*sxy - sx*sy;
+    if (vx <= 0)
+        return (false);
+
+    *bpd = cxy / vx;
+    *r2 = vy > 0 ? (cxy*cxy)/(vx*vy) : 0;
+    return (true);
+}
+
+/* return whether the given field of mem_samples[] is growing steadily, optionally its rate
+ */
+static bool memLeaking (long MemSample::*field, float *bpd_p)
+{
+    float bpd, r2;
+    if (!memTrend (field, &bpd, &r2))
+        return (false);
+    if (bpd_p)
+        *bpd_p = bpd;
+    return (bpd > MEM_LEAK_BPD && r2 > MEM_LEAK_R2);
+}
+
+/* charge the change in heap use since the previous call to label, called from printFreeHeap()
+ */
+void memStatsLabel (const char *label, long heap_used)
+{
+    long delta = mem_label_heap ? heap_used - mem_label_heap : 0;
+    mem_label_heap = heap_used;
+
+    // find label or add if room
+    MemLabel *mlp = NULL;
+    for (int i = 0; i < n_mem_labels; i++) {
+        if (strcmp (mem_labels[i].label, label) == 0) {
+            mlp = &mem_labels[i];
+            break;
+        }
+    }
+    if (!mlp) {
+        if (n_mem_labels == N_MEMLABELS)
+            return;
+        mlp = &mem_labels[n_mem_labels++];
+        snprintf (mlp->label, sizeof(mlp->label), "%s", label);
+    }
+
+    mlp->n_calls++;
+    mlp->net_bytes += delta;
+    if (delta > mlp->max_bytes)
+        mlp->max_bytes = delta;
+}
+
+/* record a StackMalloc of nbytes, or its release if negative
+ */
+void memStatsStackMalloc (long nbytes)
+{
+    long live = __atomic_add_fetch (&sm_live_bytes, nbytes, __ATOMIC_RELAXED);
+    if (nbytes > 0) {
+        __atomic_add_fetch (&sm_n_allocs, 1, __ATOMIC_RELAXED);
+        if (live > sm_peak_bytes)
+            sm_peak_bytes = live;                       // N.B. may miss a racing peak, fine here
+    }
+}
+
+#endif // _USE_UNIX
+
+
+/* called often from the main loop to sample memory use now and then
+ */
+void checkMemStats (void)
+{
+#if defined(_USE_UNIX)
+    if (n_mem_samples > 0 && !timesUp (&mem_sample_ms, MEM_SAMPLE_MS))
+        return;
+    mem_sample_ms = millis();
+
+    MemStats ms;
+    (void) readMemStats (ms);
+
+    // add to ring
+    if (n_mem_samples == N_MEMSAMPLES) {
+        memmove (&mem_samples[0], &mem_samples[1], (N_MEMSAMPLES-1)*sizeof(MemSample));
+        n_mem_samples--;
+    }
+    MemSample &s = mem_samples[n_mem_samples++];
+    s.up_s = memUptime();
+    s.rss = ms.rss;
+    s.heap_used = ms.heap_used;
+
+    Serial.printf (_FX("Mem: RSS %ld kB, heap in use %ld kB, %ld maps\n"),
+                                ms.rss/1024, ms.heap_used/1024, ms.n_maps);
+
+    // warn once of steady growth
+    float heap_bpd = 0, rss_bpd = 0;
+    bool heap_leak = memLeaking (&MemSample::heap_used, &heap_bpd);
+    bool rss_leak = memLeaking (&MemSample::rss, &rss_bpd);
+    if ((heap_leak || rss_leak) && !mem_leak_warned) {
+        Serial.printf (_FX("Mem: possible leak, heap %+.0f kB/day, RSS %+.0f kB/day\n"),
+                                heap_bpd/1024, rss_bpd/1024);
+        mem_leak_warned = true;
+    }
+#endif // _USE_UNIX
+}
+
+/* send memory report to client
+ */
+void reportMemStats (WiFiClient &client)
+{
+#if defined(_USE_UNIX)
+    char buf[150];
+
+    MemStats ms;
+    bool kernel_ok = readMemStats (ms);
+
+    // current
+    client.print (_FX("# current, kB\n"));
+    if (kernel_ok) {
+        snprintf (buf, sizeof(buf), _FX("RSS        %10ld\nRSSPeak    %10ld\nVSize      %10ld\nMaps       %10ld\n"),
+                                ms.rss/1024, ms.rss_peak/1024, ms.vsize/1024, ms.n_maps);
+        client.print (buf);
+    }
+    snprintf (buf, sizeof(buf), _FX("HeapArena  %10ld\nHeapInUse  %10ld\nHeapFree   %10ld\n"),
+                                ms.heap_arena/1024, ms.heap_used/1024, ms.heap_free/1024);
+    client.print (buf);
+    snprintf (buf, sizeof(buf), _FX("HeapMmap   %10ld in %ld chunks\n"), ms.heap_mmap/1024, ms.n_heap_mmap);
+    client.print (buf);
+    snprintf (buf, sizeof(buf), _FX("StackMalloc %9ld live, %ld peak, %u calls\n"),
+                                __atomic_load_n (&sm_live_bytes, __ATOMIC_RELAXED)/1024, sm_peak_bytes/1024,
+                                __atomic_load_n (&sm_n_allocs, __ATOMIC_RELAXED));
+    client.print (buf);
+
+    // trends
+    client.print (_FX("\n# growth over samples, kB/day\n"));
+    float bpd, r2;
+    if (memTrend (&MemSample::heap_used, &bpd, &r2)) {
+        snprintf (buf, sizeof(buf), _FX("HeapInUse  %+10.0f r2 %.2f%s\n"), bpd/1024, r2,
+                                memLeaking (&MemSample::heap_used, NULL) ? _FX(" possible leak") : "");
+        client.print (buf);
+        (void) memTrend (&MemSample::rss, &bpd, &r2);
+        snprintf (buf, sizeof(buf), _FX("RSS        %+10.0f r2 %.2f%s\n"), bpd/1024, r2,
+                                memLeaking (&MemSample::rss, NULL) ? _FX(" possible leak") : "");
+        client.print (buf);
+    } else {
+        snprintf (buf, sizeof(buf), _FX("need %ld hours of samples\n"), MEM_TREND_S/3600);
+        client.print (buf);
+    }
+
+    // per label
+    client.print (_FX("\n# heap change before each printFreeHeap label, kB\n"));
+    client.print (_FX("#Label                    Calls        Net    MaxStep\n"));
+    for (int i = 0; i < n_mem_labels; i++) {
+        const MemLabel &ml = mem_labels[i];
+        snprintf (buf, sizeof(buf), _FX("%-24.*s %6u %10ld %10ld\n"), MEMLABEL_LEN-1, ml.label, ml.n_calls,
+                                ml.net_bytes/1024, ml.max_bytes/1024);
+        client.print (buf);
+    }
+
+    // history
+    client.print (_FX("\n# hourly samples, kB\n"));
+    client.print (_FX("#Uptime_h        RSS  HeapInUse\n"));
+    for (int i = 0; i < n_mem_samples; i++) {
+        const MemSample &s = mem_samples[i];
+        snprintf (buf, sizeof(buf), _FX("%9.1f %10ld %10ld\n"), s.up_s/3600.0F, s.rss/1024, s.heap_used/1024);
+        client.print (buf);
+    }
+#else
+    client.print (_FX("memory accounting requires UNIX\n"));
+#endif // _USE_UNIX
+}
@@ -211,6 +211,23 @@ void updateBeaconScreenLocations()
 	ll2s (deg2rad(bp->lat), deg2rad(bp->lng), bp->s, 3*BEACONCW);   // about max
         setMapTagBox (bp->call, bp->s, BEACONCH, bp->call_b);
     }
+    mapSymbolsMoved();
+}
+
+/* add the area of every beacon symbol and call to the overAnySymbol() grid.
+ * visibility is left for overAnyBeacon() to decide.
+ */
+void markBeaconSymbols()
+{
+    for (NCDXFBeacon *bp = blist; bp < &blist[NBEACONS]; bp++) {
+        SBox b;
+        b.x = bp->s.x > BEACONR ? bp->s.x - BEACONR : 0;
+        b.y = bp->s.y > BEACONR ? bp->s.y - BEACONR : 0;
+        b.w = bp->s.x + BEACONR + 1 - b.x;
+        b.h = bp->s.y + BEACONR/2 + 1 - b.y;
+        markSymbolBox (b);
+        markSymbolBox (bp->call_b);
+    }
 }
 
 /* return whether the given screen coord is over any visible symbol or call box
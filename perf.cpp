@@ -0,0 +1,179 @@
+/* record how long each main loop section takes so stalls can be attributed.
+ *
+ * each section keeps a count, total, max and a log-linear histogram of its durations in microseconds:
+ * each power of 2 is split into PERF_SUB buckets so percentiles are good to within 1/PERF_SUB.
+ * recording is a few integer operations so it is left on always. on ESP the histograms stop at about
+ * 1 second and there are no frame metrics, so the table fits in about 1.4 KB of RAM.
+ *
+ * on desktops the same histograms also hold the copy and upload times, dirty area and draw-to-present
+ * latency of each frame shown by the display thread.
+ */
+
+#include "HamClock.h"
+
+
+#if defined(_IS_ESP8266)
+#define PERF_SUBBITS    0                               // just powers of 2 to save RAM
+#define PERF_SUB        (1U<<PERF_SUBBITS)              // buckets per power of 2
+#define PERF_NBUCKETS   22                              // last holds all >= 2^20 us, about 1 second
+#define PERF_NSTATS     PERF_FRAME_COPY                 // no display thread so no frame metrics
+#else
+#define PERF_SUBBITS    2                               // 4 buckets per power of 2
+#define PERF_SUB        (1U<<PERF_SUBBITS)              // buckets per power of 2
+#define PERF_NBUCKETS   (PERF_SUB*(33-PERF_SUBBITS))    // enough for any uint32_t
+#define PERF_NSTATS     PERF_N                          // all sections
+#endif
+
+typedef struct {
+    uint32_t count;                                     // n times recorded
+    uint32_t max_us;                                    // longest
+    uint64_t total_us;                                  // sum of all
+    uint32_t hist[PERF_NBUCKETS];                       // counts in each bucket
+} PerfStats;
+
+static PerfStats perf_stats[PERF_NSTATS];
+static uint32_t perf_t0;                                // millis() of first record
+static uint32_t perf_frames_lost;                       // frames whose metrics were not collected in time
+
+static const char *perf_names[PERF_N] = {
+    "loop",
+    "wifi",
+    "dxcluster",
+    "web",
+    "rss",
+    "clocks",
+    "satpass",
+    "satcat",
+    "sattrack",
+    "beacons",
+    "earth",
+    "satpath",
+    "touch",
+    "other",
+    "copy",
+    "upload",
+    "dirty",
+    "latency",
+};
+
+
+/* return histogram bucket for the given duration
+ */
+static unsigned perfBucket (uint32_t us)
+{
+    if (us < PERF_SUB)
+        return (us);
+    unsigned e = 31 - __builtin_clz (us);               // floor(log2(us)), >= PERF_SUBBITS
+    unsigned mant = (us >> (e - PERF_SUBBITS)) & (PERF_SUB-1);
+    unsigned b = PERF_SUB*(e - PERF_SUBBITS + 1) + mant;
+    return (b < PERF_NBUCKETS ? b : PERF_NBUCKETS-1);
+}
+
+/* return the smallest duration that falls in the given bucket
+ */
+static uint32_t perfBucketMin (unsigned b)
+{
+    if (b < PERF_SUB)
+        return (b);
+    unsigned e = b/PERF_SUB - 1 + PERF_SUBBITS;
+    unsigned mant = b % PERF_SUB;
+    return ((PERF_SUB + mant) << (e - PERF_SUBBITS));
+}
+
+/* return an upper bound on the duration below which the given fraction of ps fall
+ */
+static uint32_t perfPercentile (const PerfStats &ps, float frac)
+{
+    uint32_t want = ceilf (frac * ps.count);
+    uint32_t sum = 0;
+    for (unsigned b = 0; b < PERF_NBUCKETS; b++) {
+        sum += ps.hist[b];
+        if (sum >= want && sum > 0) {
+            uint32_t hi = b+1 < PERF_NBUCKETS ? perfBucketMin(b+1) - 1 : 0xffffffffU;
+            return (hi < ps.max_us ? hi : ps.max_us);
+        }
+    }
+    return (ps.max_us);
+}
+
+/* record one execution of section s that took us microseconds.
+ * N.B. main thread only
+ */
+void perfRecord (PerfSection s, uint32_t us)
+{
+    if (s >= PERF_NSTATS)
+        return;
+    if (perf_t0 == 0)
+        perf_t0 = millis() | 1;
+
+    PerfStats &ps = perf_stats[s];
+    ps.count++;
+    ps.total_us += us;
+    if (us > ps.max_us)
+        ps.max_us = us;
+    ps.hist[perfBucket(us)]++;
+}
+
+/* collect metrics of the frames presented by the display thread since the previous call.
+ * N.B. main thread only, call at least every N_FRAMESTATS frames
+ */
+void perfFrames (void)
+{
+#if defined(_USE_DESKTOP)
+    FrameStats fs[N_FRAMESTATS];
+    uint32_t n_lost;
+    int n = tft.getFrameStats (fs, N_FRAMESTATS, &n_lost);
+    for (int i = 0; i < n; i++) {
+        perfRecord (PERF_FRAME_COPY, fs[i].copy_us);
+        perfRecord (PERF_FRAME_UPLOAD, fs[i].upload_us);
+        perfRecord (PERF_FRAME_DIRTY, fs[i].dirty_px);
+        if (fs[i].latency_us)
+            perfRecord (PERF_FRAME_LATENCY, fs[i].latency_us);
+    }
+    perf_frames_lost += n_lost;
+#endif
+}
+
+/* send a table of all sections to client
+ */
+void reportPerf (WiFiClient &client)
+{
+    char buf[120];
+
+    uint32_t dt_ms = perf_t0 ? millis() - perf_t0 : 0;
+    snprintf (buf, sizeof(buf), _FX("# over the last %u seconds, times in microseconds, nested sections included\n"),
+                        dt_ms/1000);
+    client.print (buf);
+    client.print (_FX("#Section        Count      Mean       p50       p99       Max  Busy%\n"));
+
+    for (int i = 0; i < PERF_FRAME_COPY; i++) {
+        const PerfStats &ps = perf_stats[i];
+        if (ps.count == 0)
+            continue;
+        snprintf (buf, sizeof(buf), _FX("%-10s %10u %9u %9u %9u %9u %6.2f\n"), perf_names[i], ps.count,
+                        (uint32_t)(ps.total_us/ps.count), perfPercentile (ps, 0.50F),
+                        perfPercentile (ps, 0.99F), ps.max_us,
+                        dt_ms ? ps.total_us/(10.0F*dt_ms) : 0.0F);
+        client.print (buf);
+    }
+
+#if !defined(_IS_ESP8266)
+    // display frames, if any
+    uint32_t n_frames = perf_stats[PERF_FRAME_COPY].count;
+    if (n_frames == 0)
+        return;
+    snprintf (buf, sizeof(buf), _FX("\n# %u frames, %.1f per second, %u lost; dirty in pixels, others microseconds\n"),
+                        n_frames, dt_ms ? 1000.0F*n_frames/dt_ms : 0.0F, perf_frames_lost);
+    client.print (buf);
+    client.print (_FX("#Frame          Count      Mean       p50       p99       Max\n"));
+    for (int i = PERF_FRAME_COPY; i < PERF_N; i++) {
+        const PerfStats &ps = perf_stats[i];
+        if (ps.count == 0)
+            continue;
+        snprintf (buf, sizeof(buf), _FX("%-10s %10u %9u %9u %9u %9u\n"), perf_names[i], ps.count,
+                        (uint32_t)(ps.total_us/ps.count), perfPercentile (ps, 0.50F),
+                        perfPercentile (ps, 0.99F), ps.max_us);
+        client.print (buf);
+    }
+#endif // !_IS_ESP8266
+}
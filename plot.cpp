@@ -354,10 +354,11 @@ void plotWX (const SBox &box, uint16_t color, const WXInfo &wi)
  * 2. we can also be called just to update the visual appearance of one of the band indicators, in which
  *    case the table and summary line are NULL. In this case we only draw the band indicated by the global
  *    prop_map, and leave the rest of the pane alone.
+ * title is drawn only with a new table, NULL means the VOACAP service.
  * N.B. coordinate layout geometry with checkBCTouch()
  * N.B. may be called before first plotBC so beware no rel table yet.
  */
-void BCHelper (const SBox *bp, int busy, float rel_tbl[PROP_MAP_N], char *cfg_str)
+void BCHelper (const SBox *bp, int busy, float rel_tbl[PROP_MAP_N], char *cfg_str, const char *title)
 {
     // which box to draw in is required 
     if (!bp)
@@ -384,7 +385,8 @@ void BCHelper (const SBox *bp, int busy, float rel_tbl[PROP_MAP_N], char *cfg_st
         // center title across the top
         selectFontStyle (LIGHT_FONT, SMALL_FONT);
         tft.setTextColor(RA8875_WHITE);
-        const char *title = "VOACAP DE-DX";
+        if (!title)
+            title = "VOACAP DE-DX";
         uint16_t bw = getTextWidth (title);
         tft.setCursor (bp->x+(bp->w-bw)/2, ty);
         tft.print ((char*)title);
@@ -454,7 +456,7 @@ bool plotBandConditions (const SBox &box, char response[], char config[])
     }
 
     // display
-    BCHelper (&box, 0, rel, config);
+    BCHelper (&box, 0, rel, config, NULL);
 
     // ok
     return (true);
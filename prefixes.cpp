@@ -599,7 +599,86 @@ static const Prefix prefixes[] PROGMEM = {
 };
 
 #define N_PREFIXES NARRAY(prefixes)
-#define MAX_R2   (11*11)          // max radius^2, sqr degrees
+#define MAX_R       11            // max radius, degrees
+#define MAX_R2      (MAX_R*MAX_R) // max radius^2, sqr degrees
+
+/* update *mind2p and *closestp if prefixes[i] is closer to ll, lowest index breaks ties
+ */
+static void pfCheck (const LatLong &ll, float coslat, uint16_t i, float *mind2p, uint16_t *closestp)
+{
+    float dlat = ll.lat_d - 0.01F * (int16_t) pgm_read_word (&prefixes[i].lat);
+    float dlng = fabsf(ll.lng_d - 0.01F * (int16_t) pgm_read_word (&prefixes[i].lng));
+    if (dlng > 180)
+        dlng = 360 - dlng;
+    dlng *= coslat;
+    float d2 = dlat*dlat + dlng*dlng;
+    if (d2 < *mind2p || (d2 == *mind2p && i < *closestp)) {
+        *mind2p = d2;
+        *closestp = i;
+    }
+}
+
+#if defined(_USE_UNIX)
+
+/* prefixes are binned into a lat/lng grid so a query need only examine the few cells within MAX_R.
+ * prefix indices are stored grouped by cell, ascending within each, in pg_index[pg_start[c] .. pg_start[c+1]).
+ * N.B. the grid costs about 2.3 KB so ESP just scans them all.
+ */
+#define PG_CELL     15                          // cell size, degrees
+#define PG_NLAT     (180/PG_CELL)               // n cells in lat
+#define PG_NLNG     (360/PG_CELL)               // n cells in lng
+static uint16_t pg_start[PG_NLAT*PG_NLNG+1];    // first pg_index for each cell, plus end
+static uint16_t pg_index[N_PREFIXES];           // prefixes indices grouped by cell
+static bool pg_ready;                           // set once built
+
+/* return grid row for the given latitude, degrees +N
+ */
+static int pgRow (float lat_d)
+{
+    int r = (int) floorf ((lat_d + 90) / PG_CELL);
+    return (r < 0 ? 0 : (r >= PG_NLAT ? PG_NLAT-1 : r));
+}
+
+/* return grid column for the given longitude, degrees +E, any value
+ */
+static int pgCol (float lng_d)
+{
+    int c = (int) floorf ((lng_d + 180) / PG_CELL) % PG_NLNG;
+    return (c < 0 ? c + PG_NLNG : c);
+}
+
+/* return grid cell containing prefixes[i]
+ */
+static int pgCell (uint16_t i)
+{
+    float lat_d = 0.01F * (int16_t) pgm_read_word (&prefixes[i].lat);
+    float lng_d = 0.01F * (int16_t) pgm_read_word (&prefixes[i].lng);
+    return (pgRow(lat_d)*PG_NLNG + pgCol(lng_d));
+}
+
+/* bin all prefixes into pg_index and pg_start
+ */
+static void pgBuild()
+{
+    // count each cell
+    memset (pg_start, 0, sizeof(pg_start));
+    for (uint16_t i = 0; i < N_PREFIXES; i++)
+        pg_start[pgCell(i)+1]++;
+
+    // convert to starting index of each cell
+    for (int c = 0; c < PG_NLAT*PG_NLNG; c++)
+        pg_start[c+1] += pg_start[c];
+
+    // fill each cell in index order, using pg_next as the running position in each
+    uint16_t pg_next[PG_NLAT*PG_NLNG];
+    memcpy (pg_next, pg_start, sizeof(pg_next));
+    for (uint16_t i = 0; i < N_PREFIXES; i++)
+        pg_index[pg_next[pgCell(i)]++] = i;
+
+    pg_ready = true;
+}
+
+#endif // _USE_UNIX
 
 /* find nearest prefix, if within allowed max
  */
@@ -617,23 +696,46 @@ bool nearestPrefix (const LatLong &ll, char prefix[MAX_PREF_LEN+1])
     // save query location
     prev_ll = ll;
 
-    // scan for closest location
-    float mind2 = 1e10;
     float coslat = cosf(ll.lat);
+    float mind2 = 1e10;
     uint16_t closest_prefix = 0;
-    for (uint16_t i = 0; i < N_PREFIXES; i++) {
-        float dlat = ll.lat_d - 0.01F * (int16_t) pgm_read_word (&prefixes[i].lat);
-        float dlng = fabsf(ll.lng_d - 0.01F * (int16_t) pgm_read_word (&prefixes[i].lng));
-        if (dlng > 180)
-            dlng = 360 - dlng;
-        dlng *= coslat;
-        float d2 = dlat*dlat + dlng*dlng;
-        if (d2 < mind2) {
-            mind2 = d2;
-            closest_prefix = i;
+
+#if defined(_USE_UNIX)
+
+    // build grid first time
+    if (!pg_ready)
+        pgBuild();
+
+    // find range of cells that can be within MAX_R
+    int row0 = pgRow (ll.lat_d - MAX_R);
+    int row1 = pgRow (ll.lat_d + MAX_R);
+    float dlng = coslat > 0 ? MAX_R/coslat : 360;
+    int col0, n_cols;
+    if (2*dlng + PG_CELL >= 360) {
+        col0 = 0;
+        n_cols = PG_NLNG;
+    } else {
+        col0 = pgCol (ll.lng_d - dlng);
+        n_cols = (pgCol (ll.lng_d + dlng) - col0 + PG_NLNG) % PG_NLNG + 1;
+    }
+
+    // scan those cells for closest location, same answer as a full scan
+    for (int row = row0; row <= row1; row++) {
+        for (int dc = 0; dc < n_cols; dc++) {
+            int cell = row*PG_NLNG + (col0 + dc) % PG_NLNG;
+            for (uint16_t j = pg_start[cell]; j < pg_start[cell+1]; j++)
+                pfCheck (ll, coslat, pg_index[j], &mind2, &closest_prefix);
         }
     }
 
+#else
+
+    // scan all for closest location
+    for (uint16_t i = 0; i < N_PREFIXES; i++)
+        pfCheck (ll, coslat, i, &mind2, &closest_prefix);
+
+#endif // _USE_UNIX
+
     // fail if too far away
     // Serial.printf ("mind2 = %g\n", mind2);
     if (mind2 > MAX_R2) {
@@ -641,9 +743,6 @@ bool nearestPrefix (const LatLong &ll, char prefix[MAX_PREF_LEN+1])
         return (false);
     }
 
-    // float lat = (float) pgm_read_float (&prefixes[closest_prefix].lat),
-    // float lng = (float) pgm_read_float (&prefixes[closest_prefix].lng));
-
     // create legitimate string
     for (uint8_t i = 0; i < MAX_PREF_LEN; i++)
         prefix[i] = (char) pgm_read_byte (&prefixes[closest_prefix].prefix[i]);
@@ -0,0 +1,672 @@
+/* simplified on-device HF propagation model.
+ *
+ * estimates the F2 layer critical frequency at control points along a path from the sun's zenith angle,
+ * an effective sunspot number blended from SSN and SFI, latitude and Kp. The MUF follows from the secant
+ * law for the hop geometry and the LUF from D layer absorption, Kp polar absorption and power. The
+ * reliability at a frequency is the product of two logistic edges centered on these. This is nowhere
+ * near VOACAP but it needs no network, so on UNIX it is used for the band conditions pane and the
+ * propagation maps only when the VOACAP server can not be reached, and is labeled as a model there.
+ *
+ * the solar indices are kept here, refreshed from the backend once an hour when possible and updated for
+ * free whenever the SSN, SFI or Kp panes are fetched. On UNIX they are saved in $HOME/.hamclock/spacewx.txt
+ * so the model is good even if the next start has no network.
+ *
+ * On UNIX propModelMap() spreads the rows of the map raster across all CPU cores.
+ *
+ * On UNIX the solar indices are refreshed by a worker thread so the main loop never waits on the network,
+ * and each good VOACAP reply for the DE-DX path is appended to $HOME/.hamclock/voacap-rec.txt by
+ * propModelRecord() to serve as reference data.
+ *
+ * check against recorded VOACAP server outputs:
+ *   g++ -O2 -D_PROPMODEL_UNITTEST -o x.propmodel propmodel.cpp && ./x.propmodel [maxerr] < recorded.txt
+ *   each line of recorded.txt is:
+ *     YEAR MONTH UTC TXLAT TXLNG RXLAT RXLNG PATH WATTS SSN SFI KP r80,r60,r40,r30,r20,r17,r15,r12,r10
+ *   where the first 9 fields were sent to fetchBandConditions.pl, SSN SFI KP were current at that time and
+ *   the last field is the first line of its reply, reliabilities 0..1. Prints the mean absolute
+ *   reliability error in percent for each band and the model timing per path and per full map raster.
+ *   If maxerr is given, exits 1 if there are no paths or the mean error over all bands exceeds maxerr.
+ */
+
+#ifdef _PROPMODEL_UNITTEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define M_PIF   3.14159265F
+
+#else
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#endif // _PROPMODEL_UNITTEST
+
+
+#define PM_RE           6371.0F         // earth radius, km
+#define PM_HF2          320.0F          // F2 reflection height, km
+#define PM_HOPMAX       3000.0F         // longest F2 hop, km
+#define PM_MINELEV      0.035F          // min takeoff angle, rads (2 degs)
+#define PM_MAXCP        6               // max control points along a path
+
+// conditions common to all paths at one time
+typedef struct {
+    float R;                            // effective sunspot number
+    float sfi;                          // 10.7 cm solar flux
+    float kp;                           // planetary K index
+    float watts;                        // transmitter power
+    float sslat, sslng;                 // subsolar lat +N and lng +E, rads
+    float ssslat, csslat;               // sin and cos of sslat
+} PMConditions;
+
+
+/* fill in pmc from the given solar indices, power and subsolar location, rads
+ */
+static void pmInitConditions (PMConditions &pmc, float ssn, float sfi, float kp, float watts,
+    float sslat, float sslng)
+{
+    // blend SSN with the sunspot number equivalent of SFI, the latter responds faster
+    float R_sfi = sqrtf (93918.4F + 1117.3F*sfi) - 406.37F;
+    pmc.R = 0.5F*(ssn + R_sfi);
+    if (pmc.R < 0)
+        pmc.R = 0;
+    if (pmc.R > 250)
+        pmc.R = 250;
+    pmc.sfi = sfi < 60 ? 60 : sfi;
+    pmc.kp = kp;
+    pmc.watts = watts < 1 ? 1 : watts;
+    pmc.sslat = sslat;
+    pmc.sslng = sslng;
+    pmc.ssslat = sinf(sslat);
+    pmc.csslat = cosf(sslat);
+}
+
+/* return foF2, MHz, and the cos of the solar zenith angle at the given location, rads
+ */
+static float pmFoF2 (const PMConditions &pmc, float lat, float lng, float *cos_chi)
+{
+    float cchi = pmc.ssslat*sinf(lat) + pmc.csslat*cosf(lat)*cosf(lng - pmc.sslng);
+    *cos_chi = cchi;
+
+    // noon and night values rise with sunspot number
+    float fo_day = 4.0F + 0.05F*pmc.R;
+    float fo_night = 2.0F + 0.02F*pmc.R;
+
+    // smooth day-night transition through twilight, sun up to 6 degs below horizon
+    float x = (cchi + 0.1F)/1.1F;
+    if (x < 0)
+        x = 0;
+    float fo = fo_night + (fo_day - fo_night)*powf (x, 0.6F);
+
+    // weaker toward the poles
+    float alat = fabsf(lat);
+    if (alat > 0.8727F)                         // 50 degs
+        fo *= 1 - 0.3F*(alat - 0.8727F)/0.6981F;
+
+    // storms deplete F2, more so at high latitude
+    if (pmc.kp > 3)
+        fo *= 1 - 0.04F*(pmc.kp - 3)*(0.5F + alat/M_PIF*2);
+
+    return (fo < 1 ? 1 : fo);
+}
+
+/* return the secant of the F2 incidence angle for a hop spanning the given great circle angle, rads
+ */
+static float pmSecPhi (float hop_ang)
+{
+    float theta = hop_ang/2;
+    float rr = PM_RE/(PM_RE + PM_HF2);
+    float elev = atan2f (cosf(theta) - rr, sinf(theta));
+    if (elev < PM_MINELEV)
+        elev = PM_MINELEV;
+    float sinphi = rr*cosf(elev);
+    return (1.0F/sqrtf(1 - sinphi*sinphi));
+}
+
+/* find the MUF and LUF, MHz, for the path from tx to rx, all rads, short or long path.
+ */
+static void pmPath (const PMConditions &pmc, float tx_lat, float tx_lng, float rx_lat, float rx_lng,
+    bool long_path, float *mufp, float *lufp)
+{
+    // great circle angle and bearing from tx
+    float stxlat = sinf(tx_lat), ctxlat = cosf(tx_lat);
+    float srxlat = sinf(rx_lat), crxlat = cosf(rx_lat);
+    float dlng = rx_lng - tx_lng;
+    float cd = stxlat*srxlat + ctxlat*crxlat*cosf(dlng);
+    if (cd > 1)
+        cd = 1;
+    if (cd < -1)
+        cd = -1;
+    float dist = acosf(cd);
+    float az = atan2f (sinf(dlng)*crxlat, ctxlat*srxlat - stxlat*crxlat*cosf(dlng));
+    if (long_path) {
+        dist = 2*M_PIF - dist;
+        az += M_PIF;
+    }
+
+    // hops of at most PM_HOPMAX
+    int nhops = (int)ceilf (dist*PM_RE/PM_HOPMAX);
+    if (nhops < 1)
+        nhops = 1;
+    float sec_phi = pmSecPhi (dist/nhops);
+
+    // sample the middle of each hop, evenly spaced if more than PM_MAXCP
+    int ncp = nhops < PM_MAXCP ? nhops : PM_MAXCP;
+    float saz = sinf(az), caz = cosf(az);
+    float min_fo = 1e6F;
+    float absorb = 0;
+    bool polar = false;
+    for (int i = 0; i < ncp; i++) {
+        float d = dist*(i + 0.5F)/ncp;
+        float sd = sinf(d), cdd = cosf(d);
+        float slat = stxlat*cdd + ctxlat*sd*caz;
+        float lat = asinf(slat);
+        float lng = tx_lng + atan2f (saz*sd*ctxlat, cdd - stxlat*slat);
+
+        float cos_chi;
+        float fo = pmFoF2 (pmc, lat, lng, &cos_chi);
+        if (fo < min_fo)
+            min_fo = fo;
+
+        // D layer absorption, small residual at night
+        absorb += cos_chi > 0 ? powf (cos_chi, 0.75F) : 0;
+        absorb += 0.05F;
+
+        if (fabsf(lat) > 1.0472F)               // 60 degs
+            polar = true;
+    }
+    absorb *= (float)nhops/ncp;
+
+    // MUF from secant law
+    *mufp = min_fo * sec_phi;
+
+    // LUF from absorption, flux and power
+    float luf = 5.0F * sqrtf(absorb) * powf (pmc.sfi/100.0F, 0.25F) * powf (100.0F/pmc.watts, 0.15F);
+    if (polar && pmc.kp > 4)
+        luf += 2*(pmc.kp - 4);
+    *lufp = luf;
+}
+
+/* return reliability 0..1 at the given frequency for a path with the given MUF and LUF, all MHz
+ */
+static float pmRel (float MHz, float muf, float luf)
+{
+    float p_muf = 1.0F/(1.0F + expf ((MHz - muf)/(0.12F*muf)));
+    float p_luf = 1.0F/(1.0F + expf ((luf - MHz)/(0.15F*luf)));
+    return (p_muf * p_luf);
+}
+
+
+
+#ifndef _PROPMODEL_UNITTEST
+
+
+/* solar indices and when they were last refreshed
+ */
+#define PM_REFRESH      3600            // refresh indices this often, secs
+#define PM_RETRY        600             // retry failed refresh this often, secs
+static float pm_ssn = 50, pm_sfi = 100, pm_kp = 2;      // typical values until first known
+static time_t pm_ssn_t, pm_sfi_t, pm_kp_t;              // nowWO() when each was last set
+static time_t pm_try_t;                                 // nowWO() of last refresh attempt
+static bool pm_loaded;                                  // set after attempting to read saved values
+
+static const char pm_ssn_page[] = "/ham/HamClock/ssn/ssn.txt";
+static const char pm_sfi_page[] = "/ham/HamClock/solar-flux/solarflux.txt";
+static const char pm_kp_page[] = "/ham/HamClock/geomag/kindex.txt";
+
+#if defined(_USE_UNIX)
+
+// the indices are refreshed by pmFetchThread(), all the above are only accessed with pm_lock held
+static pthread_mutex_t pm_lock = PTHREAD_MUTEX_INITIALIZER;
+#define PM_LOCK()       pthread_mutex_lock (&pm_lock)
+#define PM_UNLOCK()     pthread_mutex_unlock (&pm_lock)
+static bool pm_busy;                                    // set while pmFetchThread() runs
+
+/* build the full path to our saved indices
+ */
+static void pmFileName (char *fn, size_t fn_len)
+{
+    snprintf (fn, fn_len, "%s/.hamclock/spacewx.txt", getenv("HOME"));
+}
+
+/* save the current indices.
+ * N.B. call with pm_lock held
+ */
+static void pmSave()
+{
+    char fn[1000];
+    pmFileName (fn, sizeof(fn));
+    FILE *fp = fopen (fn, "w");
+    if (!fp) {
+        Serial.printf (_FX("PropModel: %s: %s\n"), fn, strerror(errno));
+        return;
+    }
+    fprintf (fp, "%g %ld\n%g %ld\n%g %ld\n", pm_ssn, (long)pm_ssn_t, pm_sfi, (long)pm_sfi_t,
+                                pm_kp, (long)pm_kp_t);
+    fclose (fp);
+}
+
+#else
+
+#define PM_LOCK()
+#define PM_UNLOCK()
+
+#endif // _USE_UNIX
+
+/* read any saved indices once
+ * N.B. main thread only
+ */
+static void pmLoad()
+{
+    if (pm_loaded)
+        return;
+    pm_loaded = true;
+
+#if defined(_USE_UNIX)
+    char fn[1000];
+    pmFileName (fn, sizeof(fn));
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return;
+    float ssn, sfi, kp;
+    long ssn_t, sfi_t, kp_t;
+    if (fscanf (fp, "%f %ld %f %ld %f %ld", &ssn, &ssn_t, &sfi, &sfi_t, &kp, &kp_t) == 6) {
+        PM_LOCK();
+        pm_ssn = ssn; pm_ssn_t = ssn_t;
+        pm_sfi = sfi; pm_sfi_t = sfi_t;
+        pm_kp = kp; pm_kp_t = kp_t;
+        PM_UNLOCK();
+        Serial.printf (_FX("PropModel: saved SSN %g SFI %g Kp %g\n"), ssn, sfi, kp);
+    }
+    fclose (fp);
+#endif // _USE_UNIX
+}
+
+/* set *vp to v as of time t, and save
+ */
+static void pmSetIndex (float *vp, time_t *tp, float v, time_t t)
+{
+    PM_LOCK();
+    *vp = v;
+    *tp = t;
+#if defined(_USE_UNIX)
+    pmSave();
+#endif
+    PM_UNLOCK();
+}
+
+/* record a fresh SSN, SFI or Kp value, such as from their own panes
+ */
+void setPropModelSSN (float ssn)
+{
+    pmLoad();
+    pmSetIndex (&pm_ssn, &pm_ssn_t, ssn, nowWO());
+}
+
+void setPropModelSFI (float sfi)
+{
+    pmLoad();
+    pmSetIndex (&pm_sfi, &pm_sfi_t, sfi, nowWO());
+}
+
+void setPropModelKp (float kp)
+{
+    pmLoad();
+    pmSetIndex (&pm_kp, &pm_kp_t, kp, nowWO());
+}
+
+/* read the given page and return the value in line nth, 0-based, at column col.
+ * N.B. on UNIX this runs in pmFetchThread() so it must not feed the watchdog.
+ * return whether found.
+ */
+static bool pmFetch (const char *page, int nth, int col, float *valuep)
+{
+    WiFiClient client;
+    char line[100];
+    bool ok = false;
+
+    Serial.println (page);
+    if (client.connect (svr_host, HTTPPORT)) {
+        threadHttpGET (client, svr_host, page);
+        if (threadHttpSkipHeader (client)) {
+            for (int i = 0; i <= nth && threadGetTCPLine (client, line, sizeof(line)); i++) {
+                if (i == nth) {
+                    *valuep = atof (line+col);
+                    ok = true;
+                }
+            }
+        }
+    }
+    client.stop();
+
+    if (!ok)
+        Serial.printf (_FX("PropModel: %s failed\n"), page);
+    return (ok);
+}
+
+/* fetch those indices that were stale at time t.
+ * N.B. line positions match updateSunSpots(), updateSolarFlux() and updateKp() in wifi.cpp
+ */
+static void pmFetchStale (time_t t)
+{
+    PM_LOCK();
+    bool ssn_stale = t - pm_ssn_t > PM_REFRESH;
+    bool sfi_stale = t - pm_sfi_t > PM_REFRESH;
+    bool kp_stale = t - pm_kp_t > PM_REFRESH;
+    PM_UNLOCK();
+
+    float v;
+    if (ssn_stale && pmFetch (pm_ssn_page, 7, 11, &v))
+        pmSetIndex (&pm_ssn, &pm_ssn_t, v, t);
+    if (sfi_stale && pmFetch (pm_sfi_page, 20, 0, &v))
+        pmSetIndex (&pm_sfi, &pm_sfi_t, v, t);
+    if (kp_stale && pmFetch (pm_kp_page, 55, 0, &v))
+        pmSetIndex (&pm_kp, &pm_kp_t, v, t);
+}
+
+#if defined(_USE_UNIX)
+
+/* thread that refreshes the indices stale at the time given by arg then exits
+ */
+static void *pmFetchThread (void *arg)
+{
+    pmFetchStale ((time_t)(intptr_t)arg);
+
+    PM_LOCK();
+    pm_busy = false;
+    PM_UNLOCK();
+
+    return (NULL);
+}
+
+#endif // _USE_UNIX
+
+/* refresh any stale solar indices if possible; keep the old values if not.
+ * on UNIX this only starts pmFetchThread() so the new values are used by a later call.
+ */
+static void pmRefresh()
+{
+    pmLoad();
+
+    time_t t = nowWO();
+    PM_LOCK();
+    bool stale = t - pm_ssn_t > PM_REFRESH || t - pm_sfi_t > PM_REFRESH || t - pm_kp_t > PM_REFRESH;
+#if defined(_USE_UNIX)
+    stale = stale && !pm_busy;
+#endif
+    PM_UNLOCK();
+    if (!stale || t - pm_try_t < PM_RETRY || !wifiOk())
+        return;
+    pm_try_t = t;
+
+#if defined(_USE_UNIX)
+    PM_LOCK();
+    pm_busy = true;
+    PM_UNLOCK();
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, pmFetchThread, (void *)(intptr_t)t);
+    if (e) {
+        Serial.printf (_FX("PropModel: thread failed: %s\n"), strerror(e));
+        PM_LOCK();
+        pm_busy = false;
+        PM_UNLOCK();
+    } else
+        pthread_detach (tid);
+#else
+    pmFetchStale (t);
+#endif
+}
+
+/* init pmc for now, also return the indices used
+ */
+static void pmNow (PMConditions &pmc, float *ssnp, float *sfip, float *kpp)
+{
+    pmRefresh();
+
+    PM_LOCK();
+    *ssnp = pm_ssn;
+    *sfip = pm_sfi;
+    *kpp = pm_kp;
+    PM_UNLOCK();
+
+    LatLong ss_ll;
+    subSolar (nowWO(), ss_ll);
+    pmInitConditions (pmc, *ssnp, *sfip, *kpp, bc_power, ss_ll.lat, ss_ll.lng);
+}
+
+/* compute the reliability for each band from DE to DX now using the current path and power settings.
+ * also fill cfg with a short summary of the conditions used.
+ */
+void propModelBC (float rel[PROP_MAP_N], char cfg[], size_t cfg_len)
+{
+    PMConditions pmc;
+    float ssn, sfi, kp;
+    pmNow (pmc, &ssn, &sfi, &kp);
+
+    float muf, luf;
+    pmPath (pmc, de_ll.lat, de_ll.lng, dx_ll.lat, dx_ll.lng, show_lp, &muf, &luf);
+    for (int i = 0; i < PROP_MAP_N; i++)
+        rel[i] = pmRel (propMap2MHz ((PropMapSetting)i), muf, luf);
+
+    snprintf (cfg, cfg_len, _FX("%dW %s SSN %.0f SFI %.0f Kp %.0f"), bc_power, show_lp ? "LP" : "SP",
+                ssn, sfi, kp);
+    Serial.printf (_FX("PropModel: MUF %.1f LUF %.1f %s\n"), muf, luf, cfg);
+}
+
+
+#if defined(_USE_UNIX)
+
+// work shared by the map threads
+typedef struct {
+    const PMConditions *pmc;            // conditions
+    float tx_lat, tx_lng;               // DE, rads
+    bool long_path;                     // whether long path
+    float MHz;                          // frequency
+    uint8_t *rel;                       // w x h raster, 0..255
+    int w, h;                           // raster size
+    int row0, nrows;                    // this thread's rows
+} PMMapWork;
+
+/* compute the rows of the map raster described by arg, a PMMapWork
+ */
+static void *pmMapThread (void *arg)
+{
+    PMMapWork *wp = (PMMapWork *) arg;
+
+    for (int r = wp->row0; r < wp->row0 + wp->nrows; r++) {
+        float lat = (M_PIF/2) - M_PIF*(r + 0.5F)/wp->h;
+        uint8_t *rowp = &wp->rel[r*wp->w];
+        for (int c = 0; c < wp->w; c++) {
+            float lng = 2*M_PIF*(c + 0.5F)/wp->w - M_PIF;
+            float muf, luf;
+            pmPath (*wp->pmc, wp->tx_lat, wp->tx_lng, lat, lng, wp->long_path, &muf, &luf);
+            rowp[c] = (uint8_t) (255*pmRel (wp->MHz, muf, luf) + 0.5F);
+        }
+    }
+
+    return (NULL);
+}
+
+/* fill rel with the w x h equirectangular map of reliability, 0..255, from DE now at the given frequency.
+ * row 0 is the north pole, column 0 is 180 W.
+ * return whether ok.
+ */
+bool propModelMap (float MHz, uint8_t *rel, int w, int h)
+{
+    PMConditions pmc;
+    float ssn, sfi, kp;
+    pmNow (pmc, &ssn, &sfi, &kp);
+
+    uint32_t t0 = millis();
+
+    // one band of rows per core
+    int n_cpu = sysconf (_SC_NPROCESSORS_ONLN);
+    if (n_cpu < 1)
+        n_cpu = 1;
+    if (n_cpu > 64)
+        n_cpu = 64;
+    PMMapWork work[64];
+    pthread_t tids[64];
+    int n_run = 0;
+    for (int i = 0; i < n_cpu; i++) {
+        PMMapWork &wk = work[i];
+        wk.pmc = &pmc;
+        wk.tx_lat = de_ll.lat;
+        wk.tx_lng = de_ll.lng;
+        wk.long_path = show_lp;
+        wk.MHz = MHz;
+        wk.rel = rel;
+        wk.w = w;
+        wk.h = h;
+        wk.row0 = i*h/n_cpu;
+        wk.nrows = (i+1)*h/n_cpu - wk.row0;
+        // last band runs here
+        if (i == n_cpu-1 || pthread_create (&tids[n_run], NULL, pmMapThread, &wk) != 0)
+            pmMapThread (&wk);
+        else
+            n_run++;
+    }
+    for (int i = 0; i < n_run; i++)
+        pthread_join (tids[i], NULL);
+
+    Serial.printf (_FX("PropModel: %dx%d map at %.1f MHz in %u ms on %d cores\n"), w, h, MHz,
+                millis() - t0, n_cpu);
+    return (true);
+}
+
+/* append the given VOACAP reply for the current DE-DX path to $HOME/.hamclock/voacap-rec.txt in the
+ * recorded.txt format read by the _PROPMODEL_UNITTEST check, so reference data accumulate with use.
+ */
+void propModelRecord (const char *response)
+{
+    char fn[1000];
+    snprintf (fn, sizeof(fn), "%s/.hamclock/voacap-rec.txt", getenv("HOME"));
+    FILE *fp = fopen (fn, "a");
+    if (!fp) {
+        Serial.printf (_FX("PropModel: %s: %s\n"), fn, strerror(errno));
+        return;
+    }
+
+    PM_LOCK();
+    float ssn = pm_ssn, sfi = pm_sfi, kp = pm_kp;
+    PM_UNLOCK();
+
+    time_t t = nowWO();
+    fprintf (fp, "%d %d %d %.3f %.3f %.3f %.3f %d %d %g %g %g %s\n", year(t), month(t), hour(t),
+                de_ll.lat_d, de_ll.lng_d, dx_ll.lat_d, dx_ll.lng_d, show_lp, bc_power, ssn, sfi, kp, response);
+    fclose (fp);
+}
+
+#endif // _USE_UNIX
+
+#endif // !_PROPMODEL_UNITTEST
+
+
+
+#ifdef _PROPMODEL_UNITTEST
+
+static double pmNowSecs()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + 1e-9*ts.tv_nsec);
+}
+
+int main (int ac, char *av[])
+{
+    static const float band_MHz[] = {3.6F, 5.3F, 7.1F, 10.1F, 14.1F, 18.1F, 21.1F, 24.9F, 28.2F};
+    static const char *band_name[] = {"80", "60", "40", "30", "20", "17", "15", "12", "10"};
+    const int NB = 9;
+    const float D2R = M_PIF/180;
+
+    double err_sum[NB] = {0};
+    int n_paths = 0;
+    PMConditions pmc;
+
+    char line[500];
+    while (fgets (line, sizeof(line), stdin)) {
+        int year, month, utc, lp;
+        float txlat, txlng, rxlat, rxlng, watts, ssn, sfi, kp;
+        float vo[NB];
+        if (sscanf (line, "%d %d %d %f %f %f %f %d %f %f %f %f %f,%f,%f,%f,%f,%f,%f,%f,%f",
+                &year, &month, &utc, &txlat, &txlng, &rxlat, &rxlng, &lp, &watts, &ssn, &sfi, &kp,
+                &vo[0], &vo[1], &vo[2], &vo[3], &vo[4], &vo[5], &vo[6], &vo[7], &vo[8]) != 21)
+            continue;
+
+        // VOACAP is a monthly median so use the sun at the middle of the month
+        int doy = 30*(month-1) + 15;
+        float sslat = 23.44F*D2R*sinf(2*M_PIF*(284 + doy)/365.0F);
+        float sslng = -15*D2R*(utc - 12);
+        pmInitConditions (pmc, ssn, sfi, kp, watts, sslat, sslng);
+
+        float muf, luf;
+        pmPath (pmc, txlat*D2R, txlng*D2R, rxlat*D2R, rxlng*D2R, lp, &muf, &luf);
+        printf ("%5.1f %7.1f -> %5.1f %7.1f %s MUF %5.1f LUF %5.1f:", txlat, txlng, rxlat, rxlng,
+                                lp ? "LP" : "SP", muf, luf);
+        for (int i = 0; i < NB; i++) {
+            float r = 100*pmRel (band_MHz[i], muf, luf);
+            printf (" %3.0f/%3.0f", r, 100*vo[i]);
+            err_sum[i] += fabs (r - 100*vo[i]);
+        }
+        printf ("\n");
+        n_paths++;
+    }
+
+    double all_err = -1;
+    if (n_paths > 0) {
+        double all = 0;
+        printf ("mean abs error of %d paths, percent:\n", n_paths);
+        for (int i = 0; i < NB; i++) {
+            printf (" %sm %5.1f", band_name[i], err_sum[i]/n_paths);
+            all += err_sum[i];
+        }
+        all_err = all/(n_paths*NB);
+        printf ("\n all %5.1f\n", all_err);
+    }
+
+    // timing, one path then a full 660x330 map on one core
+    pmInitConditions (pmc, 100, 150, 2, 100, 0.3F, 0.5F);
+    const int NT = 1000000;
+    float sink = 0;
+    double t0 = pmNowSecs();
+    for (int i = 0; i < NT; i++) {
+        float muf, luf;
+        pmPath (pmc, 0.7F, -1.8F, (i%180 - 90)*D2R, (i%360 - 180)*D2R, false, &muf, &luf);
+        sink += pmRel (14.1F, muf, luf);
+    }
+    double t1 = pmNowSecs();
+    printf ("%.3f us per path\n", 1e6*(t1-t0)/NT);
+
+    const int W = 660, H = 330;
+    t0 = pmNowSecs();
+    for (int r = 0; r < H; r++) {
+        float lat = (M_PIF/2) - M_PIF*(r + 0.5F)/H;
+        for (int c = 0; c < W; c++) {
+            float lng = 2*M_PIF*(c + 0.5F)/W - M_PIF;
+            float muf, luf;
+            pmPath (pmc, 0.7F, -1.8F, lat, lng, false, &muf, &luf);
+            sink += pmRel (14.1F, muf, luf);
+        }
+    }
+    t1 = pmNowSecs();
+    printf ("%.1f ms per %dx%d map on one core (%g)\n", 1e3*(t1-t0), W, H, sink);
+
+    // check
+    if (ac > 1) {
+        double max_err = atof (av[1]);
+        bool ok = all_err >= 0 && all_err <= max_err;
+        printf ("%s: mean abs error %.1f, max %.1f\n", ok ? "PASS" : "FAIL", all_err, max_err);
+        return (ok ? 0 : 1);
+    }
+
+    return (0);
+}
+
+#endif // _PROPMODEL_UNITTEST
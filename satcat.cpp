@@ -0,0 +1,693 @@
+/* local catalog of earth satellite elements, indexed by name and by NORAD catalog number.
+ *
+ * the full list offered by the backend is downloaded in one request every SATCAT_REFRESH and kept in
+ * memory so selecting a satellite or freshening its elements is just a binary search. names not in the
+ * full list are queued the first time they are requested to be looked up individually, then remembered and
+ * refreshed along with the others. Lookups never wait: until the catalog or a queued name arrives they
+ * just fail, and satCatPending() tells whether it is worth asking again.
+ *
+ * on UNIX the downloads run in their own thread and the catalog is saved in $HOME/.hamclock/esats.txt so
+ * it is available immediately at the next start even without a network. elements in esats-local.txt in
+ * the same directory, if present, are added to or replace those downloaded; both files use the usual
+ * 3-line name/TLE format. on ESP there are no files and the downloads are run from updateSatCatalog().
+ *
+ * a new catalog is always built and indexed on the side and only swapped in if all went well, so a failed
+ * refresh or lookup never disturbs the one in use.
+ *
+ * N.B. downloads use threadHttpGET() and threadGetTCPLine() rather than httpGET() and getTCPLine() because
+ *      on UNIX they run in catThread() where feeding the watchdog is not allowed.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(_IS_ESP8266)
+#define SATCAT_MAX      24              // max entries, each about 180 bytes
+#define SATCAT_GROW     8               // grow entries this many at a time
+#else
+#define SATCAT_MAX      4000            // max entries
+#define SATCAT_GROW     32              // grow entries this many at a time
+#endif
+#define SATCAT_MAX_EXTRA 16             // max names not in the full list
+#define SATCAT_MAX_WANT 8               // max names queued for individual lookup
+#define SATCAT_REFRESH  (3600*3*1000UL) // refresh this often, millis()
+#define SATCAT_RETRY    (600*1000UL)    // retry failed refresh this often, millis()
+
+static const char cat_get_all[] = "/ham/HamClock/esats.pl?getall=";       // command to get all TLE
+static const char cat_one_page[] = "/ham/HamClock/esats.pl?tlename=%s";  // command to get one TLE
+
+// one satellite
+typedef struct {
+    char name[NV_SATNAME_LEN];          // spaces are underscores
+    char t1[TLE_LINEL], t2[TLE_LINEL];  // TLE lines, checksums verified
+    uint32_t catnum;                    // NORAD catalog number
+} SatCatEntry;
+
+// a complete catalog
+typedef struct {
+    SatCatEntry *ents;                  // malloced, in download order
+    uint16_t *by_name;                  // malloced indices into ents sorted by name ignoring case
+    uint16_t *by_num;                   // malloced indices into ents sorted by catnum
+    uint16_t n;                         // n entries in use
+    uint16_t n_max;                     // n entries malloced
+} SatCatalog;
+
+// a name to be looked up individually
+typedef struct {
+    char name[NV_SATNAME_LEN];          // as requested
+    uint32_t ms;                        // millis() when last tried
+    bool tried;                         // set once tried, and failed
+} SatCatWant;
+
+// shared, only accessed with cat_lock held
+static SatCatalog cat;                  // current catalog
+static char extra_names[SATCAT_MAX_EXTRA][NV_SATNAME_LEN];     // names found individually
+static uint8_t n_extra;                 // n in use
+static SatCatWant cat_want[SATCAT_MAX_WANT];    // names queued for lookup
+static uint8_t n_cat_want;              // n in use
+static bool cat_busy;                   // set while a refresh is underway
+static uint32_t cat_ms;                 // millis() of last refresh attempt
+static bool cat_ok;                     // whether last refresh attempt succeeded
+
+#if defined(_USE_UNIX)
+static pthread_mutex_t cat_lock = PTHREAD_MUTEX_INITIALIZER;
+#define CAT_LOCK()      pthread_mutex_lock (&cat_lock)
+#define CAT_UNLOCK()    pthread_mutex_unlock (&cat_lock)
+#else
+#define CAT_LOCK()
+#define CAT_UNLOCK()
+#endif
+
+
+
+/* return whether the network is up.
+ * N.B. on UNIX this is used by catThread() so avoid wifiOk() because its retry can draw
+ */
+static bool catNetOk()
+{
+#if defined(_USE_UNIX)
+    return (WiFi.status() == WL_CONNECTED);
+#else
+    return (wifiOk());
+#endif
+}
+
+/* release all memory used by c
+ */
+static void catFree (SatCatalog &c)
+{
+    free (c.ents);
+    free (c.by_name);
+    free (c.by_num);
+    memset (&c, 0, sizeof(c));
+}
+
+/* return index into c.ents of the given name, ignoring case, else -1.
+ * N.B. only valid after catIndex() unless linear.
+ */
+static int catFind (const SatCatalog &c, const char *name, bool linear = false)
+{
+    if (linear) {
+        for (int i = 0; i < c.n; i++)
+            if (strcasecmp (c.ents[i].name, name) == 0)
+                return (i);
+        return (-1);
+    }
+
+    int lo = 0, hi = c.n - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi)/2;
+        int cmp = strcasecmp (name, c.ents[c.by_name[mid]].name);
+        if (cmp == 0)
+            return (c.by_name[mid]);
+        if (cmp < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return (-1);
+}
+
+/* return index into c.ents of the given catalog number, else -1
+ */
+static int catFindNum (const SatCatalog &c, uint32_t catnum)
+{
+    int lo = 0, hi = c.n - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi)/2;
+        uint32_t mid_num = c.ents[c.by_num[mid]].catnum;
+        if (catnum == mid_num)
+            return (c.by_num[mid]);
+        if (catnum < mid_num)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return (-1);
+}
+
+/* add the given sat to c if its elements are good, replacing any of the same name if replace.
+ * return whether added.
+ * N.B. c must be indexed again with catIndex() before using catFind() or catFindNum()
+ */
+static bool catAdd (SatCatalog &c, const char *name, const char *t1, const char *t2, bool replace)
+{
+    if (strlen(name) >= NV_SATNAME_LEN || strlen(t1) != TLE_LINEL-1 || strlen(t2) != TLE_LINEL-1
+                        || !tleHasValidChecksum (t1) || !tleHasValidChecksum (t2))
+        return (false);
+
+    SatCatEntry *ep = NULL;
+    if (replace) {
+        int i = catFind (c, name, true);
+        if (i >= 0)
+            ep = &c.ents[i];
+    }
+    if (!ep) {
+        if (c.n == c.n_max) {
+            if (c.n_max >= SATCAT_MAX)
+                return (false);
+            uint16_t new_max = c.n_max + SATCAT_GROW;
+            if (new_max > SATCAT_MAX)
+                new_max = SATCAT_MAX;
+            SatCatEntry *new_ents = (SatCatEntry *) realloc (c.ents, new_max*sizeof(SatCatEntry));
+            if (!new_ents)
+                return (false);
+            c.ents = new_ents;
+            c.n_max = new_max;
+        }
+        ep = &c.ents[c.n++];
+    }
+
+    strcpy (ep->name, name);
+    strcpy (ep->t1, t1);
+    strcpy (ep->t2, t2);
+    char num[6];
+    memcpy (num, &t1[2], 5);
+    num[5] = '\0';
+    ep->catnum = atol (num);
+
+    return (true);
+}
+
+/* qsort-style function to compare pointers to SatCatEntry by name ignoring case
+ */
+static int qsCatName (const void *p1, const void *p2)
+{
+    return (strcasecmp ((*(const SatCatEntry**)p1)->name, (*(const SatCatEntry**)p2)->name));
+}
+
+/* qsort-style function to compare pointers to SatCatEntry by catalog number
+ */
+static int qsCatNum (const void *p1, const void *p2)
+{
+    uint32_t n1 = (*(const SatCatEntry**)p1)->catnum;
+    uint32_t n2 = (*(const SatCatEntry**)p2)->catnum;
+    return (n1 < n2 ? -1 : (n1 > n2 ? 1 : 0));
+}
+
+/* build the name and number indices of c.
+ * return whether there was enough memory, else c and its old indices are left unchanged.
+ */
+static bool catIndex (SatCatalog &c)
+{
+    uint16_t *by_name = (uint16_t *) malloc ((c.n+1)*sizeof(uint16_t));
+    uint16_t *by_num = (uint16_t *) malloc ((c.n+1)*sizeof(uint16_t));
+    const SatCatEntry **ptrs = (const SatCatEntry **) malloc ((c.n+1)*sizeof(SatCatEntry*));
+    if (!by_name || !by_num || !ptrs) {
+        free (by_name);
+        free (by_num);
+        free (ptrs);
+        return (false);
+    }
+
+    for (uint16_t i = 0; i < c.n; i++)
+        ptrs[i] = &c.ents[i];
+    qsort (ptrs, c.n, sizeof(SatCatEntry*), qsCatName);
+    for (uint16_t i = 0; i < c.n; i++)
+        by_name[i] = ptrs[i] - c.ents;
+    qsort (ptrs, c.n, sizeof(SatCatEntry*), qsCatNum);
+    for (uint16_t i = 0; i < c.n; i++)
+        by_num[i] = ptrs[i] - c.ents;
+    free (ptrs);
+
+    free (c.by_name);
+    free (c.by_num);
+    c.by_name = by_name;
+    c.by_num = by_num;
+
+    return (true);
+}
+
+/* download the full list into c.
+ * return whether the list could be read.
+ */
+static bool catDownload (SatCatalog &c)
+{
+    WiFiClient client;
+    bool ok = false;
+
+    if (catNetOk() && client.connect (svr_host, HTTPPORT)) {
+        threadHttpGET (client, svr_host, cat_get_all);
+        if (threadHttpSkipHeader (client)) {
+            char name[50], t1[TLE_LINEL+10], t2[TLE_LINEL+10];
+            while (threadGetTCPLine (client, name, sizeof(name))
+                                && threadGetTCPLine (client, t1, sizeof(t1))
+                                && threadGetTCPLine (client, t2, sizeof(t2))) {
+                if (!catAdd (c, name, t1, t2, false))
+                    Serial.printf (_FX("SatCat: ignoring %s\n"), name);
+            }
+            ok = c.n > 0;
+        }
+        client.stop();
+    }
+
+    return (ok);
+}
+
+/* look up one sat by name and add to c, replacing any of the same name.
+ * return whether found.
+ */
+static bool catDownloadOne (SatCatalog &c, const char *want)
+{
+    WiFiClient client;
+    bool ok = false;
+
+    if (catNetOk() && client.connect (svr_host, HTTPPORT)) {
+        char page[sizeof(cat_one_page) + NV_SATNAME_LEN];
+        snprintf (page, sizeof(page), cat_one_page, want);
+        threadHttpGET (client, svr_host, page);
+        char name[50], t1[TLE_LINEL+10], t2[TLE_LINEL+10];
+        if (threadHttpSkipHeader (client) && threadGetTCPLine (client, name, sizeof(name))
+                                   && strcasecmp (name, want) == 0
+                                   && threadGetTCPLine (client, t1, sizeof(t1))
+                                   && threadGetTCPLine (client, t2, sizeof(t2)))
+            ok = catAdd (c, name, t1, t2, true);
+        client.stop();
+    }
+
+    return (ok);
+}
+
+#if defined(_USE_UNIX)
+
+/* build the full path to the given file in our private directory
+ */
+static void catFileName (const char *file, char *fn, size_t fn_len)
+{
+    snprintf (fn, fn_len, "%s/.hamclock/%s", getenv("HOME"), file);
+}
+
+/* add each sat in the given file to c, replacing any of the same name if replace.
+ * return number added.
+ */
+static int catReadFile (SatCatalog &c, const char *file, bool replace)
+{
+    char fn[1000];
+    catFileName (file, fn, sizeof(fn));
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return (0);
+
+    char name[50], t1[TLE_LINEL+10], t2[TLE_LINEL+10];
+    int n_added = 0;
+    while (fgets (name, sizeof(name), fp) && fgets (t1, sizeof(t1), fp) && fgets (t2, sizeof(t2), fp)) {
+        name[strcspn (name, "\r\n")] = '\0';
+        t1[strcspn (t1, "\r\n")] = '\0';
+        t2[strcspn (t2, "\r\n")] = '\0';
+        if (catAdd (c, name, t1, t2, replace))
+            n_added++;
+    }
+    fclose (fp);
+
+    Serial.printf (_FX("SatCat: %d from %s\n"), n_added, fn);
+    return (n_added);
+}
+
+/* save c to the given file
+ */
+static void catWriteFile (const SatCatalog &c, const char *file)
+{
+    char fn[1000], tmp_fn[1010];
+    catFileName (file, fn, sizeof(fn));
+    snprintf (tmp_fn, sizeof(tmp_fn), "%s.new", fn);
+    FILE *fp = fopen (tmp_fn, "w");
+    if (!fp) {
+        Serial.printf (_FX("SatCat: %s: %s\n"), tmp_fn, strerror(errno));
+        return;
+    }
+    for (uint16_t i = 0; i < c.n; i++)
+        fprintf (fp, "%s\n%s\n%s\n", c.ents[i].name, c.ents[i].t1, c.ents[i].t2);
+    bool ok = fclose (fp) == 0;
+    if (ok)
+        ok = rename (tmp_fn, fn) == 0;
+    if (!ok) {
+        Serial.printf (_FX("SatCat: %s: %s\n"), fn, strerror(errno));
+        (void) unlink (tmp_fn);
+    }
+}
+
+#endif // _USE_UNIX
+
+/* replace the catalog with a fresh download plus the extra names and any local file.
+ * if the download fails the current catalog is left unchanged.
+ * return whether the download worked, false at once if another refresh is already underway.
+ */
+static bool catRefresh()
+{
+    SatCatalog c;
+    memset (&c, 0, sizeof(c));
+    uint32_t t0 = millis();
+
+    CAT_LOCK();
+    bool busy = cat_busy;
+    cat_busy = true;
+    CAT_UNLOCK();
+    if (busy)
+        return (false);
+
+    bool ok = catDownload (c);
+
+    if (ok) {
+
+        // freshen the extras too
+        char extras[SATCAT_MAX_EXTRA][NV_SATNAME_LEN];
+        CAT_LOCK();
+        uint8_t n_x = n_extra;
+        memcpy (extras, extra_names, sizeof(extras));
+        CAT_UNLOCK();
+        for (uint8_t i = 0; i < n_x; i++)
+            if (catFind (c, extras[i], true) < 0 && !catDownloadOne (c, extras[i]))
+                Serial.printf (_FX("SatCat: %s not found\n"), extras[i]);
+
+#if defined(_USE_UNIX)
+        catWriteFile (c, "esats.txt");
+        (void) catReadFile (c, "esats-local.txt", true);
+#endif
+
+        ok = catIndex (c);
+    }
+
+    // install
+    CAT_LOCK();
+    if (ok) {
+        catFree (cat);
+        cat = c;
+    }
+    cat_busy = false;
+    cat_ms = millis();
+    cat_ok = ok;
+    CAT_UNLOCK();
+
+    if (ok)
+        Serial.printf (_FX("SatCat: %d sats in %u ms\n"), c.n, millis() - t0);
+    else {
+        catFree (c);
+        Serial.println (F("SatCat: refresh failed"));
+    }
+
+    return (ok);
+}
+
+/* return whether a refresh is due
+ * N.B. call with cat_lock held
+ */
+static bool catRefreshDue()
+{
+    uint32_t dt = millis() - cat_ms;
+    return (!cat_busy && (cat_ms == 0 || dt >= SATCAT_REFRESH || (!cat_ok && dt >= SATCAT_RETRY)));
+}
+
+/* look up each queued name not yet tried, adding those found to the catalog and to the extra names.
+ * those not found are retried no sooner than SATCAT_RETRY.
+ */
+static void catServiceWants()
+{
+    while (true) {
+
+        // next name due
+        char name[NV_SATNAME_LEN];
+        CAT_LOCK();
+        int w = -1;
+        for (int i = 0; i < n_cat_want && w < 0; i++)
+            if (!cat_want[i].tried)
+                w = i;
+        if (w >= 0)
+            strcpy (name, cat_want[w].name);
+        CAT_UNLOCK();
+        if (w < 0)
+            return;
+
+        SatCatalog one;
+        memset (&one, 0, sizeof(one));
+        bool found = catDownloadOne (one, name);
+
+        CAT_LOCK();
+
+        // add or replace just this entry in place, restoring the old one if it can not be indexed
+        bool added = false;
+        if (found) {
+            const SatCatEntry &e = one.ents[0];
+            uint16_t n0 = cat.n;
+            int old_i = catFind (cat, e.name);
+            SatCatEntry old_e;
+            if (old_i >= 0)
+                old_e = cat.ents[old_i];
+            if (catAdd (cat, e.name, e.t1, e.t2, true) && catIndex (cat)) {
+                if (old_i < 0 && n_extra < SATCAT_MAX_EXTRA)
+                    strcpy (extra_names[n_extra++], e.name);
+                added = true;
+            } else {
+                if (old_i >= 0)
+                    cat.ents[old_i] = old_e;
+                cat.n = n0;
+            }
+        }
+        found = added;
+
+        // remove from queue if found, else mark to retry later. N.B. the queue may have changed meanwhile
+        for (int i = 0; i < n_cat_want; i++) {
+            if (strcasecmp (cat_want[i].name, name) == 0) {
+                if (found)
+                    cat_want[i] = cat_want[--n_cat_want];
+                else {
+                    cat_want[i].tried = true;
+                    cat_want[i].ms = millis();
+                }
+                break;
+            }
+        }
+
+        CAT_UNLOCK();
+
+        if (!found)
+            Serial.printf (_FX("SatCat: %s not found\n"), name);
+        catFree (one);
+    }
+}
+
+/* queue the given name for catServiceWants() unless already queued.
+ * return whether a lookup is pending, ie, not tried or due for another try.
+ * N.B. call with cat_lock held
+ */
+static bool catWant (const char *name)
+{
+    for (int i = 0; i < n_cat_want; i++) {
+        SatCatWant &sw = cat_want[i];
+        if (strcasecmp (sw.name, name) == 0) {
+            if (sw.tried && millis() - sw.ms >= SATCAT_RETRY)
+                sw.tried = false;
+            return (!sw.tried);
+        }
+    }
+
+    // add, replacing the oldest failure if full
+    if (n_cat_want == SATCAT_MAX_WANT) {
+        int oldest = -1;
+        uint32_t max_age = 0;
+        for (int i = 0; i < n_cat_want; i++) {
+            uint32_t age = millis() - cat_want[i].ms;
+            if (cat_want[i].tried && (oldest < 0 || age > max_age)) {
+                oldest = i;
+                max_age = age;
+            }
+        }
+        if (oldest < 0)
+            return (false);
+        cat_want[oldest] = cat_want[--n_cat_want];
+    }
+    SatCatWant &sw = cat_want[n_cat_want++];
+    strcpy (sw.name, name);
+    sw.tried = false;
+    sw.ms = 0;
+    Serial.printf (_FX("SatCat: %s queued for lookup\n"), name);
+    return (true);
+}
+
+#if defined(_USE_UNIX)
+
+/* thread that keeps the catalog fresh and looks up queued names forever
+ */
+static void *catThread (void *unused)
+{
+    (void) unused;
+
+    while (true) {
+        CAT_LOCK();
+        bool due = catRefreshDue();
+        CAT_UNLOCK();
+        if (due)
+            (void) catRefresh();
+        catServiceWants();
+        sleep (1);
+    }
+
+    return (NULL);
+}
+
+#endif // _USE_UNIX
+
+/* return whether the catalog has any entries, never waiting for one to be downloaded.
+ */
+static bool catReady()
+{
+    CAT_LOCK();
+    bool ready = cat.n > 0;
+    CAT_UNLOCK();
+    return (ready);
+}
+
+/* load the saved catalog, if any, then start keeping it fresh.
+ */
+void initSatCatalog()
+{
+#if defined(_USE_UNIX)
+    SatCatalog c;
+    memset (&c, 0, sizeof(c));
+    (void) catReadFile (c, "esats.txt", false);
+    (void) catReadFile (c, "esats-local.txt", true);
+    if (catIndex (c)) {
+        CAT_LOCK();
+        catFree (cat);
+        cat = c;
+        CAT_UNLOCK();
+    } else
+        catFree (c);
+
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, catThread, NULL);
+    if (e)
+        Serial.printf (_FX("SatCat: thread failed: %s\n"), strerror(e));
+    else
+        pthread_detach (tid);
+#endif // _USE_UNIX
+}
+
+/* called often by main loop() to refresh the catalog when due and look up queued names.
+ * N.B. on UNIX this is done by catThread().
+ */
+void updateSatCatalog()
+{
+#if !defined(_USE_UNIX)
+    catServiceWants();
+
+    // at most one check per minute once started
+    static uint32_t last_check;
+    if (cat_ms != 0 && !timesUp (&last_check, 60000))
+        return;
+    if (catRefreshDue())
+        (void) catRefresh();
+#endif
+}
+
+/* return whether the given name, or the whole catalog if name is NULL, is still being sought so a failed
+ * lookup is worth trying again later.
+ */
+bool satCatPending (const char *name)
+{
+    CAT_LOCK();
+    bool pending = cat.n == 0 && (cat_busy || cat_ms == 0);
+    if (!pending && name) {
+        for (int i = 0; !pending && i < n_cat_want; i++)
+            pending = strcasecmp (cat_want[i].name, name) == 0 && !cat_want[i].tried;
+    }
+    CAT_UNLOCK();
+    return (pending);
+}
+
+/* find the given sat by name, ignoring case, and return its proper name and elements.
+ * a name not in the catalog is queued to be looked up individually, see satCatPending().
+ * any of name_out, t1 or t2 may be NULL if not wanted.
+ * return whether found.
+ */
+bool satCatLookup (const char *name, char name_out[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL])
+{
+    if (!catReady())
+        return (false);
+
+    // usual case
+    CAT_LOCK();
+    int i = catFind (cat, name);
+    if (i >= 0) {
+        const SatCatEntry &e = cat.ents[i];
+        if (name_out)
+            strcpy (name_out, e.name);
+        if (t1)
+            strcpy (t1, e.t1);
+        if (t2)
+            strcpy (t2, e.t2);
+    } else if (strlen(name) < NV_SATNAME_LEN)
+        (void) catWant (name);
+    CAT_UNLOCK();
+
+    return (i >= 0);
+}
+
+/* find the given sat by NORAD catalog number and return its name and elements.
+ * any of name, t1 or t2 may be NULL if not wanted.
+ * return whether found.
+ */
+bool satCatLookupNum (uint32_t catnum, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL])
+{
+    if (!catReady())
+        return (false);
+
+    CAT_LOCK();
+    int i = catFindNum (cat, catnum);
+    if (i >= 0) {
+        const SatCatEntry &e = cat.ents[i];
+        if (name)
+            strcpy (name, e.name);
+        if (t1)
+            strcpy (t1, e.t1);
+        if (t2)
+            strcpy (t2, e.t2);
+    }
+    CAT_UNLOCK();
+
+    return (i >= 0);
+}
+
+/* return the name and elements of the i'th sat in catalog order.
+ * return false if i is beyond the end.
+ */
+bool satCatGet (uint16_t i, char name[NV_SATNAME_LEN], char t1[TLE_LINEL], char t2[TLE_LINEL])
+{
+    if (i == 0 && !catReady())
+        return (false);
+
+    CAT_LOCK();
+    bool ok = i < cat.n;
+    if (ok) {
+        const SatCatEntry &e = cat.ents[i];
+        strcpy (name, e.name);
+        strcpy (t1, e.t1);
+        strcpy (t2, e.t2);
+    }
+    CAT_UNLOCK();
+
+    return (ok);
+}
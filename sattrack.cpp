@@ -0,0 +1,622 @@
+/* track several earth satellites at once and maintain one schedule of their upcoming passes.
+ *
+ * earthsat.cpp follows one satellite in detail; this follows up to MAX_TRACK more lightly: each is marked
+ * on the map with the time until its next rise, and all their passes over DE for the next TRACK_DAYS are
+ * kept in one list sorted by rise time for the web server.
+ *
+ * elements come from the local catalog in satcat.cpp, read by the main loop; a name not yet in the catalog
+ * is queued there for lookup and tried again after TRACK_TLE_RETRY. all propagation is done by
+ * trackerWork(): on UNIX it runs in its own thread so the main loop only copies out finished results; on
+ * ESP it is called from updateSatTracker() and scans at most one satellite per call.
+ * N.B. functions and variables prefixed with w_ belong to trackerWork(), those with m_ to the main loop;
+ *      everything else that they share is only accessed with trk_lock held.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(_IS_ESP8266)
+#define MAX_TRACK       6               // max sats tracked
+#define TRACK_DAYS      0.5F            // schedule horizon, days
+#else
+#define MAX_TRACK       16              // max sats tracked
+#define TRACK_DAYS      1.0F            // schedule horizon, days
+#endif
+#define MAX_SATPASS     8               // max passes of each sat within TRACK_DAYS
+#define MAX_TRACKPASS   (MAX_TRACK*MAX_SATPASS)        // max passes in schedule
+#define TRACK_SET_DT    5L              // resume search this long after each set, seconds
+#define TRACK_POS_DT    10              // update map locations this often, seconds
+#define TRACK_SCHED_DT  300             // recompute schedule at least this often, seconds
+#define TRACK_TLE_DT    3600            // reload elements from catalog this often, seconds
+#define TRACK_TLE_RETRY 600             // retry failed element refresh this often, seconds
+#define TRACK_TLE_AGE   7.0F            // max element age, days
+#define TRACK_DOT_R     2               // map dot radius
+#define TRACK_SOON      10              // "soon", minutes
+#define TRACK_UP_COLOR  RA8875_GREEN    // tag color when up
+#define TRACK_SOON_COLOR RA8875_YELLOW  // tag color when rising within TRACK_SOON
+#define TRACK_COLOR     RA8875_WHITE    // tag color otherwise
+
+// name and elements of one tracked satellite
+typedef struct {
+    char name[NV_SATNAME_LEN];          // spaces are underscores
+    char t1[TLE_LINEL], t2[TLE_LINEL];  // TLE lines, if ok
+    bool ok;                            // whether t1 and t2 are valid
+} TrackElements;
+
+// location of one tracked satellite
+typedef struct {
+    char name[NV_SATNAME_LEN];          // spaces are underscores
+    float lat, lng;                     // subsat point, rads +N +E
+} TrackPos;
+
+// how one tracked satellite is marked on the map
+typedef struct {
+    char tag[NV_SATNAME_LEN+8];         // name and time to rise
+    uint16_t color;                     // tag and dot color
+    SCircle dot;                        // subsat point
+    SBox tag_b;                         // tag location
+} TrackMark;
+
+// shared: inputs set by the main loop
+static TrackElements trk_elems[MAX_TRACK];      // what to track
+static uint8_t n_trk;                           // n in use, only changed by main loop
+static uint32_t elems_gen;                      // incremented each time trk_elems changes
+static time_t in_now;                           // user's time, 0 until first set
+static DateTime in_dt;                          // in_now as a DateTime
+static float in_lat_d, in_lng_d;                // DE, degrees
+
+// shared: results published by trackerWork()
+static SatTrackPass pub_pass[MAX_TRACKPASS];    // pass schedule sorted by rise_t
+static uint16_t n_pub_pass;                     // n in use
+static TrackPos pub_pos[MAX_TRACK];             // current locations
+static uint8_t n_pub_pos;                       // n in use
+static uint32_t pub_gen;                        // incremented each time any pub_ changes
+
+#if defined(_USE_UNIX)
+static pthread_mutex_t trk_lock = PTHREAD_MUTEX_INITIALIZER;
+#define TRK_LOCK()      pthread_mutex_lock (&trk_lock)
+#define TRK_UNLOCK()    pthread_mutex_unlock (&trk_lock)
+#else
+#define TRK_LOCK()
+#define TRK_UNLOCK()
+#endif
+
+// trackerWork() private state
+static Satellite *w_sat[MAX_TRACK];             // sats with good elements
+static char w_name[MAX_TRACK][NV_SATNAME_LEN];  // their names
+static uint8_t n_w;                             // n in use
+static uint32_t w_elems_gen;                    // elems_gen when w_sat was built
+static Observer *w_obs;                         // DE
+static float w_lat_d, w_lng_d;                  // w_obs location, degrees
+static SatTrackPass w_pass[MAX_TRACKPASS];      // schedule being built
+static uint16_t n_w_pass;                       // n in use
+static uint8_t w_next;                          // next w_sat to scan
+static bool w_scanning;                         // whether schedule is being built
+static time_t w_sched_t;                        // when current schedule scan started
+static DateTime w_sched_dt;                     // w_sched_t as a DateTime
+static time_t w_pos_t;                          // when positions were last published
+static TrackPos w_pos[MAX_TRACK];               // positions being built
+
+// main loop private state
+static SatTrackPass m_pass[MAX_TRACKPASS];      // copy of pub_pass
+static uint16_t n_m_pass;                       // n in use
+static TrackPos m_pos[MAX_TRACK];               // copy of pub_pos
+static TrackMark m_mark[MAX_TRACK];             // map marker for each m_pos
+static uint8_t n_m_pos;                         // n in use
+static uint32_t m_gen;                          // pub_gen when copied
+static time_t m_tle_t;                          // when elements were last fetched, 0 to force
+
+
+
+/* return a DateTime for the given UNIX time.
+ * N.B. the TimeLib breakdown functions share a cache so only call from the main loop
+ */
+static DateTime unix2DateTime (time_t t)
+{
+    DateTime dt(year(t), month(t), day(t), hour(t), minute(t), second(t));
+    return (dt);
+}
+
+/* worker: rebuild w_sat if trk_elems has changed since last time, skipping stale elements.
+ * return whether anything changed.
+ * N.B. call with trk_lock held
+ */
+static bool w_loadElements()
+{
+    if (w_elems_gen == elems_gen)
+        return (false);
+
+    for (uint8_t i = 0; i < n_w; i++)
+        delete w_sat[i];
+    n_w = 0;
+
+    for (uint8_t i = 0; i < n_trk; i++) {
+        TrackElements &te = trk_elems[i];
+        if (!te.ok)
+            continue;
+        Satellite *sp = new Satellite (te.t1, te.t2);
+        float age = fabsf (sp->epoch() - in_dt);
+        if (age > TRACK_TLE_AGE) {
+            Serial.printf (_FX("SatTrack: %s elements are %g days old\n"), te.name, age);
+            delete sp;
+            continue;
+        }
+        w_sat[n_w] = sp;
+        strcpy (w_name[n_w], te.name);
+        n_w++;
+    }
+
+    w_elems_gen = elems_gen;
+    return (true);
+}
+
+/* worker: append the passes of w_sat[sat_i] from w_sched_t through TRACK_DAYS to w_pass[].
+ * a pass already underway rises at w_sched_t; one that does not end in time has set_t 0.
+ */
+static void w_findPasses (uint8_t sat_i)
+{
+    Satellite *sp = w_sat[sat_i];
+    DateTime t = w_sched_dt;
+    float days_left = TRACK_DAYS;
+
+    for (uint8_t n_sat_pass = 0; n_sat_pass < MAX_SATPASS && n_w_pass < MAX_TRACKPASS; n_sat_pass++) {
+
+        SatPassInfo pi;
+        findSatPass (sp, w_obs, t, days_left, pi);
+        if (!pi.rise_ok)
+            break;
+
+        SatTrackPass *pp = &w_pass[n_w_pass++];
+        strcpy (pp->name, w_name[sat_i]);
+        pp->rise_t = w_sched_t + lroundf((pi.rise_t - w_sched_dt)*SPD);
+        pp->rise_az = pi.rise_az;
+        if (!pi.set_ok) {
+            // up the rest of the schedule, just report current elevation
+            float el, az, range, rate;
+            sp->predict (pi.rise_t);
+            sp->topo (w_obs, el, az, range, rate);
+            pp->set_t = 0;
+            pp->set_az = az;
+            pp->max_el = el;
+            break;
+        }
+        pp->set_t = w_sched_t + lroundf((pi.set_t - w_sched_dt)*SPD);
+        pp->set_az = pi.set_az;
+        pp->max_el = pi.max_el;
+
+        // resume just after set
+        t = pi.set_t + (long)TRACK_SET_DT;
+        days_left = TRACK_DAYS - (t - w_sched_dt);
+        if (days_left <= 0)
+            break;
+    }
+}
+
+/* worker: fill w_pos[] with the location of each w_sat at t
+ */
+static void w_findPositions (const DateTime &t)
+{
+    for (uint8_t i = 0; i < n_w; i++) {
+        w_sat[i]->predict (t);
+        w_sat[i]->geo (w_pos[i].lat, w_pos[i].lng);
+        strcpy (w_pos[i].name, w_name[i]);
+    }
+}
+
+/* qsort-style function to sort SatTrackPass by increasing rise time
+ */
+static int qsPassRise (const void *p1, const void *p2)
+{
+    time_t r1 = ((SatTrackPass*)p1)->rise_t;
+    time_t r2 = ((SatTrackPass*)p2)->rise_t;
+    return (r1 < r2 ? -1 : (r1 > r2 ? 1 : 0));
+}
+
+/* worker: bring the positions and, when due, the pass schedule up to date then publish.
+ */
+static void trackerWork()
+{
+    // collect inputs, waiting for the first time
+    TRK_LOCK();
+    time_t now = in_now;
+    if (now == 0) {
+        TRK_UNLOCK();
+        return;
+    }
+    bool new_elems = w_loadElements();
+    DateTime dt = in_dt;
+    float lat_d = in_lat_d;
+    float lng_d = in_lng_d;
+    TRK_UNLOCK();
+
+    // new observer?
+    bool new_obs = !w_obs || lat_d != w_lat_d || lng_d != w_lng_d;
+    if (new_obs) {
+        if (w_obs)
+            delete w_obs;
+        w_obs = new Observer (lat_d, lng_d, 0);
+        w_lat_d = lat_d;
+        w_lng_d = lng_d;
+    }
+
+    // start a fresh schedule if anything changed or the current one is getting old
+    if (new_elems || new_obs || (!w_scanning && (now < w_sched_t || now - w_sched_t >= TRACK_SCHED_DT))) {
+        w_scanning = true;
+        w_next = 0;
+        n_w_pass = 0;
+        w_sched_t = now;
+        w_sched_dt = dt;
+    }
+
+    // continue scanning, publish when all done
+    bool pub_passes = false;
+    if (w_scanning) {
+#if defined(_USE_UNIX)
+        while (w_next < n_w)
+            w_findPasses (w_next++);
+#else
+        if (w_next < n_w)
+            w_findPasses (w_next++);
+#endif
+        if (w_next >= n_w) {
+            qsort (w_pass, n_w_pass, sizeof(SatTrackPass), qsPassRise);
+            w_scanning = false;
+            pub_passes = true;
+        }
+    }
+
+    // update positions with each new schedule or when due
+    if (!pub_passes && now >= w_pos_t && now - w_pos_t < TRACK_POS_DT)
+        return;
+    w_findPositions (dt);
+    w_pos_t = now;
+
+    // publish
+    TRK_LOCK();
+    if (pub_passes) {
+        memcpy (pub_pass, w_pass, n_w_pass*sizeof(SatTrackPass));
+        n_pub_pass = n_w_pass;
+    }
+    memcpy (pub_pos, w_pos, n_w*sizeof(TrackPos));
+    n_pub_pos = n_w;
+    pub_gen++;
+    TRK_UNLOCK();
+}
+
+#if defined(_USE_UNIX)
+
+/* thread that runs trackerWork() forever
+ */
+static void *trackerThread (void *unused)
+{
+    (void) unused;
+
+    while (true) {
+        trackerWork();
+        usleep (500000);
+    }
+
+    return (NULL);
+}
+
+/* start trackerThread() if not already running
+ */
+static void startTrackerThread()
+{
+    static bool started;
+    if (started)
+        return;
+
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, trackerThread, NULL);
+    if (e) {
+        Serial.printf (_FX("SatTrack: thread failed: %s\n"), strerror(e));
+        return;
+    }
+    pthread_detach (tid);
+    started = true;
+}
+
+/* file in which the names are saved
+ */
+static void trackNamesFile (char *fn, size_t fn_len)
+{
+    snprintf (fn, fn_len, "%s/.hamclock/sattrack.txt", getenv("HOME"));
+}
+
+#endif // _USE_UNIX
+
+/* get fresh elements for each tracked sat from the local catalog and install them for trackerWork().
+ * return whether all were found.
+ */
+static bool fetchTrackerElements()
+{
+    StackMalloc elems_mem(MAX_TRACK*sizeof(TrackElements));
+    TrackElements *elems = (TrackElements *) elems_mem.getMem();
+    uint8_t n_found = 0;
+
+    for (uint8_t i = 0; i < n_trk; i++) {
+        TrackElements &te = elems[i];
+        strcpy (te.name, trk_elems[i].name);
+        te.ok = satCatLookup (te.name, NULL, te.t1, te.t2);
+        if (te.ok)
+            n_found++;
+    }
+
+    // install, unless names changed meanwhile
+    TRK_LOCK();
+    bool same = true;
+    for (uint8_t i = 0; same && i < n_trk; i++)
+        same = strcmp (trk_elems[i].name, elems[i].name) == 0;
+    if (same) {
+        memcpy (trk_elems, elems, n_trk*sizeof(TrackElements));
+        elems_gen++;
+    }
+    TRK_UNLOCK();
+
+    Serial.printf (_FX("SatTrack: found elements for %d of %d\n"), n_found, n_trk);
+
+    return (n_found == n_trk);
+}
+
+/* find the tag text and color for m_pos[i] given the current schedule
+ */
+static void setTrackTag (uint8_t i, time_t now)
+{
+    TrackMark &tm = m_mark[i];
+    const char *name = m_pos[i].name;
+
+    // first pass of this sat that has not yet ended
+    for (uint16_t p = 0; p < n_m_pass; p++) {
+        const SatTrackPass &tp = m_pass[p];
+        if (strcmp (tp.name, name) || (tp.set_t && tp.set_t <= now))
+            continue;
+        if (tp.rise_t <= now) {
+            snprintf (tm.tag, sizeof(tm.tag), _FX("%s up"), name);
+            tm.color = TRACK_UP_COLOR;
+        } else {
+            int mins = (tp.rise_t - now + 59)/60;
+            if (mins < 60)
+                snprintf (tm.tag, sizeof(tm.tag), _FX("%s %dm"), name, mins);
+            else
+                snprintf (tm.tag, sizeof(tm.tag), _FX("%s %dh"), name, mins/60);
+            tm.color = mins <= TRACK_SOON ? TRACK_SOON_COLOR : TRACK_COLOR;
+        }
+        return;
+    }
+
+    // no pass within schedule
+    snprintf (tm.tag, sizeof(tm.tag), _FX("%s"), name);
+    tm.color = GRAY;
+}
+
+/* install the given list of comma-separated names, or clear if "none" or empty.
+ * return whether all are ok.
+ */
+static bool installTrackNames (const char *names)
+{
+    char new_names[MAX_TRACK][NV_SATNAME_LEN];
+    uint8_t n_new = 0;
+
+    if (strcmp (names, "none") != 0) {
+        const char *np = names;
+        while (*np) {
+            // find extent of next name, changing blanks to underscores
+            const char *comma = strchr (np, ',');
+            size_t len = comma ? (size_t)(comma - np) : strlen (np);
+            while (len > 0 && np[len-1] == ' ')
+                len--;
+            if (len > 0) {
+                if (n_new == MAX_TRACK || len >= NV_SATNAME_LEN)
+                    return (false);
+                for (size_t i = 0; i < len; i++)
+                    new_names[n_new][i] = np[i] == ' ' ? '_' : np[i];
+                new_names[n_new++][len] = '\0';
+            }
+            if (!comma)
+                break;
+            np = comma + 1;
+            while (*np == ' ')
+                np++;
+        }
+    }
+
+    // install for trackerWork() with no elements until next fetch
+    TRK_LOCK();
+    for (uint8_t i = 0; i < n_new; i++) {
+        strcpy (trk_elems[i].name, new_names[i]);
+        trk_elems[i].ok = false;
+    }
+    n_trk = n_new;
+    elems_gen++;
+    TRK_UNLOCK();
+
+    // forget previous results until the next publication
+    n_m_pass = 0;
+    n_m_pos = 0;
+    m_tle_t = 0;
+
+    Serial.printf (_FX("SatTrack: tracking %d\n"), n_trk);
+    return (true);
+}
+
+/* retrieve the saved list of satellites to track, if any.
+ * N.B. only supported on UNIX
+ */
+void initSatTracker()
+{
+#if defined(_USE_UNIX)
+    char fn[1000];
+    trackNamesFile (fn, sizeof(fn));
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return;
+
+    char names[MAX_TRACK*(NV_SATNAME_LEN+1)];
+    char line[100];
+    int n_names = 0;
+    names[0] = '\0';
+    while (fgets (line, sizeof(line), fp) && n_names < MAX_TRACK) {
+        line[strcspn (line, "\r\n")] = '\0';
+        if (line[0] && strlen(line) < NV_SATNAME_LEN) {
+            if (n_names++ > 0)
+                strcat (names, ",");
+            strcat (names, line);
+        }
+    }
+    fclose (fp);
+
+    if (n_names > 0)
+        (void) installTrackNames (names);
+#endif // _USE_UNIX
+}
+
+/* set the satellites to track from a list of comma-separated names, or none if "none".
+ * names are saved for next time on UNIX.
+ * return whether the list is acceptable.
+ */
+bool setSatTrackNames (const char *names)
+{
+    if (!installTrackNames (names))
+        return (false);
+
+#if defined(_USE_UNIX)
+    char fn[1000];
+    trackNamesFile (fn, sizeof(fn));
+    FILE *fp = fopen (fn, "w");
+    if (fp) {
+        for (uint8_t i = 0; i < n_trk; i++)
+            fprintf (fp, "%s\n", trk_elems[i].name);
+        fclose (fp);
+    } else
+        Serial.printf (_FX("SatTrack: %s: %s\n"), fn, strerror(errno));
+#endif // _USE_UNIX
+
+    return (true);
+}
+
+/* called often by main loop() to keep the tracker inputs current and collect its results.
+ * costs almost nothing when not tracking or between results.
+ */
+void updateSatTracker()
+{
+    // get out fast if nothing to do
+    if (n_trk == 0)
+        return;
+
+    // once per second is plenty
+    static uint32_t last_run;
+    if (!timesUp (&last_run, 1000))
+        return;
+    if (!clockTimeOk())
+        return;
+
+    // freshen elements when due, retrying sooner if trouble
+    time_t now = nowWO();
+    if (m_tle_t == 0 || now - m_tle_t >= TRACK_TLE_DT) {
+        if (fetchTrackerElements())
+            m_tle_t = now;
+        else
+            m_tle_t = now - TRACK_TLE_DT + TRACK_TLE_RETRY;
+    }
+
+    // share current circumstances
+    DateTime dt = unix2DateTime (now);
+    TRK_LOCK();
+    in_now = now;
+    in_dt = dt;
+    in_lat_d = de_ll.lat_d;
+    in_lng_d = de_ll.lng_d;
+    TRK_UNLOCK();
+
+    // run or make sure worker is running
+#if defined(_USE_UNIX)
+    startTrackerThread();
+#else
+    trackerWork();
+#endif
+
+    // collect any new results
+    bool fresh = false;
+    TRK_LOCK();
+    if (m_gen != pub_gen) {
+        memcpy (m_pass, pub_pass, n_pub_pass*sizeof(SatTrackPass));
+        n_m_pass = n_pub_pass;
+        memcpy (m_pos, pub_pos, n_pub_pos*sizeof(TrackPos));
+        n_m_pos = n_pub_pos;
+        m_gen = pub_gen;
+        fresh = true;
+    }
+    TRK_UNLOCK();
+
+    if (fresh)
+        updateSatTrackerScreenLocations();
+}
+
+/* set the screen location and tag of each tracked satellite for the current map style
+ */
+void updateSatTrackerScreenLocations()
+{
+    time_t now = nowWO();
+    for (uint8_t i = 0; i < n_m_pos; i++) {
+        TrackMark &tm = m_mark[i];
+        setTrackTag (i, now);
+        ll2s (m_pos[i].lat, m_pos[i].lng, tm.dot.s, TRACK_DOT_R);
+        tm.dot.r = TRACK_DOT_R;
+        setMapTagBox (tm.tag, tm.dot.s, TRACK_DOT_R+2, tm.tag_b);
+    }
+    mapSymbolsMoved();
+}
+
+/* draw each tracked satellite on the map
+ */
+void drawSatTrackerOnMap()
+{
+    for (uint8_t i = 0; i < n_m_pos; i++) {
+        TrackMark &tm = m_mark[i];
+        if (overMap (tm.dot.s))
+            tft.fillCircle (tm.dot.s.x, tm.dot.s.y, tm.dot.r, tm.color);
+        if (!overRSS (tm.tag_b))
+            drawMapTag (tm.tag, tm.tag_b, tm.color);
+    }
+}
+
+/* return whether the given screen coord lies over any tracked satellite marker
+ */
+bool overAnySatTracker (const SCoord &s)
+{
+    for (uint8_t i = 0; i < n_m_pos; i++)
+        if (inCircle (s, m_mark[i].dot) || inBox (s, m_mark[i].tag_b))
+            return (true);
+    return (false);
+}
+
+/* add each tracked satellite marker and tag to the overAnySymbol() grid
+ */
+void markSatTrackerSymbols()
+{
+    for (uint8_t i = 0; i < n_m_pos; i++) {
+        const SCircle &c = m_mark[i].dot;
+        SBox b;
+        b.x = c.s.x > c.r ? c.s.x - c.r : 0;
+        b.y = c.s.y > c.r ? c.s.y - c.r : 0;
+        b.w = c.s.x + c.r + 1 - b.x;
+        b.h = c.s.y + c.r + 1 - b.y;
+        markSymbolBox (b);
+        markSymbolBox (m_mark[i].tag_b);
+    }
+}
+
+/* pass back the current pass schedule sorted by rise time, including passes that may have already ended.
+ * return whether any satellites are being tracked.
+ */
+bool getSatTrackPasses (const SatTrackPass **passes, uint16_t *n_passes)
+{
+    *passes = m_pass;
+    *n_passes = n_m_pass;
+    return (n_trk > 0);
+}
@@ -0,0 +1,502 @@
+/* ingest spots from any number of DX clusters and WSJT-X style UDP decoders, each on its own thread.
+ *
+ * the sources are listed in $HOME/.hamclock/spotfeeds.txt, one per line:
+ *
+ *   cluster host port [login]          telnet DX cluster or skimmer, login defaults to our call
+ *   wsjtx port [capture]               WSJT-X or JTDX UDP messages
+ *
+ * if a capture file is given each datagram received on that port is also appended to it, preceded by its
+ * length as a 4 byte big-endian integer, the format replayed by the _WSJTX_UNITTEST benchmark in wsjtx.cpp.
+ * a relative name is in $HOME/.hamclock.
+ *
+ * a wsjtx port may not be the one set for the main WSJT-X connection; each UDP port is bound by just one
+ * reader, else the kernel would deal each datagram to only one of them.
+ *
+ * each source thread cracks its own input then queues the spot. A separate thread drains the queue,
+ * fills in location and DXCC entity then adds the spot to the spot store, which also removes repeats
+ * heard from more than one source. The queue is bounded: cluster threads wait for room, which holds
+ * off the sender by TCP flow control, while UDP spots are dropped and counted. The main loop never
+ * waits on any source.
+ *
+ * UNIX only.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+
+#include <pthread.h>
+
+#define FEED_MAXSRC     16              // max sources
+#define FEED_QMAX       1024            // max queued spots, power of 2
+#define FEED_QWAIT      2               // max secs a cluster thread waits for room
+#define FEED_IDLE       600             // send newline to cluster if idle this long, secs
+#define FEED_RETRY      10              // initial reconnect delay, doubles to FEED_MAXRETRY, secs
+#define FEED_MAXRETRY   600             // longest reconnect delay, secs
+#define FEED_RATEDT     60              // rate update interval, secs
+#define FEED_HOSTLEN    64              // max host name length, including EOS
+
+typedef enum {
+    FT_CLUSTER,
+    FT_WSJTX,
+} FeedType;
+
+// one source and its counters
+typedef struct {
+    FeedType type;                      // kind of source
+    char host[FEED_HOSTLEN];            // cluster host
+    int port;                           // cluster or UDP port
+    char login[MAX_DXSPOTCALL_LEN];     // cluster login
+    char capture[FEED_HOSTLEN];         // file to record UDP datagrams, if any
+    bool up;                            // whether connected now
+    uint32_t n_lines;                   // n lines or packets received
+    uint32_t n_spots;                   // n spots queued
+    uint32_t n_added;                   // n of n_spots that were not already in the store
+    uint32_t n_dropped;                 // n spots discarded because queue was full
+    uint32_t n_connects;                // n successful connections
+    uint32_t rate_n0;                   // n_spots at rate_t0
+    time_t rate_t0;                     // time of last rate update
+    float rate;                         // spots per minute, decaying average
+} FeedSource;
+
+// one queued spot with its source
+typedef struct {
+    SpotRec r;
+    int src;
+} FeedEntry;
+
+// sources and queue, only accessed with feed_lock held
+static FeedSource sources[FEED_MAXSRC];
+static int n_sources;
+static FeedEntry queue[FEED_QMAX];
+static int q_head;                      // index of oldest entry
+static int q_n;                         // n entries queued
+static int q_max;                       // most ever queued at once
+static pthread_mutex_t feed_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t q_notempty = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t q_notfull = PTHREAD_COND_INITIALIZER;
+
+
+/* return abs time secs from now suitable for pthread_cond_timedwait()
+ */
+static struct timespec feedTimeout (int secs)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_REALTIME, &ts);
+    ts.tv_sec += secs;
+    return (ts);
+}
+
+/* add r from source src to the queue.
+ * if full, wait a while for room if wait else drop.
+ */
+static void feedPush (int src, const SpotRec &r, bool wait)
+{
+    pthread_mutex_lock (&feed_lock);
+
+    if (wait) {
+        struct timespec ts = feedTimeout (FEED_QWAIT);
+        while (q_n == FEED_QMAX && pthread_cond_timedwait (&q_notfull, &feed_lock, &ts) == 0)
+            continue;
+    }
+
+    FeedSource &fs = sources[src];
+    if (q_n == FEED_QMAX) {
+        fs.n_dropped++;
+    } else {
+        FeedEntry &e = queue[(q_head + q_n) & (FEED_QMAX-1)];
+        e.r = r;
+        e.src = src;
+        if (++q_n > q_max)
+            q_max = q_n;
+        fs.n_spots++;
+        pthread_cond_signal (&q_notempty);
+    }
+
+    pthread_mutex_unlock (&feed_lock);
+}
+
+/* update the spot rate of each source if due.
+ * N.B. call with feed_lock held
+ */
+static void feedRates()
+{
+    time_t t = time(NULL);
+    for (int i = 0; i < n_sources; i++) {
+        FeedSource &fs = sources[i];
+        if (fs.rate_t0 == 0) {
+            fs.rate_t0 = t;
+            fs.rate_n0 = fs.n_spots;
+        } else if (t - fs.rate_t0 >= FEED_RATEDT) {
+            float now_rate = 60.0F * (fs.n_spots - fs.rate_n0) / (t - fs.rate_t0);
+            fs.rate = 0.7F*fs.rate + 0.3F*now_rate;
+            fs.rate_t0 = t;
+            fs.rate_n0 = fs.n_spots;
+        }
+    }
+}
+
+/* thread that moves spots from the queue into the spot store forever.
+ */
+static void *feedDrainThread (void *unused)
+{
+    (void) unused;
+
+    pthread_mutex_lock (&feed_lock);
+
+    while (true) {
+
+        // wait for work, waking occasionally to update rates
+        struct timespec ts = feedTimeout (1);
+        while (q_n == 0 && pthread_cond_timedwait (&q_notempty, &feed_lock, &ts) == 0)
+            continue;
+        feedRates();
+        if (q_n == 0)
+            continue;
+
+        // take oldest then process without lock
+        FeedEntry e = queue[q_head];
+        q_head = (q_head + 1) & (FEED_QMAX-1);
+        q_n--;
+        pthread_cond_signal (&q_notfull);
+        pthread_mutex_unlock (&feed_lock);
+
+        // fill in the rest
+        SpotRec &r = e.r;
+        for (char *cp = r.call; *cp; cp++)
+            *cp = toupper (*cp);
+        if (r.lat_d == 0 && r.lng_d == 0) {
+            LatLong ll;
+            if (ctyLookup (r.call, ll, NULL, 0)) {
+                r.lat_d = ll.lat_d;
+                r.lng_d = ll.lng_d;
+            }
+        }
+        if (!ctyDXCC (r.call, r.dxcc, sizeof(r.dxcc)))
+            r.dxcc[0] = '\0';
+        bool added = spotStoreAdd (r);
+
+        pthread_mutex_lock (&feed_lock);
+        if (added)
+            sources[e.src].n_added++;
+    }
+
+    return (NULL);
+}
+
+/* set whether the given source is connected
+ */
+static void feedSetUp (int src, bool up)
+{
+    pthread_mutex_lock (&feed_lock);
+    sources[src].up = up;
+    if (up)
+        sources[src].n_connects++;
+    pthread_mutex_unlock (&feed_lock);
+}
+
+/* count one more line or packet from the given source
+ */
+static void feedCountLine (int src)
+{
+    pthread_mutex_lock (&feed_lock);
+    sources[src].n_lines++;
+    pthread_mutex_unlock (&feed_lock);
+}
+
+/* read the next line from client into buf, without EOL.
+ * *np is the count already in buf from a previous call that timed out, set to 0 before the first.
+ * return 1 if a line, 0 if none within to_ms, -1 if connection is lost.
+ */
+static int feedReadLine (WiFiClient &client, char *buf, size_t buf_len, size_t *np, int to_ms)
+{
+    size_t &n = *np;
+    for (int dt = 0; dt < to_ms; ) {
+        if (!client.connected())
+            return (-1);
+        if (!client.available()) {
+            usleep (20000);
+            dt += 20;
+            continue;
+        }
+        int c = client.read();
+        if (c < 0)
+            return (-1);
+        if (c == '\n') {
+            buf[n] = '\0';
+            n = 0;
+            return (1);
+        }
+        if (c != '\r' && n < buf_len-1)
+            buf[n++] = isprint(c) ? c : ' ';
+    }
+    return (0);
+}
+
+/* thread that reads spots from one cluster forever, reconnecting as needed.
+ */
+static void *feedClusterThread (void *arg)
+{
+    int src = (int)(intptr_t) arg;
+    FeedSource fs;
+    pthread_mutex_lock (&feed_lock);
+    fs = sources[src];
+    pthread_mutex_unlock (&feed_lock);
+
+    int retry = FEED_RETRY;
+    while (true) {
+
+        WiFiClient client;
+        if (WiFi.status() != WL_CONNECTED || !client.connect (fs.host, fs.port)) {
+            Serial.printf (_FX("Feed: %s:%d connect failed, retry in %d s\n"), fs.host, fs.port, retry);
+            sleep (retry);
+            retry = retry*2 > FEED_MAXRETRY ? FEED_MAXRETRY : retry*2;
+            continue;
+        }
+        Serial.printf (_FX("Feed: %s:%d connected\n"), fs.host, fs.port);
+        feedSetUp (src, true);
+        retry = FEED_RETRY;
+
+        // assume we have been asked for our callsign
+        client.println (fs.login);
+
+        // read spots until lose connection
+        char line[150];
+        size_t line_n = 0;
+        time_t last_line = time(NULL);
+        int s;
+        while ((s = feedReadLine (client, line, sizeof(line), &line_n, 1000)) >= 0) {
+            if (s == 0) {
+                if (time(NULL) - last_line > FEED_IDLE) {
+                    client.print ("\r\n");
+                    last_line = time(NULL);
+                }
+                continue;
+            }
+            last_line = time(NULL);
+            feedCountLine (src);
+
+            SpotRec r;
+            memset (&r, 0, sizeof(r));
+            if (crackDXClusterSpot (line, r.call, r.de_call, &r.kHz, &r.mode)) {
+                r.t = last_line;
+                feedPush (src, r, true);
+            }
+        }
+
+        Serial.printf (_FX("Feed: %s:%d lost connection\n"), fs.host, fs.port);
+        feedSetUp (src, false);
+        client.stop();
+        sleep (FEED_RETRY);
+    }
+
+    return (NULL);
+}
+
+/* thread that reads WSJT-X messages from one UDP port forever.
+ */
+static void *feedWSJTXThread (void *arg)
+{
+    int src = (int)(intptr_t) arg;
+    int port;
+    pthread_mutex_lock (&feed_lock);
+    port = sources[src].port;
+    pthread_mutex_unlock (&feed_lock);
+
+    // bind exclusively, a shared port would split the datagrams with whoever else is bound to it
+    WiFiUDP udp;
+    while (!udp.begin (port, false)) {
+        Serial.printf (_FX("Feed: UDP %d failed, retry in %d s\n"), port, FEED_MAXRETRY);
+        sleep (FEED_MAXRETRY);
+    }
+    Serial.printf (_FX("Feed: listening on UDP %d\n"), port);
+    feedSetUp (src, true);
+
+    // open capture file, if any
+    char capture[FEED_HOSTLEN];
+    pthread_mutex_lock (&feed_lock);
+    strcpy (capture, sources[src].capture);
+    pthread_mutex_unlock (&feed_lock);
+    FILE *cap_fp = NULL;
+    if (capture[0]) {
+        char fn[1000];
+        if (capture[0] == '/')
+            snprintf (fn, sizeof(fn), "%s", capture);
+        else
+            snprintf (fn, sizeof(fn), "%s/.hamclock/%s", getenv("HOME"), capture);
+        cap_fp = fopen (fn, "a");
+        if (cap_fp)
+            Serial.printf (_FX("Feed: recording UDP %d in %s\n"), port, fn);
+        else
+            Serial.printf (_FX("Feed: %s: %s\n"), fn, strerror(errno));
+    }
+
+    WSJTXState st;
+    memset (&st, 0, sizeof(st));
+    uint8_t pkt[WSJTX_MAXPKT];
+    while (true) {
+        int n = udp.parsePacket();
+        if (n <= 0) {
+            usleep (50000);
+            continue;
+        }
+        if (n > (int)sizeof(pkt))
+            n = sizeof(pkt);
+        (void) udp.read (pkt, n);
+        feedCountLine (src);
+
+        if (cap_fp) {
+            uint8_t len[4] = {(uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+            if (fwrite (len, 4, 1, cap_fp) != 1 || fwrite (pkt, n, 1, cap_fp) != 1 || fflush (cap_fp) != 0) {
+                Serial.printf (_FX("Feed: UDP %d capture stopped: %s\n"), port, strerror(errno));
+                fclose (cap_fp);
+                cap_fp = NULL;
+            }
+        }
+
+        WSJTXMsg m;
+        SpotRec r;
+        char maid[5];
+        if (wsjtxDecode (pkt, n, m) && wsjtxSpot (m, st, r, maid)) {
+            LatLong ll;
+            if (maid[0] && maidenhead2ll (ll, maid)) {
+                r.lat_d = ll.lat_d;
+                r.lng_d = ll.lng_d;
+            }
+            r.t = time(NULL);
+            feedPush (src, r, false);
+        }
+    }
+
+    return (NULL);
+}
+
+/* crack one line from the config file and add to sources[].
+ * return whether ok.
+ */
+static bool feedAddSource (char *line)
+{
+    if (n_sources == FEED_MAXSRC)
+        return (false);
+
+    FeedSource &fs = sources[n_sources];
+    memset (&fs, 0, sizeof(fs));
+    char type[20], login[30] = "";
+    char host[FEED_HOSTLEN];
+    int n = sscanf (line, "%19s", type);
+    if (n == 1 && strcmp (type, "cluster") == 0
+                        && sscanf (line, "%*s %63s %d %29s", host, &fs.port, login) >= 2) {
+        fs.type = FT_CLUSTER;
+        snprintf (fs.host, sizeof(fs.host), "%s", host);
+        snprintf (fs.login, sizeof(fs.login), "%s", login[0] ? login : getCallsign());
+    } else if (n == 1 && strcmp (type, "wsjtx") == 0 && sscanf (line, "%*s %d", &fs.port) == 1) {
+        fs.type = FT_WSJTX;
+        snprintf (fs.host, sizeof(fs.host), "UDP");
+        if (sscanf (line, "%*s %*d %63s", host) == 1)
+            snprintf (fs.capture, sizeof(fs.capture), "%s", host);
+    } else
+        return (false);
+
+    if (fs.port <= 0 || fs.port > 65535)
+        return (false);
+
+    // the main WSJT-X connection already owns its port
+    if (fs.type == FT_WSJTX && useDXCluster() && fs.port == getDXClusterPort()
+                && (!strcasecmp (getDXClusterHost(), "WSJT-X") || !strcasecmp (getDXClusterHost(), "JTDX"))) {
+        Serial.printf (_FX("Feed: UDP %d is the main WSJT-X port\n"), fs.port);
+        return (false);
+    }
+
+    n_sources++;
+    return (true);
+}
+
+#endif // _USE_UNIX
+
+
+/* read the list of sources and start a thread for each.
+ */
+void initSpotFeeds()
+{
+#if defined(_USE_UNIX)
+    char fn[1000];
+    snprintf (fn, sizeof(fn), "%s/.hamclock/spotfeeds.txt", getenv("HOME"));
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return;
+
+    char line[200];
+    for (int ln = 1; fgets (line, sizeof(line), fp); ln++) {
+        char *hash = strchr (line, '#');
+        if (hash)
+            *hash = '\0';
+        char *lp = line;
+        while (isspace(*lp))
+            lp++;
+        size_t ll = strlen (lp);
+        while (ll > 0 && isspace(lp[ll-1]))
+            lp[--ll] = '\0';
+        if (ll == 0)
+            continue;
+        if (!feedAddSource (lp))
+            Serial.printf (_FX("Feed: %s:%d ignoring: %s\n"), fn, ln, lp);
+    }
+    fclose (fp);
+
+    if (n_sources == 0)
+        return;
+
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, feedDrainThread, NULL);
+    if (e) {
+        Serial.printf (_FX("Feed: thread failed: %s\n"), strerror(e));
+        return;
+    }
+    pthread_detach (tid);
+
+    for (int i = 0; i < n_sources; i++) {
+        void *(*thread)(void *) = sources[i].type == FT_CLUSTER ? feedClusterThread : feedWSJTXThread;
+        e = pthread_create (&tid, NULL, thread, (void *)(intptr_t)i);
+        if (e)
+            Serial.printf (_FX("Feed: thread failed: %s\n"), strerror(e));
+        else
+            pthread_detach (tid);
+    }
+
+    Serial.printf (_FX("Feed: started %d sources\n"), n_sources);
+#endif // _USE_UNIX
+}
+
+/* print a report of each source to client.
+ * return whether any sources.
+ */
+bool reportSpotFeeds (WiFiClient &client)
+{
+#if defined(_USE_UNIX)
+    if (n_sources == 0)
+        return (false);
+
+    char buf[200];
+    pthread_mutex_lock (&feed_lock);
+    int qn = q_n, qmax = q_max;
+    FeedSource copy[FEED_MAXSRC];
+    memcpy (copy, sources, n_sources*sizeof(FeedSource));
+    pthread_mutex_unlock (&feed_lock);
+
+    snprintf (buf, sizeof(buf), _FX("# queue %d of %d, max %d\n"), qn, FEED_QMAX, qmax);
+    client.print(buf);
+    client.print(_FX("#Source                         Up Conns    Lines    Spots      New  Dropped Spots/min\n"));
+    for (int i = 0; i < n_sources; i++) {
+        const FeedSource &fs = copy[i];
+        char name[FEED_HOSTLEN+10];
+        snprintf (name, sizeof(name), "%s:%d", fs.host, fs.port);
+        snprintf (buf, sizeof(buf), _FX("%-31s %2s %5u %8u %8u %8u %8u %9.1f\n"), name, fs.up ? "Y" : "N",
+                fs.n_connects, fs.n_lines, fs.n_spots, fs.n_added, fs.n_dropped, fs.rate);
+        client.print(buf);
+    }
+    return (true);
+#else
+    (void) client;
+    return (false);
+#endif // _USE_UNIX
+}
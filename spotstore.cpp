@@ -0,0 +1,582 @@
+/* store of all DX spots received, not just those on display.
+ *
+ * spots are kept in a ring of SPOTS_MAX so the oldest is discarded when full. Each spot is also linked into
+ * a hash chain keyed by call, 1 kHz frequency bucket and SPOTS_DUPSECS time bucket to reject duplicates,
+ * and into doubly linked lists, newest first, for its band, mode and DXCC entity so queries on any of
+ * these only visit matching spots. DXCC prefixes are found through their own hash table. All insertions
+ * and removals are O(1).
+ *
+ * the store is safe to use from any thread. On UNIX a background thread saves it in
+ * $HOME/.hamclock/spots.dat every SPOTS_SAVE seconds, writing a copy so the store is never locked
+ * during file I/O, and it is reloaded at the next start.
+ */
+
+#include "HamClock.h"
+
+#if defined(_USE_UNIX)
+#include <pthread.h>
+#endif
+
+
+#if defined(_IS_ESP8266)
+#define SPOTS_MAX       32              // max spots
+#define SPOTS_MAXDXCC   1               // no cty.dat on ESP so all entities are unknown
+#else
+#define SPOTS_MAX       32768           // max spots, power of 2
+#define SPOTS_MAXDXCC   512             // max distinct DXCC prefixes
+#endif
+#define SPOTS_NHASH     (2*SPOTS_MAX)   // n dedup hash buckets, power of 2
+#define SPOTS_NDXCCHASH (2*SPOTS_MAXDXCC) // n DXCC name hash slots, power of 2
+#define SPOTS_DUPSECS   600             // same call and kHz within this long is a duplicate
+#define SPOTS_SAVE      300             // save this often, secs
+#define SPOTS_MAGIC     "HCSPOTS1"      // file format identifier
+
+// indexes maintained for each spot
+typedef enum {
+    SI_BAND,
+    SI_MODE,
+    SI_DXCC,
+    SI_N
+} SpotIndex;
+
+// one stored spot with its links
+typedef struct {
+    SpotRec r;                          // public info
+    int32_t hnext;                      // next in dedup hash chain, or -1
+    int32_t prev[SI_N];                 // newer spot in same index list, or -1
+    int32_t next[SI_N];                 // older spot in same index list, or -1
+    uint16_t key[SI_N];                 // list each index uses
+} SpotSlot;
+
+// head of one index list
+typedef struct {
+    int32_t newest;                     // first slot, or -1
+    int32_t oldest;                     // last slot, or -1
+    int32_t count;                      // n in list
+} SpotList;
+
+// band edges, kHz
+static const struct {
+    uint16_t meters;
+    uint32_t lo, hi;
+} spot_bands[] = {
+    {0,        0,      0},              // any other, must be first
+    {160,   1800,   2000},
+    {80,    3500,   4000},
+    {60,    5250,   5450},
+    {40,    7000,   7300},
+    {30,   10100,  10150},
+    {20,   14000,  14350},
+    {17,   18068,  18168},
+    {15,   21000,  21450},
+    {12,   24890,  24990},
+    {10,   28000,  29700},
+    {6,    50000,  54000},
+    {2,   144000, 148000},
+};
+#define SPOTS_NBANDS    NARRAY(spot_bands)
+
+// mode names, index is SpotRec.mode
+static const char *spot_modes[] = {
+    "?", "CW", "SSB", "FT8", "FT4", "RTTY", "PSK", "JT65", "JT9", "FM", "AM", "MSK144", "DIGI", "WSPR",
+};
+#define SPOTS_NMODES    NARRAY(spot_modes)
+
+// FT8 dial frequencies, kHz, used to infer mode when not stated
+static const uint32_t ft8_kHz[] = {1840, 3573, 5357, 7074, 10136, 14074, 18100, 21074, 24915, 28074, 50313};
+
+// the store, only accessed with spots_lock held
+static SpotSlot *slots;                 // malloced ring of SPOTS_MAX
+static int32_t *hash;                   // malloced SPOTS_NHASH chain heads
+static int32_t s_head;                  // next slot to write
+static int32_t s_n;                     // n slots in use
+static SpotList lists_band[SPOTS_NBANDS];
+static SpotList lists_mode[SPOTS_NMODES];
+static SpotList lists_dxcc[SPOTS_MAXDXCC];
+static char dxcc_names[SPOTS_MAXDXCC][MAX_SPOTDXCC_LEN];  // [0] is unknown
+static uint16_t dxcc_hash[SPOTS_NDXCCHASH];    // dxcc_names[] ids by name hash, 0 if empty
+static uint16_t n_dxcc = 1;
+static bool spots_dirty;                // set when changed since last save
+
+#if defined(_USE_UNIX)
+static pthread_mutex_t spots_lock = PTHREAD_MUTEX_INITIALIZER;
+#define SPOTS_LOCK()    pthread_mutex_lock (&spots_lock)
+#define SPOTS_UNLOCK()  pthread_mutex_unlock (&spots_lock)
+#else
+#define SPOTS_LOCK()
+#define SPOTS_UNLOCK()
+#endif
+
+
+/* return the list for index i with the given key
+ */
+static SpotList &spotList (int i, uint16_t key)
+{
+    if (i == SI_BAND)
+        return (lists_band[key]);
+    if (i == SI_MODE)
+        return (lists_mode[key]);
+    return (lists_dxcc[key]);
+}
+
+/* return spot_bands[] index for the given frequency
+ */
+static uint16_t spotBandIndex (float kHz)
+{
+    for (unsigned i = 1; i < SPOTS_NBANDS; i++)
+        if (kHz >= spot_bands[i].lo && kHz <= spot_bands[i].hi)
+            return (i);
+    return (0);
+}
+
+/* return spot_bands[] index for the given band in meters, or -1
+ */
+static int spotBandFromMeters (int meters)
+{
+    for (unsigned i = 1; i < SPOTS_NBANDS; i++)
+        if (spot_bands[i].meters == meters)
+            return (i);
+    return (-1);
+}
+
+/* return the id of the given DXCC primary prefix, adding if new and room.
+ * names are never removed so dxcc_hash[] is probed linearly from the name's hash to an empty slot.
+ * N.B. call with spots_lock held
+ */
+static uint16_t spotDXCCId (const char *dxcc, bool add)
+{
+    if (!dxcc || !dxcc[0])
+        return (0);
+
+    uint32_t h = 2166136261U;                           // FNV-1a
+    for (const char *cp = dxcc; *cp; cp++) {
+        h ^= (uint8_t) *cp;
+        h *= 16777619U;
+    }
+    for (uint32_t i = h; ; i++) {
+        uint16_t &id = dxcc_hash[i & (SPOTS_NDXCCHASH-1)];
+        if (id == 0) {
+            // not found, id is where it goes
+            if (!add || n_dxcc == SPOTS_MAXDXCC)
+                return (0);
+            snprintf (dxcc_names[n_dxcc], MAX_SPOTDXCC_LEN, "%s", dxcc);
+            id = n_dxcc++;
+            return (id);
+        }
+        if (strcmp (dxcc_names[id], dxcc) == 0)
+            return (id);
+    }
+}
+
+/* return the dedup hash bucket for the given call, frequency and time
+ */
+static uint32_t spotHash (const char *call, float kHz, time_t t)
+{
+    uint32_t h = 2166136261U;                           // FNV-1a
+    for (; *call; call++) {
+        h ^= (uint8_t) toupper(*call);
+        h *= 16777619U;
+    }
+    h ^= (uint32_t) lroundf (kHz);
+    h *= 16777619U;
+    h ^= (uint32_t) (t / SPOTS_DUPSECS);
+    h *= 16777619U;
+    return (h & (SPOTS_NHASH-1));
+}
+
+/* return whether slots already holds a spot of call within the same frequency and time bucket as t
+ * N.B. call with spots_lock held
+ */
+static bool spotIsDup (const char *call, float kHz, time_t t)
+{
+    long f_bkt = lroundf (kHz);
+    long t_bkt = t / SPOTS_DUPSECS;
+
+    // check the bucket of t and the one before so spots just either side of a boundary still match
+    for (int dt = 0; dt < 2; dt++) {
+        time_t t_try = t - dt*SPOTS_DUPSECS;
+        for (int32_t i = hash[spotHash (call, kHz, t_try)]; i >= 0; i = slots[i].hnext) {
+            const SpotRec &r = slots[i].r;
+            if (lroundf (r.kHz) == f_bkt && r.t / SPOTS_DUPSECS >= t_bkt - 1 && labs ((long)(t - r.t)) < SPOTS_DUPSECS
+                                && strcasecmp (r.call, call) == 0)
+                return (true);
+        }
+    }
+    return (false);
+}
+
+/* remove slot s from all its links
+ * N.B. call with spots_lock held
+ */
+static void spotUnlink (int32_t s)
+{
+    SpotSlot &ss = slots[s];
+
+    // hash chain
+    int32_t *pp = &hash[spotHash (ss.r.call, ss.r.kHz, ss.r.t)];
+    while (*pp >= 0 && *pp != s)
+        pp = &slots[*pp].hnext;
+    if (*pp == s)
+        *pp = ss.hnext;
+
+    // index lists
+    for (int i = 0; i < SI_N; i++) {
+        SpotList &l = spotList (i, ss.key[i]);
+        if (ss.prev[i] >= 0)
+            slots[ss.prev[i]].next[i] = ss.next[i];
+        else
+            l.newest = ss.next[i];
+        if (ss.next[i] >= 0)
+            slots[ss.next[i]].prev[i] = ss.prev[i];
+        else
+            l.oldest = ss.prev[i];
+        l.count--;
+    }
+}
+
+/* link slot s as the newest in all its lists
+ * N.B. call with spots_lock held
+ */
+static void spotLink (int32_t s)
+{
+    SpotSlot &ss = slots[s];
+
+    uint32_t h = spotHash (ss.r.call, ss.r.kHz, ss.r.t);
+    ss.hnext = hash[h];
+    hash[h] = s;
+
+    for (int i = 0; i < SI_N; i++) {
+        SpotList &l = spotList (i, ss.key[i]);
+        ss.prev[i] = -1;
+        ss.next[i] = l.newest;
+        if (l.newest >= 0)
+            slots[l.newest].prev[i] = s;
+        else
+            l.oldest = s;
+        l.newest = s;
+        l.count++;
+    }
+}
+
+/* add r as the newest spot, discarding the oldest if full.
+ * N.B. call with spots_lock held
+ */
+static void spotInsert (const SpotRec &r)
+{
+    int32_t s = s_head;
+    if (s_n == SPOTS_MAX)
+        spotUnlink (s);
+    else
+        s_n++;
+    s_head = (s_head + 1) % SPOTS_MAX;
+
+    SpotSlot &ss = slots[s];
+    ss.r = r;
+    ss.r.band = spot_bands[spotBandIndex(r.kHz)].meters;
+    ss.key[SI_BAND] = spotBandIndex (r.kHz);
+    ss.key[SI_MODE] = r.mode < SPOTS_NMODES ? r.mode : 0;
+    ss.key[SI_DXCC] = spotDXCCId (r.dxcc, true);
+    spotLink (s);
+    spots_dirty = true;
+}
+
+#if defined(_USE_UNIX)
+
+/* build the full path to our save file
+ */
+static void spotFileName (char *fn, size_t fn_len)
+{
+    snprintf (fn, fn_len, "%s/.hamclock/spots.dat", getenv("HOME"));
+}
+
+/* save all spots, oldest first, if changed since last time.
+ * the spots are copied with spots_lock held then written without it.
+ */
+static void spotSave()
+{
+    // copy
+    SPOTS_LOCK();
+    if (!spots_dirty) {
+        SPOTS_UNLOCK();
+        return;
+    }
+    int32_t n = s_n;
+    SpotRec *recs = (SpotRec *) malloc ((n > 0 ? n : 1) * sizeof(SpotRec));
+    if (recs) {
+        for (int32_t i = 0; i < n; i++)
+            recs[i] = slots[(s_head - n + i + SPOTS_MAX) % SPOTS_MAX].r;
+        spots_dirty = false;
+    }
+    SPOTS_UNLOCK();
+    if (!recs) {
+        Serial.printf (_FX("Spots: no memory to save %d\n"), n);
+        return;
+    }
+
+    // write
+    char fn[1000], tmp_fn[1010];
+    spotFileName (fn, sizeof(fn));
+    snprintf (tmp_fn, sizeof(tmp_fn), "%s.new", fn);
+    FILE *fp = fopen (tmp_fn, "w");
+    bool ok = fp != NULL;
+    if (ok) {
+        uint32_t hdr[2] = {(uint32_t)sizeof(SpotRec), (uint32_t)n};
+        ok = fwrite (SPOTS_MAGIC, 8, 1, fp) == 1 && fwrite (hdr, sizeof(hdr), 1, fp) == 1
+                        && (n == 0 || fwrite (recs, sizeof(SpotRec), n, fp) == (size_t)n);
+        if (fclose (fp) != 0)
+            ok = false;
+        if (ok)
+            ok = rename (tmp_fn, fn) == 0;
+    }
+    if (!ok) {
+        Serial.printf (_FX("Spots: %s: %s\n"), fn, strerror(errno));
+        (void) unlink (tmp_fn);
+        SPOTS_LOCK();
+        spots_dirty = true;                             // try again next time
+        SPOTS_UNLOCK();
+    }
+
+    free (recs);
+}
+
+/* thread that saves the store every SPOTS_SAVE seconds forever
+ */
+static void *spotSaveThread (void *unused)
+{
+    (void) unused;
+
+    while (true) {
+        sleep (SPOTS_SAVE);
+        spotSave();
+    }
+
+    return (NULL);
+}
+
+/* load spots saved by spotSave().
+ * N.B. call with spots_lock held
+ */
+static void spotLoad()
+{
+    char fn[1000];
+    spotFileName (fn, sizeof(fn));
+    FILE *fp = fopen (fn, "r");
+    if (!fp)
+        return;
+
+    char magic[8];
+    uint32_t hdr[2];
+    if (fread (magic, 8, 1, fp) == 1 && memcmp (magic, SPOTS_MAGIC, 8) == 0
+                && fread (hdr, sizeof(hdr), 1, fp) == 1 && hdr[0] == sizeof(SpotRec)) {
+        SpotRec r;
+        for (uint32_t i = 0; i < hdr[1] && fread (&r, sizeof(r), 1, fp) == 1; i++)
+            spotInsert (r);
+        Serial.printf (_FX("Spots: restored %d from %s\n"), s_n, fn);
+    } else
+        Serial.printf (_FX("Spots: %s: unknown format\n"), fn);
+
+    fclose (fp);
+    spots_dirty = false;
+}
+
+#endif // _USE_UNIX
+
+/* insure the store is ready, return whether ok.
+ * N.B. call with spots_lock held
+ */
+static bool spotInit()
+{
+    if (slots)
+        return (true);
+
+    slots = (SpotSlot *) calloc (SPOTS_MAX, sizeof(SpotSlot));
+    hash = (int32_t *) malloc (SPOTS_NHASH * sizeof(int32_t));
+    if (!slots || !hash) {
+        Serial.printf (_FX("Spots: no memory for %d\n"), SPOTS_MAX);
+        free (slots);
+        free (hash);
+        slots = NULL;
+        hash = NULL;
+        return (false);
+    }
+    for (int i = 0; i < SPOTS_NHASH; i++)
+        hash[i] = -1;
+    for (unsigned i = 0; i < SPOTS_NBANDS; i++)
+        lists_band[i].newest = lists_band[i].oldest = -1;
+    for (unsigned i = 0; i < SPOTS_NMODES; i++)
+        lists_mode[i].newest = lists_mode[i].oldest = -1;
+    for (int i = 0; i < SPOTS_MAXDXCC; i++)
+        lists_dxcc[i].newest = lists_dxcc[i].oldest = -1;
+
+#if defined(_USE_UNIX)
+    spotLoad();
+
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, spotSaveThread, NULL);
+    if (e)
+        Serial.printf (_FX("Spots: save thread failed: %s\n"), strerror(e));
+    else
+        pthread_detach (tid);
+#endif
+
+    return (true);
+}
+
+/* return the SpotRec.mode index for the given mode name, or 0 if unknown
+ */
+uint8_t spotModeFromName (const char *name)
+{
+    for (unsigned i = 1; i < SPOTS_NMODES; i++)
+        if (strcasecmp (name, spot_modes[i]) == 0)
+            return (i);
+    return (0);
+}
+
+/* return the name of the given SpotRec.mode index
+ */
+const char *spotModeName (uint8_t mode)
+{
+    return (spot_modes[mode < SPOTS_NMODES ? mode : 0]);
+}
+
+/* guess the mode of a spot from the first mode name found in its comment, else its frequency.
+ */
+uint8_t spotModeGuess (const char *comment, float kHz)
+{
+    // look for any known mode as a separate word
+    if (comment) {
+        char word[20];
+        int wl = 0;
+        for (const char *cp = comment; ; cp++) {
+            if (isalnum (*cp)) {
+                if (wl < (int)sizeof(word)-1)
+                    word[wl++] = *cp;
+            } else {
+                if (wl > 0) {
+                    word[wl] = '\0';
+                    uint8_t m = spotModeFromName (word);
+                    if (m == 0 && (strcasecmp (word, "USB") == 0 || strcasecmp (word, "LSB") == 0))
+                        m = spotModeFromName ("SSB");
+                    if (m)
+                        return (m);
+                }
+                wl = 0;
+                if (!*cp)
+                    break;
+            }
+        }
+    }
+
+    // near an FT8 calling frequency
+    for (unsigned i = 0; i < NARRAY(ft8_kHz); i++)
+        if (kHz >= ft8_kHz[i] && kHz <= ft8_kHz[i] + 3)
+            return (spotModeFromName ("FT8"));
+
+    // bottom of each band is CW, rest is phone
+    uint16_t b = spotBandIndex (kHz);
+    if (b > 0) {
+        uint32_t cw_top = spot_bands[b].lo + (spot_bands[b].meters >= 60 ? 100 : 150);
+        return (spotModeFromName (kHz < cw_top ? "CW" : "SSB"));
+    }
+
+    return (0);
+}
+
+/* add the given spot to the store unless it is a duplicate.
+ * r.band is filled in here.
+ * return whether added.
+ */
+bool spotStoreAdd (const SpotRec &r)
+{
+    bool added = false;
+
+    SPOTS_LOCK();
+
+    if (spotInit() && !spotIsDup (r.call, r.kHz, r.t)) {
+        spotInsert (r);
+        added = true;
+    }
+
+    SPOTS_UNLOCK();
+
+    return (added);
+}
+
+/* return whether a spot of call at kHz and time t is already in the store.
+ * N.B. spotStoreAdd() checks again so this is just a cheap early test
+ */
+bool spotStoreIsDup (const char *call, float kHz, time_t t)
+{
+    SPOTS_LOCK();
+    bool dup = spotInit() && spotIsDup (call, kHz, t);
+    SPOTS_UNLOCK();
+    return (dup);
+}
+
+/* fill out[] with up to max_out spots matching q, newest first.
+ * the most selective index of those given in q is walked; the rest are tested per spot.
+ * return number found.
+ */
+int spotStoreQuery (const SpotQuery &q, SpotRec out[], int max_out)
+{
+    int n_out = 0;
+
+    SPOTS_LOCK();
+
+    if (!spotInit() || s_n == 0) {
+        SPOTS_UNLOCK();
+        return (0);
+    }
+
+    // keys for those indexes used, -1 if not
+    int key[SI_N];
+    key[SI_BAND] = q.band > 0 ? spotBandFromMeters (q.band) : -1;
+    key[SI_MODE] = q.mode > 0 && q.mode < SPOTS_NMODES ? q.mode : -1;
+    key[SI_DXCC] = q.dxcc && q.dxcc[0] ? spotDXCCId (q.dxcc, false) : -1;
+    if ((q.band > 0 && key[SI_BAND] < 0) || (q.dxcc && q.dxcc[0] && key[SI_DXCC] <= 0)) {
+        // asked for a band or entity we have never seen
+        SPOTS_UNLOCK();
+        return (0);
+    }
+
+    // choose the shortest list
+    int walk = -1;
+    int32_t walk_n = s_n;
+    for (int i = 0; i < SI_N; i++) {
+        if (key[i] >= 0 && spotList (i, key[i]).count < walk_n) {
+            walk = i;
+            walk_n = spotList (i, key[i]).count;
+        }
+    }
+
+    // walk newest to oldest
+    int32_t s = walk >= 0 ? spotList (walk, key[walk]).newest : (s_head - 1 + SPOTS_MAX) % SPOTS_MAX;
+    for (int32_t n = 0; s >= 0 && n < walk_n && n_out < max_out; n++) {
+        const SpotSlot &ss = slots[s];
+        if (q.since && ss.r.t < q.since)
+            break;
+        bool match = true;
+        for (int i = 0; match && i < SI_N; i++)
+            if (key[i] >= 0 && ss.key[i] != key[i])
+                match = false;
+        if (match && q.call && q.call[0] && strcasecmp (q.call, ss.r.call) != 0)
+            match = false;
+        if (match)
+            out[n_out++] = ss.r;
+        s = walk >= 0 ? ss.next[walk] : (s - 1 + SPOTS_MAX) % SPOTS_MAX;
+    }
+
+    SPOTS_UNLOCK();
+
+    return (n_out);
+}
+
+/* return the number of spots in the store
+ */
+int spotStoreCount()
+{
+    SPOTS_LOCK();
+    int n = s_n;
+    SPOTS_UNLOCK();
+    return (n);
+}
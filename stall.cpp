@@ -0,0 +1,235 @@
+/* notice when the main loop stops calling resetWatchdog() and capture where it is stuck.
+ *
+ * a watchdog thread checks every STALL_POLL_MS when the main thread last checked in. If that is more
+ * than STALL_MS ago it signals the main thread, whose handler saves a backtrace of wherever it is
+ * blocked. The watchdog symbolizes that outside the handler and keeps the last N_STALLS such reports,
+ * each completed with the full stall duration once the main loop checks in again. get_stalls.txt
+ * reports them.
+ *
+ * function names need the executable linked with -rdynamic, else use addr2line on the offsets.
+ * N.B. the signal is restartable but calls that never restart, such as select(2) and usleep(3), return
+ * early with EINTR in the stalled main thread so those must be prepared to try again.
+ */
+
+#include "HamClock.h"
+
+
+#if defined(_USE_UNIX)
+
+#include <signal.h>
+#include <execinfo.h>
+
+#define STALL_MS        1000                    // report main loop gaps longer than this
+#define STALL_POLL_MS   100                     // watchdog check interval
+#define STALL_SIG       SIGUSR2                 // signal used to capture main thread backtrace
+#define MAX_FRAMES      24                      // max stack frames captured
+#define STALL_TEXT      2000                    // max symbolized text kept per report
+#define N_STALLS        16                      // reports kept
+
+// one stall
+typedef struct {
+    time_t when;                                // UTC when stall began
+    uint32_t dur_ms;                            // total duration, or so far if ongoing
+    bool ongoing;                               // set until main loop checks in again
+    char frames[STALL_TEXT];                    // symbolized backtrace, one frame per line
+} StallReport;
+
+// reports, oldest first, protected by stall_lock
+static pthread_mutex_t stall_lock = PTHREAD_MUTEX_INITIALIZER;
+static StallReport stalls[N_STALLS];
+static int n_stalls;                            // n used in stalls[]
+static uint32_t n_stalls_total;                 // total stalls seen
+
+// main thread state
+static pthread_t main_tid;                      // thread that must keep checking in
+static volatile uint32_t checkin_ms;            // millis() of last check in, 0 until started
+static volatile uint32_t last_gap_ms;           // most recent gap longer than STALL_MS
+
+// written only by the signal handler while the watchdog waits
+static void *sig_frames[MAX_FRAMES];
+static volatile sig_atomic_t sig_n_frames;
+static volatile sig_atomic_t sig_done;
+
+
+/* STALL_SIG handler, runs on the main thread wherever it is stuck.
+ * N.B. backtrace() was called once at startup so it does no more loading or allocation here.
+ */
+static void onStallSignal (int sig)
+{
+    (void) sig;
+    sig_n_frames = backtrace (sig_frames, MAX_FRAMES);
+    sig_done = 1;
+}
+
+/* capture where the main thread is stuck into a new report
+ */
+static void captureStall (uint32_t dt_ms)
+{
+    char text[STALL_TEXT];
+    int text_l = 0;
+
+    // ask main thread for its backtrace, wait a little while for it
+    sig_done = 0;
+    pthread_kill (main_tid, STALL_SIG);
+    for (int i = 0; i < 20 && !sig_done; i++)
+        usleep (10000);
+
+    if (sig_done) {
+        // skip our handler and the signal trampoline
+        char **syms = backtrace_symbols (sig_frames, sig_n_frames);
+        for (int i = 2; i < sig_n_frames; i++) {
+            int l = snprintf (text + text_l, sizeof(text) - text_l, "  %s\n",
+                                        syms ? syms[i] : "?");
+            if (l >= (int)sizeof(text) - text_l)
+                break;
+            text_l += l;
+        }
+        free (syms);
+    } else
+        text_l = snprintf (text, sizeof(text), "  no backtrace, main thread did not respond\n");
+
+    pthread_mutex_lock (&stall_lock);
+    if (n_stalls == N_STALLS) {
+        memmove (&stalls[0], &stalls[1], (N_STALLS-1)*sizeof(StallReport));
+        n_stalls--;
+    }
+    StallReport &sr = stalls[n_stalls++];
+    sr.when = time(NULL) - dt_ms/1000;
+    sr.dur_ms = dt_ms;
+    sr.ongoing = true;
+    memcpy (sr.frames, text, text_l + 1);
+    n_stalls_total++;
+    pthread_mutex_unlock (&stall_lock);
+
+    Serial.printf (_FX("Stall: main loop stuck for %u ms at:\n%s"), dt_ms, text);
+}
+
+/* update the duration of the newest stall, and whether it is over
+ */
+static void updateStall (uint32_t dur_ms, bool done)
+{
+    pthread_mutex_lock (&stall_lock);
+    if (n_stalls > 0) {
+        StallReport &sr = stalls[n_stalls-1];
+        if (dur_ms > sr.dur_ms)
+            sr.dur_ms = dur_ms;
+        sr.ongoing = !done;
+    }
+    pthread_mutex_unlock (&stall_lock);
+
+    if (done)
+        Serial.printf (_FX("Stall: main loop resumed after %u ms\n"), dur_ms);
+}
+
+/* thread that watches for the main thread to stop checking in
+ */
+static void *stallThread (void *unused)
+{
+    (void) unused;
+    bool in_stall = false;
+
+    for (;;) {
+        usleep (STALL_POLL_MS*1000);
+
+        uint32_t dt = millis() - checkin_ms;
+        if (!in_stall && dt > STALL_MS) {
+            in_stall = true;
+            captureStall (dt);
+        } else if (in_stall && dt > STALL_MS) {
+            updateStall (dt, false);
+        } else if (in_stall) {
+            in_stall = false;
+            updateStall (last_gap_ms, true);
+        }
+    }
+
+    return (NULL);
+}
+
+#endif // _USE_UNIX
+
+
+/* start watching the calling thread, which must then call stallCheckIn() often
+ */
+void startStallDetector()
+{
+#if defined(_USE_UNIX)
+    // load whatever backtrace needs now so it is safe in the handler later
+    void *warmup[2];
+    (void) backtrace (warmup, 2);
+
+    struct sigaction sa;
+    memset (&sa, 0, sizeof(sa));
+    sa.sa_handler = onStallSignal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset (&sa.sa_mask);
+    if (sigaction (STALL_SIG, &sa, NULL) < 0) {
+        Serial.printf (_FX("Stall: sigaction: %s\n"), strerror(errno));
+        return;
+    }
+
+    main_tid = pthread_self();
+    checkin_ms = millis() | 1;
+
+    pthread_t tid;
+    int e = pthread_create (&tid, NULL, stallThread, NULL);
+    if (e)
+        Serial.printf (_FX("Stall: thread failed: %s\n"), strerror(e));
+    else
+        pthread_detach (tid);
+#endif // _USE_UNIX
+}
+
+/* called via resetWatchdog() to show the main loop is still running.
+ * N.B. calls from any other thread are ignored.
+ */
+void stallCheckIn (uint32_t ms)
+{
+#if defined(_USE_UNIX)
+    if (checkin_ms == 0 || !pthread_equal (pthread_self(), main_tid))
+        return;
+    if (ms - checkin_ms > STALL_MS)
+        last_gap_ms = ms - checkin_ms;
+    checkin_ms = ms | 1;
+#else
+    (void) ms;
+#endif // _USE_UNIX
+}
+
+/* send the stall reports to client, newest first
+ */
+void reportStalls (WiFiClient &client)
+{
+#if defined(_USE_UNIX)
+    char buf[100];
+
+    pthread_mutex_lock (&stall_lock);
+    int n = n_stalls;
+    snprintf (buf, sizeof(buf), _FX("# %u main loop stalls longer than %d ms, last %d shown newest first\n"),
+                        n_stalls_total, STALL_MS, n);
+    pthread_mutex_unlock (&stall_lock);
+    client.print (buf);
+
+    // copy each so the lock is not held while sending
+    for (int i = n; --i >= 0; ) {
+        StallReport sr;
+        pthread_mutex_lock (&stall_lock);
+        bool ok = i < n_stalls;
+        if (ok)
+            sr = stalls[i];
+        pthread_mutex_unlock (&stall_lock);
+        if (!ok)
+            continue;
+
+        struct tm tm;
+        gmtime_r (&sr.when, &tm);
+        snprintf (buf, sizeof(buf), _FX("\nStall %04d-%02d-%02dT%02d:%02d:%02dZ %u ms%s\n"),
+                        tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                        sr.dur_ms, sr.ongoing ? _FX(" so far") : "");
+        client.print (buf);
+        client.print (sr.frames);
+    }
+#else
+    client.print (_FX("stall detection requires UNIX\n"));
+#endif // _USE_UNIX
+}
@@ -0,0 +1,379 @@
+/* bench: time the main drawing and parsing kernels over fixed inputs without a display.
+ *
+ * linked with all the HamClock objects built with _USE_BENCH, which draws only into the in-memory
+ * canvas, so the numbers reflect the same code paths as the X11 and fb0 builds at the same resolution.
+ * all inputs are synthesized here so runs are repeatable and comparable across machines and commits.
+ * each kernel is run in batches until a batch takes at least BATCH_MS, then the median of N_BATCHES
+ * batches is reported as ns per operation. Output is one JSON object on stdout.
+ *
+ * build and run at every resolution: make bench
+ */
+
+#include "../HamClock.h"
+
+
+#define BATCH_MS        50                      // min time of each batch
+#define N_BATCHES       7                       // batches per kernel, median is reported
+#define MAX_KERNELS     20                      // max kernels we report
+
+// one result
+typedef struct {
+    const char *name;
+    double ns_op;
+    uint32_t iterations;                        // total ops run in all batches
+} Result;
+
+static Result results[MAX_KERNELS];
+static int n_results;
+
+// a kernel runs its operation n times
+typedef void (*KernelFP)(uint32_t n);
+
+// keep the compiler from discarding results
+static volatile uint32_t sink;
+
+// fixed satellite, the example TLE in Wikipedia's "Two-line element set" article
+static const char tle_l1[] = "1 25544U 98067A   08264.51782528 -.00002182  00000-0 -11606-4 0  2927";
+static const char tle_l2[] = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537";
+static Satellite *sat;
+
+// fixed cluster spots, as formatted by DX Spider
+static const char *spot_lines[] = {
+    "DX de KD0AA:     18100.0  JR1FYS       FT8 LOUD in FL!                2156Z EL98",
+    "DX de W1AW:       7025.5  DL1ABC       CW 599 tnx                     2157Z",
+    "DX de VE3XYZ:    14195.0  VK2DEF       USB 59 booming                 2158Z",
+    "DX de G4ABC:     50313.0  EA8/ON4XYZ   FT8 -12 dB 1433 Hz             2159Z",
+    "DX de JA1ZZZ:    10136.0  K7QQQ        FT4                            2200Z",
+    "DX de N0CALL:     3573.0  PY2AAA       RTTY CQ TEST                   2201Z",
+};
+#define N_SPOT_LINES    NARRAY(spot_lines)
+
+// fixed WSJT-X Decode packet, built once
+static uint8_t decode_pkt[WSJTX_MAXPKT];
+static int decode_len;
+
+
+/* return monotonic time in ns
+ */
+static uint64_t nowNs(void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return ((uint64_t)t.tv_sec*1000000000ULL + t.tv_nsec);
+}
+
+/* qsort comparison of doubles
+ */
+static int qsDouble (const void *p1, const void *p2)
+{
+    double d1 = *(const double *)p1;
+    double d2 = *(const double *)p2;
+    return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+/* time the given kernel and add to results
+ */
+static void runKernel (const char *name, KernelFP fp)
+{
+    // find n so one batch takes at least BATCH_MS, also serves to warm caches
+    uint32_t n = 1;
+    for (;;) {
+        uint64_t t0 = nowNs();
+        (*fp)(n);
+        uint64_t dt = nowNs() - t0;
+        if (dt >= BATCH_MS*1000000ULL || n >= (1U<<30))
+            break;
+        n *= 2;
+    }
+
+    double ns_op[N_BATCHES];
+    for (int i = 0; i < N_BATCHES; i++) {
+        uint64_t t0 = nowNs();
+        (*fp)(n);
+        ns_op[i] = (double)(nowNs() - t0)/n;
+    }
+    qsort (ns_op, N_BATCHES, sizeof(double), qsDouble);
+
+    if (n_results < MAX_KERNELS) {
+        Result &r = results[n_results++];
+        r.name = name;
+        r.ns_op = ns_op[N_BATCHES/2];
+        r.iterations = n*N_BATCHES;
+    }
+    fprintf (stderr, "%-20s %12.1f ns/op\n", name, ns_op[N_BATCHES/2]);
+}
+
+
+
+/* kernels
+ */
+
+/* convert successive points on a lat/lng grid to screen coords
+ */
+static void kernLL2S (uint32_t n)
+{
+    SCoord s;
+    for (uint32_t i = 0; i < n; i++) {
+        float lat = deg2rad ((float)(i % 179) - 89);
+        float lng = deg2rad ((float)((i*7) % 359) - 179);
+        ll2s (lat, lng, s, 0);
+        sink += s.x + s.y;
+    }
+}
+
+/* convert successive map screen coords to lat/lng
+ */
+static void kernS2LL (uint32_t n)
+{
+    LatLong ll;
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t x = map_b.x + (i % map_b.w);
+        uint16_t y = map_b.y + ((i/map_b.w) % map_b.h);
+        if (s2ll (x, y, ll))
+            sink += (uint32_t)ll.lat_d;
+    }
+}
+
+static void kernLL2SMerc (uint32_t n) { azm_on = 0; kernLL2S(n); }
+static void kernLL2SAzm (uint32_t n) { azm_on = 1; kernLL2S(n); azm_on = 0; }
+static void kernS2LLMerc (uint32_t n) { azm_on = 0; kernS2LL(n); }
+static void kernS2LLAzm (uint32_t n) { azm_on = 1; kernS2LL(n); azm_on = 0; }
+
+/* draw n full maps, one op is one map pixel as the map is painted one pixel at a time
+ */
+static void kernDrawMap (uint32_t n)
+{
+    SCoord s;
+    for (uint32_t i = 0; i < n; i++) {
+        s.x = map_b.x + (i % map_b.w);
+        s.y = map_b.y + ((i/map_b.w) % map_b.h);
+        drawMapCoord (s);
+    }
+}
+static void kernDrawMapMerc (uint32_t n) { azm_on = 0; kernDrawMap(n); }
+static void kernDrawMapAzm (uint32_t n) { azm_on = 1; kernDrawMap(n); azm_on = 0; }
+
+/* plot one map pixel directly at twilight so both maps are blended, the worst case
+ */
+static void kernPlotEarth (uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t x = map_b.x + (i % map_b.w);
+        uint16_t y = map_b.y + ((i/map_b.w) % map_b.h);
+        float lat = 90.0F - 180.0F*(y - map_b.y)/map_b.h;
+        float lng = 360.0F*(x - map_b.x)/map_b.w - 180.0F;
+        tft.plotEarth (x, y, lat, lng, 0, 360.0F/map_b.w, -180.0F/map_b.h, 0, 0.5F);
+    }
+}
+
+/* draw n characters in each font, plotChar is private so go through print()
+ */
+static void kernChar (uint32_t n, FontWeight w, FontSize s)
+{
+    static const char chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    selectFontStyle (w, s);
+    tft.setTextColor (RA8875_WHITE);
+    for (uint32_t i = 0; i < n; i++) {
+        if ((i % 20) == 0)
+            tft.setCursor (10, 100);
+        tft.print (chars[i % (sizeof(chars)-1)]);
+    }
+}
+static void kernCharFast (uint32_t n) { kernChar (n, LIGHT_FONT, FAST_FONT); }
+static void kernCharSmall (uint32_t n) { kernChar (n, BOLD_FONT, SMALL_FONT); }
+static void kernCharLarge (uint32_t n) { kernChar (n, BOLD_FONT, LARGE_FONT); }
+
+/* fill circles the size of the map symbols and a larger one
+ */
+static void kernFillCircle (uint32_t n, int16_t r)
+{
+    for (uint32_t i = 0; i < n; i++)
+        tft.fillCircle (map_b.x + 50 + (i % 500), map_b.y + 50 + (i % 200), r, (uint16_t)i);
+}
+static void kernFillCircle4 (uint32_t n) { kernFillCircle (n, 4); }
+static void kernFillCircle9 (uint32_t n) { kernFillCircle (n, SUN_R); }
+static void kernFillCircle40 (uint32_t n) { kernFillCircle (n, 40); }
+
+/* predict the satellite at successive minutes
+ */
+static void kernSatPredict (uint32_t n)
+{
+    DateTime t0 (2008, 9, 21, 12, 0, 0);
+    float lat, lng;
+    for (uint32_t i = 0; i < n; i++) {
+        DateTime t = t0 + (long)(i % 1440)*60;
+        sat->predict (t);
+        sat->geo (lat, lng);
+        sink += (uint32_t)lat;
+    }
+}
+
+/* crack cluster spot lines
+ */
+static void kernCrackSpot (uint32_t n)
+{
+    char call[MAX_DXSPOTCALL_LEN], de_call[MAX_DXSPOTCALL_LEN];
+    float kHz;
+    uint8_t mode;
+    for (uint32_t i = 0; i < n; i++)
+        if (crackDXClusterSpot (spot_lines[i % N_SPOT_LINES], call, de_call, &kHz, &mode))
+            sink += mode;
+}
+
+/* decode a WSJT-X Decode packet and find its sender
+ */
+static void kernWSJTXDecode (uint32_t n)
+{
+    WSJTXMsg m;
+    char call[MAX_DXSPOTCALL_LEN], grid[5];
+    for (uint32_t i = 0; i < n; i++)
+        if (wsjtxDecode (decode_pkt, decode_len, m) && wsjtxMsgSender (m.decode.msg, call, grid))
+            sink += call[0];
+}
+
+/* guess the mode from spot comments
+ */
+static void kernModeGuess (uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        const char *line = spot_lines[i % N_SPOT_LINES];
+        sink += spotModeGuess (line + 39, 14074.0F);
+    }
+}
+
+
+
+/* setup
+ */
+
+/* append a big-endian u32 as in a Qt QDataStream
+ */
+static void putU32 (uint8_t *&bp, uint32_t x)
+{
+    *bp++ = x >> 24; *bp++ = x >> 16; *bp++ = x >> 8; *bp++ = x;
+}
+
+/* append a QDataStream utf8 string
+ */
+static void putStr (uint8_t *&bp, const char *s)
+{
+    uint32_t l = strlen(s);
+    putU32 (bp, l);
+    memcpy (bp, s, l);
+    bp += l;
+}
+
+/* build the fixed WSJT-X Decode packet
+ */
+static void buildDecodePkt(void)
+{
+    uint8_t *bp = decode_pkt;
+    putU32 (bp, 0xadbccbdaU);                   // magic
+    putU32 (bp, 2);                             // schema
+    putU32 (bp, WM_DECODE);
+    putStr (bp, "WSJT-X");
+    *bp++ = 1;                                  // new
+    putU32 (bp, 12*3600000);                    // ms since midnight
+    putU32 (bp, (uint32_t)-12);                 // snr
+    memset (bp, 0, 8); bp += 8;                 // dt
+    putU32 (bp, 1433);                          // df
+    putStr (bp, "~");                           // mode
+    putStr (bp, "CQ DX JA1ABC PM95");           // message
+    *bp++ = 0;                                  // low confidence
+    *bp++ = 0;                                  // off air
+    decode_len = bp - decode_pkt;
+}
+
+/* install synthetic day and night maps so plotEarth has the same memory access pattern as real maps
+ */
+static void initEarthMaps(void)
+{
+    size_t npix = (size_t)EARTH_BIG_W*EARTH_BIG_H;
+    uint16_t *day = (uint16_t *) malloc (npix * sizeof(uint16_t));
+    uint16_t *night = (uint16_t *) malloc (npix * sizeof(uint16_t));
+    if (!day || !night) {
+        fprintf (stderr, "Can not malloc %lu for earth maps\n", (unsigned long)(2*npix*sizeof(uint16_t)));
+        exit(1);
+    }
+    for (size_t i = 0; i < npix; i++) {
+        uint32_t row = i / EARTH_BIG_W, col = i % EARTH_BIG_W;
+        day[i] = RGB565 (col*255/EARTH_BIG_W, row*255/EARTH_BIG_H, 200);
+        night[i] = RGB565 (0, col*63/EARTH_BIG_W, row*63/EARTH_BIG_H);
+    }
+    tft.setEarthPix ((char*)day, (char*)night);
+
+    // N.B. unless _UNTILED_EARTH these were copied
+    #if !defined(_UNTILED_EARTH)
+        free (day);
+        free (night);
+    #endif
+}
+
+/* set up the same map geometry, DE and sun as the real setup()
+ */
+static void initMap(void)
+{
+    map_b.w = EARTH_W;
+    map_b.h = EARTH_H;
+    map_b.x = tft.width() - map_b.w - 1;
+    map_b.y = tft.height() - map_b.h - 1;
+
+    de_ll.lat_d = 40; de_ll.lng_d = -105;
+    normalizeLL (de_ll);
+    sdelat = sinf(de_ll.lat);
+    cdelat = cosf(de_ll.lat);
+    antipode (deap_ll, de_ll);
+
+    // equinox noon over the map center puts the terminator through the map both ways
+    sun_ss_ll.lat_d = 0; sun_ss_ll.lng_d = 0;
+    normalizeLL (sun_ss_ll);
+    ssslat = sinf(sun_ss_ll.lat);
+    csslat = cosf(sun_ss_ll.lat);
+}
+
+int main (int ac, char *av[])
+{
+    our_name = av[0];
+
+    if (ac > 1) {
+        fprintf (stderr, "Purpose: time HamClock drawing and parsing kernels at %dx%d\n", FB_XRES, FB_YRES);
+        fprintf (stderr, "Usage: %s\n", av[0]);
+        fprintf (stderr, "results are printed to stdout as JSON, progress to stderr\n");
+        exit(1);
+    }
+
+    tft.begin(0);
+    initEarthMaps();
+    initMap();
+    buildDecodePkt();
+    sat = new Satellite (tle_l1, tle_l2);
+
+    runKernel ("ll2s_merc", kernLL2SMerc);
+    runKernel ("ll2s_azm", kernLL2SAzm);
+    runKernel ("s2ll_merc", kernS2LLMerc);
+    runKernel ("s2ll_azm", kernS2LLAzm);
+    runKernel ("plotEarth", kernPlotEarth);
+    runKernel ("drawMapCoord_merc", kernDrawMapMerc);
+    runKernel ("drawMapCoord_azm", kernDrawMapAzm);
+    runKernel ("plotChar_fast", kernCharFast);
+    runKernel ("plotChar_small", kernCharSmall);
+    runKernel ("plotChar_large", kernCharLarge);
+    runKernel ("fillCircle_r4", kernFillCircle4);
+    runKernel ("fillCircle_r9", kernFillCircle9);
+    runKernel ("fillCircle_r40", kernFillCircle40);
+    runKernel ("sat_predict", kernSatPredict);
+    runKernel ("crackDXClusterSpot", kernCrackSpot);
+    runKernel ("wsjtxDecode", kernWSJTXDecode);
+    runKernel ("spotModeGuess", kernModeGuess);
+
+    printf ("{\"version\":\"%s\",\"resolution\":\"%dx%d\",\"scale\":%d,\"kernels\":[\n",
+                HC_VERSION, FB_XRES, FB_YRES, tft.SCALESZ);
+    for (int i = 0; i < n_results; i++) {
+        Result &r = results[i];
+        printf (" {\"name\":\"%s\",\"unit\":\"ns/op\",\"value\":%.1f,\"iterations\":%u}%s\n",
+                    r.name, r.ns_op, r.iterations, i < n_results-1 ? "," : "");
+    }
+    printf ("]}\n");
+
+    return (0);
+}
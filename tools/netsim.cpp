@@ -0,0 +1,761 @@
+/* netsim: stand-in for every server HamClock talks to, replaying a recording made with HAMCLOCK_NETREC.
+ *
+ * run HamClock with HAMCLOCK_NETREC=file to record all its outgoing TCP and UDP exchanges, then run
+ * this with that file and run HamClock again with HAMCLOCK_NETSIM=host:port pointing here. HamClock then
+ * connects only to us, starting each TCP connection and UDP datagram with "NETSIM tcp|udp host port\n"
+ * naming where it really wanted to go, see ArduinoLib/NetRec.h. We answer each with a recorded
+ * conversation to the same host and port whose first request line matches, else one whose request
+ * matches up to any query, else any to that host and port. Repeats of the same request cycle through
+ * all recordings of it in order, so runs are deterministic.
+ *
+ * responses may be delayed, throttled or made to fail to measure how HamClock copes; failures are drawn
+ * from a seeded random sequence so they too repeat from run to run.
+ *
+ * build: make netsim
+ * example:
+ *   HAMCLOCK_NETREC=net.rec hamclock                   # record a while then quit
+ *   netsim -f net.rec -p 8090 -l 200 -B 50000 -e 10 &
+ *   HAMCLOCK_NETSIM=localhost:8090 hamclock
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_LINE        300                     // max recording header or request line
+#define MAX_PRE         200                     // max NETSIM preamble
+#define MAX_PKT         1500                    // max UDP datagram
+#define PRE_TIMEOUT     5000                    // max ms to wait for the preamble
+#define REQ_TIMEOUT     10000                   // max ms to wait for the first request
+#define TALK_FIRST_MS   300                     // ms with no request before trying server-first recordings
+
+// one recorded event
+typedef struct {
+    char dir;                                   // 'W' from HamClock or 'R' to HamClock
+    long ms;                                    // ms since recording began
+    uint8_t *data;                              // malloced bytes
+    int n;                                      // n bytes in data
+} Event;
+
+// one recorded conversation
+typedef struct {
+    int id;                                     // id in recording
+    bool is_udp;                                // else tcp
+    char host[100];                             // real server
+    int port;
+    Event *ev;                                  // malloced list of events
+    int n_ev;
+    bool closed;                                // whether recording saw it close
+    char req[MAX_LINE];                         // first line of first W, "" if server spoke first
+    unsigned n_used;                            // times replayed
+} Conv;
+
+// failure kinds
+typedef enum {
+    FAIL_NONE,
+    FAIL_REFUSE,                                // close as soon as connected
+    FAIL_RESET,                                 // reset part way through the first response
+    FAIL_STALL,                                 // accept but never respond
+    FAIL_N
+} FailKind;
+static const char *fail_names[FAIL_N] = {"none", "refuse", "reset", "stall"};
+
+// options
+static const char *rec_file;                    // recording to replay
+static int sim_port = 8090;                     // TCP and UDP port to serve
+static int latency_ms;                          // added before each response
+static int jitter_ms;                           // plus uniform random up to this
+static long bw_Bps;                             // bytes per second per connection, 0 unlimited
+static bool orig_timing;                        // keep recorded gaps within each response
+static int fail_pct;                            // percent of exchanges that fail
+static unsigned fail_mask = (1<<FAIL_REFUSE) | (1<<FAIL_RESET) | (1<<FAIL_STALL);
+static int stall_secs = 30;                     // how long FAIL_STALL holds a connection
+static unsigned seed = 1;                       // failure and jitter sequence seed
+static bool verbose;                            // log each exchange
+
+// recording
+static Conv *convs;
+static int n_convs;
+
+// shared state
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned n_served, n_unmatched, n_failed[FAIL_N];
+
+
+
+/*********************************************************************************************
+ *
+ * utilities
+ *
+ */
+
+
+/* print a message with a time stamp to stderr
+ */
+static void logMsg (const char *fmt, ...)
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    fprintf (stderr, "%ld.%03ld netsim: ", (long)tv.tv_sec, (long)tv.tv_usec/1000);
+    va_list ap;
+    va_start (ap, fmt);
+    vfprintf (stderr, fmt, ap);
+    va_end (ap);
+}
+
+/* sleep for the given ms
+ */
+static void sleepMs (long ms)
+{
+    if (ms <= 0)
+        return;
+    struct timespec ts;
+    ts.tv_sec = ms/1000;
+    ts.tv_nsec = (ms%1000)*1000000L;
+    while (nanosleep (&ts, &ts) < 0 && errno == EINTR)
+        continue;
+}
+
+/* return next value from the shared seeded random sequence, [0,n)
+ */
+static unsigned simRandom (unsigned n)
+{
+    pthread_mutex_lock (&sim_lock);
+    unsigned r = n > 0 ? rand_r (&seed) % n : 0;
+    pthread_mutex_unlock (&sim_lock);
+    return (r);
+}
+
+/* wait up to to_ms for fd to be readable, return whether it is
+ */
+static bool waitReadable (int fd, int to_ms)
+{
+    fd_set rset;
+    FD_ZERO (&rset);
+    FD_SET (fd, &rset);
+    struct timeval tv;
+    tv.tv_sec = to_ms/1000;
+    tv.tv_usec = (to_ms%1000)*1000;
+    return (select (fd+1, &rset, NULL, NULL, &tv) > 0);
+}
+
+/* copy the first line of buf[n] into line without its EOL
+ */
+static void firstLine (const uint8_t *buf, int n, char *line, size_t line_len)
+{
+    size_t l = 0;
+    for (int i = 0; i < n && l < line_len-1 && buf[i] != '\r' && buf[i] != '\n'; i++)
+        line[l++] = buf[i];
+    line[l] = '\0';
+}
+
+/* return whether two request lines match up to any query
+ */
+static bool samePath (const char *r1, const char *r2)
+{
+    size_t skip = strncmp (r1, "GET ", 4) == 0 ? 4 : 0;
+    size_t l1 = skip + strcspn (r1 + skip, "? ");
+    return (strncmp (r1, r2, l1) == 0 && (r2[l1] == '?' || r2[l1] == ' ' || r2[l1] == '\0'));
+}
+
+
+
+/*********************************************************************************************
+ *
+ * recording
+ *
+ */
+
+
+/* return the conversation with the given recording id, else NULL
+ */
+static Conv *findConvId (int id)
+{
+    for (int i = n_convs; --i >= 0; )
+        if (convs[i].id == id)
+            return (&convs[i]);
+    return (NULL);
+}
+
+/* load the recording, return whether ok
+ */
+static bool loadRecording (const char *fn)
+{
+    FILE *fp = fopen (fn, "r");
+    if (!fp) {
+        logMsg ("%s: %s\n", fn, strerror(errno));
+        return (false);
+    }
+
+    char line[MAX_LINE];
+    int n_lines = 0;
+    while (fgets (line, sizeof(line), fp)) {
+        n_lines++;
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        char proto[10], host[100];
+        int id, port, n;
+        long ms;
+        if (sscanf (line, "C %d %ld %9s %99s %d", &id, &ms, proto, host, &port) == 5) {
+            // new conversation, a recording appended to an earlier one reuses ids so later wins
+            convs = (Conv *) realloc (convs, (n_convs+1)*sizeof(Conv));
+            Conv &c = convs[n_convs++];
+            memset (&c, 0, sizeof(c));
+            c.id = id;
+            c.is_udp = strcmp (proto, "udp") == 0;
+            snprintf (c.host, sizeof(c.host), "%s", host);
+            c.port = port;
+
+        } else if (sscanf (line, "%*c %d %ld %d", &id, &ms, &n) == 3 && (line[0] == 'W' || line[0] == 'R')) {
+            // data, always read the bytes even if the conversation is unknown
+            uint8_t *data = (uint8_t *) malloc (n + 1);
+            if (!data || fread (data, 1, n, fp) != (size_t)n || fgetc (fp) != '\n') {
+                logMsg ("%s:%d: short data\n", fn, n_lines);
+                fclose (fp);
+                return (false);
+            }
+            Conv *cp = findConvId (id);
+            if (!cp) {
+                free (data);
+                continue;
+            }
+            cp->ev = (Event *) realloc (cp->ev, (cp->n_ev+1)*sizeof(Event));
+            Event &e = cp->ev[cp->n_ev++];
+            e.dir = line[0];
+            e.ms = ms;
+            e.data = data;
+            e.n = n;
+            if (e.dir == 'W' && cp->n_ev == 1)
+                firstLine (data, n, cp->req, sizeof(cp->req));
+
+        } else if (sscanf (line, "X %d %ld", &id, &ms) == 2) {
+            Conv *cp = findConvId (id);
+            if (cp)
+                cp->closed = true;
+
+        } else {
+            logMsg ("%s:%d: bogus line: %s", fn, n_lines, line);
+            fclose (fp);
+            return (false);
+        }
+    }
+    fclose (fp);
+
+    logMsg ("%s: %d conversations\n", fn, n_convs);
+    return (n_convs > 0);
+}
+
+/* find the best recorded conversation for the given destination and request line, NULL if none.
+ * an empty req means HamClock has not said anything so prefer ones where the server speaks first.
+ */
+static Conv *matchConv (bool is_udp, const char *host, int port, const char *req)
+{
+    Conv *best = NULL;
+    int best_q = 0;
+
+    pthread_mutex_lock (&sim_lock);
+    for (int i = 0; i < n_convs; i++) {
+        Conv &c = convs[i];
+        if (c.is_udp != is_udp || c.port != port || strcmp (c.host, host) != 0 || c.n_ev == 0)
+            continue;
+
+        // quality of match, higher is better
+        int q;
+        if (is_udp)
+            q = 1;
+        else if (!req[0])
+            q = c.req[0] ? 0 : 3;
+        else if (strcmp (c.req, req) == 0)
+            q = 3;
+        else if (c.req[0] && samePath (c.req, req))
+            q = 2;
+        else
+            q = c.req[0] ? 1 : 0;
+        if (q == 0)
+            continue;
+
+        // among equals use the least used so repeats cycle in recorded order
+        if (!best || q > best_q || (q == best_q && c.n_used < best->n_used)) {
+            best = &c;
+            best_q = q;
+        }
+    }
+    if (best)
+        best->n_used++;
+    pthread_mutex_unlock (&sim_lock);
+
+    return (best);
+}
+
+/* decide whether the next exchange fails and how
+ */
+static FailKind chooseFailure (void)
+{
+    if (fail_pct <= 0 || (int)simRandom(100) >= fail_pct)
+        return (FAIL_NONE);
+
+    int n_kinds = 0;
+    FailKind kinds[FAIL_N];
+    for (int k = FAIL_NONE+1; k < FAIL_N; k++)
+        if (fail_mask & (1<<k))
+            kinds[n_kinds++] = (FailKind)k;
+    return (n_kinds > 0 ? kinds[simRandom(n_kinds)] : FAIL_NONE);
+}
+
+/* return the delay before starting a response, ms
+ */
+static long responseDelay (void)
+{
+    return (latency_ms + (jitter_ms > 0 ? simRandom (jitter_ms+1) : 0));
+}
+
+
+
+/*********************************************************************************************
+ *
+ * tcp
+ *
+ */
+
+
+// one tcp connection
+typedef struct {
+    int fd;
+    struct sockaddr_in sa;
+} TCPConn;
+
+/* send n bytes to fd at no more than bw_Bps, return whether all went
+ */
+static bool sendThrottled (int fd, const uint8_t *buf, int n)
+{
+    // send in 20 ms slices when throttled
+    int slice = bw_Bps > 0 ? (int)(bw_Bps/50) : n;
+    if (slice < 1)
+        slice = 1;
+
+    for (int sent = 0; sent < n; ) {
+        int want = n - sent < slice ? n - sent : slice;
+        int nw = write (fd, buf + sent, want);
+        if (nw <= 0)
+            return (false);
+        sent += nw;
+        if (bw_Bps > 0)
+            sleepMs (1000L*nw/bw_Bps);
+    }
+    return (true);
+}
+
+/* discard whatever HamClock has sent so far, return false if it has closed
+ */
+static bool drainInput (int fd)
+{
+    uint8_t buf[4096];
+    while (waitReadable (fd, 0)) {
+        int nr = read (fd, buf, sizeof(buf));
+        if (nr <= 0)
+            return (false);
+    }
+    return (true);
+}
+
+/* read the NETSIM preamble and the first request line, if any, from fd.
+ * return whether preamble was ok.
+ */
+static bool readPreamble (int fd, char *host, int host_len, int *port, char *req, int req_len)
+{
+    char buf[MAX_PRE + MAX_LINE];
+    int n = 0;
+    char *eol = NULL;
+
+    // read a byte at a time through the preamble so the request is left in the socket
+    while (n < MAX_PRE-1 && !eol) {
+        if (!waitReadable (fd, PRE_TIMEOUT) || read (fd, buf+n, 1) != 1)
+            return (false);
+        if (buf[n++] == '\n')
+            eol = buf + n - 1;
+    }
+    buf[n] = '\0';
+
+    char proto[10], h[100];
+    if (sscanf (buf, "NETSIM %9s %99s %d", proto, h, port) != 3 || strcmp (proto, "tcp") != 0)
+        return (false);
+    snprintf (host, host_len, "%s", h);
+
+    // peek at the first request line if HamClock speaks first; servers that speak first get nothing
+    req[0] = '\0';
+    if (waitReadable (fd, TALK_FIRST_MS)) {
+        int nr = recv (fd, buf, sizeof(buf)-1, MSG_PEEK);
+        if (nr > 0)
+            firstLine ((uint8_t*)buf, nr, req, req_len);
+    }
+    return (true);
+}
+
+/* replay the given conversation to fd, applying the given failure
+ */
+static void replayTCP (int fd, const Conv &c, FailKind fail)
+{
+    bool in_response = false;
+    bool first_response = true;
+    long prev_ms = 0;
+
+    for (int i = 0; i < c.n_ev; i++) {
+        const Event &e = c.ev[i];
+
+        if (e.dir == 'W') {
+            // HamClock's turn, let it finish before responding
+            if (!waitReadable (fd, REQ_TIMEOUT) || !drainInput (fd))
+                return;
+            in_response = false;
+            continue;
+        }
+
+        // start of a response or a gap within one
+        if (!in_response) {
+            if (fail == FAIL_STALL) {
+                sleepMs (1000L*stall_secs);
+                return;
+            }
+            sleepMs (responseDelay());
+            in_response = true;
+        } else if (orig_timing)
+            sleepMs (e.ms - prev_ms);
+        prev_ms = e.ms;
+
+        if (fail == FAIL_RESET && first_response) {
+            // send half then reset
+            (void) sendThrottled (fd, e.data, e.n/2);
+            struct linger l = {1, 0};
+            setsockopt (fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+            return;
+        }
+
+        if (!sendThrottled (fd, e.data, e.n) || !drainInput (fd))
+            return;
+
+        if (i+1 < c.n_ev && c.ev[i+1].dir == 'W')
+            first_response = false;
+    }
+
+    // leave open if the recording was still open, eg a cluster, until HamClock gives up
+    if (!c.closed)
+        while (waitReadable (fd, 24*3600*1000) && drainInput (fd))
+            continue;
+}
+
+/* thread to serve one TCP connection
+ */
+static void *tcpThread (void *arg)
+{
+    TCPConn *tp = (TCPConn *) arg;
+    int fd = tp->fd;
+
+    char host[100], req[MAX_LINE];
+    int port;
+    if (!readPreamble (fd, host, sizeof(host), &port, req, sizeof(req))) {
+        logMsg ("%s: no NETSIM preamble\n", inet_ntoa (tp->sa.sin_addr));
+        close (fd);
+        free (tp);
+        return (NULL);
+    }
+
+    Conv *cp = matchConv (false, host, port, req);
+    FailKind fail = cp ? chooseFailure() : FAIL_NONE;
+
+    pthread_mutex_lock (&sim_lock);
+    if (!cp)
+        n_unmatched++;
+    else {
+        n_served++;
+        n_failed[fail]++;
+    }
+    pthread_mutex_unlock (&sim_lock);
+
+    if (verbose || !cp)
+        logMsg ("tcp %s:%d %s -> %s\n", host, port, req[0] ? req : "(server first)",
+                    cp ? fail_names[fail] : "no recording");
+
+    if (!cp) {
+        // say so if http else just hang up
+        if (strncmp (req, "GET ", 4) == 0) {
+            static const char nf[] = "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n\r\n"
+                                     "not in recording\r\n";
+            (void) drainInput (fd);
+            (void) !write (fd, nf, sizeof(nf)-1);
+        }
+    } else if (fail != FAIL_REFUSE)
+        replayTCP (fd, *cp, fail);
+
+    close (fd);
+    free (tp);
+    return (NULL);
+}
+
+/* thread to accept TCP connections forever
+ */
+static void *acceptThread (void *arg)
+{
+    int lfd = *(int *)arg;
+
+    for (;;) {
+        TCPConn *tp = (TCPConn *) malloc (sizeof(TCPConn));
+        socklen_t sa_len = sizeof(tp->sa);
+        tp->fd = accept (lfd, (struct sockaddr *)&tp->sa, &sa_len);
+        if (tp->fd < 0) {
+            logMsg ("accept: %s\n", strerror(errno));
+            free (tp);
+            sleepMs (100);
+            continue;
+        }
+        pthread_t tid;
+        if (pthread_create (&tid, NULL, tcpThread, tp)) {
+            logMsg ("tcp thread: %s\n", strerror(errno));
+            close (tp->fd);
+            free (tp);
+            continue;
+        }
+        pthread_detach (tid);
+    }
+    return (NULL);
+}
+
+
+
+/*********************************************************************************************
+ *
+ * udp
+ *
+ */
+
+
+// one pending udp reply
+typedef struct {
+    int fd;
+    struct sockaddr_in sa;
+    const Conv *cp;
+} UDPReply;
+
+/* thread to send the recorded replies to one datagram after the response delay
+ */
+static void *udpReplyThread (void *arg)
+{
+    UDPReply *up = (UDPReply *) arg;
+    sleepMs (responseDelay());
+    for (int i = 0; i < up->cp->n_ev; i++) {
+        const Event &e = up->cp->ev[i];
+        if (e.dir == 'R')
+            (void) sendto (up->fd, e.data, e.n, 0, (struct sockaddr *)&up->sa, sizeof(up->sa));
+    }
+    free (up);
+    return (NULL);
+}
+
+/* serve UDP datagrams forever
+ */
+static void serveUDP (int ufd)
+{
+    for (;;) {
+        uint8_t pkt[MAX_PRE + MAX_PKT + 1];
+        struct sockaddr_in sa;
+        socklen_t sa_len = sizeof(sa);
+        int n = recvfrom (ufd, pkt, sizeof(pkt)-1, 0, (struct sockaddr *)&sa, &sa_len);
+        if (n < 0) {
+            logMsg ("recvfrom: %s\n", strerror(errno));
+            sleepMs (100);
+            continue;
+        }
+        pkt[n] = '\0';
+
+        char proto[10], host[100];
+        int port;
+        if (sscanf ((char*)pkt, "NETSIM %9s %99s %d", proto, host, &port) != 3 || strcmp (proto, "udp")) {
+            logMsg ("%s: no NETSIM preamble\n", inet_ntoa (sa.sin_addr));
+            continue;
+        }
+
+        // any failure just loses the reply, as UDP does
+        const Conv *cp = matchConv (true, host, port, "");
+        FailKind fail = cp ? chooseFailure() : FAIL_NONE;
+        pthread_mutex_lock (&sim_lock);
+        if (!cp)
+            n_unmatched++;
+        else {
+            n_served++;
+            n_failed[fail]++;
+        }
+        pthread_mutex_unlock (&sim_lock);
+        if (verbose || !cp)
+            logMsg ("udp %s:%d -> %s\n", host, port, cp ? fail_names[fail] : "no recording");
+        if (!cp || fail != FAIL_NONE)
+            continue;
+
+        UDPReply *up = (UDPReply *) malloc (sizeof(UDPReply));
+        up->fd = ufd;
+        up->sa = sa;
+        up->cp = cp;
+        pthread_t tid;
+        if (pthread_create (&tid, NULL, udpReplyThread, up)) {
+            free (up);
+            continue;
+        }
+        pthread_detach (tid);
+    }
+}
+
+
+
+/*********************************************************************************************
+ *
+ * main
+ *
+ */
+
+
+/* list the recording to stdout
+ */
+static void listRecording (void)
+{
+    for (int i = 0; i < n_convs; i++) {
+        const Conv &c = convs[i];
+        long n_w = 0, n_r = 0;
+        for (int j = 0; j < c.n_ev; j++)
+            *(c.ev[j].dir == 'W' ? &n_w : &n_r) += c.ev[j].n;
+        long dt = c.n_ev > 0 ? c.ev[c.n_ev-1].ms - c.ev[0].ms : 0;
+        printf ("%5d %s %s:%d sent %ld rcvd %ld in %ld ms%s: %s\n", c.id, c.is_udp ? "udp" : "tcp",
+                    c.host, c.port, n_w, n_r, dt, c.closed ? "" : " still open", c.req);
+    }
+}
+
+/* on SIGINT or SIGTERM report totals and exit
+ */
+static void onSignal (int sig)
+{
+    (void) sig;
+    fprintf (stderr, "\nServed %u, Unmatched %u, Failed", n_served, n_unmatched);
+    for (int k = FAIL_NONE+1; k < FAIL_N; k++)
+        fprintf (stderr, " %s %u", fail_names[k], n_failed[k]);
+    fprintf (stderr, "\n");
+    _exit (0);
+}
+
+/* crack the -F list of failure kinds, return whether ok
+ */
+static bool crackFailKinds (const char *list)
+{
+    fail_mask = 0;
+    char buf[100];
+    snprintf (buf, sizeof(buf), "%s", list);
+    for (char *tok = strtok (buf, ","); tok; tok = strtok (NULL, ",")) {
+        int k;
+        for (k = FAIL_NONE+1; k < FAIL_N; k++)
+            if (strcmp (tok, fail_names[k]) == 0)
+                break;
+        if (k == FAIL_N)
+            return (false);
+        fail_mask |= 1 << k;
+    }
+    return (fail_mask != 0);
+}
+
+static void usage (const char *me)
+{
+    fprintf (stderr, "Usage: %s [options] -f file\n", me);
+    fprintf (stderr, "  -f file      recording made with HAMCLOCK_NETREC=file\n");
+    fprintf (stderr, "  -L           list the recording and exit\n");
+    fprintf (stderr, "  -p port      serve on this TCP and UDP port; default %d\n", sim_port);
+    fprintf (stderr, "  -l ms        delay before each response; default %d\n", latency_ms);
+    fprintf (stderr, "  -j ms        plus random delay up to this; default %d\n", jitter_ms);
+    fprintf (stderr, "  -B bytes/s   bandwidth of each connection, 0 for unlimited; default %ld\n", bw_Bps);
+    fprintf (stderr, "  -o           also keep the original gaps within each response\n");
+    fprintf (stderr, "  -e percent   percent of exchanges that fail; default %d\n", fail_pct);
+    fprintf (stderr, "  -F kinds     comma list of refuse,reset,stall; default all\n");
+    fprintf (stderr, "  -S secs      how long a stall lasts; default %d\n", stall_secs);
+    fprintf (stderr, "  -s seed      seed for failures and jitter; default %u\n", seed);
+    fprintf (stderr, "  -v           log every exchange\n");
+    exit (1);
+}
+
+int main (int ac, char *av[])
+{
+    bool list = false;
+    int opt;
+    while ((opt = getopt (ac, av, "f:Lp:l:j:B:oe:F:S:s:v")) != -1) {
+        switch (opt) {
+        case 'f': rec_file = optarg; break;
+        case 'L': list = true; break;
+        case 'p': sim_port = atoi (optarg); break;
+        case 'l': latency_ms = atoi (optarg); break;
+        case 'j': jitter_ms = atoi (optarg); break;
+        case 'B': bw_Bps = atol (optarg); break;
+        case 'o': orig_timing = true; break;
+        case 'e': fail_pct = atoi (optarg); break;
+        case 'F': if (!crackFailKinds (optarg)) usage (av[0]); break;
+        case 'S': stall_secs = atoi (optarg); break;
+        case 's': seed = strtoul (optarg, NULL, 0); break;
+        case 'v': verbose = true; break;
+        default: usage (av[0]);
+        }
+    }
+    if (optind != ac || !rec_file || sim_port <= 0 || latency_ms < 0 || jitter_ms < 0 || bw_Bps < 0
+                        || fail_pct < 0 || fail_pct > 100 || stall_secs < 0)
+        usage (av[0]);
+
+    if (!loadRecording (rec_file))
+        return (1);
+    if (list) {
+        listRecording();
+        return (0);
+    }
+
+    signal (SIGPIPE, SIG_IGN);
+    signal (SIGINT, onSignal);
+    signal (SIGTERM, onSignal);
+
+    struct sockaddr_in sa;
+    memset (&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl (INADDR_ANY);
+    sa.sin_port = htons (sim_port);
+
+    static int lfd;
+    lfd = socket (AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt (lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (lfd < 0 || bind (lfd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen (lfd, 50) < 0) {
+        logMsg ("tcp port %d: %s\n", sim_port, strerror(errno));
+        return (1);
+    }
+    int ufd = socket (AF_INET, SOCK_DGRAM, 0);
+    if (ufd < 0 || bind (ufd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        logMsg ("udp port %d: %s\n", sim_port, strerror(errno));
+        return (1);
+    }
+
+    pthread_t tid;
+    if (pthread_create (&tid, NULL, acceptThread, &lfd)) {
+        logMsg ("accept thread: %s\n", strerror(errno));
+        return (1);
+    }
+    pthread_detach (tid);
+
+    logMsg ("serving port %d latency %d+%d ms bandwidth %ld B/s failing %d%%\n", sim_port, latency_ms,
+                        jitter_ms, bw_Bps, fail_pct);
+    serveUDP (ufd);
+
+    return (0);
+}
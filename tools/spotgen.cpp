@@ -0,0 +1,990 @@
+/* spotgen: stand-in DX cluster and WSJT-X decode source for load testing HamClock.
+ *
+ * serves a DX Spider look-alike cluster on a TCP port and sends WSJT-X UDP packets, each either
+ * synthesized at a given rate or replayed, looping, from a recording. The cluster answers logins,
+ * set/ commands and show/heading well enough for HamClock's own DX pane and for spotfeeds.txt sources.
+ *
+ * with -b spotgen also benchmarks a running HamClock through its web server: a quiet baseline period
+ * followed by a period under load, reporting ingestion rate, spot-to-display latency and the change in
+ * main loop responsiveness. Latency is measured by sending probe spots through the cluster and polling
+ * get_dxspots.txt every POLL_MS until they appear, so it requires the HamClock DX pane to be connected
+ * to this cluster. Ingestion is taken from get_spotfeeds.txt so it requires spotfeeds.txt sources pointing here.
+ * Main loop responsiveness is the round trip time of get_time.txt, which is served once per main loop.
+ *
+ * build: make spotgen
+ * example:
+ *   spotgen -c 7300 -r 200 -u localhost:2237 -R 50 -b localhost:8080 -t 30
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define MAX_CLIENTS     16                      // max simultaneous cluster connections
+#define CLIENT_OBUF     (256*1024)              // max unsent bytes per client before dropping spots
+#define MAX_LINE        200                     // max cluster line length
+#define MAX_PKT         1500                    // max WSJT-X packet length
+#define STATUS_SECS     15                      // WSJT-X Status interval
+#define PROBE_TIMEOUT   10.0                    // max secs to wait for a probe to appear
+#define POLL_MS         20                      // get_dxspots.txt polling interval
+#define RTT_MS          100                     // get_time.txt sampling interval
+#define MAX_SAMPLES     100000                  // max samples of each kind per phase
+#define NODE_CALL       "SPOTGEN"               // our cluster node call
+
+
+// one cluster connection
+typedef struct {
+    int fd;                                     // socket, -1 if unused
+    bool logged_in;                             // set once call has been received
+    char call[20];                              // login call
+    char ibuf[MAX_LINE];                        // partial input line
+    int n_ibuf;                                 // bytes in ibuf
+    char *obuf;                                 // malloced output waiting to be sent
+    int n_obuf;                                 // bytes in obuf
+    unsigned n_dropped;                         // spots dropped because obuf was full
+} Client;
+
+// a set of samples, ms
+typedef struct {
+    double *v;
+    int n;
+} Samples;
+
+// options
+static int cl_port = 7300;                      // cluster port, 0 for none
+static double cl_rate = 10;                     // cluster spots per second
+static const char *cl_file;                     // cluster replay file, else synthesize
+static const char *ux_addr;                     // WSJT-X host:port, else none
+static double ux_rate = 10;                     // WSJT-X decodes per second
+static const char *ux_file;                     // WSJT-X replay capture, else synthesize
+static const char *bm_addr;                     // HamClock web server host:port to benchmark, else none
+static int bm_secs = 30;                        // duration of each benchmark phase
+static double probe_secs = 2;                   // interval between latency probes
+static bool verbose;                            // log traffic
+
+// generator state, shared with the benchmark thread
+static pthread_mutex_t gen_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool gen_loaded;                // whether to generate spots at all
+static volatile bool gen_done;                  // set when benchmark is complete
+static char probe_call[20];                     // probe waiting to be sent, if any
+static double probe_sent;                       // when it was sent, 0 until then
+static unsigned n_cl_sent, n_ux_sent;           // spots sent so far
+static unsigned n_cl_dropped;                   // cluster spots dropped for slow clients
+static int n_clients_up;                        // n logged in clients
+
+static Client clients[MAX_CLIENTS];
+
+// replay recordings
+static char **cl_lines;                         // cluster lines
+static int n_cl_lines;
+static uint8_t *ux_cap;                         // WSJT-X capture, as in wsjtx.cpp unit test
+static long n_ux_cap;
+
+
+
+/* print a message with a time stamp to stderr
+ */
+static void logMsg (const char *fmt, ...)
+{
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    fprintf (stderr, "%ld.%03ld spotgen: ", (long)tv.tv_sec, (long)tv.tv_usec/1000);
+    va_list ap;
+    va_start (ap, fmt);
+    vfprintf (stderr, fmt, ap);
+    va_end (ap);
+}
+
+/* return monotonic time in seconds
+ */
+static double nowSecs()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + 1e-9*ts.tv_nsec);
+}
+
+/* crack host:port, return whether ok
+ */
+static bool crackHostPort (const char *str, char *host, size_t host_len, int *port)
+{
+    const char *colon = strrchr (str, ':');
+    if (!colon || colon == str || (size_t)(colon - str) >= host_len)
+        return (false);
+    memcpy (host, str, colon - str);
+    host[colon - str] = '\0';
+    *port = atoi (colon+1);
+    return (*port > 0 && *port < 65536);
+}
+
+/* resolve host:port into sa, return whether ok
+ */
+static bool resolveAddr (const char *str, int socktype, struct sockaddr_storage *sa, socklen_t *sa_len)
+{
+    char host[100];
+    int port;
+    if (!crackHostPort (str, host, sizeof(host), &port)) {
+        logMsg ("%s: expecting host:port\n", str);
+        return (false);
+    }
+
+    struct addrinfo hints, *aip;
+    memset (&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+    char port_str[10];
+    snprintf (port_str, sizeof(port_str), "%d", port);
+    int e = getaddrinfo (host, port_str, &hints, &aip);
+    if (e) {
+        logMsg ("%s: %s\n", host, gai_strerror(e));
+        return (false);
+    }
+    memcpy (sa, aip->ai_addr, aip->ai_addrlen);
+    *sa_len = aip->ai_addrlen;
+    freeaddrinfo (aip);
+    return (true);
+}
+
+
+
+/*********************************************************************************************
+ *
+ * spot synthesis
+ *
+ */
+
+static const char *dx_pfx[] = {
+    "K1", "W9", "VE3", "DL2", "G4", "F5", "JA1", "VK2", "ZL1", "PY2", "LU1", "ZS6", "EA3", "I2", "OH2",
+    "SM5", "UA3", "BY1", "HL1", "VU2", "EA8", "CT1", "4X1", "ZF2", "KH6", "KL7", "XE1", "CE3", "9A2", "YB0",
+};
+static const char *spotters[] = {
+    "W3LPL-#", "K9LC-#", "DK9IP-#", "VE6WZ-#", "JH7CSU1-#", "EA5WU-#", "KM3T-#", "VK4CT-#",
+};
+static const char *grids[] = {
+    "FN42", "EN61", "FN03", "JO62", "IO91", "JN18", "PM95", "QF56", "RF80", "GG66", "GF05", "KG33",
+    "JN11", "JN45", "KP20", "JO89", "KO85", "OM89", "PM37", "MK82", "IL18", "IM58", "KM72", "EK99",
+    "BL11", "BP51", "EK09", "FF46", "JN75", "OI33",
+};
+static const struct {
+    float kHz;                                  // FT8 dial frequency
+    float cw0, cw1;                             // CW sub-band
+} bands[] = {
+    {  1840,  1800,  1840},
+    {  3573,  3500,  3570},
+    {  7074,  7000,  7040},
+    { 10136, 10100, 10130},
+    { 14074, 14000, 14070},
+    { 18100, 18068, 18095},
+    { 21074, 21000, 21070},
+    { 24915, 24890, 24915},
+    { 28074, 28000, 28070},
+};
+#define NARRAY(a)       (sizeof(a)/sizeof(a[0]))
+
+/* fill call with a plausible unique call for spot number n
+ */
+static void synthCall (unsigned n, char *call, size_t call_len)
+{
+    unsigned p = n % NARRAY(dx_pfx);
+    unsigned s = n / NARRAY(dx_pfx);
+    snprintf (call, call_len, "%s%c%c%c", dx_pfx[p], 'A' + s%26, 'A' + s/26%26, 'A' + s/676%26);
+}
+
+/* format a cluster spot line as sent by DX Spider, with the time in column 70 where HamClock expects it
+ */
+static void formatSpotLine (char *line, size_t line_len, const char *de, float kHz, const char *call,
+const char *comment)
+{
+    time_t t = time(NULL);
+    struct tm *tmp = gmtime (&t);
+    char head[40];
+    int nh = snprintf (head, sizeof(head), "DX de %s:", de);
+    int fw = 24 - nh;
+    if (fw < 9)
+        fw = 9;
+    int n = snprintf (line, line_len, "%s%*.1f  %-12.12s ", head, fw, kHz, call);
+    int cw = 69 - n;                            // comment width that puts time at column 70
+    if (cw < 1)
+        cw = 1;
+    snprintf (line + n, line_len - n, "%-*.*s %02d%02dZ\r\n", cw, cw, comment, tmp->tm_hour, tmp->tm_min);
+}
+
+/* synthesize cluster spot number n
+ */
+static void synthClusterSpot (unsigned n, char *line, size_t line_len)
+{
+    char call[20], de[20], comment[40];
+    synthCall (n, call, sizeof(call));
+    snprintf (de, sizeof(de), "%s", spotters[n % NARRAY(spotters)]);
+    char *hash = strchr (de, '#');
+    if (hash)
+        *hash = '1' + n % 3;
+
+    int b = (n * 7) % NARRAY(bands);
+    float kHz;
+    if (n % 3 == 0) {
+        kHz = bands[b].kHz + 0.1F*(n % 30);
+        snprintf (comment, sizeof(comment), "FT8 %+d dB %d Hz", -20 + (int)(n % 30), 300 + (int)(n*37 % 2400));
+    } else {
+        kHz = bands[b].cw0 + 0.1F*(n % (int)(10*(bands[b].cw1 - bands[b].cw0)));
+        snprintf (comment, sizeof(comment), "CW %d dB %d WPM CQ", 5 + (int)(n % 30), 18 + (int)(n % 15));
+    }
+    formatSpotLine (line, line_len, de, kHz, call, comment);
+}
+
+static void putU32 (uint8_t *&bp, uint32_t x)
+{
+    *bp++ = x >> 24; *bp++ = x >> 16; *bp++ = x >> 8; *bp++ = x;
+}
+
+static void putStr (uint8_t *&bp, const char *s)
+{
+    uint32_t n = strlen(s);
+    putU32 (bp, n);
+    memcpy (bp, s, n);
+    bp += n;
+}
+
+/* build a WSJT-X Status packet, return its length
+ */
+static int synthStatus (uint8_t *pkt)
+{
+    uint8_t *bp = pkt;
+    putU32 (bp, 0xadbccbdaU);
+    putU32 (bp, 2);
+    putU32 (bp, 1);                             // Status
+    putStr (bp, "WSJT-X");
+    putU32 (bp, 0); putU32 (bp, 14074000);      // dial Hz
+    putStr (bp, "FT8"); putStr (bp, ""); putStr (bp, "-10"); putStr (bp, "FT8");
+    *bp++ = 0; *bp++ = 0; *bp++ = 1;            // Tx enabled, transmitting, decoding
+    putU32 (bp, 1500); putU32 (bp, 1500);       // Rx and Tx DF
+    putStr (bp, "W1AW"); putStr (bp, "FN31"); putStr (bp, "");
+    return (bp - pkt);
+}
+
+/* build WSJT-X Decode packet number n as a CQ with grid, return its length
+ */
+static int synthDecode (unsigned n, uint8_t *pkt)
+{
+    uint8_t *bp = pkt;
+    putU32 (bp, 0xadbccbdaU);
+    putU32 (bp, 2);
+    putU32 (bp, 2);                             // Decode
+    putStr (bp, "WSJT-X");
+    *bp++ = 1;                                  // new
+    time_t t = time(NULL);
+    putU32 (bp, (t % 86400) / 15 * 15000);      // ms since midnight, start of period
+    putU32 (bp, (uint32_t)(-20 + (int)(n % 30)));
+    double dt = 0.1*(n % 7);
+    uint64_t dtx;
+    memcpy (&dtx, &dt, 8);
+    putU32 (bp, dtx >> 32); putU32 (bp, dtx);
+    putU32 (bp, 200 + (n*37) % 2800);           // DF
+    putStr (bp, "~");
+    char call[20], msg[64];
+    synthCall (n, call, sizeof(call));
+    snprintf (msg, sizeof(msg), "CQ %s %s", call, grids[n % NARRAY(grids)]);
+    putStr (bp, msg);
+    *bp++ = 0; *bp++ = 0;                       // low confidence, off air
+    return (bp - pkt);
+}
+
+
+
+/*********************************************************************************************
+ *
+ * replay recordings
+ *
+ */
+
+/* read cluster lines from fn, return whether any
+ */
+static bool loadClusterFile (const char *fn)
+{
+    FILE *fp = fopen (fn, "r");
+    if (!fp) {
+        logMsg ("%s: %s\n", fn, strerror(errno));
+        return (false);
+    }
+    char line[MAX_LINE];
+    while (fgets (line, sizeof(line)-1, fp)) {
+        size_t ll = strlen (line);
+        while (ll > 0 && (line[ll-1] == '\n' || line[ll-1] == '\r'))
+            line[--ll] = '\0';
+        if (ll == 0)
+            continue;
+        strcat (line, "\r\n");
+        cl_lines = (char **) realloc (cl_lines, (n_cl_lines+1)*sizeof(char*));
+        cl_lines[n_cl_lines++] = strdup (line);
+    }
+    fclose (fp);
+    if (n_cl_lines == 0)
+        logMsg ("%s: no lines\n", fn);
+    return (n_cl_lines > 0);
+}
+
+/* read a WSJT-X capture of 4-byte big-endian lengths each followed by a packet, return whether ok
+ */
+static bool loadWSJTXFile (const char *fn)
+{
+    FILE *fp = fopen (fn, "r");
+    if (!fp) {
+        logMsg ("%s: %s\n", fn, strerror(errno));
+        return (false);
+    }
+    fseek (fp, 0, SEEK_END);
+    n_ux_cap = ftell (fp);
+    rewind (fp);
+    ux_cap = (uint8_t *) malloc (n_ux_cap > 0 ? n_ux_cap : 1);
+    bool ok = n_ux_cap > 4 && fread (ux_cap, 1, n_ux_cap, fp) == (size_t)n_ux_cap;
+    fclose (fp);
+    if (!ok)
+        logMsg ("%s: empty or unreadable\n", fn);
+    return (ok);
+}
+
+/* copy the next packet from the capture at *offp into pkt, wrapping at end, return its length
+ */
+static int nextCapturePacket (long *offp, uint8_t *pkt)
+{
+    for (int tries = 0; tries < 2; tries++) {
+        if (*offp + 4 <= n_ux_cap) {
+            const uint8_t *lp = &ux_cap[*offp];
+            uint32_t len = ((uint32_t)lp[0] << 24) | ((uint32_t)lp[1] << 16) | ((uint32_t)lp[2] << 8) | lp[3];
+            if (len <= MAX_PKT && *offp + 4 + len <= n_ux_cap) {
+                memcpy (pkt, lp + 4, len);
+                *offp += 4 + len;
+                return (len);
+            }
+        }
+        *offp = 0;
+    }
+    return (0);
+}
+
+
+
+/*********************************************************************************************
+ *
+ * cluster server
+ *
+ */
+
+/* queue str for client c, return false if it did not fit.
+ */
+static bool clientSend (Client &c, const char *str)
+{
+    int n = strlen (str);
+    if (c.n_obuf + n > CLIENT_OBUF)
+        return (false);
+    memcpy (c.obuf + c.n_obuf, str, n);
+    c.n_obuf += n;
+    return (true);
+}
+
+/* queue a DX Spider style prompt for client c
+ */
+static void clientPrompt (Client &c)
+{
+    char buf[100];
+    time_t t = time(NULL);
+    struct tm *tmp = gmtime (&t);
+    char date[30];
+    strftime (date, sizeof(date), "%d-%b-%Y %H%MZ", tmp);
+    snprintf (buf, sizeof(buf), "%s de %s %s dxspider >\r\n", c.call, NODE_CALL, date);
+    clientSend (c, buf);
+}
+
+static void clientClose (Client &c)
+{
+    if (c.logged_in)
+        n_clients_up--;
+    logMsg ("cluster: %s disconnected after %u dropped spots\n", c.logged_in ? c.call : "client",
+                c.n_dropped);
+    close (c.fd);
+    free (c.obuf);
+    memset (&c, 0, sizeof(c));
+    c.fd = -1;
+}
+
+/* respond to one complete line from client c
+ */
+static void clientLine (Client &c, char *line)
+{
+    if (verbose)
+        logMsg ("cluster: < %s\n", line);
+
+    if (!c.logged_in) {
+        // first line is call
+        snprintf (c.call, sizeof(c.call), "%.*s", (int)strcspn (line, " \t"), line);
+        if (c.call[0] == '\0')
+            return;
+        char buf[200];
+        snprintf (buf, sizeof(buf), "Hello %s, this is %s in test, running DXSpider look-alike\r\n",
+                        c.call, NODE_CALL);
+        clientSend (c, buf);
+        clientPrompt (c);
+        c.logged_in = true;
+        n_clients_up++;
+        logMsg ("cluster: %s logged in\n", c.call);
+        return;
+    }
+
+    // show/heading gets a made-up but consistent answer, all else just a prompt
+    char call[20];
+    if (sscanf (line, "show/heading %19s", call) == 1 || sscanf (line, "sh/h %19s", call) == 1) {
+        unsigned h = 0;
+        for (char *cp = call; *cp; cp++)
+            h = 31*h + *cp;
+        char buf[200];
+        snprintf (buf, sizeof(buf), "%s Somewhere: %u degs - dist: %u mi, %u km Reciprocal heading: %u degs\r\n",
+                        call, h % 360, 100 + h % 9000, (100 + h % 9000)*1609/1000, (h + 180) % 360);
+        clientSend (c, buf);
+    }
+    clientPrompt (c);
+}
+
+/* read whatever is available from client c, respond to each complete line
+ */
+static void clientRead (Client &c)
+{
+    char buf[1024];
+    int n = read (c.fd, buf, sizeof(buf));
+    if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        clientClose (c);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        char ch = buf[i];
+        if (ch == '\r')
+            continue;
+        if (ch == '\n') {
+            c.ibuf[c.n_ibuf] = '\0';
+            clientLine (c, c.ibuf);
+            c.n_ibuf = 0;
+        } else if (c.n_ibuf < MAX_LINE-1)
+            c.ibuf[c.n_ibuf++] = ch;
+    }
+}
+
+/* send as much queued output to client c as it will take
+ */
+static void clientWrite (Client &c)
+{
+    int n = write (c.fd, c.obuf, c.n_obuf);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EINTR)
+            clientClose (c);
+        return;
+    }
+    memmove (c.obuf, c.obuf + n, c.n_obuf - n);
+    c.n_obuf -= n;
+}
+
+/* accept a new client on the listening socket
+ */
+static void clientAccept (int lfd)
+{
+    int fd = accept (lfd, NULL, NULL);
+    if (fd < 0)
+        return;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client &c = clients[i];
+        if (c.fd < 0) {
+            fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+            int one = 1;
+            setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            c.fd = fd;
+            c.obuf = (char *) malloc (CLIENT_OBUF);
+            clientSend (c, "login: ");
+            logMsg ("cluster: new connection\n");
+            return;
+        }
+    }
+    logMsg ("cluster: too many connections\n");
+    close (fd);
+}
+
+/* queue line for every logged in client, counting drops for any that are backed up
+ */
+static void broadcastLine (const char *line)
+{
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client &c = clients[i];
+        if (c.fd >= 0 && c.logged_in && !clientSend (c, line)) {
+            c.n_dropped++;
+            n_cl_dropped++;
+        }
+    }
+}
+
+/* create the listening socket, return fd or -1
+ */
+static int listenCluster (int port)
+{
+    int fd = socket (AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        logMsg ("socket: %s\n", strerror(errno));
+        return (-1);
+    }
+    int one = 1;
+    setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in sa;
+    memset (&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl (INADDR_ANY);
+    sa.sin_port = htons (port);
+    if (bind (fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen (fd, 5) < 0) {
+        logMsg ("cluster port %d: %s\n", port, strerror(errno));
+        close (fd);
+        return (-1);
+    }
+    return (fd);
+}
+
+/* run the cluster server and WSJT-X sender until gen_done.
+ */
+static void generate (int lfd, int ufd, const struct sockaddr_storage *ua, socklen_t ua_len)
+{
+    double cl_next = nowSecs(), ux_next = cl_next, status_next = cl_next;
+    unsigned cl_n = 0, ux_n = 0;
+    long ux_off = 0;
+
+    while (!gen_done) {
+
+        // wait for io or the next spot due, at most 10 ms
+        fd_set rfds, wfds;
+        FD_ZERO (&rfds);
+        FD_ZERO (&wfds);
+        int maxfd = -1;
+        if (lfd >= 0) {
+            FD_SET (lfd, &rfds);
+            maxfd = lfd;
+        }
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            Client &c = clients[i];
+            if (c.fd < 0)
+                continue;
+            FD_SET (c.fd, &rfds);
+            if (c.n_obuf > 0)
+                FD_SET (c.fd, &wfds);
+            if (c.fd > maxfd)
+                maxfd = c.fd;
+        }
+        struct timeval tv = {0, 10000};
+        if (select (maxfd+1, &rfds, &wfds, NULL, &tv) < 0) {
+            if (errno == EINTR)
+                continue;
+            logMsg ("select: %s\n", strerror(errno));
+            exit (1);
+        }
+
+        pthread_mutex_lock (&gen_lock);
+
+        // service connections
+        if (lfd >= 0 && FD_ISSET (lfd, &rfds))
+            clientAccept (lfd);
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            Client &c = clients[i];
+            if (c.fd >= 0 && FD_ISSET (c.fd, &rfds))
+                clientRead (c);
+            if (c.fd >= 0 && FD_ISSET (c.fd, &wfds))
+                clientWrite (c);
+        }
+
+        double t = nowSecs();
+
+        // send probe, if any, ahead of everything else
+        if (probe_call[0] && probe_sent == 0) {
+            char line[MAX_LINE];
+            formatSpotLine (line, sizeof(line), NODE_CALL, 14025.0F, probe_call, "probe");
+            broadcastLine (line);
+            probe_sent = nowSecs();
+        }
+
+        // send cluster spots due, catching up if behind but not by more than 1 second worth
+        if (!gen_loaded || cl_rate <= 0 || lfd < 0)
+            cl_next = t;
+        else if (cl_next < t - 1)
+            cl_next = t - 1;
+        while (cl_next <= t && gen_loaded && cl_rate > 0 && lfd >= 0) {
+            char line[MAX_LINE];
+            if (cl_file)
+                snprintf (line, sizeof(line), "%s", cl_lines[cl_n % n_cl_lines]);
+            else
+                synthClusterSpot (cl_n, line, sizeof(line));
+            cl_n++;
+            if (verbose)
+                logMsg ("cluster: > %s", line);
+            broadcastLine (line);
+            n_cl_sent++;
+            cl_next += 1/cl_rate;
+        }
+
+        // send WSJT-X packets due, same
+        if (!gen_loaded || ux_rate <= 0 || ufd < 0)
+            ux_next = t;
+        else if (ux_next < t - 1)
+            ux_next = t - 1;
+        while (ux_next <= t && gen_loaded && ux_rate > 0 && ufd >= 0) {
+            uint8_t pkt[MAX_PKT];
+            int len;
+            if (ux_file)
+                len = nextCapturePacket (&ux_off, pkt);
+            else if (t >= status_next) {
+                len = synthStatus (pkt);
+                status_next = t + STATUS_SECS;
+            } else
+                len = synthDecode (ux_n++, pkt);
+            if (len > 0 && sendto (ufd, pkt, len, 0, (const struct sockaddr *)ua, ua_len) < 0 && verbose)
+                logMsg ("wsjtx: %s\n", strerror(errno));
+            n_ux_sent++;
+            ux_next += 1/ux_rate;
+        }
+
+        pthread_mutex_unlock (&gen_lock);
+    }
+}
+
+
+
+/*********************************************************************************************
+ *
+ * benchmark
+ *
+ */
+
+/* perform one HTTP GET of path from the HamClock web server, return malloced reply body or NULL.
+ * set *rtt_ms to the total round trip time.
+ */
+static char *httpGet (const char *path, double *rtt_ms)
+{
+    struct sockaddr_storage sa;
+    socklen_t sa_len;
+    if (!resolveAddr (bm_addr, SOCK_STREAM, &sa, &sa_len))
+        return (NULL);
+
+    double t0 = nowSecs();
+    int fd = socket (sa.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+        return (NULL);
+    struct timeval tv = {10, 0};
+    setsockopt (fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect (fd, (struct sockaddr *)&sa, sa_len) < 0) {
+        close (fd);
+        return (NULL);
+    }
+    char req[200];
+    snprintf (req, sizeof(req), "GET /%s HTTP/1.0\r\n\r\n", path);
+    if (write (fd, req, strlen(req)) < 0) {
+        close (fd);
+        return (NULL);
+    }
+
+    size_t n_reply = 0, reply_size = 4096;
+    char *reply = (char *) malloc (reply_size);
+    int n;
+    while ((n = read (fd, reply + n_reply, reply_size - n_reply - 1)) > 0) {
+        n_reply += n;
+        if (n_reply + 1 >= reply_size)
+            reply = (char *) realloc (reply, reply_size *= 2);
+    }
+    close (fd);
+    reply[n_reply] = '\0';
+    *rtt_ms = 1000*(nowSecs() - t0);
+
+    // return just the body
+    char *body = strstr (reply, "\r\n\r\n");
+    if (!body || strncmp (reply, "HTTP/1.0 200", 12)) {
+        free (reply);
+        return (NULL);
+    }
+    memmove (reply, body + 4, n_reply - (body + 4 - reply) + 1);
+    return (reply);
+}
+
+/* return the total New column of get_spotfeeds.txt, or -1 if not available
+ */
+static long feedsNew()
+{
+    double rtt;
+    char *body = httpGet ("get_spotfeeds.txt", &rtt);
+    if (!body)
+        return (-1);
+    long total = 0;
+    for (char *lp = strtok (body, "\n"); lp; lp = strtok (NULL, "\n")) {
+        char name[100], up[4];
+        unsigned conns, lines, spots, added;
+        if (lp[0] != '#' && sscanf (lp, "%99s %3s %u %u %u %u", name, up, &conns, &lines, &spots, &added) == 6)
+            total += added;
+    }
+    free (body);
+    return (total);
+}
+
+/* return the MaxWDDT line of get_sys.txt, or -1 if not available
+ */
+static long maxWDDT()
+{
+    double rtt;
+    char *body = httpGet ("get_sys.txt", &rtt);
+    if (!body)
+        return (-1);
+    char *wd = strstr (body, "MaxWDDT");
+    long v = wd ? atol (wd + 7) : -1;
+    free (body);
+    return (v);
+}
+
+static void addSample (Samples &s, double v)
+{
+    if (!s.v)
+        s.v = (double *) malloc (MAX_SAMPLES * sizeof(double));
+    if (s.n < MAX_SAMPLES)
+        s.v[s.n++] = v;
+}
+
+static int cmpDouble (const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+/* return the given percentile of s, sorting it in place, or 0 if empty
+ */
+static double percentile (Samples &s, double pct)
+{
+    if (s.n == 0)
+        return (0);
+    qsort (s.v, s.n, sizeof(double), cmpDouble);
+    int i = (int)(pct/100*(s.n-1) + 0.5);
+    return (s.v[i]);
+}
+
+/* run one benchmark phase of bm_secs, sampling get_time.txt round trips into rtt and, if probing,
+ * probe latencies into lat. n_probes is set to the number of probes sent.
+ */
+static void runPhase (Samples &rtt, Samples &lat, bool probing, int *n_probes)
+{
+    static unsigned probe_n;
+    double t_end = nowSecs() + bm_secs;
+    double next_rtt = 0, next_probe = nowSecs() + probe_secs/2;
+    *n_probes = 0;
+
+    while (nowSecs() < t_end) {
+        double t = nowSecs();
+
+        if (t >= next_rtt) {
+            double ms;
+            char *body = httpGet ("get_time.txt", &ms);
+            if (body) {
+                addSample (rtt, ms);
+                free (body);
+            }
+            next_rtt = t + RTT_MS/1000.0;
+        }
+
+        if (probing && t >= next_probe) {
+            // queue a new probe, unique call each time
+            pthread_mutex_lock (&gen_lock);
+            snprintf (probe_call, sizeof(probe_call), "N0Z%c%c%c", 'A' + probe_n%26, 'A' + probe_n/26%26,
+                            'A' + probe_n/676%26);
+            probe_n++;
+            probe_sent = 0;
+            pthread_mutex_unlock (&gen_lock);
+            (*n_probes)++;
+
+            // poll the DX pane until it shows up or give up
+            double t_sent = 0;
+            double t_give_up = t + PROBE_TIMEOUT < t_end ? t + PROBE_TIMEOUT : t_end;
+            while (nowSecs() < t_give_up) {
+                usleep (POLL_MS*1000);
+                pthread_mutex_lock (&gen_lock);
+                t_sent = probe_sent;
+                pthread_mutex_unlock (&gen_lock);
+                if (t_sent == 0)
+                    continue;
+                double ms;
+                char *body = httpGet ("get_dxspots.txt", &ms);
+                bool seen = body && strstr (body, probe_call);
+                free (body);
+                if (seen) {
+                    addSample (lat, 1000*(nowSecs() - t_sent));
+                    break;
+                }
+            }
+            pthread_mutex_lock (&gen_lock);
+            probe_call[0] = '\0';
+            pthread_mutex_unlock (&gen_lock);
+            next_probe = nowSecs() + probe_secs;
+        }
+
+        usleep (5000);
+    }
+}
+
+/* benchmark thread: baseline phase without load, then a phase with load, then report and stop.
+ */
+static void *benchThread (void *unused)
+{
+    (void) unused;
+    Samples base_rtt = {0}, base_lat = {0}, load_rtt = {0}, load_lat = {0};
+    int n_probes;
+
+    // baseline, probes only measure latency without competing spots
+    logMsg ("bench: baseline for %d s\n", bm_secs);
+    long wd0 = maxWDDT();
+    runPhase (base_rtt, base_lat, true, &n_probes);
+    int base_probes = n_probes;
+
+    // loaded
+    logMsg ("bench: load for %d s\n", bm_secs);
+    pthread_mutex_lock (&gen_lock);
+    unsigned cl0 = n_cl_sent, ux0 = n_ux_sent, dr0 = n_cl_dropped;
+    gen_loaded = true;
+    pthread_mutex_unlock (&gen_lock);
+    long new0 = feedsNew();
+    double t0 = nowSecs();
+    runPhase (load_rtt, load_lat, true, &n_probes);
+    long new1 = feedsNew();
+    double dt = nowSecs() - t0;
+    pthread_mutex_lock (&gen_lock);
+    gen_loaded = false;
+    unsigned cl1 = n_cl_sent, ux1 = n_ux_sent, dr1 = n_cl_dropped;
+    int n_up = n_clients_up;
+    pthread_mutex_unlock (&gen_lock);
+    long wd1 = maxWDDT();
+
+    // report
+    printf ("Clients     %d\n", n_up);
+    printf ("ClusterSent %u  %.1f/s\n", cl1 - cl0, (cl1 - cl0)/dt);
+    printf ("ClusterDrop %u\n", dr1 - dr0);
+    printf ("WSJTXSent   %u  %.1f/s\n", ux1 - ux0, (ux1 - ux0)/dt);
+    if (new0 >= 0 && new1 >= 0)
+        printf ("Ingested    %ld  %.1f/s\n", new1 - new0, (new1 - new0)/dt);
+    else
+        printf ("Ingested    n/a, no spot feeds\n");
+    printf ("#            p50 ms   p95 ms   max ms        n\n");
+    printf ("BaseLatency %8.1f %8.1f %8.1f %4d/%-4d\n", percentile(base_lat,50), percentile(base_lat,95),
+                        percentile(base_lat,100), base_lat.n, base_probes);
+    printf ("LoadLatency %8.1f %8.1f %8.1f %4d/%-4d\n", percentile(load_lat,50), percentile(load_lat,95),
+                        percentile(load_lat,100), load_lat.n, n_probes);
+    printf ("BaseLoopRTT %8.1f %8.1f %8.1f %8d\n", percentile(base_rtt,50), percentile(base_rtt,95),
+                        percentile(base_rtt,100), base_rtt.n);
+    printf ("LoadLoopRTT %8.1f %8.1f %8.1f %8d\n", percentile(load_rtt,50), percentile(load_rtt,95),
+                        percentile(load_rtt,100), load_rtt.n);
+    printf ("LoopImpact  %+8.1f %+8.1f %+8.1f\n", percentile(load_rtt,50) - percentile(base_rtt,50),
+                        percentile(load_rtt,95) - percentile(base_rtt,95),
+                        percentile(load_rtt,100) - percentile(base_rtt,100));
+    printf ("MaxWDDT     %ld -> %ld ms\n", wd0, wd1);
+    fflush (stdout);
+
+    gen_done = true;
+    return (NULL);
+}
+
+
+
+static void usage (const char *me)
+{
+    fprintf (stderr, "Usage: %s [options]\n", me);
+    fprintf (stderr, "  -c port      serve cluster on this TCP port, 0 for none; default %d\n", cl_port);
+    fprintf (stderr, "  -r rate      cluster spots per second; default %g\n", cl_rate);
+    fprintf (stderr, "  -f file      replay cluster lines from file instead of synthesizing\n");
+    fprintf (stderr, "  -u host:port send WSJT-X packets to this UDP address; default none\n");
+    fprintf (stderr, "  -R rate      WSJT-X packets per second; default %g\n", ux_rate);
+    fprintf (stderr, "  -w file      replay WSJT-X capture instead of synthesizing\n");
+    fprintf (stderr, "  -b host:port benchmark the HamClock web server at this address then exit\n");
+    fprintf (stderr, "  -t secs      duration of each benchmark phase; default %d\n", bm_secs);
+    fprintf (stderr, "  -p secs      interval between latency probes; default %g\n", probe_secs);
+    fprintf (stderr, "  -v           log all traffic\n");
+    exit (1);
+}
+
+int main (int ac, char *av[])
+{
+    int opt;
+    while ((opt = getopt (ac, av, "c:r:f:u:R:w:b:t:p:v")) != -1) {
+        switch (opt) {
+        case 'c': cl_port = atoi (optarg); break;
+        case 'r': cl_rate = atof (optarg); break;
+        case 'f': cl_file = optarg; break;
+        case 'u': ux_addr = optarg; break;
+        case 'R': ux_rate = atof (optarg); break;
+        case 'w': ux_file = optarg; break;
+        case 'b': bm_addr = optarg; break;
+        case 't': bm_secs = atoi (optarg); break;
+        case 'p': probe_secs = atof (optarg); break;
+        case 'v': verbose = true; break;
+        default: usage (av[0]);
+        }
+    }
+    if (optind != ac || bm_secs <= 0 || probe_secs <= 0)
+        usage (av[0]);
+
+    signal (SIGPIPE, SIG_IGN);
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    if (cl_file && !loadClusterFile (cl_file))
+        return (1);
+    if (ux_file && !loadWSJTXFile (ux_file))
+        return (1);
+
+    int lfd = -1;
+    if (cl_port > 0 && (lfd = listenCluster (cl_port)) < 0)
+        return (1);
+
+    int ufd = -1;
+    struct sockaddr_storage ua;
+    socklen_t ua_len = 0;
+    if (ux_addr) {
+        if (!resolveAddr (ux_addr, SOCK_DGRAM, &ua, &ua_len))
+            return (1);
+        ufd = socket (ua.ss_family, SOCK_DGRAM, 0);
+        if (ufd < 0) {
+            logMsg ("socket: %s\n", strerror(errno));
+            return (1);
+        }
+    }
+
+    if (lfd < 0 && ufd < 0) {
+        logMsg ("nothing to do\n");
+        return (1);
+    }
+
+    // without a benchmark just generate forever
+    if (bm_addr) {
+        pthread_t tid;
+        if (pthread_create (&tid, NULL, benchThread, NULL)) {
+            logMsg ("bench thread failed: %s\n", strerror(errno));
+            return (1);
+        }
+        pthread_detach (tid);
+    } else
+        gen_loaded = true;
+
+    logMsg ("cluster port %d at %g/s, wsjtx %s at %g/s\n", cl_port, cl_rate, ux_addr ? ux_addr : "none",
+                        ux_rate);
+    generate (lfd, ufd, &ua, ua_len);
+
+    return (0);
+}
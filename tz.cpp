@@ -11,6 +11,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
 #include <math.h>
 
 signed char pgm_read_byte (const signed char *p)
@@ -20,9 +26,32 @@ signed char pgm_read_byte (const signed char *p)
 #define	PROGMEM
 
 typedef struct {
+    float lat, lng;
     float lat_d, lng_d;
 } LatLong;
 
+// no prefixes so every cell may take any nearby zone
+#define MAX_PREF_LEN 4
+static bool nearestPrefix (const LatLong &ll, char prefix[MAX_PREF_LEN+1])
+{
+    (void) ll; (void) prefix;
+    return (false);
+}
+
+#define _USE_UNIX
+#define _FX(x) x
+#define NARRAY(a) (sizeof(a)/sizeof(a[0]))
+#define deg2rad(d) ((M_PI/180)*(d))
+#define nowWO() time(NULL)
+static struct {
+    void printf (const char *fmt, ...) {
+        va_list ap;
+        va_start (ap, fmt);
+        vprintf (fmt, ap);
+        va_end (ap);
+    }
+} Serial;
+
 #else
 
 #include "HamClock.h"
@@ -6838,17 +6867,652 @@ static const signed char tzmap[180][360] PROGMEM = {
     },
 };
 
-/* given a LatLong return nominal timezone seconds from UTC.
+/* return tzmap row and column for the given location
  */
-int32_t getTZ (const LatLong &ll)
+static void tzmapCell (const LatLong &ll, int &row, int &col)
 {
     // make absolutely certain of range
     int lat = ll.lat_d < -89 ? -89 : (ll.lat_d > 89 ? 89 : ll.lat_d);
-    int lng = fmod((ll.lng_d+180+3600),360);
+    row = lat + 89;
+    col = fmod((ll.lng_d+180+3600),360);
+}
+
+#if defined(_USE_UNIX)
+
+/* on UNIX each tzmap cell is also resolved to a named zone from the system zoneinfo so the real offset,
+ * including daylight time, can be reported. The country of each cell is taken from the nearest amateur
+ * prefix and the cell is given the nearest zone.tab location in that country whose standard offset agrees
+ * with the nominal tzmap offset there; cells whose country is not known, such as at sea, fall back to the
+ * nearest such location in any country. A few zones that span wide areas get extra locations so their
+ * outskirts are not claimed by a small neighbor of the same country. The resulting zone of each cell is
+ * run-length encoded along each row, so a lookup is a short binary search within one row.
+ *
+ * offsets are found by reading the TZif file of each zone directly, never by changing TZ, because setenv()
+ * is not safe once other threads may be calling getenv().
+ */
+
+#define TZ_DIR          "/usr/share/zoneinfo"
+#define TZ_ZONETAB      TZ_DIR "/zone.tab"
+#define TZ_MAXNAME      40                      // max zone name length, including EOS
+#define TZ_MAXDIST      15                      // max distance from a zone location to claim a cell, degs
+#define TZ_MAXCDIST     45                      // same but when the zone is known to be in the same country
+#define TZ_MAXFILE      100000                  // largest TZif file we expect
+#define TZ_NOZONE       0xffff                  // zone index for a cell not near any suitable zone
+#define TZ_NROWS        NARRAY(tzmap)           // n tzmap rows
+#define TZ_NCOLS        NARRAY(tzmap[0])        // n tzmap columns
+
+typedef struct {
+    char name[TZ_MAXNAME];                      // eg, America/Denver
+    char cc[3];                                 // ISO 3166 country code
+    int32_t off0, off1;                         // offsets in January and July, secs
+    int32_t cur_off;                            // offset at cur_t0 .. cur_t1
+    time_t cur_t0, cur_t1;                      // range over which cur_off is known to be valid
+} TZZone;
+
+typedef struct {
+    float x, y, z;                              // location as a unit vector
+    uint16_t zone;                              // tz_zones index
+} TZPoint;
+
+typedef struct {
+    uint16_t col;                               // first tzmap column of this run
+    uint16_t zone;                              // tz_zones index, or TZ_NOZONE
+} TZRun;
+
+static TZZone *tz_zones;                        // malloced list of zones
+static uint16_t n_tz_zones;                     // n in tz_zones
+static TZPoint *tz_points;                      // malloced zone locations, at least one per zone
+static uint16_t n_tz_points;                    // n in tz_points
+static TZRun *tz_runs;                          // malloced runs, all rows
+static uint16_t tz_row_run[TZ_NROWS+1];         // first tz_runs index of each row, plus end
+static bool tz_ready;                           // set once tried to build, even if failed
+
+/* ISO 3166 country of each prefix in prefixes.cpp. The longest entry that begins the prefix wins so
+ * the exceptions follow the general entries they override. Prefixes of disputed or uninhabited places
+ * are omitted, which leaves their cells free to take any nearby zone.
+ */
+typedef struct {
+    char prefix[MAX_PREF_LEN+1];
+    char cc[3];
+} TZPrefixCC;
+static const TZPrefixCC tz_prefcc[] = {
+    {"1A", "IT"}, {"3A", "MC"}, {"3B", "MU"}, {"3C", "GQ"}, {"3D2", "FJ"}, {"3DA", "SZ"}, {"3V", "TN"},
+    {"3W", "VN"}, {"3X", "GN"}, {"3Y", "BV"}, {"3Y0", "AQ"}, {"4J", "AZ"}, {"4L", "GE"}, {"4O", "ME"},
+    {"4S", "LK"}, {"4U1i", "CH"}, {"4U1u", "US"}, {"4W", "TL"}, {"4X", "IL"}, {"5A", "LY"}, {"5B", "CY"},
+    {"5H", "TZ"}, {"5N", "NG"}, {"5R", "MG"}, {"5T", "MR"}, {"5U", "NE"}, {"5V", "TG"}, {"5W", "WS"},
+    {"5X", "UG"}, {"5Z", "KE"}, {"6W", "SN"}, {"6Y", "JM"}, {"7O", "YE"}, {"7P", "LS"}, {"7Q", "MW"},
+    {"7X", "DZ"}, {"8P", "BB"}, {"8Q", "MV"}, {"8R", "GY"}, {"9A", "HR"}, {"9G", "GH"}, {"9H", "MT"},
+    {"9J", "ZM"}, {"9K", "KW"}, {"9L", "SL"}, {"9M", "MY"}, {"9N", "NP"}, {"9Q", "CD"}, {"9U", "BI"},
+    {"9V", "SG"}, {"9X", "RW"}, {"9Y", "TT"},
+    {"A2", "BW"}, {"A3", "TO"}, {"A4", "OM"}, {"A5", "BT"}, {"A6", "AE"}, {"A7", "QA"}, {"A9", "BH"},
+    {"AP", "PK"}, {"BV", "TW"}, {"BY", "CN"}, {"C2", "NR"}, {"C3", "AD"}, {"C5", "GM"}, {"C6", "BS"},
+    {"C9", "MZ"}, {"CE", "CL"}, {"CN", "MA"}, {"CO", "CU"}, {"CP", "BO"}, {"CT", "PT"}, {"CU", "PT"},
+    {"CX", "UY"}, {"CY", "CA"}, {"D2", "AO"}, {"D4", "CV"}, {"D6", "KM"}, {"DL", "DE"}, {"DU", "PH"},
+    {"E3", "ER"}, {"E4", "PS"}, {"E5", "CK"}, {"E6", "NU"}, {"E7", "BA"}, {"EA", "ES"}, {"EI", "IE"},
+    {"EK", "AM"}, {"EL", "LR"}, {"EP", "IR"}, {"ER", "MD"}, {"ES", "EE"}, {"ET", "ET"}, {"EU", "BY"},
+    {"EX", "KG"}, {"EY", "TJ"}, {"EZ", "TM"},
+    {"F", "FR"}, {"FG", "GP"}, {"FH", "YT"}, {"FJ", "BL"}, {"FK", "NC"}, {"FM", "MQ"}, {"FO", "PF"},
+    {"FP", "PM"}, {"FR", "RE"}, {"FS", "MF"}, {"FT", "TF"}, {"FW", "WF"}, {"FY", "GF"},
+    {"G", "GB"}, {"GD", "IM"}, {"GJ", "JE"}, {"GU", "GG"},
+    {"H4", "SB"}, {"HA", "HU"}, {"HB", "CH"}, {"HB0", "LI"}, {"HC", "EC"}, {"HH", "HT"}, {"HI", "DO"},
+    {"HK", "CO"}, {"HL", "KR"}, {"HP", "PA"}, {"HR", "HN"}, {"HS", "TH"}, {"HV", "VA"}, {"HZ", "SA"},
+    {"I", "IT"}, {"J2", "DJ"}, {"J3", "GD"}, {"J5", "GW"}, {"J6", "LC"}, {"J7", "DM"}, {"J8", "VC"},
+    {"JA", "JP"}, {"JD", "JP"}, {"JT", "MN"}, {"JW", "SJ"}, {"JX", "SJ"}, {"JY", "JO"},
+    {"K", "US"}, {"KG4", "CU"}, {"KH0", "MP"}, {"KH1", "UM"}, {"KH2", "GU"}, {"KH3", "UM"},
+    {"KH4", "UM"}, {"KH5", "UM"}, {"KH8", "AS"}, {"KH9", "UM"}, {"KP1", "UM"}, {"KP2", "VI"},
+    {"KP4", "PR"}, {"KP5", "PR"},
+    {"LA", "NO"}, {"LU", "AR"}, {"LX", "LU"}, {"LY", "LT"}, {"LZ", "BG"},
+    {"OA", "PE"}, {"OD", "LB"}, {"OE", "AT"}, {"OH", "FI"}, {"OH0", "AX"}, {"OJ0", "AX"}, {"OK", "CZ"},
+    {"OM", "SK"}, {"ON", "BE"}, {"OX", "GL"}, {"OY", "FO"}, {"OZ", "DK"},
+    {"P2", "PG"}, {"P4", "AW"}, {"P5", "KP"}, {"PA", "NL"}, {"PJ2", "CW"}, {"PJ4", "BQ"}, {"PJ5", "BQ"},
+    {"PJ7", "SX"}, {"PP", "BR"}, {"PQ", "BR"}, {"PR", "BR"}, {"PS", "BR"}, {"PT", "BR"}, {"PV", "BR"},
+    {"PW", "BR"}, {"PY", "BR"}, {"PZ", "SR"},
+    {"R", "RU"}, {"S0", "EH"}, {"S2", "BD"}, {"S5", "SI"}, {"S7", "SC"}, {"S9", "ST"}, {"SM", "SE"},
+    {"SP", "PL"}, {"ST", "SD"}, {"SU", "EG"}, {"SV", "GR"},
+    {"T2", "TV"}, {"T3", "KI"}, {"T5", "SO"}, {"T7", "SM"}, {"T8", "PW"}, {"TA", "TR"}, {"TF", "IS"},
+    {"TG", "GT"}, {"TI", "CR"}, {"TJ", "CM"}, {"TK", "FR"}, {"TL", "CF"}, {"TN", "CG"}, {"TR", "GA"},
+    {"TT", "TD"}, {"TU", "CI"}, {"TY", "BJ"}, {"TZ", "ML"},
+    {"UK", "UZ"}, {"UN", "KZ"}, {"UR", "UA"},
+    {"V2", "AG"}, {"V3", "BZ"}, {"V4", "KN"}, {"V5", "NA"}, {"V6", "FM"}, {"V7", "MH"}, {"V8", "BN"},
+    {"VE", "CA"}, {"VK", "AU"}, {"VK0h", "HM"}, {"VK9c", "CC"}, {"VK9n", "NF"}, {"VK9x", "CX"},
+    {"VO", "CA"}, {"VP2e", "AI"}, {"VP2m", "MS"}, {"VP2v", "VG"}, {"VP5", "TC"}, {"VP6", "PN"},
+    {"VP8f", "FK"}, {"VP8g", "GS"}, {"VP8h", "AQ"}, {"VP8o", "AQ"}, {"VP8s", "GS"}, {"VP9", "BM"},
+    {"VQ9", "IO"}, {"VR", "HK"}, {"VR6", "PN"}, {"VU", "IN"}, {"VY", "CA"},
+    {"XE", "MX"}, {"XF", "MX"}, {"XT", "BF"}, {"XU", "KH"}, {"XW", "LA"}, {"XX9", "MO"}, {"XZ", "MM"},
+    {"YA", "AF"}, {"YB", "ID"}, {"YI", "IQ"}, {"YJ", "VU"}, {"YK", "SY"}, {"YL", "LV"}, {"YN", "NI"},
+    {"YO", "RO"}, {"YS", "SV"}, {"YU", "RS"}, {"YV", "VE"},
+    {"Z2", "ZW"}, {"Z3", "MK"}, {"Z8", "SS"}, {"ZA", "AL"}, {"ZB2", "GI"}, {"ZC4", "CY"}, {"ZD", "SH"},
+    {"ZF", "KY"}, {"ZK3", "TK"}, {"ZL", "NZ"}, {"ZP", "PY"}, {"ZS", "ZA"},
+};
+
+/* extra locations for zones covering wide areas.
+ */
+typedef struct {
+    const char *zone;
+    float lat_d, lng_d;
+} TZExtra;
+static const TZExtra tz_extra[] = {
+    {"America/Chicago",         32.78F,  -96.80F},      // Dallas
+    {"America/Chicago",         29.76F,  -95.37F},      // Houston
+    {"America/Chicago",         29.42F,  -98.49F},      // San Antonio
+    {"America/Chicago",         27.51F,  -99.51F},      // Laredo
+    {"America/Chicago",         35.47F,  -97.52F},      // Oklahoma City
+    {"America/Chicago",         39.10F,  -94.58F},      // Kansas City
+    {"America/Chicago",         44.98F,  -93.27F},      // Minneapolis
+    {"America/Chicago",         35.15F,  -90.05F},      // Memphis
+    {"America/Chicago",         36.16F,  -86.78F},      // Nashville
+    {"America/Chicago",         29.95F,  -90.07F},      // New Orleans
+    {"America/Denver",          35.08F, -106.65F},      // Albuquerque
+    {"America/Denver",          31.76F, -106.49F},      // El Paso
+    {"America/Denver",          40.76F, -111.89F},      // Salt Lake City
+    {"America/Denver",          45.78F, -108.50F},      // Billings
+    {"America/Phoenix",         32.22F, -110.97F},      // Tucson
+    {"America/Phoenix",         35.20F, -111.65F},      // Flagstaff
+    {"America/Los_Angeles",     37.77F, -122.42F},      // San Francisco
+    {"America/Los_Angeles",     45.52F, -122.68F},      // Portland
+    {"America/Los_Angeles",     47.61F, -122.33F},      // Seattle
+    {"America/Los_Angeles",     36.17F, -115.14F},      // Las Vegas
+    {"America/New_York",        33.75F,  -84.39F},      // Atlanta
+    {"America/New_York",        25.76F,  -80.19F},      // Miami
+    {"America/New_York",        38.90F,  -77.04F},      // Washington
+    {"America/New_York",        41.50F,  -81.69F},      // Cleveland
+    {"America/Toronto",         45.50F,  -73.57F},      // Montreal
+    {"America/Edmonton",        51.05F, -114.07F},      // Calgary
+    {"Australia/Sydney",       -30.30F,  153.11F},      // Coffs Harbour
+    {"Australia/Sydney",       -31.09F,  150.93F},      // Tamworth
+};
+
+/* add a location for the given tz_zones index
+ */
+static void addZonePoint (uint16_t zone, float lat_d, float lng_d)
+{
+    tz_points = (TZPoint *) realloc (tz_points, (n_tz_points+1)*sizeof(TZPoint));
+    TZPoint &pt = tz_points[n_tz_points++];
+    pt.x = cosf(deg2rad(lat_d))*cosf(deg2rad(lng_d));
+    pt.y = cosf(deg2rad(lat_d))*sinf(deg2rad(lng_d));
+    pt.z = sinf(deg2rad(lat_d));
+    pt.zone = zone;
+}
+
+/* crack a zone.tab +-DDMM[SS] or +-DDDMM[SS] angle of ndeg degree digits, return degrees
+ */
+static float crackZoneAngle (const char *str, int ndeg, const char **endp)
+{
+    int sign = *str++ == '-' ? -1 : 1;
+    int n = 0;
+    while (str[n] >= '0' && str[n] <= '9')
+        n++;
+    int v = atoi (str);
+    float a;
+    if (n == ndeg + 4)
+        a = v/10000 + ((v/100)%100)/60.0F + (v%100)/3600.0F;
+    else
+        a = v/100 + (v%100)/60.0F;
+    *endp = str + n;
+    return (sign * a);
+}
+
+/* return the big-endian signed integer of n bytes at p
+ */
+static int64_t tzifInt (const uint8_t *p, int n)
+{
+    uint64_t v = (*p & 0x80) ? ~0ULL : 0;
+    while (n-- > 0)
+        v = (v << 8) | *p++;
+    return ((int64_t)v);
+}
+
+/* crack a POSIX TZ [+-]hh[:mm[:ss]] time at *sp, advancing *sp. return secs.
+ */
+static int32_t posixTZTime (const char **sp)
+{
+    const char *s = *sp;
+    int sign = 1;
+    if (*s == '+' || *s == '-')
+        sign = *s++ == '-' ? -1 : 1;
+    int32_t secs = 3600*strtol (s, (char**)&s, 10);
+    if (*s == ':') {
+        secs += 60*strtol (s+1, (char**)&s, 10);
+        if (*s == ':')
+            secs += strtol (s+1, (char**)&s, 10);
+    }
+    *sp = s;
+    return (sign*secs);
+}
+
+/* skip a POSIX TZ zone abbreviation at *sp, either alphabetic or in <>. return whether one was found.
+ */
+static bool posixTZName (const char **sp)
+{
+    const char *s = *sp;
+    if (*s == '<') {
+        while (*s && *s != '>')
+            s++;
+        if (*s++ != '>')
+            return (false);
+    } else {
+        while (isalpha (*s))
+            s++;
+    }
+    bool found = s > *sp;
+    *sp = s;
+    return (found);
+}
+
+/* crack a POSIX TZ rule at *sp, advancing *sp, and return when it happens in the given year in secs
+ * from the start of the year, local time.
+ */
+static bool posixTZRule (const char **sp, int yr, int32_t &secs)
+{
+    const char *s = *sp;
+    bool leap = (yr%4 == 0 && yr%100 != 0) || yr%400 == 0;
+    struct tm tm;
+    memset (&tm, 0, sizeof(tm));
+    tm.tm_year = yr - 1900;
+    tm.tm_mday = 1;
+    int yday;
+
+    if (*s == 'M') {
+        // Mm.w.d: day d (0 = Sunday) of week w (5 = last) of month m
+        int m = strtol (s+1, (char**)&s, 10);
+        if (*s != '.')
+            return (false);
+        int w = strtol (s+1, (char**)&s, 10);
+        if (*s != '.')
+            return (false);
+        int d = strtol (s+1, (char**)&s, 10);
+        if (m < 1 || m > 12 || w < 1 || w > 5 || d < 0 || d > 6)
+            return (false);
+        tm.tm_mon = m - 1;
+        (void) timegm (&tm);                            // N.B. sets tm_wday and tm_yday
+        static const uint8_t mdays[12] = {31,28,31,30,31,30,31,31,30,31,30,31};
+        int ndays = mdays[m-1] + (m == 2 && leap);
+        int mday = 1 + (d - tm.tm_wday + 7)%7 + 7*(w-1);
+        while (mday > ndays)
+            mday -= 7;
+        yday = tm.tm_yday + mday - 1;
+    } else if (*s == 'J') {
+        // Jn: 1 .. 365 never counting Feb 29
+        int n = strtol (s+1, (char**)&s, 10);
+        yday = n - 1 + (leap && n >= 60);
+    } else if (isdigit (*s)) {
+        // n: 0 .. 365 counting Feb 29
+        yday = strtol (s, (char**)&s, 10);
+    } else
+        return (false);
+
+    int32_t tod = 2*3600;
+    if (*s == '/') {
+        s++;
+        tod = posixTZTime (&s);
+    }
+
+    secs = yday*86400 + tod;
+    *sp = s;
+    return (true);
+}
+
+/* find the offset at t of the POSIX TZ string found at the end of a TZif file, eg MST7MDT,M3.2.0,M11.1.0
+ * return whether the string could be cracked.
+ */
+static bool posixTZOffset (const char *tz, time_t t, int32_t &off)
+{
+    const char *s = tz;
+
+    // standard zone, N.B. POSIX offsets are positive west
+    if (!posixTZName (&s))
+        return (false);
+    int32_t std_off = -posixTZTime (&s);
+    if (*s == '\0') {
+        off = std_off;
+        return (true);
+    }
+
+    // daylight zone, one hour ahead unless stated
+    if (!posixTZName (&s))
+        return (false);
+    int32_t dst_off = std_off + 3600;
+    if (*s && *s != ',')
+        dst_off = -posixTZTime (&s);
+
+    // when daylight time starts and ends this year
+    struct tm tm;
+    time_t t_std = t + std_off;
+    gmtime_r (&t_std, &tm);
+    int yr = tm.tm_year + 1900;
+    int32_t start, end;
+    if (*s++ != ',' || !posixTZRule (&s, yr, start) || *s++ != ',' || !posixTZRule (&s, yr, end))
+        return (false);
+
+    // start is in standard time, end in daylight time
+    memset (&tm, 0, sizeof(tm));
+    tm.tm_year = yr - 1900;
+    tm.tm_mday = 1;
+    time_t t_yr = timegm (&tm);
+    time_t t_start = t_yr + start - std_off;
+    time_t t_end = t_yr + end - dst_off;
+
+    bool dst = t_start < t_end ? (t >= t_start && t < t_end) : !(t >= t_end && t < t_start);
+    off = dst ? dst_off : std_off;
+    return (true);
+}
+
+/* find the offset from UTC at t of the given zone by reading its TZif file.
+ * return whether the file could be read.
+ */
+static bool zoneOffset (const char *name, time_t t, int32_t &off)
+{
+    char path[sizeof(TZ_DIR) + TZ_MAXNAME + 2];
+    snprintf (path, sizeof(path), "%s/%s", TZ_DIR, name);
+    FILE *fp = fopen (path, "r");
+    if (!fp)
+        return (false);
+    uint8_t *buf = (uint8_t *) malloc (TZ_MAXFILE);
+    size_t len = buf ? fread (buf, 1, TZ_MAXFILE, fp) : 0;
+    fclose (fp);
+
+    bool ok = false;
+    const uint8_t *p = buf, *endp = buf + len;
+    const int hdr_len = 44;
+    if (len < (size_t)hdr_len || memcmp (buf, "TZif", 4) != 0)
+        goto out;
+
+    {
+        // header counts: isutcnt isstdcnt leapcnt timecnt typecnt charcnt
+        int64_t isut = tzifInt (p+20, 4), isstd = tzifInt (p+24, 4), leap = tzifInt (p+28, 4);
+        int64_t timecnt = tzifInt (p+32, 4), typecnt = tzifInt (p+36, 4), charcnt = tzifInt (p+40, 4);
+        int tlen = 4;
+
+        // version 2 and later repeat the data with 64 bit times followed by a POSIX TZ string
+        bool v2 = buf[4] >= '2';
+        if (v2) {
+            p += hdr_len + timecnt*5 + typecnt*6 + charcnt + leap*8 + isstd + isut;
+            if (p + hdr_len > endp || memcmp (p, "TZif", 4) != 0)
+                goto out;
+            isut = tzifInt (p+20, 4); isstd = tzifInt (p+24, 4); leap = tzifInt (p+28, 4);
+            timecnt = tzifInt (p+32, 4); typecnt = tzifInt (p+36, 4); charcnt = tzifInt (p+40, 4);
+            tlen = 8;
+        }
+        const uint8_t *times = p + hdr_len;
+        const uint8_t *idx = times + timecnt*tlen;
+        const uint8_t *types = idx + timecnt;
+        const uint8_t *footer = types + typecnt*6 + charcnt + leap*(tlen+4) + isstd + isut;
+        if (typecnt < 1 || footer > endp)
+            goto out;
+
+        // last transition at or before t
+        int64_t i = timecnt - 1;
+        while (i >= 0 && tzifInt (times + i*tlen, tlen) > t)
+            i--;
+
+        // beyond the last transition the footer rule applies if there is one
+        if (i == timecnt - 1 && v2 && footer + 2 < endp && footer[0] == '\n' && footer[1] != '\n') {
+            char tz[100];
+            size_t n = 0;
+            for (const uint8_t *cp = footer + 1; cp < endp && *cp != '\n' && n < sizeof(tz)-1; cp++)
+                tz[n++] = *cp;
+            tz[n] = '\0';
+            if (posixTZOffset (tz, t, off)) {
+                ok = true;
+                goto out;
+            }
+        }
+
+        // else the type of that transition, or the first type if before them all
+        int type = i >= 0 ? idx[i] : 0;
+        if (type >= typecnt)
+            goto out;
+        off = tzifInt (types + 6*type, 4);
+        ok = true;
+    }
+
+out:
+    free (buf);
+    return (ok);
+}
+
+/* return the ISO country code of the given tzmap cell based on the nearest amateur prefix, else NULL.
+ */
+static const char *cellCountry (float lat_d, float lng_d)
+{
+    LatLong ll;
+    ll.lat_d = lat_d;
+    ll.lng_d = lng_d;
+    ll.lat = deg2rad (lat_d);
+    ll.lng = deg2rad (lng_d);
+    char prefix[MAX_PREF_LEN+1];
+    if (!nearestPrefix (ll, prefix))
+        return (NULL);
+
+    const char *cc = NULL;
+    size_t best_len = 0;
+    for (unsigned i = 0; i < NARRAY(tz_prefcc); i++) {
+        size_t l = strlen (tz_prefcc[i].prefix);
+        if (l > best_len && strncmp (prefix, tz_prefcc[i].prefix, l) == 0) {
+            cc = tz_prefcc[i].cc;
+            best_len = l;
+        }
+    }
+    return (cc);
+}
+
+/* read TZ_ZONETAB into tz_zones and tz_points, add tz_extra, return whether any were found.
+ */
+static bool readZoneTab()
+{
+    FILE *fp = fopen (TZ_ZONETAB, "r");
+    if (!fp) {
+        Serial.printf (_FX("TZ: %s: %s\n"), TZ_ZONETAB, strerror(errno));
+        return (false);
+    }
+
+    // find January and July of this year for the offsets of each zone
+    time_t t = nowWO();
+    struct tm tm;
+    gmtime_r (&t, &tm);
+    tm.tm_mon = 0;
+    tm.tm_mday = 15;
+    tm.tm_hour = tm.tm_min = tm.tm_sec = 0;
+    time_t jan = timegm (&tm);
+    time_t jul = jan + 181*24*3600L;
+
+    char line[200];
+    while (fgets (line, sizeof(line), fp)) {
+
+        // format: country <tab> coords <tab> name [<tab> comment]
+        if (line[0] == '#')
+            continue;
+        char cc[10], coords[30], name[TZ_MAXNAME];
+        if (sscanf (line, "%9s %29s %39s", cc, coords, name) != 3 || strlen (cc) != 2)
+            continue;
+        const char *cp = coords;
+        if (*cp != '+' && *cp != '-')
+            continue;
+        float lat_d = crackZoneAngle (cp, 2, &cp);
+        if (*cp != '+' && *cp != '-')
+            continue;
+        float lng_d = crackZoneAngle (cp, 3, &cp);
+        int32_t off0, off1;
+        if (!zoneOffset (name, jan, off0) || !zoneOffset (name, jul, off1))
+            continue;
+
+        tz_zones = (TZZone *) realloc (tz_zones, (n_tz_zones+1)*sizeof(TZZone));
+        TZZone &zone = tz_zones[n_tz_zones++];
+        memset (&zone, 0, sizeof(zone));
+        strcpy (zone.name, name);
+        strcpy (zone.cc, cc);
+        zone.off0 = off0;
+        zone.off1 = off1;
+        addZonePoint (n_tz_zones-1, lat_d, lng_d);
+    }
+
+    fclose (fp);
+
+    for (unsigned i = 0; i < NARRAY(tz_extra); i++) {
+        for (uint16_t j = 0; j < n_tz_zones; j++) {
+            if (strcmp (tz_extra[i].zone, tz_zones[j].name) == 0) {
+                addZonePoint (j, tz_extra[i].lat_d, tz_extra[i].lng_d);
+                break;
+            }
+        }
+    }
+
+    return (n_tz_zones > 0);
+}
+
+/* return the tz_zones index with a location nearest the given unit vector but no farther than max_cos,
+ * whose standard offset is off unless any_off and, if cc is not NULL, lies in that country.
+ * return TZ_NOZONE if none qualify.
+ */
+static uint16_t nearestZone (float x, float y, float z, int32_t off, bool any_off, const char *cc, float max_cos)
+{
+    uint16_t zone = TZ_NOZONE;
+    for (uint16_t i = 0; i < n_tz_points; i++) {
+        const TZPoint &pt = tz_points[i];
+        const TZZone &tzz = tz_zones[pt.zone];
+        if (!any_off && (tzz.off0 < tzz.off1 ? tzz.off0 : tzz.off1) != off)
+            continue;
+        if (cc && strcmp (cc, tzz.cc) != 0)
+            continue;
+        float c = x*pt.x + y*pt.y + z*pt.z;
+        if (c > max_cos) {
+            max_cos = c;
+            zone = pt.zone;
+        }
+    }
+    return (zone);
+}
+
+/* assign the nearest suitable zone to each tzmap cell and run-length encode the result into tz_runs.
+ */
+static void buildZoneRuns()
+{
+    float min_cos = cosf(deg2rad(TZ_MAXDIST));
+    float min_ccos = cosf(deg2rad(TZ_MAXCDIST));
+    int n_runs = 0;
+
+    for (unsigned row = 0; row < TZ_NROWS; row++) {
+        float lat_d = (float)row - 89;
+        float lat = deg2rad (lat_d);
+        tz_row_run[row] = n_runs;
+        uint16_t prev_zone = TZ_NOZONE;
+        for (unsigned col = 0; col < TZ_NCOLS; col++) {
+
+            // center of cell, same sense as tzmapCell()
+            float lng_d = (float)col - 180 + 0.5F;
+            float lng = deg2rad (lng_d);
+            float x = cosf(lat)*cosf(lng), y = cosf(lat)*sinf(lng), z = sinf(lat);
+            int32_t off = 900*((signed char)pgm_read_byte(&tzmap[row][col]));
+
+            // nearest zone that agrees with tzmap and, if known, lies in the same country.
+            // tzmap marks sea as 0 which includes many coastal cells, so there any nearby zone of the country
+            // will do. Otherwise if the country has no such zone leave the cell at its nominal offset rather
+            // than borrow a zone across the border.
+            uint16_t zone;
+            const char *cc = cellCountry (lat_d, lng_d);
+            if (cc) {
+                zone = nearestZone (x, y, z, off, false, cc, min_ccos);
+                if (zone == TZ_NOZONE && off == 0)
+                    zone = nearestZone (x, y, z, off, true, cc, min_cos);
+            } else
+                zone = nearestZone (x, y, z, off, false, NULL, min_cos);
+
+            // start a new run if changed
+            if (col == 0 || zone != prev_zone) {
+                tz_runs = (TZRun *) realloc (tz_runs, (n_runs+1)*sizeof(TZRun));
+                tz_runs[n_runs].col = col;
+                tz_runs[n_runs].zone = zone;
+                n_runs++;
+                prev_zone = zone;
+            }
+        }
+    }
+    tz_row_run[TZ_NROWS] = n_runs;
+
+    Serial.printf (_FX("TZ: %d zones in %d runs\n"), n_tz_zones, n_runs);
+}
+
+/* return the zone for the given tzmap cell, else NULL.
+ */
+static TZZone *findZone (int row, int col)
+{
+    if (!tz_ready) {
+        tz_ready = true;
+        if (readZoneTab())
+            buildZoneRuns();
+    }
+    if (!tz_runs)
+        return (NULL);
+
+    // binary search for last run in row starting at or before col
+    int lo = tz_row_run[row], hi = tz_row_run[row+1] - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1)/2;
+        if (tz_runs[mid].col <= col)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    uint16_t zone = tz_runs[lo].zone;
+    return (zone == TZ_NOZONE ? NULL : &tz_zones[zone]);
+}
+
+/* return the current offset of the given zone, secs.
+ * the zone file is consulted at most once every 15 minutes per zone.
+ */
+static int32_t currentZoneOffset (TZZone &tzz)
+{
+    time_t t = nowWO();
+    if (t < tzz.cur_t0 || t >= tzz.cur_t1) {
+        if (!zoneOffset (tzz.name, t, tzz.cur_off))
+            tzz.cur_off = tzz.off0 < tzz.off1 ? tzz.off0 : tzz.off1;
+        tzz.cur_t0 = t - t%900;
+        tzz.cur_t1 = tzz.cur_t0 + 900;
+    }
+    return (tzz.cur_off);
+}
+
+/* return the name of the zone at the given location, else NULL if not known.
+ */
+const char *getTZName (const LatLong &ll)
+{
+    int row, col;
+    tzmapCell (ll, row, col);
+    TZZone *tzz = findZone (row, col);
+    return (tzz ? tzz->name : NULL);
+}
+
+#else
+
+/* zone names are not available
+ */
+const char *getTZName (const LatLong &ll)
+{
+    (void) ll;
+    return (NULL);
+}
+
+#endif // _USE_UNIX
+
+/* given a LatLong return timezone seconds from UTC.
+ * on UNIX this is the current offset of the local zone, including any daylight time, when it is known.
+ */
+int32_t getTZ (const LatLong &ll)
+{
+    int row, col;
+    tzmapCell (ll, row, col);
 #ifdef _MAIN_TEST
-    printf ("row %d col %d\n", lat+89, lng);
+    printf ("row %d col %d\n", row, col);
 #endif // _MAIN_TEST
-    return (900*((signed char)pgm_read_byte(&tzmap[lat+89][lng])));
+
+#if defined(_USE_UNIX)
+    TZZone *tzz = findZone (row, col);
+    if (tzz)
+        return (currentZoneOffset (*tzz));
+#endif // _USE_UNIX
+
+    return (900*((signed char)pgm_read_byte(&tzmap[row][col])));
 }
 
 
@@ -6866,6 +7530,8 @@ int main (int ac, char *av[])
 	ll.lng_d = atof(av[2]);
 
 	printf ("%g %g -> %g\n", ll.lat_d, ll.lng_d, getTZ(ll)/3600.0);
+        const char *name = getTZName (ll);
+        printf ("zone %s\n", name ? name : "unknown");
     }
     return (0);
 }
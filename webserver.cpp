@@ -273,6 +273,13 @@ static bool getWiFiDEDXInfo_helper (WiFiClient &client, char *unused, bool send_
     snprintf (buf, sizeof(buf), _FX("%stz     %+g"), prefix, tz.tz_secs/3600.0);
     client.println (buf);
 
+    // zone name, if known
+    const char *tz_name = getTZName (ll);
+    if (tz_name) {
+        snprintf (buf, sizeof(buf), _FX("%szone   %s"), prefix, tz_name);
+        client.println (buf);
+    }
+
     // report lat
     snprintf (buf, sizeof(buf), _FX("%slat    %0.2f degs"), prefix, ll.lat_d);
     client.println (buf);
@@ -342,8 +349,18 @@ static bool getWiFiDXSpots (WiFiClient &client, char *line)
     // start reply, even if none
     startPlainText (client);
 
+    // sun rise and set at every spot in one pass
+    StackMalloc ll_mem((nspots+1)*sizeof(LatLong));
+    StackMalloc rs_mem(2*(nspots+1)*sizeof(time_t));
+    LatLong *lls = (LatLong *) ll_mem.getMem();
+    time_t *rise = (time_t *) rs_mem.getMem();
+    time_t *set = rise + nspots + 1;
+    for (uint8_t i = 0; i < nspots; i++)
+        lls[i] = spots[i].ll;
+    sunrsMany (nowWO(), lls, nspots, rise, set);
+
     // print each row, similar to drawDXSpot()
-    FWIFIPR (client, F("#  kHz   Call        UTC  Grid    Lat     Lng       Dist   Bear\n"));
+    FWIFIPR (client, F("#  kHz   Call        UTC  Grid    Lat     Lng       Dist   Bear  Rise   Set\n"));
     float sdelat = sinf(de_ll.lat);
     float cdelat = cosf(de_ll.lat);
     for (uint8_t i = 0; i < nspots; i++) {
@@ -373,9 +390,20 @@ static bool getWiFiDXSpots (WiFiClient &client, char *line)
         if (show_km)                                    // match DX display
             dist *= 1.609344F;                          // miles -> km
 
+        // sun rise and set UTC, or none
+        char rs[2][6];
+        time_t rst[2] = {rise[i], set[i]};
+        for (int j = 0; j < 2; j++) {
+            if (rise[i] && set[i])
+                snprintf (rs[j], sizeof(rs[j]), "%02d:%02d", hour(rst[j]), minute(rst[j]));
+            else
+                strcpy (rs[j], "--:--");
+        }
+
         // print together
-        snprintf (line+8, sizeof(line)-8, _FX(" %-*s %04u %s   %6.2f %7.2f   %6.0f   %4.0f\n"),
-                    MAX_DXSPOTCALL_LEN-1, sp->call, sp->uts, maid, sp->ll.lat_d, sp->ll.lng_d, dist, bear);
+        snprintf (line+8, sizeof(line)-8, _FX(" %-*s %04u %s   %6.2f %7.2f   %6.0f   %4.0f %s %s\n"),
+                    MAX_DXSPOTCALL_LEN-1, sp->call, sp->uts, maid, sp->ll.lat_d, sp->ll.lng_d, dist, bear,
+                    rs[0], rs[1]);
         client.print(line);
     }
 
@@ -383,6 +411,98 @@ static bool getWiFiDXSpots (WiFiClient &client, char *line)
     return (true);
 }
 
+/* remote report spots from the spot store, newest first.
+ * all of band=meters&mode=X&dxcc=prefix&call=X&age=mins&max=N are optional and may be in any order.
+ */
+static bool getWiFiSpotStore (WiFiClient &client, char *line)
+{
+    // replace any %20
+    replaceBlankEntity (line);
+
+    // remove trailing HTTP, if any (curl sends it, chrome doesn't)
+    char *http = strstr (line, " HTTP");
+    if (http)
+        *http = '\0';
+
+    // crack each name=value
+    SpotQuery q;
+    memset (&q, 0, sizeof(q));
+    int max_out = 100;
+    char *lasts;
+    for (char *arg = strtok_r (line, "&", &lasts); arg; arg = strtok_r (NULL, "&", &lasts)) {
+        char *value = strchr (arg, '=');
+        if (!value) {
+            line[0] = '\0';                             // code for Garbled command
+            return (false);
+        }
+        *value++ = '\0';
+        if (strcmp (arg, "band") == 0)
+            q.band = atoi (value);
+        else if (strcmp (arg, "mode") == 0) {
+            q.mode = spotModeFromName (value);
+            if (q.mode == 0) {
+                strcpy_P (line, PSTR("Unknown mode"));
+                return (false);
+            }
+        } else if (strcmp (arg, "dxcc") == 0)
+            q.dxcc = value;
+        else if (strcmp (arg, "call") == 0)
+            q.call = value;
+        else if (strcmp (arg, "age") == 0)
+            q.since = now() - 60*atol(value);
+        else if (strcmp (arg, "max") == 0)
+            max_out = atoi (value);
+        else {
+            line[0] = '\0';                             // code for Garbled command
+            return (false);
+        }
+    }
+    if (max_out < 1 || max_out > 1000) {
+        strcpy_P (line, PSTR("max must be 1 .. 1000"));
+        return (false);
+    }
+
+    // query
+    StackMalloc spots_mem(max_out*sizeof(SpotRec));
+    SpotRec *spots = (SpotRec *) spots_mem.getMem();
+    if (!spots) {
+        strcpy_P (line, PSTR("No memory"));
+        return (false);
+    }
+    int n_spots = spotStoreQuery (q, spots, max_out);
+
+    // start reply, even if none
+    startPlainText (client);
+
+    // print each row
+    char buf[120];
+    snprintf (buf, sizeof(buf), _FX("# %d of %d spots\n"), n_spots, spotStoreCount());
+    client.print(buf);
+    FWIFIPR (client, F("#       kHz Call        Spotter     DXCC    Band Mode    UTC                  Lat     Lng\n"));
+    for (int i = 0; i < n_spots; i++) {
+        SpotRec &r = spots[i];
+        snprintf (buf, sizeof(buf), _FX("%11.1f %-*s %-*s %-*s %4u %-6s %04d-%02d-%02dT%02d:%02d:%02dZ %6.2f %7.2f\n"),
+                    r.kHz, MAX_DXSPOTCALL_LEN-1, r.call, MAX_DXSPOTCALL_LEN-1, r.de_call,
+                    MAX_SPOTDXCC_LEN-1, r.dxcc, r.band, spotModeName(r.mode),
+                    year(r.t), month(r.t), day(r.t), hour(r.t), minute(r.t), second(r.t), r.lat_d, r.lng_d);
+        client.print(buf);
+    }
+
+    // ok
+    return (true);
+}
+
+/* remote report each extra spot source
+ */
+static bool getWiFiSpotFeeds (WiFiClient &client, char *line)
+{
+    startPlainText (client);
+    if (!reportSpotFeeds (client))
+        FWIFIPRLN (client, F("No spot feeds"));
+    (void) line;
+    return (true);
+}
+
 /* remote report some basic clock configuration
  */
 static bool getWiFiConfig (WiFiClient &client, char *unused)
@@ -597,6 +717,48 @@ static bool getWiFiSatellite (WiFiClient &client, char *unused)
     return (true);
 }
 
+/* report the pass schedule of all tracked satellites, or none.
+ * always return true
+ */
+static bool getWiFiSatTrack (WiFiClient &client, char *unused)
+{
+    (void) unused;
+
+    // start reply
+    startPlainText (client);
+
+    const SatTrackPass *passes;
+    uint16_t n_passes;
+    if (!getSatTrackPasses (&passes, &n_passes)) {
+	FWIFIPRLN (client, F("none"));
+        return (true);
+    }
+
+    // print each pass not yet ended, times in minutes from now
+    FWIFIPR (client, F("Name       Rise  RiseAz  MaxEl     Set   SetAz\n"));
+    time_t now = nowWO();
+    for (uint16_t i = 0; i < n_passes; i++) {
+        const SatTrackPass *pp = &passes[i];
+        if (pp->set_t && pp->set_t <= now)
+            continue;
+
+        char line[100];
+        int l = snprintf (line, sizeof(line), _FX("%-*s "), NV_SATNAME_LEN-1, pp->name);
+        if (pp->rise_t <= now)
+            l += snprintf (line+l, sizeof(line)-l, _FX("%7s %7s"), "Up", "");
+        else
+            l += snprintf (line+l, sizeof(line)-l, _FX("%7.1f %7.0f"), (pp->rise_t-now)/60.0F, pp->rise_az);
+        l += snprintf (line+l, sizeof(line)-l, _FX(" %6.0f "), pp->max_el);
+        if (pp->set_t)
+            l += snprintf (line+l, sizeof(line)-l, _FX("%7.1f %7.0f\n"), (pp->set_t-now)/60.0F, pp->set_az);
+        else
+            l += snprintf (line+l, sizeof(line)-l, _FX("%7s %7s\n"), "NoSet", "");
+        client.print (line);
+    }
+
+    return (true);
+}
+
 /* send the current collection of sensor data to client in CSV format.
  */
 static bool getWiFiSensorInfo (WiFiClient &client, char *line)
@@ -630,6 +792,39 @@ static bool getWiFiSensorInfo (WiFiClient &client, char *line)
     return (true);
 }
 
+/* send main loop section timing statistics
+ */
+static bool getWiFiPerf (WiFiClient &client, char *unused)
+{
+    (void) unused;
+
+    startPlainText(client);
+    reportPerf (client);
+    return (true);
+}
+
+/* send process memory use and trends
+ */
+static bool getWiFiMem (WiFiClient &client, char *unused)
+{
+    (void) unused;
+
+    startPlainText(client);
+    reportMemStats (client);
+    return (true);
+}
+
+/* send recent main loop stall reports
+ */
+static bool getWiFiStalls (WiFiClient &client, char *unused)
+{
+    (void) unused;
+
+    startPlainText(client);
+    reportStalls (client);
+    return (true);
+}
+
 /* send some misc system info
  */
 static bool getWiFiSys (WiFiClient &client, char *unused)
@@ -1045,6 +1240,30 @@ static bool setWiFiSatName (WiFiClient &client, char line[])
     return (false);
 }
 
+/* set the list of satellites to track: set_sattrack?abc,def|none
+ * return whether command is successful.
+ */
+static bool setWiFiSatTrack (WiFiClient &client, char line[])
+{
+    resetWatchdog();
+
+    // replace any %20
+    replaceBlankEntity (line);
+
+    // remove trailing HTTP, if any
+    char *http = strstr (line, " HTTP");
+    if (http)
+        *http = '\0';
+
+    // do it
+    if (setSatTrackNames (line))
+        return (getWiFiSatTrack (client, line));
+
+    // nope
+    strcpy_P (line, PSTR("Bad list"));
+    return (false);
+}
+
 /* set satellite from given TLE: set_sattle?name=n&t1=line1&t2=line2
  * return whether command is successful.
  */
@@ -1201,8 +1420,14 @@ static void serveRemote(WiFiClient &client, bool ro)
         { PSTR("get_de.txt "),        getWiFiDEInfo,         NULL },
         { PSTR("get_dx.txt "),        getWiFiDXInfo,         NULL },
         { PSTR("get_dxspots.txt "),   getWiFiDXSpots,        NULL },
+        { PSTR("get_mem.txt "),       getWiFiMem,            NULL },
+        { PSTR("get_perf.txt "),      getWiFiPerf,           NULL },
         { PSTR("get_satellite.txt "), getWiFiSatellite,      NULL },
+        { PSTR("get_sattrack.txt "),  getWiFiSatTrack,       NULL },
         { PSTR("get_sensors.txt "),   getWiFiSensorInfo,     NULL },
+        { PSTR("get_spotfeeds.txt "), getWiFiSpotFeeds,      NULL },
+        { PSTR("get_spots?"),         getWiFiSpotStore,      PSTR("band=m&mode=X&dxcc=pfx&call=X&age=mins&max=N") },
+        { PSTR("get_stalls.txt "),    getWiFiStalls,         NULL },
         { PSTR("get_sys.txt "),       getWiFiSys,            NULL },
         { PSTR("get_time.txt "),      getWiFiTime,           NULL },
         { PSTR("set_countdown?"),     setWiFiCountdown,      PSTR("minutes") },
@@ -1213,8 +1438,9 @@ static void serveRemote(WiFiClient &client, bool ro)
         { PSTR("set_newdx?"),         setWiFiNewDX,          PSTR("lat=X&lng=Y") },
         { PSTR("set_newdxgrid?"),     setWiFiNewDXGrid,      PSTR("AB12") },
         { PSTR("set_pane?"),          setWiFiPane,           PSTR("Pane[123]=XXX") },
-        { PSTR("set_satname?"),       setWiFiSatName,        PSTR("abc|none") },
+        { PSTR("set_satname?"),       setWiFiSatName,        PSTR("abc|NORAD-number|none") },
         { PSTR("set_sattle?"),        setWiFiSatTLE,         PSTR("name=abc&t1=line1&t2=line2") },
+        { PSTR("set_sattrack?"),      setWiFiSatTrack,       PSTR("abc,def,...|none") },
         { PSTR("set_time?"),          setWiFiTime,           PSTR("ISO=YYYY-MM-DDTHH:MM:SS") },
         { PSTR("set_time?"),          setWiFiTime,           PSTR("Now") },
         { PSTR("set_time?"),          setWiFiTime,           PSTR("unix=secs_since_1970") },
@@ -1304,8 +1530,10 @@ void checkWebServer()
 {
     // check if someone is trying to tell/ask us something
     WiFiClient client = remoteServer.available();
-    if (client)
+    if (client) {
+        PerfTimer pt (PERF_WEB);
 	serveRemote(client, false);
+    }
 }
 
 void initWebServer()
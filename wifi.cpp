@@ -479,7 +479,7 @@ static void checkVOACAPMap (bool force)
 
     // show pending unless prior BC error or no BC box
     if (!bc_error && bc_box)
-        BCHelper (bc_box, 1, NULL, NULL);
+        BCHelper (bc_box, 1, NULL, NULL, NULL);
 
     // update prop map if on
     bool ok = true;
@@ -507,7 +507,7 @@ static void checkVOACAPMap (bool force)
 
     // show result of effort unless prior BC error or no BC box
     if (!bc_error && bc_box)
-        BCHelper (bc_box, ok ? 0 : -1, NULL, NULL);
+        BCHelper (bc_box, ok ? 0 : -1, NULL, NULL, NULL);
 
     // above can take a while, so drain any taps that happened to avoid backing up even more
     drainTouch();
@@ -789,6 +789,7 @@ void updateWiFi(void)
 
     // freshen RSS
     if (t0 >= next_rss) {
+        PerfTimer pt (PERF_RSS);
 	if (updateRSS())
 	    next_rss = millis() + RSS_INTERVAL;
 	else
@@ -1519,6 +1520,76 @@ bool httpSkipHeader (WiFiClient &client)
     return (httpSkipHeader (client, NULL));
 }
 
+/* same as getChar() but safe from threads other than the main loop, which must not feed the watchdog.
+ */
+static bool threadGetChar (WiFiClient &client, char *cp)
+{
+#if defined(_USE_UNIX)
+    #define THREAD_GETTO 5000   // millis()
+    for (int dt = 0; !client.available(); dt += 10) {
+        if (!client.connected() || dt > THREAD_GETTO)
+            return (false);
+        usleep (10000);
+    }
+    int c = client.read();
+    if (c < 0)
+        return (false);
+    *cp = (char)c;
+    return (true);
+#else
+    return (getChar (client, cp));
+#endif
+}
+
+/* same as httpGET() but safe from any thread.
+ */
+void threadHttpGET (WiFiClient &client, const char *server, const char *page)
+{
+#if defined(_USE_UNIX)
+    client.print ("GET ");
+    client.print (page);
+    client.print (" HTTP/1.0\r\nHost: ");
+    client.println (server);
+    sendUserAgent (client);
+    client.print ("Connection: close\r\n\r\n");
+#else
+    httpGET (client, server, page);
+#endif
+}
+
+/* same as getTCPLine() but safe from any thread, without the trailing \r\n.
+ * return whether a complete line was read.
+ */
+bool threadGetTCPLine (WiFiClient &client, char line[], uint16_t line_len)
+{
+    uint16_t i = 0;
+    char c;
+
+    while (threadGetChar (client, &c)) {
+        if (c == '\r')
+            continue;
+        if (c == '\n') {
+            line[i] = '\0';
+            return (true);
+        }
+        if (i < line_len - 1)
+            line[i++] = c;
+    }
+    return (false);
+}
+
+/* same as httpSkipHeader() but safe from any thread.
+ */
+bool threadHttpSkipHeader (WiFiClient &client)
+{
+    char line[150];
+    do {
+        if (!threadGetTCPLine (client, line, sizeof(line)))
+            return (false);
+    } while (line[0] != '\0');
+    return (true);
+}
+
 /* retrieve and plot latest and predicted kp indices, return whether all ok
  */
 static bool updateKp(SBox &b)
@@ -1565,6 +1636,8 @@ static bool updateKp(SBox &b)
     ok = (kp_i == NKP);
     if (!ok)
         Serial.printf (_FX("Kp only %d of %d\n"), kp_i, NKP);
+    else
+        setPropModelKp (kp[NHKP-1]);
 
 out:
 
@@ -1732,6 +1805,7 @@ static bool updateSunSpots()
 	if (ssn_i == NSUNSPOT) {
             x[NSUNSPOT] = x[NSUNSPOT-1];        // dup last time
             sspot[NSUNSPOT] = 0;                // set value to 0
+            setPropModelSSN (sspot[NSUNSPOT-1]);
 	    ok = plotXY (plot1_b, x, sspot, NSUNSPOT+1, _FX("Days"), _FX("Sunspot Number"),
                                         SSPOT_COLOR, sspot[NSUNSPOT-1]);
         }
@@ -1793,8 +1867,10 @@ static bool updateSolarFlux(const SBox &box)
 	// plot if found all, display current value
 	updateClocks(false);
 	resetWatchdog();
-	if (flux_i == NSFLUX)
+	if (flux_i == NSFLUX) {
 	    ok = plotXY (box, x, flux, NSFLUX, _FX("Days"), _FX("Solar flux"), FLUX_COLOR, flux[NSFLUX-10]);
+            setPropModelSFI (flux[NSFLUX-10]);
+        }
 
     } else {
 	Serial.println (F("connection failed"));
@@ -1811,6 +1887,7 @@ out:
 }
 
 /* retrieve and draw latest band conditions in the given box, return whether all ok.
+ * on UNIX if the server can not be reached fall back to the built-in model, labeled as such.
  * N.B. reset bc_reverting
  */
 static bool updateBandConditions(const SBox &box)
@@ -1870,6 +1947,10 @@ static bool updateBandConditions(const SBox &box)
         Serial.printf (_FX("BC response: %s\n"), response);
         Serial.printf (_FX("BC config: %s\n"), config);
         ok = plotBandConditions (box, response, config);
+#if defined(_USE_UNIX)
+        if (ok)
+            propModelRecord (response);
+#endif // _USE_UNIX
 
     } else {
 	plotMessage (box, RA8875_RED, _FX("Connection failed"));
@@ -1879,6 +1960,18 @@ static bool updateBandConditions(const SBox &box)
 out:
     bc_reverting = false;
     bc_client.stop();
+
+#if defined(_USE_UNIX)
+    if (!ok) {
+        float rel[PROP_MAP_N];
+        char cfg[50];
+        propModelBC (rel, cfg, sizeof(cfg));
+        BCHelper (&box, 0, rel, cfg, _FX("Model DE-DX"));
+        Serial.printf (_FX("BC: VOACAP failed, using model: %s\n"), cfg);
+        ok = true;
+    }
+#endif // _USE_UNIX
+
     resetWatchdog();
     printFreeHeap (F("BandConditions"));
     return (ok);
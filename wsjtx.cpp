@@ -0,0 +1,532 @@
+/* decode WSJT-X and JTDX UDP messages.
+ *
+ * packet definition: https://github.com/roelandjansen/wsjt-x/blob/master/NetworkMessage.hpp
+ *
+ * messages are QDataStream serializations: big-endian integers, doubles as 8 byte IEEE, and utf8 strings
+ * as a 4 byte length (0xffffffff for null) followed by that many bytes without EOS. Decoding is done in
+ * place: strings are returned as WSJTXStr pointing into the packet, nothing is copied or modified, and
+ * every field is bounds checked so a short or corrupt packet is simply rejected.
+ *
+ * build stand-alone benchmark that replays captured packets, see main() at the end:
+ *   g++ -O2 -Wall -D_WSJTX_UNITTEST -o x.wsjtx wsjtx.cpp
+ */
+
+#ifdef _WSJTX_UNITTEST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+
+#define MAX_DXSPOTCALL_LEN 12
+
+#include "wsjtx.h"
+
+#else
+
+#include "HamClock.h"
+
+#endif // _WSJTX_UNITTEST
+
+
+#define WSJTX_MAGIC     0xadbccbdaU     // first 4 bytes of every message
+
+
+// read position within one packet
+typedef struct {
+    const uint8_t *bp;                  // next byte
+    const uint8_t *end;                 // one past last byte
+    bool ok;                            // cleared if any read ran past end
+} WSJTXReader;
+
+
+/* return whether r has at least n more bytes, else mark it bad
+ */
+static bool wsjtxHave (WSJTXReader &r, uint32_t n)
+{
+    if (!r.ok || (uint32_t)(r.end - r.bp) < n)
+        r.ok = false;
+    return (r.ok);
+}
+
+static uint8_t wsjtxU8 (WSJTXReader &r)
+{
+    if (!wsjtxHave (r, 1))
+        return (0);
+    return (*r.bp++);
+}
+
+static bool wsjtxBool (WSJTXReader &r)
+{
+    return (wsjtxU8 (r) != 0);
+}
+
+static uint32_t wsjtxU32 (WSJTXReader &r)
+{
+    if (!wsjtxHave (r, 4))
+        return (0);
+    const uint8_t *b = r.bp;
+    r.bp += 4;
+    return (((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3]);
+}
+
+static uint64_t wsjtxU64 (WSJTXReader &r)
+{
+    uint64_t x = (uint64_t)wsjtxU32 (r) << 32;
+    return (x | wsjtxU32 (r));
+}
+
+static double wsjtxDouble (WSJTXReader &r)
+{
+    uint64_t x = wsjtxU64 (r);
+    double d;
+    memcpy (&d, &x, sizeof(d));
+    return (d);
+}
+
+/* read a utf8 string as a view into the packet
+ */
+static WSJTXStr wsjtxUTF8 (WSJTXReader &r)
+{
+    WSJTXStr s = {"", 0};
+    uint32_t len = wsjtxU32 (r);
+    if (len == 0xffffffffU)                     // null string
+        return (s);
+    if (!wsjtxHave (r, len))
+        return (s);
+    s.s = (const char *) r.bp;
+    s.len = len;
+    r.bp += len;
+    return (s);
+}
+
+/* skip a QDateTime, saving its julian day and ms since midnight.
+ * only UTC, local and offset times are supported.
+ */
+static void wsjtxDateTime (WSJTXReader &r, int64_t &jd, uint32_t &ms)
+{
+    jd = (int64_t) wsjtxU64 (r);
+    ms = wsjtxU32 (r);
+    uint8_t spec = wsjtxU8 (r);
+    if (spec == 2)
+        (void) wsjtxU32 (r);                    // offset from UTC, secs
+    else if (spec > 2)
+        r.ok = false;                           // QTimeZone, not worth supporting
+}
+
+/* crack the packet pkt of len bytes into m.
+ * strings in m point into pkt so are valid only as long as pkt and are not EOS terminated.
+ * return false if not a WSJT-X packet, is a type we do not decode, or is too short.
+ */
+bool wsjtxDecode (const uint8_t *pkt, int len, WSJTXMsg &m)
+{
+    WSJTXReader r = {pkt, pkt + (len > 0 ? len : 0), true};
+
+    if (wsjtxU32 (r) != WSJTX_MAGIC)
+        return (false);
+    (void) wsjtxU32 (r);                        // schema
+    m.type = wsjtxU32 (r);
+    m.id = wsjtxUTF8 (r);                       // ignore to allow clones such as JTDX
+
+    switch (m.type) {
+
+    case WM_STATUS:
+        m.status.dial_hz = wsjtxU64 (r);
+        m.status.mode = wsjtxUTF8 (r);
+        m.status.dx_call = wsjtxUTF8 (r);
+        (void) wsjtxUTF8 (r);                   // report
+        (void) wsjtxUTF8 (r);                   // Tx mode
+        (void) wsjtxBool (r);                   // Tx enabled
+        (void) wsjtxBool (r);                   // transmitting
+        (void) wsjtxBool (r);                   // decoding
+        (void) wsjtxU32 (r);                    // Rx DF
+        (void) wsjtxU32 (r);                    // Tx DF
+        m.status.de_call = wsjtxUTF8 (r);
+        m.status.de_grid = wsjtxUTF8 (r);
+        m.status.dx_grid = wsjtxUTF8 (r);
+        // remaining fields vary with schema and are not needed
+        break;
+
+    case WM_DECODE:
+        m.decode.is_new = wsjtxBool (r);
+        m.decode.ms = wsjtxU32 (r);
+        m.decode.snr = (int32_t) wsjtxU32 (r);
+        m.decode.dt = wsjtxDouble (r);
+        m.decode.df = wsjtxU32 (r);
+        m.decode.mode = wsjtxUTF8 (r);
+        m.decode.msg = wsjtxUTF8 (r);
+        if (!r.ok)
+            return (false);
+        // added in later schemas
+        m.decode.low_conf = r.bp < r.end ? wsjtxBool (r) : false;
+        m.decode.off_air = r.bp < r.end ? wsjtxBool (r) : false;
+        break;
+
+    case WM_CLEAR:
+        // window was added in later schemas
+        m.clear.window = r.bp < r.end ? wsjtxU8 (r) : 0;
+        break;
+
+    case WM_QSOLOGGED:
+        wsjtxDateTime (r, m.logged.jd_off, m.logged.ms_off);
+        m.logged.dx_call = wsjtxUTF8 (r);
+        m.logged.dx_grid = wsjtxUTF8 (r);
+        m.logged.tx_hz = wsjtxU64 (r);
+        m.logged.mode = wsjtxUTF8 (r);
+        // remaining reports, power, comments and names are not needed
+        break;
+
+    case WM_WSPRDECODE:
+        m.wspr.is_new = wsjtxBool (r);
+        m.wspr.ms = wsjtxU32 (r);
+        m.wspr.snr = (int32_t) wsjtxU32 (r);
+        m.wspr.dt = wsjtxDouble (r);
+        m.wspr.hz = wsjtxU64 (r);
+        m.wspr.drift = (int32_t) wsjtxU32 (r);
+        m.wspr.call = wsjtxUTF8 (r);
+        m.wspr.grid = wsjtxUTF8 (r);
+        m.wspr.power = (int32_t) wsjtxU32 (r);
+        if (!r.ok)
+            return (false);
+        m.wspr.off_air = r.bp < r.end ? wsjtxBool (r) : false;
+        break;
+
+    default:
+        return (false);
+    }
+
+    return (r.ok);
+}
+
+/* copy s to buf as an EOS terminated string, truncating if necessary.
+ * return buf.
+ */
+char *wsjtxStrCopy (const WSJTXStr &s, char *buf, size_t buf_len)
+{
+    size_t n = s.len < buf_len ? s.len : buf_len-1;
+    memcpy (buf, s.s, n);
+    buf[n] = '\0';
+    return (buf);
+}
+
+/* return whether s looks like a 4 character grid square, but not the RR73 sign-off.
+ */
+static bool wsjtxIsGrid (const char *s, size_t len)
+{
+    return (len == 4 && s[0] >= 'A' && s[0] <= 'R' && s[1] >= 'A' && s[1] <= 'R'
+                        && isdigit(s[2]) && isdigit(s[3]) && strncmp (s, "RR73", 4) != 0);
+}
+
+/* return whether s looks like a call sign: letters, digits and / with at least one of each of the first two.
+ */
+static bool wsjtxIsCall (const char *s, size_t len)
+{
+    if (len < 3 || len >= MAX_DXSPOTCALL_LEN)
+        return (false);
+    bool digit = false, alpha = false;
+    for (size_t i = 0; i < len; i++) {
+        if (isdigit(s[i]))
+            digit = true;
+        else if (isupper(s[i]))
+            alpha = true;
+        else if (s[i] != '/')
+            return (false);
+    }
+    return (digit && alpha);
+}
+
+/* find the transmitting station and its grid, if any, in the text of a standard FT8/FT4/JT65 message:
+ *   CQ [modifier] CALL [GRID]
+ *   TOCALL FROMCALL [GRID|report|RR73|73]
+ * hashed calls in <> are accepted without the brackets. grid is set to "" if none.
+ * return whether found.
+ */
+bool wsjtxMsgSender (const WSJTXStr &msg, char call[MAX_DXSPOTCALL_LEN], char grid[5])
+{
+    // split into at most 5 words, each a view into msg
+    const char *w[5];
+    size_t wl[5];
+    int nw = 0;
+    const char *mp = msg.s, *mend = msg.s + msg.len;
+    while (nw < 5) {
+        while (mp < mend && *mp == ' ')
+            mp++;
+        if (mp == mend)
+            break;
+        w[nw] = mp;
+        while (mp < mend && *mp != ' ')
+            mp++;
+        wl[nw] = mp - w[nw];
+        if (wl[nw] > 2 && w[nw][0] == '<' && w[nw][wl[nw]-1] == '>') {
+            w[nw]++;
+            wl[nw] -= 2;
+        }
+        nw++;
+    }
+
+    // sender is the first word with a digit after CQ and any modifier, else the second word
+    int si = -1;
+    if (nw >= 2 && ((wl[0] == 2 && strncmp (w[0], "CQ", 2) == 0) || (wl[0] == 3 && strncmp (w[0], "QRZ", 3) == 0))) {
+        for (int i = 1; i < nw && si < 0; i++)
+            if (wsjtxIsCall (w[i], wl[i]))
+                si = i;
+    } else if (nw >= 2)
+        si = 1;
+    if (si < 0 || !wsjtxIsCall (w[si], wl[si]))
+        return (false);
+
+    memcpy (call, w[si], wl[si]);
+    call[wl[si]] = '\0';
+    if (si+1 < nw && wsjtxIsGrid (w[si+1], wl[si+1])) {
+        memcpy (grid, w[si+1], 4);
+        grid[4] = '\0';
+    } else
+        grid[0] = '\0';
+
+    return (true);
+}
+
+
+#if !defined(_WSJTX_UNITTEST)
+
+/* return the spot store mode of the given WSJT-X mode, either a Status name or a Decode symbol.
+ */
+static uint8_t wsjtxSpotMode (const WSJTXStr &mode)
+{
+    static const char *symbols[][2] = {
+        {"~", "FT8"}, {"+", "FT4"}, {"#", "JT65"}, {"@", "JT9"}, {"&", "MSK144"},
+    };
+    char buf[20];
+    wsjtxStrCopy (mode, buf, sizeof(buf));
+    for (unsigned i = 0; i < NARRAY(symbols); i++)
+        if (strcmp (buf, symbols[i][0]) == 0)
+            return (spotModeFromName (symbols[i][1]));
+    uint8_t m = spotModeFromName (buf);
+    return (m ? m : spotModeFromName ("DIGI"));
+}
+
+/* turn m into a spot if possible: r.call, de_call, kHz and mode are set and the rest of r is zeroed.
+ * grid is set to the 4 character grid of r.call if known, else "".
+ * st carries the dial frequency, mode and our call from Status messages to later Decodes, init to zeros.
+ * return whether m describes a spot.
+ */
+bool wsjtxSpot (const WSJTXMsg &m, WSJTXState &st, SpotRec &r, char grid[5])
+{
+    memset (&r, 0, sizeof(r));
+    grid[0] = '\0';
+
+    switch (m.type) {
+
+    case WM_STATUS:
+        st.dial_hz = m.status.dial_hz;
+        st.mode = wsjtxSpotMode (m.status.mode);
+        wsjtxStrCopy (m.status.de_call, st.de_call, sizeof(st.de_call));
+        if (m.status.dial_hz == 0 || m.status.dx_call.len == 0 || m.status.dx_grid.len < 4
+                        || !wsjtxIsGrid (m.status.dx_grid.s, 4))
+            return (false);
+        wsjtxStrCopy (m.status.dx_call, r.call, sizeof(r.call));
+        wsjtxStrCopy (m.status.dx_grid, grid, 5);
+        r.kHz = m.status.dial_hz * 1e-3;
+        r.mode = st.mode;
+        break;
+
+    case WM_DECODE:
+        if (!m.decode.is_new || m.decode.off_air || st.dial_hz == 0
+                        || !wsjtxMsgSender (m.decode.msg, r.call, grid))
+            return (false);
+        r.kHz = (st.dial_hz + m.decode.df) * 1e-3;
+        r.mode = wsjtxSpotMode (m.decode.mode);
+        break;
+
+    case WM_WSPRDECODE:
+        if (!m.wspr.is_new || m.wspr.off_air || m.wspr.call.len == 0)
+            return (false);
+        wsjtxStrCopy (m.wspr.call, r.call, sizeof(r.call));
+        if (m.wspr.grid.len >= 4 && wsjtxIsGrid (m.wspr.grid.s, 4))
+            wsjtxStrCopy (m.wspr.grid, grid, 5);
+        r.kHz = m.wspr.hz * 1e-3;
+        r.mode = spotModeFromName ("WSPR");
+        break;
+
+    case WM_QSOLOGGED:
+        if (m.logged.dx_call.len == 0 || m.logged.tx_hz == 0)
+            return (false);
+        wsjtxStrCopy (m.logged.dx_call, r.call, sizeof(r.call));
+        if (m.logged.dx_grid.len >= 4 && wsjtxIsGrid (m.logged.dx_grid.s, 4))
+            wsjtxStrCopy (m.logged.dx_grid, grid, 5);
+        r.kHz = m.logged.tx_hz * 1e-3;
+        r.mode = wsjtxSpotMode (m.logged.mode);
+        break;
+
+    default:
+        return (false);
+    }
+
+    snprintf (r.de_call, sizeof(r.de_call), "%s", st.de_call);
+    return (true);
+}
+
+#endif // !_WSJTX_UNITTEST
+
+
+
+#ifdef _WSJTX_UNITTEST
+
+/* capture file is a sequence of packets, each preceded by its length as a 4 byte big-endian integer.
+ * real traffic can be recorded in this format with a "wsjtx port capture" line in spotfeeds.txt, see
+ * spotfeed.cpp. with -g a synthetic capture of a busy FT8 band is written first.
+ */
+
+static void putU32 (uint8_t *&bp, uint32_t x)
+{
+    *bp++ = x >> 24; *bp++ = x >> 16; *bp++ = x >> 8; *bp++ = x;
+}
+
+static void putStr (uint8_t *&bp, const char *s)
+{
+    uint32_t n = strlen(s);
+    putU32 (bp, n);
+    memcpy (bp, s, n);
+    bp += n;
+}
+
+static void writeCapture (const char *fn, int n)
+{
+    FILE *fp = fopen (fn, "w");
+    if (!fp) {
+        fprintf (stderr, "%s: %s\n", fn, strerror(errno));
+        exit(1);
+    }
+
+    static const char *pfx[] = {"K1", "W9", "DL2", "JA3", "VK4", "G0", "PY2", "ZS6", "EA8", "VE3"};
+    static const char *grids[] = {"FN42", "EN61", "JO62", "PM95", "QG62", "IO91", "GG66", "KG33", "IL18", "FN03"};
+    for (int i = 0; i < n; i++) {
+        uint8_t pkt[512], *bp = pkt;
+        putU32 (bp, 0xadbccbdaU);
+        putU32 (bp, 2);
+        if (i % 50 == 0) {
+            putU32 (bp, 1);                             // Status
+            putStr (bp, "WSJT-X");
+            putU32 (bp, 0); putU32 (bp, 14074000);
+            putStr (bp, "FT8"); putStr (bp, ""); putStr (bp, "-10"); putStr (bp, "FT8");
+            *bp++ = 0; *bp++ = 0; *bp++ = 1;
+            putU32 (bp, 1500); putU32 (bp, 1500);
+            putStr (bp, "W1AW"); putStr (bp, "FN31"); putStr (bp, "");
+        } else {
+            putU32 (bp, 2);                             // Decode
+            putStr (bp, "WSJT-X");
+            *bp++ = 1;
+            putU32 (bp, (i/20 % 5760) * 15000);
+            putU32 (bp, (uint32_t)(-20 + i%30));
+            double dt = 0.1*(i%7);
+            uint64_t dtx;
+            memcpy (&dtx, &dt, 8);
+            putU32 (bp, dtx >> 32); putU32 (bp, dtx);
+            putU32 (bp, 200 + (i*37)%2800);
+            putStr (bp, "~");
+            char msg[64];
+            int c = i % 10, s = (i/10) % 1000;
+            if (i % 3 == 0)
+                snprintf (msg, sizeof(msg), "CQ %s%c%c %s", pfx[c], 'A'+s%26, 'A'+s/26%26, grids[c]);
+            else if (i % 3 == 1)
+                snprintf (msg, sizeof(msg), "W1AW %s%c%c %s", pfx[c], 'A'+s%26, 'A'+s/26%26, grids[c]);
+            else
+                snprintf (msg, sizeof(msg), "%s%c%c <W1AW> -%02d", pfx[c], 'A'+s%26, 'A'+s/26%26, i%20);
+            putStr (bp, msg);
+            *bp++ = 0; *bp++ = 0;
+        }
+        uint8_t len[4], *lp = len;
+        putU32 (lp, bp - pkt);
+        fwrite (len, 4, 1, fp);
+        fwrite (pkt, bp - pkt, 1, fp);
+    }
+    fclose (fp);
+}
+
+int main (int ac, char *av[])
+{
+    if (ac == 4 && strcmp (av[1], "-g") == 0) {
+        writeCapture (av[2], atoi(av[3]));
+        ac = 2;
+        av[1] = av[2];
+    }
+    if (ac != 2) {
+        fprintf (stderr, "Usage: %s [-g n] capture\n", av[0]);
+        return (1);
+    }
+
+    // load whole capture
+    FILE *fp = fopen (av[1], "r");
+    if (!fp) {
+        fprintf (stderr, "%s: %s\n", av[1], strerror(errno));
+        return (1);
+    }
+    fseek (fp, 0, SEEK_END);
+    long n_cap = ftell (fp);
+    rewind (fp);
+    uint8_t *cap = (uint8_t *) malloc (n_cap);
+    if (fread (cap, 1, n_cap, fp) != (size_t)n_cap) {
+        fprintf (stderr, "%s: short read\n", av[1]);
+        return (1);
+    }
+    fclose (fp);
+
+    // replay repeatedly
+    const int NREP = 20;
+    int n_pkts = 0, n_status = 0, n_decode = 0, n_spots = 0, n_bad = 0;
+    char call[MAX_DXSPOTCALL_LEN], grid[5];
+    struct timespec t0, t1;
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+    for (int rep = 0; rep < NREP; rep++) {
+        for (long i = 0; i + 4 <= n_cap; ) {
+            uint32_t len = (cap[i] << 24) | (cap[i+1] << 16) | (cap[i+2] << 8) | cap[i+3];
+            i += 4;
+            if (i + len > (uint32_t)n_cap)
+                break;
+            WSJTXMsg m;
+            n_pkts++;
+            if (!wsjtxDecode (cap+i, len, m))
+                n_bad++;
+            else if (m.type == WM_STATUS)
+                n_status++;
+            else if (m.type == WM_DECODE) {
+                n_decode++;
+                if (wsjtxMsgSender (m.decode.msg, call, grid))
+                    n_spots++;
+            }
+            i += len;
+        }
+    }
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + 1e-9*(t1.tv_nsec - t0.tv_nsec);
+
+    printf ("%d packets: %d Status %d Decode %d spots %d rejected\n", n_pkts, n_status, n_decode, n_spots, n_bad);
+    printf ("%.3f us/packet, %.0f packets/sec, %.1f MB/s\n", 1e6*secs/n_pkts, n_pkts/secs, NREP*n_cap/secs/1e6);
+
+    // decode every truncation of the first packets, build with -fsanitize=address to check none read past end.
+    // some are legitimately accepted because trailing fields are optional.
+    uint8_t *copy = (uint8_t *) malloc (1024);
+    int n_trunc_ok = 0;
+    for (long i = 0; i + 4 <= n_cap && i < 50000; ) {
+        uint32_t len = (cap[i] << 24) | (cap[i+1] << 16) | (cap[i+2] << 8) | cap[i+3];
+        i += 4;
+        for (uint32_t l = 0; l < len; l++) {
+            WSJTXMsg m;
+            memcpy (copy, cap+i, l);
+            if (wsjtxDecode (copy, l, m) && m.type != WM_CLEAR)
+                n_trunc_ok++;
+        }
+        i += len;
+    }
+    printf ("truncated packets accepted: %d\n", n_trunc_ok);
+
+    free (copy);
+    free (cap);
+
+    return (0);
+}
+
+#endif // _WSJTX_UNITTEST
@@ -0,0 +1,71 @@
+#ifndef _WSJTX_H
+#define _WSJTX_H
+
+/* WSJT-X UDP message types and decoder, see wsjtx.cpp.
+ * shared by HamClock.h and the stand-alone _WSJTX_UNITTEST build so both see the same layout.
+ * N.B. MAX_DXSPOTCALL_LEN must be defined before including this file.
+ */
+
+// string within a packet, not EOS terminated
+typedef struct {
+    const char *s;
+    uint32_t len;
+} WSJTXStr;
+
+// message types we decode
+typedef enum {
+    WM_HEARTBEAT  = 0,
+    WM_STATUS     = 1,
+    WM_DECODE     = 2,
+    WM_CLEAR      = 3,
+    WM_QSOLOGGED  = 5,
+    WM_WSPRDECODE = 10,
+} WSJTXMsgType;
+
+// one decoded message, fields depend on type
+typedef struct {
+    uint32_t type;                      // WSJTXMsgType
+    WSJTXStr id;                        // sending program
+    union {
+        struct {
+            uint64_t dial_hz;
+            WSJTXStr mode, dx_call, de_call, de_grid, dx_grid;
+        } status;
+        struct {
+            bool is_new, low_conf, off_air;
+            uint32_t ms;                // ms since UTC midnight
+            int32_t snr;
+            double dt;
+            uint32_t df;                // Hz above dial
+            WSJTXStr mode, msg;
+        } decode;
+        struct {
+            uint8_t window;
+        } clear;
+        struct {
+            int64_t jd_off;             // julian day of QSO end
+            uint32_t ms_off;            // ms since midnight of QSO end
+            WSJTXStr dx_call, dx_grid;
+            uint64_t tx_hz;
+            WSJTXStr mode;
+        } logged;
+        struct {
+            bool is_new, off_air;
+            uint32_t ms;                // ms since UTC midnight
+            int32_t snr;
+            double dt;
+            uint64_t hz;
+            int32_t drift;
+            WSJTXStr call, grid;
+            int32_t power;
+        } wspr;
+    };
+} WSJTXMsg;
+
+#define WSJTX_MAXPKT    1500            // largest packet we accept
+
+extern bool wsjtxDecode (const uint8_t *pkt, int len, WSJTXMsg &m);
+extern char *wsjtxStrCopy (const WSJTXStr &s, char *buf, size_t buf_len);
+extern bool wsjtxMsgSender (const WSJTXStr &msg, char call[MAX_DXSPOTCALL_LEN], char grid[5]);
+
+#endif // _WSJTX_H